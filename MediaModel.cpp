@@ -94,6 +94,22 @@ MediaModel::InsertMedia(const ModelMedia& media) {
 	endInsertRows();
 }
 
+void
+MediaModel::InsertMediaList(const QVector<ModelMedia>& media_list) {
+	if (media_list.empty()) {
+		return;
+	}
+
+	beginInsertRows(QModelIndex(), model_media_vec.size(), model_media_vec.size() + media_list.size() - 1);
+
+	model_media_vec.append(media_list);
+	for (const ModelMedia& media : media_list) {
+		media_id_set.insert(media.id);
+	}
+
+	endInsertRows();
+}
+
 void
 MediaModel::RemoveMeida(const unsigned int media_id) {
 	int index = GetMediaIndexById(media_id);
@@ -103,6 +119,42 @@ MediaModel::RemoveMeida(const unsigned int media_id) {
 	media_id_set.remove(media_id);
 }
 
+void
+MediaModel::RemoveMediaList(const QVector<unsigned int>& media_id_list) {
+
+	//one pass to find rows instead of a lookup per media
+	QSet<unsigned int> remove_id_set;
+	for (unsigned int media_id : media_id_list) {
+		if (media_id_set.remove(media_id)) {
+			remove_id_set.insert(media_id);
+		}
+	}
+
+	if (remove_id_set.empty()) {
+		return;
+	}
+
+	//remove from the back so earlier row numbers stay valid, adjacent rows go out together
+	int row = model_media_vec.size() - 1;
+	while (row >= 0) {
+		if (!remove_id_set.contains(model_media_vec[row].id)) {
+			row--;
+			continue;
+		}
+
+		int last_row = row;
+		while (row > 0 && remove_id_set.contains(model_media_vec[row - 1].id)) {
+			row--;
+		}
+
+		beginRemoveRows(QModelIndex(), row, last_row);
+		model_media_vec.remove(row, last_row - row + 1);
+		endRemoveRows();
+
+		row--;
+	}
+}
+
 void 
 MediaModel::UpdateMediaName(const unsigned int media_id, const QString& new_name) {
 	int index = GetMediaIndexById(media_id);
@@ -120,6 +172,13 @@ MediaModel::UpdateMediaSubdir(const unsigned int media_id, const QString& new_su
 	//don't need to emit anything since no display data has been changed
 }
 
+void
+MediaModel::UpdateMediaHash(const unsigned int media_id, const QString& new_hash) {
+	int index = GetMediaIndexById(media_id);
+	model_media_vec[index].hash = new_hash;
+	//hash is not displayed
+}
+
 void 
 MediaModel::GetMediaFullPathByIndex(const QModelIndex& index, QString* out) {
 	*out = model_media_vec[index.row()].GetAbsPath();
@@ -41,9 +41,12 @@ public:
 
 	void Reset();
 	void InsertMedia(const ModelMedia& new_media);
+	void InsertMediaList(const QVector<ModelMedia>& new_media_list);
 	void RemoveMeida(const unsigned int media_id);
+	void RemoveMediaList(const QVector<unsigned int>& media_id_list);
 	void UpdateMediaName(const unsigned int media_id, const QString& new_name);
 	void UpdateMediaSubdir(const unsigned int media_id, const QString& new_subdir);
+	void UpdateMediaHash(const unsigned int media_id, const QString& new_hash);
 
 	void GetMediaFullPathByIndex(const QModelIndex&, QString*);
 
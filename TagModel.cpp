@@ -211,6 +211,32 @@ TagModel::DecTagMediaCount(const unsigned int tag_id) {
 	emit dataChanged(createIndex(index, 1), createIndex(index, 1));
 }
 
+void
+TagModel::AddTagMediaCounts(const QHash<unsigned int, int>& delta_table) {
+	int first_index = -1;
+	int last_index = -1;
+
+	for (int index = 0; index < model_tag_vec.size(); index++) {
+		auto iter = delta_table.constFind(model_tag_vec[index].id);
+		if (iter == delta_table.constEnd()) {
+			continue;
+		}
+
+		model_tag_vec[index].media_count += *iter;
+
+		if (first_index < 0) {
+			first_index = index;
+		}
+		last_index = index;
+	}
+
+	if (first_index < 0) {
+		return;
+	}
+
+	emit dataChanged(createIndex(first_index, 1), createIndex(last_index, 1));
+}
+
 void			
 TagModel::GetAllTags() {
 
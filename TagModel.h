@@ -30,6 +30,7 @@ public:
 	void			UpdateTagName(const unsigned int, const QString&);
 	void			IncTagMediaCount(const unsigned int);
 	void			DecTagMediaCount(const unsigned int);
+	void			AddTagMediaCounts(const QHash<unsigned int, int>& delta_table);	//one pass and one dataChanged for many tags
 
 	void			GetAllTags();
 	void			GetTagIdByIndex(const QModelIndex&, unsigned int*);
@@ -0,0 +1,184 @@
+#include "api_events.h"
+
+#include <iterator>
+
+APIEventQueue::APIEventQueue(int capacity /*= API_EVENT_QUEUE_MAX*/) :
+	capacity(qMax(capacity, 1)),
+	resync_pending(false),
+	last_seq(0)
+{
+}
+
+void
+APIEventQueue::Push(const APIEvent& event) {
+	if (resync_pending || event.type == APIEvent::RESYNC) {
+		return;
+	}
+
+	if (Fold(event)) {
+		return;
+	}
+
+	if ((int) event_list.size() >= capacity) {
+		event_list.clear();
+		key_table.clear();
+		resync_pending = true;
+		return;
+	}
+
+	Append(event);
+}
+
+bool
+APIEventQueue::HasEvent() const {
+	return resync_pending || !event_list.empty();
+}
+
+APIEvent
+APIEventQueue::Take() {
+	APIEvent event;
+
+	if (resync_pending) {
+		resync_pending = false;
+	}
+	else {
+		event = event_list.front();
+
+		EventKey key = GetKey(event);
+		auto iter = key_table.find(key);
+		if (iter != key_table.end() && iter.value() == event_list.begin()) {
+			key_table.erase(iter);
+		}
+
+		event_list.pop_front();
+	}
+
+	event.seq = ++last_seq;
+
+	return event;
+}
+
+int
+APIEventQueue::Size() const {
+	return (int) event_list.size() + (resync_pending ? 1 : 0);
+}
+
+quint64
+APIEventQueue::LastSeq() const {
+	return last_seq;
+}
+
+//private
+
+//static
+APIEventQueue::EventKey
+APIEventQueue::GetKey(const APIEvent& event) {
+	switch (event.type) {
+	case APIEvent::TAG_INSERTED:
+	case APIEvent::TAG_NAME_UPDATED:
+	case APIEvent::TAG_REMOVED:
+		return { event.type, event.tag_id, 0 };
+	case APIEvent::LINK_FORMED:
+	case APIEvent::LINK_DESTROYED:
+		return { APIEvent::LINK_FORMED, event.tag_id, event.media_id };
+	default:
+		return { event.type, 0, event.media_id };
+	}
+}
+
+bool
+APIEventQueue::Fold(const APIEvent& event) {
+
+	switch (event.type) {
+	case APIEvent::TAG_NAME_UPDATED:
+	case APIEvent::MEDIA_TAGLESS:
+	case APIEvent::MEDIA_NAME_UPDATED:
+	case APIEvent::MEDIA_SUBDIR_UPDATED:
+	case APIEvent::MEDIA_HASH_UPDATED: {
+
+		auto iter = key_table.find(GetKey(event));
+		if (iter == key_table.end()) {
+			return false;
+		}
+
+		iter.value()->value = event.value;
+		iter.value()->media = event.media;
+		return true;
+	}
+	case APIEvent::LINK_FORMED:
+	case APIEvent::LINK_DESTROYED: {
+
+		auto iter = key_table.find(GetKey(event));
+		if (iter == key_table.end()) {
+			return false;
+		}
+
+		//same one twice, keep the first
+		if (iter.value()->type == event.type) {
+			return true;
+		}
+
+		//a tagless record queued in between would be wrong without both
+		if (key_table.contains({ APIEvent::MEDIA_TAGLESS, 0, event.media_id })) {
+			return false;
+		}
+
+		event_list.erase(iter.value());
+		key_table.erase(iter);
+		return true;
+	}
+	case APIEvent::TAG_REMOVED: {
+
+		Drop({ APIEvent::TAG_NAME_UPDATED, event.tag_id, 0 });
+
+		for (auto iter = event_list.begin(); iter != event_list.end();) {
+			if ((iter->type == APIEvent::LINK_FORMED || iter->type == APIEvent::LINK_DESTROYED) && iter->tag_id == event.tag_id) {
+				key_table.remove(GetKey(*iter));
+				iter = event_list.erase(iter);
+			}
+			else {
+				iter++;
+			}
+		}
+
+		//client never heard of the tag
+		EventKey inserted_key = { APIEvent::TAG_INSERTED, event.tag_id, 0 };
+		if (key_table.contains(inserted_key)) {
+			Drop(inserted_key);
+			return true;
+		}
+
+		return false;
+	}
+	case APIEvent::MEDIA_REMOVED:
+
+		Drop({ APIEvent::MEDIA_TAGLESS, 0, event.media_id });
+		Drop({ APIEvent::MEDIA_NAME_UPDATED, 0, event.media_id });
+		Drop({ APIEvent::MEDIA_SUBDIR_UPDATED, 0, event.media_id });
+		Drop({ APIEvent::MEDIA_HASH_UPDATED, 0, event.media_id });
+		return false;
+	default:
+		return false;
+	}
+}
+
+void
+APIEventQueue::Drop(const EventKey& key) {
+	auto iter = key_table.find(key);
+	if (iter == key_table.end()) {
+		return;
+	}
+
+	event_list.erase(iter.value());
+	key_table.erase(iter);
+}
+
+void
+APIEventQueue::Append(const APIEvent& event) {
+	event_list.push_back(event);
+
+	//removals are never folded into
+	if (event.type != APIEvent::TAG_REMOVED && event.type != APIEvent::MEDIA_REMOVED) {
+		key_table.insert(GetKey(event), std::prev(event_list.end()));
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+	Daemon change events waiting to be pushed to one subscribed API client
+
+	Every subscriber has its own queue so a slow client never holds back the
+	others. Events are folded while they wait, a client only needs to end up
+	with the same state it would have reached by seeing every one of them:
+
+		*_UPDATED on a queued *_UPDATED of the same type and id
+								replaces its value in place
+		MEDIA_TAGLESS on a queued MEDIA_TAGLESS of the same media
+								replaces the record in place
+		LINK_FORMED/LINK_DESTROYED on a queued opposite of the same link
+								both dropped, unless a tagless record of the media is queued
+		TAG_REMOVED				drops queued name update and links of the tag,
+								a queued TAG_INSERTED of the tag is dropped along with it
+		MEDIA_REMOVED			drops queued updates and tagless record of the media
+
+	Sequence numbers are handed out as events are taken, so a client sees them
+	without gaps. When folding can't keep the queue under capacity everything
+	queued is dropped and the next event taken is RESYNC, the client has to
+	fetch state again. Events pushed before that RESYNC is taken are dropped
+	too since the fetch covers them.
+*/
+
+#include <QString>
+#include <QHash>
+
+#include <list>
+
+#include "media_structs.h"
+
+#define API_EVENT_QUEUE_MAX		4096
+
+struct APIEvent {
+
+	enum Type {
+		TAG_INSERTED,
+		TAG_NAME_UPDATED,
+		TAG_REMOVED,
+		MEDIA_TAGLESS,			//media added or lost its last tag
+		MEDIA_REMOVED,
+		MEDIA_NAME_UPDATED,
+		MEDIA_SUBDIR_UPDATED,
+		MEDIA_HASH_UPDATED,
+		LINK_FORMED,
+		LINK_DESTROYED,
+		RESYNC					//only ever taken, never pushed
+	};
+
+	Type			type = RESYNC;
+	unsigned int	tag_id = 0;
+	unsigned int	media_id = 0;
+	QString			value;		//tag name, media name, subdir or hash
+	ModelMedia		media;		//MEDIA_TAGLESS only
+	quint64			seq = 0;	//set when taken
+};
+
+class APIEventQueue {
+public:
+	APIEventQueue(int capacity = API_EVENT_QUEUE_MAX);
+
+	void		Push(const APIEvent& event);
+	bool		HasEvent() const;
+	APIEvent	Take();				//HasEvent must be true
+
+	int			Size() const;
+	quint64		LastSeq() const;	//seq of the last event taken, 0 if none
+
+private:
+	struct EventKey {
+		int				kind;		//event type, both link types share LINK_FORMED
+		unsigned int	tag_id;
+		unsigned int	media_id;
+
+		bool operator==(const EventKey& other) const {
+			return kind == other.kind && tag_id == other.tag_id && media_id == other.media_id;
+		}
+	};
+
+	friend uint qHash(const EventKey& key, uint seed) {
+		return qHash(key.kind, seed) ^ (qHash(key.tag_id, seed) * 31) ^ (qHash(key.media_id, seed) * 961);
+	}
+
+	typedef std::list<APIEvent>::iterator EventIter;
+
+	int							capacity;
+	std::list<APIEvent>			event_list;		//oldest first
+	QHash<EventKey, EventIter>	key_table;		//every queued event that can be folded
+	bool						resync_pending;
+	quint64						last_seq;
+
+	static EventKey	GetKey(const APIEvent& event);
+
+	bool	Fold(const APIEvent& event);	//true if event was absorbed by what is queued
+	void	Drop(const EventKey& key);
+	void	Append(const APIEvent& event);
+};
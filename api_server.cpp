@@ -1,4 +1,6 @@
 #include "api_server.h"
+#include "metrics.h"
+#include "stats.h"
 
 #include <QStringBuilder>
 #include <QJsonDocument>
@@ -7,6 +9,10 @@
 #include <QDebug>
 #include <QList>
 #include <QVariant>
+#include <QFutureWatcher>
+#include <QtEndian>
+#include <QCborValue>
+#include <QtConcurrent>
 
 //static
 QString
@@ -21,24 +27,82 @@ APIServerWorker::GetCommandString(const APICommand cmd) {
 		"UPDATE TAG",
 		"DELETE TAG",
 		"GET MEDIA",
-		"GET ROOT DIR"
+		"GET ROOT DIR",
+		"GET DUPLICATES",
+		"GET DIR STATS",
+		"SUBSCRIBE",
+		"UNSUBSCRIBE",
+		"EVENT",
+		"LINK",
+		"UNLINK",
+		"BATCH",
+		"NOT MODIFIED",
+		"STATS"
 	};
 
-	return str_list[ static_cast<int>(cmd)];
+	return str_list.value(static_cast<int>(cmd), "UNKNOWN");
+}
+
+//static
+bool
+APIServerWorker::IsReadOnlyCommand(const APICommand cmd) {
+	switch (cmd) {
+	case APICommand::CMD_GETALLTAG:
+	case APICommand::CMD_GETTAG:
+	case APICommand::CMD_GETMEDIA:
+	case APICommand::CMD_GETROOTDIR:
+	case APICommand::CMD_GETDUPLICATES:
+	case APICommand::CMD_GETDIRSTATS:
+	case APICommand::CMD_STATS:
+		return true;
+	default:
+		return false;
+	}
 }
 
 APIServerWorker::APIServerWorker(Daemon* daemon) :
 	daemon(daemon),
-	pipe_server(this)
+	pipe_server(this),
+	shared_index_timer(this)
 {
+	shared_index_timer.setSingleShot(true);
+	shared_index_timer.setInterval(SHARED_INDEX_PUBLISH_DELAY_MSEC);
 }
 
 void
 APIServerWorker::WorkerMain() {
 
-	
+	Metrics::SetThreadName("api");
+
 	connect(&pipe_server, &QLocalServer::newConnection, this, &APIServerWorker::OnNewConnection);
 
+	connect(daemon, &Daemon::TagInserted, this, &APIServerWorker::OnDaemonTagInserted);
+	connect(daemon, &Daemon::TagNameUpdated, this, &APIServerWorker::OnDaemonTagNameUpdated);
+	connect(daemon, &Daemon::TagRemoved, this, &APIServerWorker::OnDaemonTagRemoved);
+	connect(daemon, &Daemon::TaglessMediaInserted, this, &APIServerWorker::OnDaemonTaglessMediaInserted);
+	connect(daemon, &Daemon::MediaRemoved, this, &APIServerWorker::OnDaemonMediaRemoved);
+	connect(daemon, &Daemon::MediaNameUpdated, this, &APIServerWorker::OnDaemonMediaNameUpdated);
+	connect(daemon, &Daemon::MediaSubdirUpdated, this, &APIServerWorker::OnDaemonMediaSubdirUpdated);
+	connect(daemon, &Daemon::MediaHashUpdated, this, &APIServerWorker::OnDaemonMediaHashUpdated);
+	connect(daemon, &Daemon::MediaBatchApplied, this, &APIServerWorker::OnDaemonMediaBatchApplied);
+	connect(daemon, &Daemon::LinkFormed, this, &APIServerWorker::OnDaemonLinkFormed);
+	connect(daemon, &Daemon::LinksFormed, this, &APIServerWorker::OnDaemonLinksFormed);
+	connect(daemon, &Daemon::LinkDestroyed, this, &APIServerWorker::OnDaemonLinkDestroyed);
+
+	connect(daemon, &Daemon::Initialized, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(daemon, &Daemon::TagInserted, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(daemon, &Daemon::TagNameUpdated, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(daemon, &Daemon::TagRemoved, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(daemon, &Daemon::MediaRemoved, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(daemon, &Daemon::MediaBatchApplied, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(daemon, &Daemon::LinkFormed, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(daemon, &Daemon::LinksFormed, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(daemon, &Daemon::LinkDestroyed, this, &APIServerWorker::OnDaemonIndexChanged);
+	connect(&shared_index_timer, &QTimer::timeout, this, &APIServerWorker::PublishSharedIndex);
+
+	//daemon may have finished initializing before the connections above were made
+	PublishSharedIndex();
+
 	if (!pipe_server.listen("\\\\.\\pipe\\" % QString(PIPE_NAME))) {
 		Logger::Log(pipe_server.errorString(), LogEntry::LT_ERROR);
 		return;
@@ -51,10 +115,15 @@ void
 APIServerWorker::OnCleanup() {
 	
 	pipe_server.close();
-	if (curr_pipe_client != nullptr) {
-		curr_pipe_client->disconnectFromServer();
+	shared_index_timer.stop();
+
+	//disconnecting removes from the table
+	for (const std::shared_ptr<APIConnection>& connection : connection_table.values()) {
+		connection->socket->disconnectFromServer();
 	}
 
+	read_pool.waitForDone();
+
 	thread()->quit();
 }
 
@@ -62,24 +131,231 @@ APIServerWorker::OnCleanup() {
 //private slots
 void
 APIServerWorker::OnNewConnection() {
-	QLocalSocket *tmp_pipe_client = pipe_server.nextPendingConnection();
-	//connect(tmp_pipe_client, &QLocalSocket::disconnected, tmp_pipe_client, &QLocalSocket::deleteLater);		
-	connect(tmp_pipe_client, &QLocalSocket::disconnected, [tmp_pipe_client, this] { OnClientDisconnected(tmp_pipe_client); });
-	Logger::Log("New pipe client connected", LogEntry::LT_APISERVER);
+	while (pipe_server.hasPendingConnections()) {
+
+		std::shared_ptr<APIConnection> connection = std::make_shared<APIConnection>();
+		connection->id = next_connection_id++;
+		connection->socket = pipe_server.nextPendingConnection();
+
+		connection_table.insert(connection->socket, connection);
+
+		connect(connection->socket, &QLocalSocket::disconnected, this, [this, connection] { OnClientDisconnected(connection); });
+		connect(connection->socket, &QLocalSocket::readyRead, this, [this, connection] { OnClientReadyRead(connection); });
+		connect(connection->socket, &QLocalSocket::bytesWritten, this, [this, connection] { OnClientBytesWritten(connection); });
+
+		Logger::Log("New pipe client " % QString::number(connection->id) % " connected, " % QString::number(connection_table.size()) % " connected", LogEntry::LT_APISERVER);
+	}
+
+	UpdateConnectionMetrics();
+}
+
+void
+APIServerWorker::OnDaemonTagInserted(const ModelTag& new_model_tag) {
+	APIEvent event;
+	event.type = APIEvent::TAG_INSERTED;
+	event.tag_id = new_model_tag.id;
+	event.value = new_model_tag.name;
+	Publish(event);
+}
+
+void
+APIServerWorker::OnDaemonTagNameUpdated(const unsigned int tag_id, const QString& new_name) {
+	APIEvent event;
+	event.type = APIEvent::TAG_NAME_UPDATED;
+	event.tag_id = tag_id;
+	event.value = new_name;
+	Publish(event);
+}
+
+void
+APIServerWorker::OnDaemonTagRemoved(const unsigned int tag_id) {
+	APIEvent event;
+	event.type = APIEvent::TAG_REMOVED;
+	event.tag_id = tag_id;
+	Publish(event);
+}
 
-	if (curr_pipe_client != nullptr) {
-		curr_pipe_client->disconnectFromServer();
+void
+APIServerWorker::OnDaemonTaglessMediaInserted(const ModelMedia& new_model_media) {
+	APIEvent event;
+	event.type = APIEvent::MEDIA_TAGLESS;
+	event.media_id = new_model_media.id;
+	event.media = new_model_media;
+	Publish(event);
+}
+
+void
+APIServerWorker::OnDaemonMediaRemoved(const unsigned int media_id) {
+	APIEvent event;
+	event.type = APIEvent::MEDIA_REMOVED;
+	event.media_id = media_id;
+	Publish(event);
+}
+
+void
+APIServerWorker::OnDaemonMediaNameUpdated(const unsigned int media_id, const QString& new_name) {
+	APIEvent event;
+	event.type = APIEvent::MEDIA_NAME_UPDATED;
+	event.media_id = media_id;
+	event.value = new_name;
+	Publish(event);
+}
+
+void
+APIServerWorker::OnDaemonMediaSubdirUpdated(const unsigned int media_id, const QString& new_subdir) {
+	APIEvent event;
+	event.type = APIEvent::MEDIA_SUBDIR_UPDATED;
+	event.media_id = media_id;
+	event.value = new_subdir;
+	Publish(event);
+}
+
+void
+APIServerWorker::OnDaemonMediaHashUpdated(const unsigned int media_id, const QString& new_hash) {
+	APIEvent event;
+	event.type = APIEvent::MEDIA_HASH_UPDATED;
+	event.media_id = media_id;
+	event.value = new_hash;
+	Publish(event);
+}
+
+//same order gui applies a batch in
+void
+APIServerWorker::OnDaemonMediaBatchApplied(const ModelMediaBatch& batch) {
+	if (subscriber_count == 0) {
+		return;
+	}
+
+	for (const auto& link : batch.link_destroyed_list) {
+		OnDaemonLinkDestroyed(link.first, link.second);
+	}
+
+	for (unsigned int media_id : batch.removed_id_list) {
+		OnDaemonMediaRemoved(media_id);
 	}
 
-	curr_pipe_client = tmp_pipe_client;
-	connect(curr_pipe_client, &QLocalSocket::readyRead, this, &APIServerWorker::OnClientReadyRead);
+	for (const ModelMedia& m_media : batch.inserted_list) {
+		OnDaemonTaglessMediaInserted(m_media);
+	}
+
+	for (const auto& link : batch.link_formed_list) {
+		OnDaemonLinkFormed(link.first, link.second);
+	}
 }
 
+void
+APIServerWorker::OnDaemonLinkFormed(const ModelTag& model_tag, const unsigned int media_id) {
+	APIEvent event;
+	event.type = APIEvent::LINK_FORMED;
+	event.tag_id = model_tag.id;
+	event.media_id = media_id;
+	Publish(event);
+}
+
+void
+APIServerWorker::OnDaemonLinksFormed(const ModelLinkBatch& batch) {
+	if (subscriber_count == 0) {
+		return;
+	}
+
+	for (const auto& link : batch.link_list) {
+		APIEvent event;
+		event.type = APIEvent::LINK_FORMED;
+		event.tag_id = link.first;
+		event.media_id = link.second;
+		Publish(event);
+	}
+}
+
+void
+APIServerWorker::OnDaemonLinkDestroyed(const unsigned int tag_id, const unsigned int media_id) {
+	APIEvent event;
+	event.type = APIEvent::LINK_DESTROYED;
+	event.tag_id = tag_id;
+	event.media_id = media_id;
+	Publish(event);
+}
+
+void
+APIServerWorker::OnDaemonIndexChanged() {
+	if (!shared_index_timer.isActive()) {
+		shared_index_timer.start();
+	}
+}
+
+void
+APIServerWorker::PublishSharedIndex() {
+
+	//half loaded tags would look like missing ones, Initialized brings us back here
+	if (!daemon->IsInitialized()) {
+		return;
+	}
+
+	QVector<Tag> tag_list;
+	quint64 generation = daemon->GetTagSnapshot(&tag_list);
+
+	//changes that don't touch tags still move the generation, but a repeat means nothing happened at all
+	if (generation == shared_index_publisher.GetPublishedGeneration()) {
+		return;
+	}
+
+	if (shared_index_publisher.Publish(SharedIndex::Serialize(generation, tag_list), generation) < 0) {
+		Logger::Log("Failed publishing shared index: " % shared_index_publisher.GetLastError(), LogEntry::LT_ERROR);
+	}
+}
+
+//private
+
 void 
-APIServerWorker::OnClientReadyRead() {
-	QString tmp_log_str = "New payload recved";
+APIServerWorker::OnClientReadyRead(const std::shared_ptr<APIConnection>& connection) {
 	
-	QByteArray payload = curr_pipe_client->readAll();
+	connection->read_buffer.append(connection->socket->readAll());
+
+	if (connection->read_buffer.isEmpty()) {
+		return;
+	}
+
+	if (connection->framing == APIConnection::UNKNOWN) {
+		char first_char = connection->read_buffer[0];
+		bool legacy = first_char == '{' || first_char == ' ' || first_char == '\t' || first_char == '\r' || first_char == '\n';
+
+		connection->framing = legacy ? APIConnection::LEGACY : APIConnection::FRAMED;
+	}
+
+	if (connection->framing == APIConnection::LEGACY) {
+		QueueRequest(connection, connection->read_buffer);
+		connection->read_buffer.clear();
+	}
+	else {
+		//every complete frame, the partial one at the end stays for the next read
+		int offset = 0;
+		while (connection->read_buffer.size() - offset >= API_FRAME_HEADER_SIZE) {
+
+			quint32 frame_size = qFromBigEndian<quint32>(connection->read_buffer.constData() + offset);
+			if (frame_size > API_MAX_FRAME_SIZE) {
+				Logger::Log("Client " % QString::number(connection->id) % " sent a frame of " % QString::number(frame_size) % " bytes, disconnecting", LogEntry::LT_APISERVER);
+				connection->socket->disconnectFromServer();
+				return;
+			}
+
+			if (connection->read_buffer.size() - offset - API_FRAME_HEADER_SIZE < (int) frame_size) {
+				break;
+			}
+
+			QueueRequest(connection, connection->read_buffer.mid(offset + API_FRAME_HEADER_SIZE, frame_size));
+			offset += API_FRAME_HEADER_SIZE + frame_size;
+		}
+
+		connection->read_buffer.remove(0, offset);
+	}
+
+	Dispatch(connection);
+	Flush(*connection);
+}
+
+void
+APIServerWorker::QueueRequest(const std::shared_ptr<APIConnection>& connection, const QByteArray& payload) {
+	QString tmp_log_str = "New payload recved from client " % QString::number(connection->id);
 
 	if (payload.size() < 500) {
 		tmp_log_str.append(": " % QString(payload));
@@ -90,33 +366,72 @@ APIServerWorker::OnClientReadyRead() {
 
 	Logger::Log(tmp_log_str, LogEntry::LT_APISERVER);
 
-	ProcessPayload(payload);
+	std::shared_ptr<APIRequest> request = std::make_shared<APIRequest>();
+	ParsePayload(payload, request.get());
+
+	//legacy clients have no header to tell encodings apart, they always get json
+	//and can't tell chunks apart either
+	if (connection->framing == APIConnection::LEGACY) {
+		request->encoding = APIRequest::JSON;
+		request->stream = false;
+	}
+
+	connection->request_queue.push_back(request);
 }
 
 void 
-APIServerWorker::OnClientDisconnected(QLocalSocket* socket) {
-	socket->deleteLater();	//free up object memory next time enters event loop
-	if (curr_pipe_client == socket) {
-		curr_pipe_client = nullptr;
+APIServerWorker::OnClientDisconnected(const std::shared_ptr<APIConnection>& connection) {
+	if (connection->socket == nullptr) {
+		return;
 	}
+
+	connection_table.remove(connection->socket);
+
+	connection->socket->deleteLater();	//free up object memory next time enters event loop
+	connection->socket = nullptr;
+	connection->request_queue.clear();
+
+	if (connection->event_queue) {
+		connection->event_queue.reset();
+		subscriber_count--;
+	}
+
+	UpdateConnectionMetrics();
+
+	Logger::Log("Pipe client " % QString::number(connection->id) % " disconnected", LogEntry::LT_APISERVER);
+}
+
+//socket drained some, streams waiting on it can write more
+void
+APIServerWorker::OnClientBytesWritten(const std::shared_ptr<APIConnection>& connection) {
+	if (connection->socket == nullptr) {
+		return;
+	}
+
+	Flush(*connection);
 }
 
+void
+APIServerWorker::UpdateConnectionMetrics() {
+	Metrics::Set(Metrics::API_CONNECTION_COUNT, connection_table.size());
+	Metrics::Set(Metrics::API_SUBSCRIBER_COUNT, subscriber_count);
+}
+
+//a payload that can not be parsed becomes a request that is already done with an error response
 void 
-APIServerWorker::ProcessPayload(const QByteArray& payload) {
+APIServerWorker::ParsePayload(const QByteArray& payload, APIRequest* out) {
 	QJsonObject json;
-	QJsonValue result;
-	QList<QVariant> args;
 
 	{
 		QJsonDocument json_doc = QJsonDocument::fromJson(payload);
 		if (json_doc.isNull()) {
 			Logger::Log("Error parsing payload into json", LogEntry::LT_APISERVER);
-			goto send_error;
+			goto parse_error;
 		}
 
 		if (!json_doc.isObject()) {
 			Logger::Log("Error payload is not a json object", LogEntry::LT_APISERVER);
-			goto send_error;
+			goto parse_error;
 		}
 
 		json = json_doc.object();
@@ -124,61 +439,506 @@ APIServerWorker::ProcessPayload(const QByteArray& payload) {
 
 	if (!json.contains("cmd")) {
 		Logger::Log("Error payload doesn't contain a command", LogEntry::LT_APISERVER);
-		goto send_error;
+		goto parse_error;
 	}
 
-	APICommand cmd = static_cast<APICommand>(json.value("cmd").toInt(0));	//default to 0 (ERROR) if can't be parsed to int
-	Logger::Log("Recv command: " % GetCommandString(cmd), LogEntry::LT_APISERVER);
+	out->cmd = static_cast<APICommand>(json.value("cmd").toInt(0));	//default to 0 (ERROR) if can't be parsed to int
+	out->rid = json.value("rid");
+	out->encoding = json.value("enc").toString() == "cbor" ? APIRequest::CBOR : APIRequest::JSON;
+	out->columnar = json.value("layout").toString() == "columnar";
+	out->stream = out->cmd == APICommand::CMD_GETMEDIA && json.value("stream").toBool();
+	out->if_none_match = (quint64) json.value("inm").toDouble(0);		//exact below 2^53, generations stay far below
 
 	if (json.contains("args")) {
-		args = json.value("args").toArray().toVariantList();
+		out->args = json.value("args").toArray().toVariantList();
 	}
 
-	switch (cmd) {
-	case APICommand::CMD_GETALLTAG:
-		result = GetAllTag();
-		break;
+	return;
+
+parse_error:
+
+	out->response = FormResponse(APICommand::CMD_ERROR);
+	out->state = APIRequest::DONE;
+}
+
+/*
+	Walks the client's requests oldest first. Read only requests start on the pool right away,
+	a request that changes something runs only when nothing before it is still running and
+	stops the walk until it is done, so nothing after it can see the state before it.
+*/
+void
+APIServerWorker::Dispatch(const std::shared_ptr<APIConnection>& connection) {
+
+	bool earlier_running = false;
+
+	for (const std::shared_ptr<APIRequest>& request : connection->request_queue) {
+
+		if (request->state == APIRequest::DONE || request->state == APIRequest::STREAMING) {
+			continue;
+		}
+
+		if (request->state == APIRequest::RUNNING) {
+			earlier_running = true;
+			continue;
+		}
+
+		//only touches the connection itself
+		if (request->cmd == APICommand::CMD_SUBSCRIBE || request->cmd == APICommand::CMD_UNSUBSCRIBE) {
+			request->response = Subscribe(*connection, *request);
+			request->state = APIRequest::DONE;
+			continue;
+		}
+
+		if (IsReadOnlyCommand(request->cmd)) {
+
+			request->state = APIRequest::RUNNING;
+			earlier_running = true;
+
+			QFutureWatcher<QByteArray> *watcher = new QFutureWatcher<QByteArray>(this);
+
+			connect(watcher, &QFutureWatcher<QByteArray>::finished, this, [this, watcher, connection, request] {
+				request->response = watcher->result();
+				request->state = request->stream ? APIRequest::STREAMING : APIRequest::DONE;
+				watcher->deleteLater();
+
+				//client is gone, nothing to write to
+				if (connection->socket == nullptr) {
+					return;
+				}
+
+				Dispatch(connection);
+				Flush(*connection);
+			});
+
+			watcher->setFuture(QtConcurrent::run(&read_pool, [this, request] {
+				//only the result is fetched here, it is serialized chunk by chunk as the client reads
+				if (request->stream) {
+					request->stream_result = GetMediaResult(static_cast<GetMediaType>(request->args.value(0).toInt()), request->args.value(1));
+					return QByteArray();
+				}
+
+				return Execute(*request);
+			}));
+			continue;
+		}
+
+		if (earlier_running) {
+			break;
+		}
+
+		request->response = Execute(*request);
+		request->state = APIRequest::DONE;
+	}
+}
+
+void
+APIServerWorker::Flush(APIConnection& connection) {
+
+	//writing can report bytesWritten straight away, which would flush again mid walk
+	if (connection.flushing) {
+		return;
+	}
+
+	connection.flushing = true;
+	bool written = false;
+
+	if (connection.framing == APIConnection::LEGACY) {
+		while (!connection.request_queue.empty() && connection.request_queue.front()->state == APIRequest::DONE) {
+			connection.socket->write(connection.request_queue.front()->response);
+			connection.request_queue.pop_front();
+			written = true;
+		}
+	}
+	else {
+		auto iter = connection.request_queue.begin();
+		while (iter != connection.request_queue.end()) {
+			if ((*iter)->state == APIRequest::STREAMING) {
+				bool finished = WriteStream(connection, **iter);
+				written = true;
+
+				if (finished) {
+					iter = connection.request_queue.erase(iter);
+				}
+				else {
+					iter++;
+				}
+				continue;
+			}
+
+			if ((*iter)->state != APIRequest::DONE) {
+				iter++;
+				continue;
+			}
+
+			WriteFrame(connection, (*iter)->response);
+
+			iter = connection.request_queue.erase(iter);
+			written = true;
+		}
+
+		//events wait in the queue where they can still be folded until the socket drains
+		while (connection.event_queue && connection.event_queue->HasEvent() && connection.socket->bytesToWrite() < API_STREAM_HIGH_WATER) {
+			APIEvent event = connection.event_queue->Take();
+
+			QJsonObject extra;
+			extra.insert("seq", (qint64) event.seq);
+
+			WriteFrame(connection, FormResponse(APICommand::CMD_EVENT, EventToJson(event), QJsonValue(), connection.event_encoding, extra));
+			written = true;
+		}
+	}
+
+	if (written) {
+		connection.socket->flush();
+	}
+
+	connection.flushing = false;
+}
+
+/*
+	Serializes chunks only while the socket has little queued, so at most about
+	API_STREAM_HIGH_WATER of a big result sits in memory as bytes at once. The rest is
+	written from OnClientBytesWritten as the client reads.
+*/
+bool
+APIServerWorker::WriteStream(APIConnection& connection, APIRequest& request) {
+	const QVector<ModelMedia>& media_list = request.stream_result.model_media_list;
+
+	while (request.stream_pos < media_list.size()) {
+		if (connection.socket->bytesToWrite() >= API_STREAM_HIGH_WATER) {
+			return false;
+		}
+
+		int count = qMin(API_STREAM_CHUNK_MEDIA, media_list.size() - request.stream_pos);
+
+		QJsonObject extra;
+		extra.insert("seq", request.stream_seq);
+
+		QJsonValue chunk = MediaListToJson(media_list, request.stream_pos, count, request.columnar);
+
+		request.stream_bytes += WriteFrame(connection, FormResponse(APICommand::CMD_OK, chunk, request.rid, request.encoding, extra));
+		request.stream_pos += count;
+		request.stream_seq++;
+	}
+
+	QJsonObject totals;
+	totals.insert("count", media_list.size());
+	totals.insert("chunks", request.stream_seq);
+	totals.insert("bytes", request.stream_bytes);
+
+	QJsonObject extra;
+	extra.insert("end", true);
+
+	WriteFrame(connection, FormResponse(APICommand::CMD_OK, totals, request.rid, request.encoding, extra));
+
+	request.stream_result = MediaModelResult();
+
+	return true;
+}
+
+//returns bytes written including the header
+qint64
+APIServerWorker::WriteFrame(APIConnection& connection, const QByteArray& payload) {
+	char header[API_FRAME_HEADER_SIZE];
+	qToBigEndian<quint32>(payload.size(), header);
+
+	connection.socket->write(header, API_FRAME_HEADER_SIZE);
+	connection.socket->write(payload);
+
+	return API_FRAME_HEADER_SIZE + payload.size();
+}
+
+QByteArray
+APIServerWorker::Subscribe(APIConnection& connection, const APIRequest& request) {
+
+	//legacy clients couldn't tell an event from a response
+	if (connection.framing != APIConnection::FRAMED) {
+		Logger::Log("Client " % QString::number(connection.id) % " can't subscribe without framing", LogEntry::LT_APISERVER);
+		return FormResponse(APICommand::CMD_ERROR, QJsonValue(), request.rid, request.encoding);
+	}
+
+	if (request.cmd == APICommand::CMD_UNSUBSCRIBE) {
+		if (connection.event_queue) {
+			connection.event_queue.reset();
+			subscriber_count--;
+			UpdateConnectionMetrics();
+		}
+
+		return FormResponse(APICommand::CMD_OK, QJsonValue(), request.rid, request.encoding);
+	}
+
+	if (!connection.event_queue) {
+		connection.event_queue.reset(new APIEventQueue());
+		subscriber_count++;
+		UpdateConnectionMetrics();
+
+		Logger::Log("Client " % QString::number(connection.id) % " subscribed, " % QString::number(subscriber_count) % " subscribed", LogEntry::LT_APISERVER);
+	}
+
+	connection.event_encoding = request.encoding;
+
+	QJsonObject result;
+	result.insert("seq", (qint64) connection.event_queue->LastSeq());
+
+	return FormResponse(APICommand::CMD_OK, result, request.rid, request.encoding);
+}
+
+//events are written once the daemon's burst of signals has been handled, so they have a chance to fold
+void
+APIServerWorker::Publish(const APIEvent& event) {
+	if (subscriber_count == 0) {
+		return;
+	}
+
+	for (const std::shared_ptr<APIConnection>& connection : connection_table) {
+		if (connection->event_queue) {
+			connection->event_queue->Push(event);
+		}
+	}
+
+	if (!subscriber_flush_pending) {
+		subscriber_flush_pending = true;
+		QMetaObject::invokeMethod(this, [this] { FlushSubscribers(); }, Qt::QueuedConnection);
+	}
+}
+
+void
+APIServerWorker::FlushSubscribers() {
+	subscriber_flush_pending = false;
+
+	for (const std::shared_ptr<APIConnection>& connection : connection_table.values()) {
+		if (connection->event_queue) {
+			Flush(*connection);
+		}
+	}
+}
+
+QByteArray
+APIServerWorker::Execute(const APIRequest& request) {
+	Metrics::ScopedTimer timer(Metrics::API_REQUEST);
+
+	QJsonValue result;
+	const QList<QVariant>& args = request.args;
+
+	Logger::Log("Recv command: " % GetCommandString(request.cmd), LogEntry::LT_APISERVER);
+
+	quint64 generation = GetCommandGeneration(request);
+	if (generation != 0) {
+		return ExecuteCached(request, generation);
+	}
+
+	switch (request.cmd) {
 	case APICommand::CMD_GETTAG:
 		break;
+	case APICommand::CMD_STATS:
+		result = Stats::Collect(daemon);
+		break;
 	case APICommand::CMD_ADDTAG:
-		result = AddTag(args[0].toString());
+		result = AddTag(args.value(0).toString());
 		break;
 	case APICommand::CMD_UPDATETAGNAME:
-		result = UpdateTagName(args[0].toUInt(), args[1].toString());
+		result = UpdateTagName(args.value(0).toUInt(), args.value(1).toString());
 		break;
 	case APICommand::CMD_DELETETAG:
-		result = RemoveTag(args[0].toUInt());
+		result = RemoveTag(args.value(0).toUInt());
+		break;
+	case APICommand::CMD_LINK:
+	case APICommand::CMD_UNLINK:
+	case APICommand::CMD_BATCH: {
+		bool applied;
+		result = ApplyTagOps(request, &applied);
+		if (!applied) {
+			return FormResponse(APICommand::CMD_ERROR, result, request.rid, request.encoding);
+		}
+		break;
+	}
+	default:
+		Logger::Log("Unknown request command", LogEntry::LT_APISERVER);
+		return FormResponse(APICommand::CMD_ERROR, QJsonValue(), request.rid, request.encoding);
+	}
+
+	return FormResponse(APICommand::CMD_OK, result, request.rid, request.encoding);
+}
+
+/*
+	Result of a read only command is kept serialized along with the generation it was made at,
+	and reused until the daemon's generation for it moves on. The generation is read before the
+	result, so a result is never older than the generation it's kept under.
+*/
+QByteArray
+APIServerWorker::ExecuteCached(const APIRequest& request, quint64 generation) {
+	const QList<QVariant>& args = request.args;
+
+	if (request.if_none_match == generation) {
+		Metrics::Inc(Metrics::API_CACHE_HIT_TOTAL);
+		return FormCachedResponse(APICommand::CMD_NOT_MODIFIED, QByteArray(), generation, request);
+	}
+
+	QByteArray key = GetCacheKey(request);
+
+	response_cache_lock.lock();
+
+	auto iter = response_cache.constFind(key);
+	if (iter != response_cache.constEnd() && iter->generation == generation) {
+		QByteArray res_bytes = iter->res_bytes;
+		response_cache_lock.unlock();
+
+		Metrics::Inc(Metrics::API_CACHE_HIT_TOTAL);
+
+		return FormCachedResponse(APICommand::CMD_OK, res_bytes, generation, request);
+	}
+
+	response_cache_lock.unlock();
+
+	QJsonValue result;
+	QByteArray res_bytes;
+
+	switch (request.cmd) {
+	case APICommand::CMD_GETALLTAG:
+		result = GetAllTag();
 		break;
 	case APICommand::CMD_GETMEDIA:
-		if (args.length() > 1)
-			result = GetMedia(static_cast<GetMediaType>(args[0].toInt()), args[1]);
-		else {
-			result = GetMedia(static_cast<GetMediaType>(args[0].toInt()));
+		if (request.encoding == APIRequest::CBOR) {
+			res_bytes = GetMediaCbor(request);
+			break;
 		}
+
+		result = GetMedia(static_cast<GetMediaType>(args.value(0).toInt()), args.value(1), request.columnar);
 		break;
 	case APICommand::CMD_GETROOTDIR:
 		result = GetRootDir();
 		break;
+	case APICommand::CMD_GETDUPLICATES:
+		result = GetDuplicates();
+		break;
+	case APICommand::CMD_GETDIRSTATS:
+		result = GetDirStats(args.value(0).toString());
+		if (result.isNull()) {
+			return FormResponse(APICommand::CMD_ERROR, QJsonValue(), request.rid, request.encoding);
+		}
+		break;
 	default:
-		Logger::Log("Unknown request command", LogEntry::LT_APISERVER);
-		goto send_error;
+		return FormResponse(APICommand::CMD_ERROR, QJsonValue(), request.rid, request.encoding);
 	}
 
-	curr_pipe_client->write(FormResponse(APICommand::CMD_OK, result));
-	curr_pipe_client->flush();
-	return;
+	if (res_bytes.isEmpty()) {
+		res_bytes = EncodeValue(result, request.encoding);
+	}
 
-send_error:
+	CacheResponse(key, generation, res_bytes);
 
-	curr_pipe_client->write(FormResponse(APICommand::CMD_ERROR));
-	curr_pipe_client->flush();
+	return FormCachedResponse(APICommand::CMD_OK, res_bytes, generation, request);
+}
+
+quint64
+APIServerWorker::GetCommandGeneration(const APIRequest& request) {
+	switch (request.cmd) {
+	case APICommand::CMD_GETALLTAG:
+	case APICommand::CMD_GETROOTDIR:
+	case APICommand::CMD_GETDUPLICATES:
+	case APICommand::CMD_GETDIRSTATS:
+		return daemon->GetGeneration();
+	case APICommand::CMD_GETMEDIA:
+		if (static_cast<GetMediaType>(request.args.value(0).toInt()) == GetMediaType::TYPE_TAG) {
+			return daemon->GetTagGeneration(request.args.value(1).toUInt());
+		}
+
+		return daemon->GetGeneration();
+	default:
+		return 0;
+	}
+}
+
+void
+APIServerWorker::CacheResponse(const QByteArray& key, quint64 generation, const QByteArray& res_bytes) {
+	if (res_bytes.size() > API_RESPONSE_CACHE_BYTES / 4) {
+		return;
+	}
+
+	response_cache_lock.lock();
+
+	auto iter = response_cache.find(key);
+	if (iter != response_cache.end()) {
+
+		//another thread made a newer one meanwhile
+		if (iter->generation > generation) {
+			response_cache_lock.unlock();
+			return;
+		}
+
+		response_cache_bytes -= iter->res_bytes.size();
+		response_cache.erase(iter);
+	}
+
+	//entries of old generations are never looked at again, dropping everything gets rid of them too
+	if (response_cache_bytes + res_bytes.size() > API_RESPONSE_CACHE_BYTES) {
+		response_cache.clear();
+		response_cache_bytes = 0;
+	}
+
+	response_cache.insert(key, { generation, res_bytes });
+	response_cache_bytes += res_bytes.size();
+	Metrics::Set(Metrics::API_CACHE_BYTES, response_cache_bytes);
+
+	response_cache_lock.unlock();
+}
+
+//same layout FormResponse makes, with res already serialized
+QByteArray
+APIServerWorker::FormCachedResponse(const APICommand cmd, const QByteArray& res_bytes, quint64 generation, const APIRequest& request) {
+	bool has_rid = !request.rid.isNull() && !request.rid.isUndefined();
+	bool has_res = !res_bytes.isEmpty();
+
+	QByteArray response;
+	response.reserve(res_bytes.size() + 64);
+
+	if (request.encoding == APIRequest::CBOR) {
+
+		//map header, fewer than 24 entries fit in its first byte
+		response.append(char(0xA0 | (2 + has_rid + has_res)));
+
+		response.append(QCborValue(QLatin1String("cmd")).toCbor());
+		response.append(QCborValue(static_cast<int>(cmd)).toCbor());
+		response.append(QCborValue(QLatin1String("gen")).toCbor());
+		response.append(QCborValue((qint64) generation).toCbor());
+
+		if (has_rid) {
+			response.append(QCborValue(QLatin1String("rid")).toCbor());
+			response.append(EncodeValue(request.rid, APIRequest::CBOR));
+		}
+
+		if (has_res) {
+			response.append(QCborValue(QLatin1String("res")).toCbor());
+			response.append(res_bytes);
+		}
+
+		return response;
+	}
+
+	response.append("{\"cmd\":" % QByteArray::number(static_cast<int>(cmd)) % ",\"gen\":" % QByteArray::number(generation));
+
+	if (has_rid) {
+		response.append(",\"rid\":" % EncodeValue(request.rid, APIRequest::JSON));
+	}
+
+	if (has_res) {
+		response.append(",\"res\":" % res_bytes);
+	}
+
+	response.append('}');
+
+	return response;
 }
 
 QByteArray 
-APIServerWorker::FormResponse(const APICommand cmd, const QJsonValue& result /* = QJsonObject()*/) {	
-	QJsonObject res_object;
+APIServerWorker::FormResponse(const APICommand cmd, const QJsonValue& result /* = QJsonObject()*/, const QJsonValue& rid /* = QJsonValue()*/, APIRequest::Encoding encoding /* = APIRequest::JSON */, const QJsonObject& extra /* = QJsonObject() */) {	
+	QJsonObject res_object = extra;
 	res_object.insert( "cmd", QJsonValue(static_cast<int>(cmd)) );
 
+	if (!rid.isNull() && !rid.isUndefined()) {
+		res_object.insert("rid", rid);
+	}
+
 	/*
 	switch (cmd) {
 	case APICommand::CMD_ERROR:
@@ -194,6 +954,10 @@ APIServerWorker::FormResponse(const APICommand cmd, const QJsonValue& result /*
 		res_object.insert("res", result);
 	}
 
+	if (encoding == APIRequest::CBOR) {
+		return QCborValue::fromJsonValue(res_object).toCbor();
+	}
+
 	return QJsonDocument(res_object).toJson(QJsonDocument::Compact);
 }
 
@@ -261,27 +1025,258 @@ APIServerWorker::UpdateTagName(const unsigned int tag_id, const QString& new_tag
 }
 
 QJsonValue
-APIServerWorker::GetMedia(GetMediaType type, const QVariant& arg /* = QVariant() */) {
+APIServerWorker::ApplyTagOps(const APIRequest& request, bool* applied) {
+
+	QVector<TagOp> op_list;
+	QVector<TagOpResult> result_list;
+
+	QList<QVariant> op_map_list;
+	if (request.cmd == APICommand::CMD_BATCH) {
+		op_map_list = request.args;
+	}
+	else {
+		QVariantMap op_map;
+		op_map.insert("op", request.cmd == APICommand::CMD_LINK ? "link" : "unlink");
+		op_map.insert("tag", request.args.value(0));
+		op_map.insert("media", request.args.value(1));
+		op_map_list.push_back(op_map);
+	}
+
+	*applied = false;
+	int ret = 1;
+
+	for (const QVariant& op_variant : op_map_list) {
+		TagOp op;
+		if (!ParseTagOp(op_variant.toMap(), &op)) {
+			Logger::Log("Tag op " % QString::number(op_list.size()) % " can't be parsed", LogEntry::LT_APISERVER);
+
+			result_list.fill(TagOpResult(), op_map_list.size());
+			result_list[op_list.size()].ret = -1;
+			ret = -1;
+			break;
+		}
+
+		op_list.push_back(op);
+	}
+
+	if (ret > 0) {
+		ret = daemon->ApplyTagOpList(op_list, &result_list);
+	}
+
+	QJsonArray result;
+	for (const TagOpResult& op_result : result_list) {
+		QJsonObject op_json;
+		op_json.insert("ret", op_result.ret);
+		op_json.insert("tag", (qint64) op_result.tag_id);
+		result.push_back(op_json);
+	}
+
+	*applied = ret > 0;
+	return result;
+}
+
+//static
+QByteArray
+APIServerWorker::EncodeValue(const QJsonValue& value, APIRequest::Encoding encoding) {
+	if (encoding == APIRequest::CBOR) {
+		return QCborValue::fromJsonValue(value).toCbor();
+	}
+
+	//QJsonDocument only takes an object or an array, strip the array around a lone value
+	QByteArray array_bytes = QJsonDocument(QJsonArray({ value })).toJson(QJsonDocument::Compact);
+	return array_bytes.mid(1, array_bytes.size() - 2);
+}
+
+//static
+QByteArray
+APIServerWorker::GetCacheKey(const APIRequest& request) {
+	QByteArray key = QByteArray::number(static_cast<int>(request.cmd)) % ':' % QByteArray::number(request.encoding) % ':' % QByteArray::number(request.columnar) % ':';
+	key.append(QJsonDocument(QJsonArray::fromVariantList(request.args)).toJson(QJsonDocument::Compact));
+	return key;
+}
+
+//static
+bool
+APIServerWorker::ParseTagOp(const QVariantMap& op_map, TagOp* out) {
+	static QHash<QString, TagOp::Type> type_table = {
+		{ "add_tag", TagOp::ADD_TAG },
+		{ "rename_tag", TagOp::RENAME_TAG },
+		{ "link", TagOp::LINK },
+		{ "unlink", TagOp::UNLINK }
+	};
+
+	auto iter = type_table.constFind(op_map.value("op").toString());
+	if (iter == type_table.constEnd()) {
+		return false;
+	}
+
+	out->type = *iter;
+
+	//a name is a string, anything else is an id
+	QVariant tag = op_map.value("tag");
+	if (tag.type() == QVariant::String) {
+		out->tag_name = tag.toString();
+	}
+	else {
+		bool ok;
+		out->tag_id = tag.toUInt(&ok);
+		if (!ok) {
+			return false;
+		}
+	}
+
+	if (out->type == TagOp::ADD_TAG && out->tag_name.isEmpty()) {
+		return false;
+	}
+
+	out->new_name = op_map.value("name").toString();
+
+	if (out->type == TagOp::LINK || out->type == TagOp::UNLINK) {
+		bool ok;
+		out->media_id = op_map.value("media").toUInt(&ok);
+		if (!ok) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+MediaModelResult
+APIServerWorker::GetMediaResult(GetMediaType type, const QVariant& arg /* = QVariant() */) {
 
-	MediaModelResult mm_res;
 	switch (type) {
 	case GetMediaType::TYPE_ALL:
-		mm_res = daemon->GetAllMedia();
-		break;
+		return daemon->GetAllMedia();
 	case GetMediaType::TYPE_NOTAG:
-		mm_res = daemon->GetAllTaglessMedia();
-		break;
+		return daemon->GetAllTaglessMedia();
 	case GetMediaType::TYPE_TAG:
-		mm_res = daemon->GetTagMedias(arg.toUInt());
-		break;
+		return daemon->GetTagMedias(arg.toUInt());
 	case GetMediaType::TYPE_QUERY:
-		mm_res = daemon->GetQueryMedia(arg.toString());
+		return daemon->GetQueryMedia(arg.toString());
+	}
+
+	return MediaModelResult();
+}
+
+QJsonValue
+APIServerWorker::GetMedia(GetMediaType type, const QVariant& arg /* = QVariant() */, bool columnar /* = false */) {
+
+	MediaModelResult mm_res = GetMediaResult(type, arg);
+
+	return MediaListToJson(mm_res.model_media_list, 0, mm_res.model_media_list.size(), columnar);
+}
+
+//static
+QJsonValue
+APIServerWorker::EventToJson(const APIEvent& event) {
+	static QVector<QString> type_str_list = {
+		"tag_inserted",
+		"tag_name_updated",
+		"tag_removed",
+		"media_tagless",
+		"media_removed",
+		"media_name_updated",
+		"media_subdir_updated",
+		"media_hash_updated",
+		"link_formed",
+		"link_destroyed",
+		"resync"
+	};
+
+	QJsonObject result;
+	result.insert("type", type_str_list.value(event.type));
+
+	switch (event.type) {
+	case APIEvent::TAG_INSERTED:
+	case APIEvent::TAG_NAME_UPDATED:
+		result.insert("tag", (qint64) event.tag_id);
+		result.insert("name", event.value);
+		break;
+	case APIEvent::TAG_REMOVED:
+		result.insert("tag", (qint64) event.tag_id);
+		break;
+	case APIEvent::MEDIA_TAGLESS: {
+		QJsonObject media_json;
+
+		media_json.insert("id", (qint64) event.media.id);
+		media_json.insert("name", event.media.name);
+		media_json.insert("hash", event.media.hash);
+		media_json.insert("subdir", event.media.sub_path);
+
+		result.insert("media", media_json);
 		break;
 	}
+	case APIEvent::MEDIA_REMOVED:
+		result.insert("media", (qint64) event.media_id);
+		break;
+	case APIEvent::MEDIA_NAME_UPDATED:
+		result.insert("media", (qint64) event.media_id);
+		result.insert("name", event.value);
+		break;
+	case APIEvent::MEDIA_SUBDIR_UPDATED:
+		result.insert("media", (qint64) event.media_id);
+		result.insert("subdir", event.value);
+		break;
+	case APIEvent::MEDIA_HASH_UPDATED:
+		result.insert("media", (qint64) event.media_id);
+		result.insert("hash", event.value);
+		break;
+	case APIEvent::LINK_FORMED:
+	case APIEvent::LINK_DESTROYED:
+		result.insert("tag", (qint64) event.tag_id);
+		result.insert("media", (qint64) event.media_id);
+		break;
+	case APIEvent::RESYNC:
+		break;
+	}
+
+	return result;
+}
+
+//static
+QJsonValue
+APIServerWorker::MediaListToJson(const QVector<ModelMedia>& media_list, int from, int count, bool columnar) {
+
+	if (columnar) {
+		QJsonArray id_list;
+		QJsonArray name_list;
+		QJsonArray hash_list;
+		QJsonArray dir_idx_list;
+		QJsonArray dir_list;
+		QHash<QString, int> dir_idx_table;
+
+		for (int i = from; i < from + count; i++) {
+			const ModelMedia& m_media = media_list[i];
+
+			auto iter = dir_idx_table.constFind(m_media.sub_path);
+			if (iter == dir_idx_table.constEnd()) {
+				iter = dir_idx_table.insert(m_media.sub_path, dir_list.size());
+				dir_list.push_back(m_media.sub_path);
+			}
+
+			id_list.push_back((qint64) m_media.id);
+			name_list.push_back(m_media.name);
+			hash_list.push_back(m_media.hash);
+			dir_idx_list.push_back(*iter);
+		}
+
+		QJsonObject result;
+
+		result.insert("count", count);
+		result.insert("id", id_list);
+		result.insert("name", name_list);
+		result.insert("hash", hash_list);
+		result.insert("dir", dir_idx_list);
+		result.insert("dirs", dir_list);
+
+		return result;
+	}
 
 	QJsonArray result;
 
-	for (const ModelMedia& m_media: mm_res.model_media_list) {
+	for (int i = from; i < from + count; i++) {
+		const ModelMedia& m_media = media_list[i];
 		QJsonObject media_json;
 
 		media_json.insert("id", (qint64) m_media.id);
@@ -293,10 +1288,137 @@ APIServerWorker::GetMedia(GetMediaType type, const QVariant& arg /* = QVariant()
 	}
 
 	return result;
+}
+
+//same structure as the json res, but every media is written as it is visited
+QByteArray
+APIServerWorker::GetMediaCbor(const APIRequest& request) {
+
+	const QList<QVariant>& args = request.args;
+	MediaModelResult mm_res = GetMediaResult(static_cast<GetMediaType>(args.value(0).toInt()), args.value(1));
+	const QVector<ModelMedia>& media_list = mm_res.model_media_list;
+
+	QByteArray res_bytes;
+	QCborStreamWriter writer(&res_bytes);
+
+	if (request.columnar) {
+		QHash<QString, int> dir_idx_table;
+		QVector<const QString*> dir_list;		//in index order
+
+		writer.startMap(6);
+
+		writer.append(QLatin1String("count"));
+		writer.append((qint64) media_list.size());
+
+		writer.append(QLatin1String("id"));
+		writer.startArray(media_list.size());
+		for (const ModelMedia& m_media : media_list) {
+			writer.append((quint64) m_media.id);
+		}
+		writer.endArray();
+
+		writer.append(QLatin1String("name"));
+		writer.startArray(media_list.size());
+		for (const ModelMedia& m_media : media_list) {
+			writer.append(m_media.name);
+		}
+		writer.endArray();
+
+		writer.append(QLatin1String("hash"));
+		writer.startArray(media_list.size());
+		for (const ModelMedia& m_media : media_list) {
+			writer.append(m_media.hash);
+		}
+		writer.endArray();
+
+		writer.append(QLatin1String("dir"));
+		writer.startArray(media_list.size());
+		for (const ModelMedia& m_media : media_list) {
+			auto iter = dir_idx_table.constFind(m_media.sub_path);
+			if (iter == dir_idx_table.constEnd()) {
+				iter = dir_idx_table.insert(m_media.sub_path, dir_list.size());
+				dir_list.push_back(&m_media.sub_path);
+			}
+
+			writer.append((qint64) *iter);
+		}
+		writer.endArray();
+
+		writer.append(QLatin1String("dirs"));
+		writer.startArray(dir_list.size());
+		for (const QString* dir : dir_list) {
+			writer.append(*dir);
+		}
+		writer.endArray();
+
+		writer.endMap();
+	}
+	else {
+		writer.startArray(media_list.size());
 
+		for (const ModelMedia& m_media : media_list) {
+			writer.startMap(4);
+			writer.append(QLatin1String("id"));
+			writer.append((quint64) m_media.id);
+			writer.append(QLatin1String("name"));
+			writer.append(m_media.name);
+			writer.append(QLatin1String("hash"));
+			writer.append(m_media.hash);
+			writer.append(QLatin1String("subdir"));
+			writer.append(m_media.sub_path);
+			writer.endMap();
+		}
+
+		writer.endArray();
+	}
+
+	return res_bytes;
 }
 
 QJsonValue
 APIServerWorker::GetRootDir() {
 	return QJsonValue(daemon->GetRootDirectory());
-}
\ No newline at end of file
+}
+
+//array of media id arrays, one per group of identical files
+QJsonValue
+APIServerWorker::GetDuplicates() {
+
+	QVector<QVector<unsigned int>> group_list;
+	daemon->FindDuplicateMedia(&group_list);
+
+	QJsonArray result;
+
+	for (const QVector<unsigned int>& group : group_list) {
+		QJsonArray group_json;
+
+		for (unsigned int media_id : group) {
+			group_json.push_back((qint64) media_id);
+		}
+
+		result.push_back(group_json);
+	}
+
+	return result;
+}
+
+//null if dir is not tracked
+QJsonValue
+APIServerWorker::GetDirStats(const QString& sub_path) {
+
+	DirStats stats;
+	if (daemon->GetDirStats(sub_path, &stats) < 0) {
+		Logger::Log("Dir: " % sub_path % " is not tracked", LogEntry::LT_APISERVER);
+		return QJsonValue();
+	}
+
+	QJsonObject result;
+
+	result.insert("media_count", (qint64) stats.media_count);
+	result.insert("child_dir_count", (qint64) stats.child_dir_count);
+	result.insert("recur_media_count", (qint64) stats.recur_media_count);
+	result.insert("recur_byte_count", (qint64) stats.recur_byte_count);
+	result.insert("recur_dir_count", (qint64) stats.recur_dir_count);
+
+	return result;
+}
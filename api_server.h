@@ -7,9 +7,22 @@
 #include <QMetaObject>
 #include <QByteArray>
 #include <QJsonArray>
+#include <QJsonObject>
+#include <QCborStreamWriter>
+#include <QHash>
+#include <QList>
+#include <QVariant>
+#include <QThreadPool>
+#include <QMutex>
+#include <QTimer>
+
+#include <deque>
+#include <memory>
 
 #include "logger.h"
 #include "daemon.h"
+#include "api_events.h"
+#include "shared_index_segment.h"
 
 #define THREAD_QUIT_WAIT_MSEC 3000
 
@@ -26,24 +39,93 @@
 	Client request structure:
 	{
 		cmd: <APICommand>,
+		rid: <any>,		//optional, framed connections only
+		enc: "cbor",	//optional, framed connections only. response is CBOR with the same structure
+		layout: "columnar",	//optional, GET MEDIA only
+		stream: true,	//optional, GET MEDIA on framed connections only
+		inm: <gen>,		//optional, if none match. NOT_MODIFIED with no res if the result is still at this generation
 		args: []
 	}
 
 	Server response structure:
 	{
 		cmd: <APICommand>,
+		gen: <n>,		//GET ALL TAG, GET MEDIA, GET ROOT DIR, GET DUPLICATES, GET DIR STATS. daemon generation the result is from
+		rid: <any>,		//copied from the request
 		res: {
 			
 			... //command specific properties
 		}
 	}
 
+	Framing:
+	Each JSON object is sent as a 4 byte big endian length followed by that many bytes.
+	A client can send any number of framed requests without waiting, they may be
+	answered out of order so each should carry its own rid.
+
+	Columnar GET MEDIA result, one entry per media at the same index in every array:
+	{
+		count: <n>,
+		id: [],
+		name: [],
+		hash: [],
+		dir: [],		//index into dirs
+		dirs: []		//each distinct sub path once
+	}
+
+	Streamed GET MEDIA, the result comes back as any number of chunk frames followed by
+	one end frame, all carrying the request's rid:
+	{ cmd: OK, rid, seq: <n>, res: <up to API_STREAM_CHUNK_MEDIA media, same layout as unstreamed> }
+	{ cmd: OK, rid, end: true, res: { count: <media>, chunks: <chunk frames>, bytes: <chunk frame bytes> } }
+
+	Events, framed connections only. After SUBSCRIBE the server pushes a frame for every
+	change the daemon makes, with no rid:
+	{ cmd: EVENT, seq: <n>, res: { type: <event type>, ...event properties } }
+	seq goes up by one per event. The SUBSCRIBE response carries the seq of the last event
+	sent, subscribe first and fetch state after so nothing falls in between. An event with
+	type "resync" means events were dropped because the client fell too far behind, state
+	has to be fetched again. See api_events.h for how queued events are folded.
+
+	LINK and UNLINK take [<tag>, <media id>], a tag is its id or, given as a string, its name.
+	BATCH takes a list of ops applied all together or not at all:
+	{ op: "add_tag", tag: <name> }
+	{ op: "rename_tag", tag: <tag>, name: <new name> }
+	{ op: "link" | "unlink", tag: <tag>, media: <media id> }
+	All three answer with one result per op, OK only if every op was applied:
+	[ { ret: <1 applied, 0 not applied, negative why this op failed>, tag: <tag id> } ]
+
+	STATS takes no args, its res is laid out in stats.h.
+
+	Clients on the same host can read tags and their media ids without the pipe, from the
+	snapshot the server keeps published in shared memory, see shared_index_segment.h.
+
+	A connection whose first byte is '{' or whitespace is a legacy connection instead:
+	no length prefix, whatever arrives in one read is one request and responses come
+	back in request order.
 */
 
+#define API_FRAME_HEADER_SIZE	4
+#define API_MAX_FRAME_SIZE		(64 * 1024 * 1024)	//bigger length means a broken client, connection is dropped
+
+#define API_STREAM_CHUNK_MEDIA	1000				//media per chunk frame
+#define API_STREAM_HIGH_WATER	(256 * 1024)		//no more chunks are serialized while the socket has this much queued
+
+#define API_RESPONSE_CACHE_BYTES	(64 * 1024 * 1024)	//cache is emptied when it would grow past this, results over a quarter of it are not kept
+
+#define SHARED_INDEX_PUBLISH_DELAY_MSEC	100			//tag and link changes within this long go out in one snapshot
+
 
 
 #define PIPE_NAME "TAGSEARCH_PIPE"
 
+/*
+	Any number of clients can be connected at once. Read only commands run on a pool of
+	threads, commands that change something run on the server thread once everything the
+	same client sent before them has finished, and whatever runs after them waits for them.
+	Legacy clients get their responses in the order they sent their requests, framed
+	clients as soon as each is ready.
+*/
+
 enum class APICommand {
 	CMD_ERROR,
 	CMD_OK,
@@ -54,7 +136,17 @@ enum class APICommand {
 	CMD_UPDATETAGNAME,
 	CMD_DELETETAG,
 	CMD_GETMEDIA,
-	CMD_GETROOTDIR
+	CMD_GETROOTDIR,
+	CMD_GETDUPLICATES,
+	CMD_GETDIRSTATS,
+	CMD_SUBSCRIBE,
+	CMD_UNSUBSCRIBE,
+	CMD_EVENT,				//server to client only
+	CMD_LINK,
+	CMD_UNLINK,
+	CMD_BATCH,
+	CMD_NOT_MODIFIED,		//server to client only
+	CMD_STATS
 };
 
 enum class GetMediaType {
@@ -64,6 +156,56 @@ enum class GetMediaType {
 	TYPE_QUERY
 };
 
+//one request from a client
+struct APIRequest {
+
+	enum State {
+		QUEUED,
+		RUNNING,
+		STREAMING,		//result is ready, chunks are written as the socket drains
+		DONE
+	};
+
+	enum Encoding {
+		JSON,
+		CBOR
+	};
+
+	APICommand			cmd = APICommand::CMD_ERROR;
+	QJsonValue			rid;		//null if none
+	Encoding			encoding = JSON;
+	bool				columnar = false;
+	bool				stream = false;
+	quint64				if_none_match = 0;
+	QList<QVariant>		args;
+	State				state = QUEUED;
+	QByteArray			response;
+
+	MediaModelResult	stream_result;		//STREAMING only
+	int					stream_pos = 0;		//first media not written yet
+	int					stream_seq = 0;
+	qint64				stream_bytes = 0;
+};
+
+//one connected client
+struct APIConnection {
+
+	enum Framing {
+		UNKNOWN,		//nothing received yet
+		LEGACY,
+		FRAMED
+	};
+
+	unsigned int							id = 0;
+	QLocalSocket*							socket = nullptr;	//null once disconnected, requests still running are dropped
+	Framing									framing = UNKNOWN;
+	QByteArray								read_buffer;		//partial frame
+	bool									flushing = false;
+	std::unique_ptr<APIEventQueue>			event_queue;		//null unless subscribed
+	APIRequest::Encoding					event_encoding = APIRequest::JSON;
+	std::deque<std::shared_ptr<APIRequest>>	request_queue;		//oldest first, answered from the front
+};
+
 //Qt requires worker-object approach in order to have slots be run in a new thread's event loop
 class APIServerWorker: public QObject {
 	Q_OBJECT
@@ -77,6 +219,7 @@ public:
 	APIServerWorker& operator= (const APIServerWorker&) = delete;
 
 	static QString GetCommandString(const APICommand cmd);
+	static bool IsReadOnlyCommand(const APICommand cmd);
 
 public slots:
 
@@ -86,21 +229,70 @@ public slots:
 private slots:
 	
 	void OnNewConnection();
-	void OnClientReadyRead();
-	void OnClientDisconnected(QLocalSocket* socket);
+
+	//daemon changes, queued for subscribers
+	void OnDaemonTagInserted(const ModelTag& new_model_tag);
+	void OnDaemonTagNameUpdated(const unsigned int tag_id, const QString& new_name);
+	void OnDaemonTagRemoved(const unsigned int tag_id);
+	void OnDaemonTaglessMediaInserted(const ModelMedia& new_model_media);
+	void OnDaemonMediaRemoved(const unsigned int media_id);
+	void OnDaemonMediaNameUpdated(const unsigned int media_id, const QString& new_name);
+	void OnDaemonMediaSubdirUpdated(const unsigned int media_id, const QString& new_subdir);
+	void OnDaemonMediaHashUpdated(const unsigned int media_id, const QString& new_hash);
+	void OnDaemonMediaBatchApplied(const ModelMediaBatch& batch);
+	void OnDaemonLinkFormed(const ModelTag& model_tag, const unsigned int media_id);
+	void OnDaemonLinksFormed(const ModelLinkBatch& batch);
+	void OnDaemonLinkDestroyed(const unsigned int tag_id, const unsigned int media_id);
+
+	void OnDaemonIndexChanged();		//tags or links changed, shared index is published shortly
+	void PublishSharedIndex();
 
 private:
 
 	Daemon*						daemon;
 
 	QLocalServer				pipe_server;
-	//QMetaObject::Connection		client_readyready_connection;
-	QLocalSocket*				curr_pipe_client = nullptr;
-
-	QVector<QLocalSocket*>		accepted_connections;
-
-	void ProcessPayload(const QByteArray& payload);
-	QByteArray FormResponse(const APICommand cmd, const QJsonValue& result = QJsonValue());
+	QThreadPool					read_pool;			//read only commands
+
+	QHash<QLocalSocket*, std::shared_ptr<APIConnection>>	connection_table;
+
+	SharedIndexPublisher		shared_index_publisher;
+	QTimer						shared_index_timer;
+
+	//serialized res of read commands, keyed by command, layout and args
+	struct CachedResponse {
+		quint64		generation;
+		QByteArray	res_bytes;
+	};
+
+	QMutex									response_cache_lock;
+	QHash<QByteArray, CachedResponse>		response_cache;
+	qint64									response_cache_bytes = 0;
+
+	unsigned int											next_connection_id = 1;
+	int														subscriber_count = 0;
+	bool													subscriber_flush_pending = false;	//events published since subscribers were last flushed
+
+	void OnClientReadyRead(const std::shared_ptr<APIConnection>& connection);
+	void OnClientDisconnected(const std::shared_ptr<APIConnection>& connection);
+	void OnClientBytesWritten(const std::shared_ptr<APIConnection>& connection);
+	void UpdateConnectionMetrics();
+
+	void		QueueRequest(const std::shared_ptr<APIConnection>& connection, const QByteArray& payload);
+	void		ParsePayload(const QByteArray& payload, APIRequest* out);
+	void		Dispatch(const std::shared_ptr<APIConnection>& connection);		//starts whatever the order rules allow
+	void		Flush(APIConnection& connection);								//writes finished responses, legacy only from the front
+	bool		WriteStream(APIConnection& connection, APIRequest& request);	//true once the end frame is written
+	qint64		WriteFrame(APIConnection& connection, const QByteArray& payload);
+	QByteArray	Execute(const APIRequest& request);								//any thread
+	QByteArray	ExecuteCached(const APIRequest& request, quint64 generation);	//any thread, commands GetCommandGeneration knows
+	quint64		GetCommandGeneration(const APIRequest& request);				//0 if not cached
+	void		CacheResponse(const QByteArray& key, quint64 generation, const QByteArray& res_bytes);
+	QByteArray	FormCachedResponse(const APICommand cmd, const QByteArray& res_bytes, quint64 generation, const APIRequest& request);
+	QByteArray	Subscribe(APIConnection& connection, const APIRequest& request);	//SUBSCRIBE and UNSUBSCRIBE
+	void		Publish(const APIEvent& event);
+	void		FlushSubscribers();
+	QByteArray	FormResponse(const APICommand cmd, const QJsonValue& result = QJsonValue(), const QJsonValue& rid = QJsonValue(), APIRequest::Encoding encoding = APIRequest::JSON, const QJsonObject& extra = QJsonObject());
 
 
 	//command handlers
@@ -109,8 +301,19 @@ private:
 	QJsonValue AddTag(const QString& tag_name);
 	QJsonValue RemoveTag(const unsigned int tag_id);
 	QJsonValue UpdateTagName(const unsigned int tag_id, const QString& new_tag_name);
-	QJsonValue GetMedia(GetMediaType type, const QVariant& arg = QVariant());
+	MediaModelResult GetMediaResult(GetMediaType type, const QVariant& arg = QVariant());
+	QJsonValue GetMedia(GetMediaType type, const QVariant& arg = QVariant(), bool columnar = false);
+	QByteArray GetMediaCbor(const APIRequest& request);		//res only, written straight from the result
+	static QJsonValue EventToJson(const APIEvent& event);
+	static QJsonValue MediaListToJson(const QVector<ModelMedia>& media_list, int from, int count, bool columnar);
 	QJsonValue GetRootDir();
+	QJsonValue GetDuplicates();
+	QJsonValue GetDirStats(const QString& sub_path);
+	QJsonValue ApplyTagOps(const APIRequest& request, bool* applied);		//LINK, UNLINK and BATCH
+
+	static bool ParseTagOp(const QVariantMap& op_map, TagOp* out);
+	static QByteArray EncodeValue(const QJsonValue& value, APIRequest::Encoding encoding);
+	static QByteArray GetCacheKey(const APIRequest& request);
 
 };
 
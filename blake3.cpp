@@ -0,0 +1,398 @@
+#include "blake3.h"
+
+#include <QVector>
+#include <QtConcurrent>
+
+#include <cstring>
+
+namespace {
+
+	enum Flag : uint8_t {
+		CHUNK_START	= 1 << 0,
+		CHUNK_END	= 1 << 1,
+		PARENT		= 1 << 2,
+		ROOT		= 1 << 3
+	};
+
+	const uint32_t IV[8] = {
+		0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+	};
+
+	const uint8_t MSG_SCHEDULE[7][16] = {
+		{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+		{ 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+		{ 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+		{ 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+		{ 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+		{ 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+		{ 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 }
+	};
+
+	inline uint32_t
+	Rotr(uint32_t w, int c) {
+		return (w >> c) | (w << (32 - c));
+	}
+
+	inline uint32_t
+	LoadLE(const uint8_t* p) {
+		return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+	}
+
+	inline void
+	G(uint32_t* s, int a, int b, int c, int d, uint32_t x, uint32_t y) {
+		s[a] = s[a] + s[b] + x;
+		s[d] = Rotr(s[d] ^ s[a], 16);
+		s[c] = s[c] + s[d];
+		s[b] = Rotr(s[b] ^ s[c], 12);
+		s[a] = s[a] + s[b] + y;
+		s[d] = Rotr(s[d] ^ s[a], 8);
+		s[c] = s[c] + s[d];
+		s[b] = Rotr(s[b] ^ s[c], 7);
+	}
+
+	//full 16 word output, first 8 words are the next chaining value
+	void
+	Compress(const uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN], uint8_t block_len, quint64 counter, uint8_t flags, uint32_t out[16]) {
+
+		uint32_t m[16];
+		for (int i = 0; i < 16; i++) {
+			m[i] = LoadLE(block + i * 4);
+		}
+
+		uint32_t s[16] = {
+			cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+			IV[0], IV[1], IV[2], IV[3],
+			(uint32_t) counter, (uint32_t) (counter >> 32), block_len, flags
+		};
+
+		for (int r = 0; r < 7; r++) {
+			const uint8_t* sch = MSG_SCHEDULE[r];
+
+			G(s, 0, 4, 8, 12, m[sch[0]], m[sch[1]]);
+			G(s, 1, 5, 9, 13, m[sch[2]], m[sch[3]]);
+			G(s, 2, 6, 10, 14, m[sch[4]], m[sch[5]]);
+			G(s, 3, 7, 11, 15, m[sch[6]], m[sch[7]]);
+
+			G(s, 0, 5, 10, 15, m[sch[8]], m[sch[9]]);
+			G(s, 1, 6, 11, 12, m[sch[10]], m[sch[11]]);
+			G(s, 2, 7, 8, 13, m[sch[12]], m[sch[13]]);
+			G(s, 3, 4, 9, 14, m[sch[14]], m[sch[15]]);
+		}
+
+		for (int i = 0; i < 8; i++) {
+			out[i] = s[i] ^ s[i + 8];
+			out[i + 8] = s[i + 8] ^ cv[i];
+		}
+	}
+
+	void
+	ParentBlock(const uint32_t left[8], const uint32_t right[8], uint8_t block_out[BLAKE3_BLOCK_LEN]) {
+		for (int i = 0; i < 8; i++) {
+			for (int j = 0; j < 4; j++) {
+				block_out[i * 4 + j] = (uint8_t) (left[i] >> (8 * j));
+				block_out[32 + i * 4 + j] = (uint8_t) (right[i] >> (8 * j));
+			}
+		}
+	}
+
+	void
+	ParentCv(const uint32_t left[8], const uint32_t right[8], uint32_t cv_out[8]) {
+		uint8_t block[BLAKE3_BLOCK_LEN];
+		uint32_t out[16];
+
+		ParentBlock(left, right, block);
+		Compress(IV, block, BLAKE3_BLOCK_LEN, 0, PARENT, out);
+		memcpy(cv_out, out, 8 * sizeof(uint32_t));
+	}
+
+	void
+	RootOutput(const uint32_t cv[8], const uint8_t block[BLAKE3_BLOCK_LEN], uint8_t block_len, uint8_t flags, uint8_t* out, int length) {
+		uint32_t words[16];
+		Compress(cv, block, block_len, 0, flags | ROOT, words);
+
+		for (int i = 0; i < length; i++) {
+			out[i] = (uint8_t) (words[i / 4] >> (8 * (i % 4)));
+		}
+	}
+
+	void
+	ChunkCv(const uint8_t* input, quint64 chunk_counter, uint32_t cv_out[8]) {
+		uint32_t cv[8];
+		uint32_t out[16];
+		memcpy(cv, IV, sizeof(cv));
+
+		for (int i = 0; i < BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN; i++) {
+			uint8_t flags = (i == 0 ? CHUNK_START : 0) | (i == BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN - 1 ? CHUNK_END : 0);
+			Compress(cv, input + i * BLAKE3_BLOCK_LEN, BLAKE3_BLOCK_LEN, chunk_counter, flags, out);
+			memcpy(cv, out, sizeof(cv));
+		}
+
+		memcpy(cv_out, cv, sizeof(cv));
+	}
+
+	//non root chaining value of a subtree, size is a power of two of at least one chunk
+	void
+	SubtreeCv(const uint8_t* input, size_t size, quint64 chunk_counter, uint32_t cv_out[8]) {
+
+		if (size == BLAKE3_CHUNK_LEN) {
+			ChunkCv(input, chunk_counter, cv_out);
+			return;
+		}
+
+		uint32_t left[8];
+		uint32_t right[8];
+		size_t half = size / 2;
+
+		SubtreeCv(input, half, chunk_counter, left);
+		SubtreeCv(input + half, half, chunk_counter + half / BLAKE3_CHUNK_LEN, right);
+		ParentCv(left, right, cv_out);
+	}
+
+	size_t
+	RoundDownPow2(size_t n) {
+		size_t p = 1;
+		while (p <= n / 2) {
+			p *= 2;
+		}
+		return p;
+	}
+}
+
+//chunk state
+
+void
+Blake3::ChunkState::Reset(quint64 chunk_counter) {
+	memcpy(cv, IV, sizeof(cv));
+	this->chunk_counter = chunk_counter;
+	memset(block, 0, sizeof(block));
+	block_len = 0;
+	blocks_compressed = 0;
+}
+
+size_t
+Blake3::ChunkState::Len() const {
+	return (size_t) blocks_compressed * BLAKE3_BLOCK_LEN + block_len;
+}
+
+uint8_t
+Blake3::ChunkState::StartFlag() const {
+	return blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+void
+Blake3::ChunkState::Update(const uint8_t* input, size_t size) {
+
+	while (size > 0) {
+
+		//last block is held back, it gets the CHUNK_END flag and maybe ROOT
+		if (block_len == BLAKE3_BLOCK_LEN) {
+			uint32_t out[16];
+			Compress(cv, block, BLAKE3_BLOCK_LEN, chunk_counter, StartFlag(), out);
+			memcpy(cv, out, sizeof(cv));
+
+			blocks_compressed++;
+			memset(block, 0, sizeof(block));
+			block_len = 0;
+		}
+
+		size_t take = std::min<size_t>(BLAKE3_BLOCK_LEN - block_len, size);
+		memcpy(block + block_len, input, take);
+
+		block_len += (uint8_t) take;
+		input += take;
+		size -= take;
+	}
+}
+
+void
+Blake3::ChunkState::ChainingValue(uint32_t cv_out[8]) const {
+	uint32_t out[16];
+	Compress(cv, block, block_len, chunk_counter, StartFlag() | CHUNK_END, out);
+	memcpy(cv_out, out, 8 * sizeof(uint32_t));
+}
+
+void
+Blake3::ChunkState::RootBytes(uint8_t* out, int length) const {
+	RootOutput(cv, block, block_len, StartFlag() | CHUNK_END, out, length);
+}
+
+//hasher
+
+Blake3::Blake3() :
+	cv_stack_len(0),
+	parallel_flag(true)
+{
+	chunk.Reset(0);
+}
+
+void
+Blake3::SetParallel(bool parallel_flag) {
+	this->parallel_flag = parallel_flag;
+}
+
+void
+Blake3::AddData(const char* data, size_t size) {
+
+	const uint8_t* input = (const uint8_t*) data;
+
+	//finish the partial chunk first, it is only closed once more input shows up
+	if (chunk.Len() > 0) {
+		size_t take = std::min(BLAKE3_CHUNK_LEN - chunk.Len(), size);
+		chunk.Update(input, take);
+		input += take;
+		size -= take;
+
+		if (size == 0) {
+			return;
+		}
+
+		uint32_t cv[8];
+		chunk.ChainingValue(cv);
+		PushCv(cv, chunk.chunk_counter);
+		chunk.Reset(chunk.chunk_counter + 1);
+	}
+
+	//whole subtrees while more than a chunk is left, the biggest one that fits and lines up with what came before
+	while (size > BLAKE3_CHUNK_LEN) {
+
+		size_t subtree_size = RoundDownPow2(size);
+		quint64 bytes_so_far = chunk.chunk_counter * BLAKE3_CHUNK_LEN;
+		while (((subtree_size - 1) & bytes_so_far) != 0) {
+			subtree_size /= 2;
+		}
+
+		quint64 subtree_chunks = subtree_size / BLAKE3_CHUNK_LEN;
+
+		if (subtree_size <= BLAKE3_CHUNK_LEN) {
+			ChunkState single;
+			single.Reset(chunk.chunk_counter);
+			single.Update(input, subtree_size);
+
+			uint32_t cv[8];
+			single.ChainingValue(cv);
+			PushCv(cv, chunk.chunk_counter);
+		}
+		else {
+			//pushed as two children so the subtree root can still turn out to be the root of everything
+			uint32_t left[8];
+			uint32_t right[8];
+			SubtreeChildCvs(input, subtree_size, chunk.chunk_counter, left, right);
+
+			PushCv(left, chunk.chunk_counter);
+			PushCv(right, chunk.chunk_counter + subtree_chunks / 2);
+		}
+
+		chunk.Reset(chunk.chunk_counter + subtree_chunks);
+		input += subtree_size;
+		size -= subtree_size;
+	}
+
+	if (size > 0) {
+		chunk.Update(input, size);
+		MergeCvStack(chunk.chunk_counter);
+	}
+}
+
+QByteArray
+Blake3::Result(int length /*= BLAKE3_OUT_LEN*/) {
+
+	length = std::max(0, std::min(length, 2 * BLAKE3_OUT_LEN));
+	QByteArray digest(length, '\0');
+
+	if (cv_stack_len == 0) {
+		chunk.RootBytes((uint8_t*) digest.data(), length);
+	}
+	else {
+		//fold the stack from the top, the last parent is the root
+		uint32_t cv[8];
+		int remaining;
+
+		if (chunk.Len() > 0) {
+			chunk.ChainingValue(cv);
+			remaining = cv_stack_len;
+		}
+		else {
+			//input ended on a subtree boundary, the last two stack entries are the children of the root candidate
+			memcpy(cv, cv_stack[cv_stack_len - 1], sizeof(cv));
+			remaining = cv_stack_len - 1;
+		}
+
+		uint8_t block[BLAKE3_BLOCK_LEN];
+
+		while (remaining > 1) {
+			remaining--;
+			ParentCv(cv_stack[remaining], cv, cv);
+		}
+
+		ParentBlock(cv_stack[0], cv, block);
+		RootOutput(IV, block, BLAKE3_BLOCK_LEN, PARENT, (uint8_t*) digest.data(), length);
+	}
+
+	chunk.Reset(0);
+	cv_stack_len = 0;
+
+	return digest;
+}
+
+//private
+
+void
+Blake3::PushCv(const uint32_t cv[8], quint64 chunk_counter) {
+	MergeCvStack(chunk_counter);
+	memcpy(cv_stack[cv_stack_len], cv, 8 * sizeof(uint32_t));
+	cv_stack_len++;
+}
+
+//a completed subtree of 2^n chunks leaves one entry per set bit of the chunk count
+void
+Blake3::MergeCvStack(quint64 total_chunks) {
+
+	int post_merge_len = 0;
+	for (quint64 n = total_chunks; n != 0; n &= n - 1) {
+		post_merge_len++;
+	}
+
+	while (cv_stack_len > post_merge_len) {
+		ParentCv(cv_stack[cv_stack_len - 2], cv_stack[cv_stack_len - 1], cv_stack[cv_stack_len - 2]);
+		cv_stack_len--;
+	}
+}
+
+void
+Blake3::SubtreeChildCvs(const uint8_t* input, size_t size, quint64 chunk_counter, uint32_t left_out[8], uint32_t right_out[8]) const {
+
+	//at least two leaves, each a power of two of chunks
+	size_t leaf_size = std::min<size_t>(BLAKE3_PARALLEL_LEAF, size / 2);
+	int leaf_count = (int) (size / leaf_size);
+
+	QVector<int> leaf_idx_list(leaf_count);
+	for (int i = 0; i < leaf_count; i++) {
+		leaf_idx_list[i] = i;
+	}
+
+	QVector<uint32_t> cv_list(leaf_count * 8);
+
+	auto hash_leaf = [input, leaf_size, chunk_counter, &cv_list](const int& idx) -> void {
+		SubtreeCv(input + idx * leaf_size, leaf_size, chunk_counter + idx * (leaf_size / BLAKE3_CHUNK_LEN), cv_list.data() + idx * 8);
+	};
+
+	if (parallel_flag && size >= 2 * BLAKE3_PARALLEL_LEAF) {
+		QtConcurrent::blockingMap(leaf_idx_list, hash_leaf);
+	}
+	else {
+		for (int idx : leaf_idx_list) {
+			hash_leaf(idx);
+		}
+	}
+
+	//pairwise up the tree until only the two children of the subtree root are left
+	while (leaf_count > 2) {
+		for (int i = 0; i < leaf_count / 2; i++) {
+			ParentCv(cv_list.data() + 2 * i * 8, cv_list.data() + (2 * i + 1) * 8, cv_list.data() + i * 8);
+		}
+		leaf_count /= 2;
+	}
+
+	memcpy(left_out, cv_list.data(), 8 * sizeof(uint32_t));
+	memcpy(right_out, cv_list.data() + 8, 8 * sizeof(uint32_t));
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+	BLAKE3 hash, portable implementation
+
+	Input is split into 1KB chunks that form a binary tree, every subtree can be
+	hashed on its own. Large updates are cut into leaf subtrees hashed in
+	parallel on the global thread pool and merged on the calling thread, so one
+	big file is hashed by several cores. Chaining values of finished subtrees
+	wait on a stack and only the very last chunk or parent is hashed as root,
+	at least one chunk of input is always kept back until Result is called.
+*/
+
+#include <QByteArray>
+
+#include <cstddef>
+#include <cstdint>
+
+#define BLAKE3_OUT_LEN			32
+#define BLAKE3_CHUNK_LEN		1024
+#define BLAKE3_BLOCK_LEN		64
+#define BLAKE3_PARALLEL_LEAF	(64 * 1024)		//subtrees at least twice this are split across threads
+
+class Blake3 {
+public:
+	Blake3();
+
+	//parallel is off for small inputs no matter what
+	void		SetParallel(bool parallel_flag);
+
+	void		AddData(const char* data, size_t size);
+
+	//first length bytes of root output, up to 64. hasher starts over afterwards
+	QByteArray	Result(int length = BLAKE3_OUT_LEN);
+
+private:
+
+	struct ChunkState {
+		uint32_t	cv[8];
+		quint64		chunk_counter;
+		uint8_t		block[BLAKE3_BLOCK_LEN];
+		uint8_t		block_len;
+		uint8_t		blocks_compressed;
+
+		void	Reset(quint64 chunk_counter);
+		size_t	Len() const;
+		void	Update(const uint8_t* input, size_t size);
+		void	ChainingValue(uint32_t cv_out[8]) const;
+		void	RootBytes(uint8_t* out, int length) const;
+		uint8_t	StartFlag() const;
+	};
+
+	ChunkState	chunk;
+	uint32_t	cv_stack[54][8];		//one per level, 2^54 chunks is past any file size
+	int			cv_stack_len;
+	bool		parallel_flag;
+
+	void	PushCv(const uint32_t cv[8], quint64 chunk_counter);
+	void	MergeCvStack(quint64 total_chunks);
+
+	//two child chaining values of a subtree of size bytes, size is a power of two of at least two chunks
+	void	SubtreeChildCvs(const uint8_t* input, size_t size, quint64 chunk_counter, uint32_t left_out[8], uint32_t right_out[8]) const;
+};
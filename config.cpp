@@ -10,6 +10,7 @@
 
 #include "error.h"
 #include "logger.h"
+#include "hash_engine.h"
 
 Config::~Config() {
 	if (dirty) {
@@ -69,6 +70,10 @@ Config::Load() {
 			saved_config_map.insert(MEDIAVIEW, ConfigUnion(ParseMediaListViewConfig(all_config_obj.value(sub_sys_key).toObject())));
 			effective_config_map.insert(MEDIAVIEW, *saved_config_map.constFind(MEDIAVIEW));
 		}
+		else if (sub_sys_key == "monitor") {
+			saved_config_map.insert(MONITOR, ConfigUnion(ParseNotifyConfig(all_config_obj.value(sub_sys_key).toObject())));
+			effective_config_map.insert(MONITOR, *saved_config_map.constFind(MONITOR));
+		}
 		else {
 			Logger::Log("Unknown subconfig, skipping...", LogEntry::LT_WARNING);
 			continue;
@@ -90,6 +95,11 @@ Config::Load() {
 		effective_config_map.insert(MEDIAVIEW, ConfigUnion(MediaListViewConfig()));
 	}
 
+	if (!saved_config_map.contains(MONITOR)) {
+		saved_config_map.insert(MONITOR, ConfigUnion(NotifyConfig()));
+		effective_config_map.insert(MONITOR, ConfigUnion(NotifyConfig()));
+	}
+
 	//config_map_lock.unlock();
 	Logger::Log("Config file loaded", LogEntry::LT_SUCCESS);
 	return 1;
@@ -121,6 +131,22 @@ Config::Save() {
 		media_list_view_config_obj.insert("spacing", QString::number(saved_config_map.constFind(MEDIAVIEW)->media_list_view_config.spacing));
 		main_obj.insert("mediaview", QJsonValue(std::move(media_list_view_config_obj)));
 	}
+	{
+		QJsonObject notify_config_obj;
+		notify_config_obj.insert("buffer_size_kb", QString::number(saved_config_map.constFind(MONITOR)->notify_config.buffer_size_kb));
+		notify_config_obj.insert("max_buffer_size_kb", QString::number(saved_config_map.constFind(MONITOR)->notify_config.max_buffer_size_kb));
+		notify_config_obj.insert("quiet_msec", QString::number(saved_config_map.constFind(MONITOR)->notify_config.quiet_msec));
+		notify_config_obj.insert("max_hold_msec", QString::number(saved_config_map.constFind(MONITOR)->notify_config.max_hold_msec));
+		notify_config_obj.insert("batch_max_events", QString::number(saved_config_map.constFind(MONITOR)->notify_config.batch_max_events));
+		notify_config_obj.insert("move_window_msec", QString::number(saved_config_map.constFind(MONITOR)->notify_config.move_window_msec));
+		notify_config_obj.insert("hash_workers", QString::number(saved_config_map.constFind(MONITOR)->notify_config.hash_workers));
+		notify_config_obj.insert("hash", HashEngine::AlgoName(saved_config_map.constFind(MONITOR)->notify_config.hash_algo));
+		notify_config_obj.insert("io_readers_rotational", QString::number(saved_config_map.constFind(MONITOR)->notify_config.io_readers_rotational));
+		notify_config_obj.insert("io_readers_solid", QString::number(saved_config_map.constFind(MONITOR)->notify_config.io_readers_solid));
+		notify_config_obj.insert("io_readers_network", QString::number(saved_config_map.constFind(MONITOR)->notify_config.io_readers_network));
+		notify_config_obj.insert("io_buffers", QString::number(saved_config_map.constFind(MONITOR)->notify_config.io_buffers));
+		main_obj.insert("monitor", QJsonValue(std::move(notify_config_obj)));
+	}
 
 	//config_map_lock.unlock();
 
@@ -312,6 +338,102 @@ Config::ParseMediaListViewConfig(const QJsonObject& media_view_config_json) {
 	return config;
 }
 
+NotifyConfig
+Config::ParseNotifyConfig(const QJsonObject& notify_config_json) {
+	NotifyConfig config;
+	QString str_buff;
+	for (const QString& key : notify_config_json.keys()) {
+
+		if (!notify_config_json.value(key).isString()) {
+			Logger::Log("Key: " % key % " value is not a string. Using default value...", LogEntry::LT_WARNING);
+			continue;
+		}
+
+		str_buff = notify_config_json.value(key).toString();
+
+		if (key == "buffer_size_kb") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 1)) {
+				config.buffer_size_kb = input;
+			}
+		}
+		else if (key == "max_buffer_size_kb") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 1)) {
+				config.max_buffer_size_kb = input;
+			}
+		}
+		else if (key == "quiet_msec") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 0)) {
+				config.quiet_msec = input;
+			}
+		}
+		else if (key == "max_hold_msec") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 0)) {
+				config.max_hold_msec = input;
+			}
+		}
+		else if (key == "batch_max_events") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 1)) {
+				config.batch_max_events = input;
+			}
+		}
+		else if (key == "move_window_msec") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 0)) {
+				config.move_window_msec = input;
+			}
+		}
+		else if (key == "hash_workers") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 1)) {
+				config.hash_workers = input;
+			}
+		}
+		else if (key == "hash") {
+			int input;
+			if (HashEngine::AlgoFromName(str_buff, &input)) {
+				config.hash_algo = input;
+			}
+			else {
+				Logger::Log("Unknown hash algorithm: " % str_buff % ". Using default value...", LogEntry::LT_WARNING);
+			}
+		}
+		else if (key == "io_readers_rotational") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 1)) {
+				config.io_readers_rotational = input;
+			}
+		}
+		else if (key == "io_readers_solid") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 1)) {
+				config.io_readers_solid = input;
+			}
+		}
+		else if (key == "io_readers_network") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 1)) {
+				config.io_readers_network = input;
+			}
+		}
+		else if (key == "io_buffers") {
+			int input;
+			if (IntCheck(str_buff, &input) && LowerBoundCheck(input, 1)) {
+				config.io_buffers = input;
+			}
+		}
+		else {
+			Logger::Log("Unknown key: " % key % ". Skipping...", LogEntry::LT_WARNING);
+		}
+	}
+
+	return config;
+}
+
 bool 
 Config::IntCheck(const QString& str, int* out) {
 	bool ok;
@@ -29,10 +29,26 @@ struct MediaListViewConfig {
 	int spacing = 1;
 };
 
+struct NotifyConfig {
+	int buffer_size_kb = 8;			//change buffer starts at this size
+	int max_buffer_size_kb = 64;	//and doubles on overflow up to this size
+	int quiet_msec = 500;			//create and modify are held until the path sees no events for this long
+	int max_hold_msec = 5000;		//but never held longer than this
+	int batch_max_events = 2048;	//file events applied together under one lock and transaction
+	int move_window_msec = 1000;	//removed files wait this long for a matching CREATE before they are deleted
+	int hash_workers = 2;			//files hashed in parallel off the monitor thread
+	int hash_algo = 0;				//HashEngine::Algo new content hashes are made with, saved by name as "hash"
+	int io_readers_rotational = 1;	//reader threads per spinning disk, more than one makes the head seek between files
+	int io_readers_solid = 4;		//per ssd/nvme, more reads in flight
+	int io_readers_network = 2;		//per network share
+	int io_buffers = 16;			//4MB read blocks shared between readers and hashers
+};
+
 union ConfigUnion {
 	LoggerConfig logger_config;
 	ThumbnailGenConfig thumbnail_gen_config;
 	MediaListViewConfig media_list_view_config;
+	NotifyConfig notify_config;
 
 	explicit ConfigUnion(LoggerConfig config):
 		logger_config(std::move(config))
@@ -48,6 +64,11 @@ union ConfigUnion {
 		media_list_view_config(std::move(config))
 	{
 	}
+
+	explicit ConfigUnion(NotifyConfig config):
+		notify_config(std::move(config))
+	{
+	}
 };
 
 class Config {
@@ -58,7 +79,8 @@ public:
 	enum SubconfigType {
 		LOGGER,
 		THUMBGEN,
-		MEDIAVIEW
+		MEDIAVIEW,
+		MONITOR
 	};
 	
 	int									Load();
@@ -83,6 +105,7 @@ private:
 	LoggerConfig		ParseLoggerConfig(const QJsonObject& logger_config_json);
 	ThumbnailGenConfig	ParseThumbGenConfig(const QJsonObject& thumbgen_config_json);
 	MediaListViewConfig	ParseMediaListViewConfig(const QJsonObject& media_view_config_json);
+	NotifyConfig		ParseNotifyConfig(const QJsonObject& notify_config_json);
 
 	bool StringCheck(const QJsonValue& json_val);
 	bool IntCheck(const QString& str, int* out);
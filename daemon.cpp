@@ -5,6 +5,7 @@
 #include <QStack>
 #include <QFile>
 #include <QDir>
+#include <QDateTime>
 #include <QDebug>
 #include <QFuture>
 #include <QtConcurrent>
@@ -18,9 +19,37 @@
 #include "util.h"
 #include "query.h"
 #include "error.h"
+#include "metrics.h"
+#include "hash_engine.h"
 
-Daemon::Daemon() 
+//does nothing, queuing it is what wakes the monitor thread out of its alertable wait
+static void CALLBACK
+HashResultReadyRoutine(ULONG_PTR) {
+}
+
+//size and hashes of media as they are now
+static Fingerprint
+MediaFingerprint(const MediaInfo& media) {
+	Fingerprint fingerprint;
+	fingerprint.size = media.size;
+	fingerprint.quick_hash = media.quick_hash;
+	fingerprint.hash = media.hash;
+	fingerprint.hash_algo = media.hash_algo;
+	return fingerprint;
+}
+
+Daemon::Daemon() :
+	hash_service([this](const QString& abs_path, const std::atomic_bool& cancel_flag, Fingerprint* fingerprint_out) -> int {
+		return HashEngine::FileFingerprint(io_scheduler, abs_path, notify_config.hash_algo, cancel_flag, fingerprint_out);
+	}),
+	monitor_thread_handle(NULL),
+	tag_list_lock(Metrics::TAG_LOCK_WAIT, Metrics::TAG_LOCK_HOLD),
+	media_list_lock(Metrics::MEDIA_LOCK_WAIT, Metrics::MEDIA_LOCK_HOLD),
+	initialized(false),
+	generation(QDateTime::currentMSecsSinceEpoch()),
+	media_generation(generation.load())
 {
+	index_snapshot.Publish(generation);
 }
 
 Daemon::~Daemon() {
@@ -43,6 +72,45 @@ Daemon::Stop() {
 	SetEvent(monitor_terminate_event);
 }
 
+quint64
+Daemon::GetGeneration() const {
+	return index_snapshot.Pin()->GetGeneration();
+}
+
+quint64
+Daemon::GetTagGeneration(const unsigned int tag_id) const {
+	tag_generation_lock.lock();
+	quint64 tag_generation = tag_generation_table.value(tag_id, 0);
+	tag_generation_lock.unlock();
+
+	//tag's media list carries media names and paths. a change not published yet reports the
+	//published generation until it is, reads would still miss it
+	return qMin(qMax(tag_generation, media_generation.load()), GetGeneration());
+}
+
+bool
+Daemon::IsInitialized() const {
+	return initialized;
+}
+
+quint64
+Daemon::GetTagSnapshot(QVector<Tag>* tag_list_out) {
+	std::shared_ptr<const IndexSnapshot> snapshot = index_snapshot.Pin();
+
+	//media id sets are implicitly shared, copying every tag is cheap
+	tag_list_out->reserve(snapshot->GetTagCount());
+	snapshot->ForEachTag([tag_list_out](const Tag& tag) {
+		tag_list_out->push_back(tag);
+	});
+
+	return snapshot->GetGeneration();
+}
+
+void
+Daemon::SetNotifyConfig(const NotifyConfig& config) {
+	notify_config = config;
+}
+
 QString
 Daemon::GetRootDirectory() {
 	return abs_root_dir;
@@ -64,6 +132,7 @@ Daemon::AddTag(const QString& name, unsigned int* new_tag_id /*= nullptr*/) {
 
 	unsigned int id;
 	global_tag_list.InsertNewTag(name, &id);
+	BumpTagGeneration(id);
 
 	if (new_tag_id != nullptr) {
 		*new_tag_id = id;
@@ -79,6 +148,8 @@ Daemon::AddTag(const QString& name, unsigned int* new_tag_id /*= nullptr*/) {
 
 	tag_list_lock.unlock();
 
+	PublishIndexSnapshot();
+
 	if(tag_db.InsertTag(tmp) < 0) {
 		Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
 		return -Error::DAEMON_DB;
@@ -111,9 +182,12 @@ Daemon::UpdateTagName(const unsigned int tag_id, const QString& new_name) {
 	}
 
 	global_tag_list.UpdateTagName(tag_id, new_name);
+	BumpTagGeneration(tag_id);
 
 	tag_list_lock.unlock();
 
+	PublishIndexSnapshot();
+
 	Tag buff;
 	global_tag_list.GetTagById(tag_id, &buff);
 
@@ -170,10 +244,13 @@ Daemon::RemoveTagById(const unsigned int tag_id) {
 
 	//remove this tag from memory
 	global_tag_list.RemoveTagById(tag_id);
+	BumpTagGeneration(tag_id);
 
 	tag_list_lock.unlock();
 	media_list_lock.unlock();
 
+	PublishIndexSnapshot();
+
 	//remove this tag from link db
 	if (tag_link_db.RemoveTagLinkByTagId(tag_id) < 0) {
 		Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
@@ -240,64 +317,108 @@ Daemon::FormLinkByIds(const unsigned int tag_id, const unsigned int media_id) {
 
 int 
 Daemon::FormMediaMappedLink(const QVector<MediaInfo>& media_list) {
-	QVector<unsigned int> media_ids;
-	QVector<unsigned int> tag_ids;
-
-	QVector<QString> tag_name_list;
 
-	tag_list_lock.lockForWrite();
-	
-	Tag tag_buff;
-	ModelTag m_tag_buff;
+	//patterns run before any lock is taken
+	QVector<QVector<QString>> mapped_tag_name_list;
+	mediamap.GetMappedTagsList(media_list, &mapped_tag_name_list);
 
-	for (auto media_iter = media_list.cbegin(); media_iter != media_list.cend(); media_iter++) {
+	QVector<QPair<unsigned int, unsigned int>> link_list;
+	QHash<QString, unsigned int> tag_id_table;		//each mapped name is looked up once
+	unsigned int tag_id;
 
-		tag_name_list.clear();
-		mediamap.GetMappedTags(media_iter->GetSubpathLongName(), &tag_name_list);
-		
-		if (tag_name_list.empty()) {
-			continue;
-		}
+	tag_list_lock.lockForRead();
 
-		Logger::Log("Applying filename mapped link for: " % media_iter->long_name);
+	for (int i = 0; i < media_list.size(); i++) {
+		for (const QString& tag_name : mapped_tag_name_list[i]) {
 
-		for (auto tag_name_iter = tag_name_list.cbegin(); tag_name_iter != tag_name_list.cend(); tag_name_iter++) {
+			auto iter = tag_id_table.constFind(tag_name);
+			if (iter == tag_id_table.constEnd()) {
 
-			if (!global_tag_list.TagExistByName(*tag_name_iter)) {
+				if (!global_tag_list.TagExistByName(tag_name)) {
+					Logger::Log("Tag name: " % tag_name % " does not exist", LogEntry::LT_ERROR);
+					continue;
+				}
 
-				Logger::Log("Tag name: " % *tag_name_iter % " does not exist", LogEntry::LT_ERROR);
-				continue;
+				global_tag_list.GetTagIdByName(tag_name, &tag_id);
+				iter = tag_id_table.insert(tag_name, tag_id);
 			}
 
-			global_tag_list.GetTagByName(*tag_name_iter, &tag_buff);
-				
+			link_list.push_back(qMakePair(*iter, media_list[i].id));
+		}
+	}
+
+	tag_list_lock.unlock();
 
-			media_list_lock.lockForWrite();
+	if (link_list.empty()) {
+		return 1;
+	}
 
-			global_media_list.InsertMediaTag(tag_buff.id, media_iter->id);
-			global_tag_list.InsertTagMedia(tag_buff.id, media_iter->id);
+	return FormLinkList(link_list);
+}
 
-			media_ids.push_back(media_iter->id);
-			tag_ids.push_back(tag_buff.id);
+int
+Daemon::FormLinkList(const QVector<QPair<unsigned int, unsigned int>>& link_list) {
 
-			media_list_lock.unlock();
+	QVector<unsigned int> tag_id_list;
+	QVector<unsigned int> media_id_list;
+	QSet<QPair<unsigned int, unsigned int>> link_set;		//same pair twice in link list
+	ModelLinkBatch batch;
 
-			tag_buff.FormModelTag(&m_tag_buff);
+	tag_list_lock.lockForWrite();
+	media_list_lock.lockForWrite();
 
-			emit LinkFormed(m_tag_buff, media_iter->id);
-			Logger::Log("Linked formed: Tag: " % m_tag_buff.name % " media id: " % QString::number(media_iter->id), LogEntry::LT_SUCCESS);
-			
+	for (const auto& link : link_list) {
+		if (!global_tag_list.TagExistById(link.first) || !global_media_list.MediaExistById(link.second)) {
+			continue;
+		}
+
+		if (global_media_list.MediaTagIdExist(link.second, link.first) || link_set.contains(link)) {
+			continue;
 		}
+
+		link_set.insert(link);
+		tag_id_list.push_back(link.first);
+		media_id_list.push_back(link.second);
 	}
 
-	//update to database
-	if (tag_link_db.CreateTagLinkByTagMediaIdList(tag_ids, media_ids) < 0) {
-		Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
+	if (tag_id_list.empty()) {
+		media_list_lock.unlock();
 		tag_list_lock.unlock();
+		return 1;
+	}
+
+	//update to database in one statement list, memory only once it went through
+	if (tag_link_db.CreateTagLinkByTagMediaIdList(tag_id_list, media_id_list) < 0) {
+		media_list_lock.unlock();
+		tag_list_lock.unlock();
+
+		Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
 		return -Error::DAEMON_DB;
 	}
 
+	for (int i = 0; i < tag_id_list.size(); i++) {
+		global_media_list.InsertMediaTag(tag_id_list[i], media_id_list[i]);
+		global_tag_list.InsertTagMedia(tag_id_list[i], media_id_list[i]);
+
+		batch.link_list.push_back(qMakePair(tag_id_list[i], media_id_list[i]));
+		batch.tag_count_delta_table[tag_id_list[i]]++;
+	}
+
+	ModelTag m_tag_buff;
+	for (auto iter = batch.tag_count_delta_table.constBegin(); iter != batch.tag_count_delta_table.constEnd(); iter++) {
+		global_tag_list.GetModelTagById(iter.key(), &m_tag_buff);
+		batch.tag_list.push_back(m_tag_buff);
+		BumpTagGeneration(iter.key());
+	}
+
+	media_list_lock.unlock();
 	tag_list_lock.unlock();
+
+	PublishIndexSnapshot();
+
+	emit LinksFormed(batch);
+
+	Logger::Log(QString::number(batch.link_list.size()) % " links formed over " % QString::number(batch.tag_list.size()) % " tags", LogEntry::LT_SUCCESS);
 	return 1;
 }
 
@@ -311,6 +432,7 @@ Daemon::DestroyLink(const unsigned int tag_id, const unsigned int media_id) {
 
 	global_tag_list.RemoveTagMedia(tag_id, media_id);
 	global_media_list.RemoveMediaTag(tag_id, media_id);
+	BumpTagGeneration(tag_id);
 
 	//destroy in database
 	if (tag_link_db.RemoveTagLinkByTagIdMediaId(tag_id, media_id) < 0) {
@@ -323,6 +445,8 @@ Daemon::DestroyLink(const unsigned int tag_id, const unsigned int media_id) {
 	tag_list_lock.unlock();
 	media_list_lock.unlock();
 
+	PublishIndexSnapshot();
+
 	emit LinkDestroyed(tag_id, media_id);
 
 	if (global_media_list.GetMediaTagCount(media_id) == 0) {
@@ -338,19 +462,331 @@ Daemon::DestroyLink(const unsigned int tag_id, const unsigned int media_id) {
 	return 1;
 }
 
-int 
-Daemon::AddMedia(const QString& sub_path, const QString& name, const QString& alt_name, const QString& hash /*optional*/) {
+int
+Daemon::ApplyTagOpList(const QVector<TagOp>& op_list, QVector<TagOpResult>* result_list) {
+
+	//what each applied op changed in memory, so it can be put back
+	struct UndoEntry {
+		TagOp::Type		type;
+		unsigned int	tag_id;
+		unsigned int	media_id;
+		QString			old_name;
+	};
 
-	MediaInfo new_media(sub_path, name, alt_name, hash);
+	QVector<UndoEntry> undo_list;
+	result_list->fill(TagOpResult(), op_list.size());
+
+	//puts memory back for every undo entry the filter accepts, newest first
+	auto undo = [this, &undo_list, result_list](bool links_only) {
+		for (int i = undo_list.size() - 1; i >= 0; i--) {
+			const UndoEntry& entry = undo_list[i];
+
+			switch (entry.type) {
+			case TagOp::ADD_TAG:
+				if (links_only) continue;
+				global_tag_list.RemoveTagById(entry.tag_id);
+				break;
+			case TagOp::RENAME_TAG:
+				if (links_only) continue;
+				global_tag_list.UpdateTagName(entry.tag_id, entry.old_name);
+				break;
+			case TagOp::LINK:
+				global_tag_list.RemoveTagMedia(entry.tag_id, entry.media_id);
+				global_media_list.RemoveMediaTag(entry.tag_id, entry.media_id);
+				break;
+			case TagOp::UNLINK:
+				global_tag_list.InsertTagMedia(entry.tag_id, entry.media_id);
+				global_media_list.InsertMediaTag(entry.tag_id, entry.media_id);
+				break;
+			}
+
+			(*result_list)[i].ret = 0;
+		}
+	};
+
+	tag_list_lock.lockForWrite();
+	media_list_lock.lockForWrite();
+
+	int failed_idx = -1;
+
+	for (int i = 0; i < op_list.size() && failed_idx < 0; i++) {
+		const TagOp& op = op_list[i];
+		TagOpResult& result = (*result_list)[i];
+
+		unsigned int tag_id = op.tag_id;
+
+		if (op.type == TagOp::ADD_TAG) {
+			if (op.tag_name.isEmpty() || global_tag_list.TagExistByName(op.tag_name)) {
+				result.ret = -1;
+				failed_idx = i;
+				continue;
+			}
+
+			global_tag_list.InsertNewTag(op.tag_name, &tag_id);
+			undo_list.push_back({ op.type, tag_id, 0, QString() });
+
+			result.ret = 1;
+			result.tag_id = tag_id;
+			continue;
+		}
+
+		if (!op.tag_name.isEmpty()) {
+			if (!global_tag_list.TagExistByName(op.tag_name)) {
+				result.ret = -1;
+				failed_idx = i;
+				continue;
+			}
+
+			global_tag_list.GetTagIdByName(op.tag_name, &tag_id);
+		}
+		else if (!global_tag_list.TagExistById(tag_id)) {
+			result.ret = -1;
+			failed_idx = i;
+			continue;
+		}
+
+		result.tag_id = tag_id;
+
+		switch (op.type) {
+		case TagOp::RENAME_TAG: {
+			if (op.new_name.isEmpty() || global_tag_list.TagExistByName(op.new_name)) {
+				result.ret = -1;
+				break;
+			}
+
+			Tag tag;
+			global_tag_list.GetTagById(tag_id, &tag);
+
+			global_tag_list.UpdateTagName(tag_id, op.new_name);
+			undo_list.push_back({ op.type, tag_id, 0, tag.name });
+
+			result.ret = 1;
+			break;
+		}
+		case TagOp::LINK:
+		case TagOp::UNLINK: {
+			if (!global_media_list.MediaExistById(op.media_id)) {
+				result.ret = -2;
+				break;
+			}
+
+			bool linked = global_media_list.MediaTagIdExist(op.media_id, tag_id);
+			if (linked == (op.type == TagOp::LINK)) {
+				result.ret = -3;
+				break;
+			}
+
+			if (op.type == TagOp::LINK) {
+				global_tag_list.InsertTagMedia(tag_id, op.media_id);
+				global_media_list.InsertMediaTag(tag_id, op.media_id);
+			}
+			else {
+				global_tag_list.RemoveTagMedia(tag_id, op.media_id);
+				global_media_list.RemoveMediaTag(tag_id, op.media_id);
+			}
+
+			undo_list.push_back({ op.type, tag_id, op.media_id, QString() });
 
-	if (hash.isEmpty()) {
-		//compute hash
-		if (FileUtil::GetFileSHA2(abs_root_dir, new_media, &new_media.hash) < 0) {
-			Logger::Log("Failed to calculate hash for file: " % new_media.long_name, LogEntry::LT_WARNING);
-			new_media.hash.clear();
+			result.ret = 1;
+			break;
+		}
+		default:
+			result.ret = -1;
+			break;
+		}
+
+		if (result.ret < 0) {
+			failed_idx = i;
+		}
+	}
+
+	if (failed_idx >= 0) {
+		undo(false);
+
+		media_list_lock.unlock();
+		tag_list_lock.unlock();
+
+		Logger::Log("Tag op " % QString::number(failed_idx) % " of " % QString::number(op_list.size()) % " failed with " % QString::number((*result_list)[failed_idx].ret) % ", nothing applied", LogEntry::LT_ERROR);
+		return -1;
+	}
+
+	//memory already reflects every op, databases get the same in one transaction each
+	bool db_ok = tag_db.BeginTransaction() > 0 && tag_link_db.BeginTransaction() > 0;
+
+	Tag tag_buff;
+	for (int i = 0; i < undo_list.size() && db_ok; i++) {
+		const UndoEntry& entry = undo_list[i];
+
+		switch (entry.type) {
+		case TagOp::ADD_TAG:
+			tag_buff = Tag();
+			tag_buff.id = entry.tag_id;
+			tag_buff.name = op_list[i].tag_name;
+			db_ok = tag_db.InsertTag(tag_buff) > 0;
+			break;
+		case TagOp::RENAME_TAG:
+			global_tag_list.GetTagById(entry.tag_id, &tag_buff);
+			db_ok = tag_db.UpdateTag(tag_buff) > 0;
+			break;
+		case TagOp::LINK:
+			db_ok = tag_link_db.CreateTagLink(entry.tag_id, entry.media_id) > 0;
+			break;
+		case TagOp::UNLINK:
+			db_ok = tag_link_db.RemoveTagLinkByTagIdMediaId(entry.tag_id, entry.media_id) > 0;
+			break;
+		}
+	}
+
+	//tags and links live in separate files, tags go first so links never point at a tag that was not written
+	bool tag_db_ok = db_ok && tag_db.CommitTransaction() > 0;
+	db_ok = tag_db_ok && tag_link_db.CommitTransaction() > 0;
+
+	if (!db_ok) {
+		tag_db.RollbackTransaction();
+		tag_link_db.RollbackTransaction();
+
+		for (const UndoEntry& entry : undo_list) {
+			BumpTagGeneration(entry.tag_id);
+		}
+
+		//tags that made it to disk stay
+		undo(tag_db_ok);
+
+		//kept tags still have to reach readers and the view, links are gone so counts come from memory
+		QVector<ModelTag> kept_tag_list;
+		QVector<QPair<unsigned int, QString>> kept_rename_list;
+		ModelTag m_tag_buff;
+
+		for (int i = 0; i < undo_list.size() && tag_db_ok; i++) {
+			const UndoEntry& entry = undo_list[i];
+
+			if (entry.type == TagOp::ADD_TAG) {
+				global_tag_list.GetModelTagById(entry.tag_id, &m_tag_buff);
+				m_tag_buff.name = op_list[i].tag_name;
+				kept_tag_list.push_back(m_tag_buff);
+			}
+			else if (entry.type == TagOp::RENAME_TAG) {
+				kept_rename_list.push_back(qMakePair(entry.tag_id, op_list[i].new_name));
+			}
+		}
+
+		media_list_lock.unlock();
+		tag_list_lock.unlock();
+
+		if (tag_db_ok) {
+			PublishIndexSnapshot();
+
+			for (const ModelTag& m_tag : kept_tag_list) {
+				emit TagInserted(m_tag);
+			}
+
+			for (const auto& rename : kept_rename_list) {
+				emit TagNameUpdated(rename.first, rename.second);
+			}
+		}
+
+		Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
+		return -Error::DAEMON_DB;
+	}
+
+	for (const UndoEntry& entry : undo_list) {
+		BumpTagGeneration(entry.tag_id);
+	}
+
+	//signals in op order, consecutive links go out as one batch
+	QVector<ModelTag> inserted_tag_list;
+	QVector<QPair<unsigned int, QString>> renamed_tag_list;
+	QVector<ModelLinkBatch> link_batch_list;
+	QVector<QPair<unsigned int, unsigned int>> destroyed_link_list;
+	QVector<ModelMedia> tagless_media_list;
+	QSet<unsigned int> tagless_media_id_set;
+
+	//each signal group keeps the position of the op it came from
+	QVector<QPair<TagOp::Type, int>> emit_order;
+	ModelTag m_tag_buff;
+	Media media_buff;
+
+	for (int i = 0; i < undo_list.size(); i++) {
+		const UndoEntry& entry = undo_list[i];
+
+		switch (entry.type) {
+		case TagOp::ADD_TAG:
+			global_tag_list.GetModelTagById(entry.tag_id, &m_tag_buff);
+			m_tag_buff.name = op_list[i].tag_name;
+			m_tag_buff.media_count = 0;
+			emit_order.push_back(qMakePair(entry.type, inserted_tag_list.size()));
+			inserted_tag_list.push_back(m_tag_buff);
+			break;
+		case TagOp::RENAME_TAG:
+			emit_order.push_back(qMakePair(entry.type, renamed_tag_list.size()));
+			renamed_tag_list.push_back(qMakePair(entry.tag_id, op_list[i].new_name));
+			break;
+		case TagOp::LINK:
+			if (emit_order.empty() || emit_order.last().first != TagOp::LINK) {
+				emit_order.push_back(qMakePair(entry.type, link_batch_list.size()));
+				link_batch_list.push_back(ModelLinkBatch());
+			}
+
+			link_batch_list.last().link_list.push_back(qMakePair(entry.tag_id, entry.media_id));
+			link_batch_list.last().tag_count_delta_table[entry.tag_id]++;
+			break;
+		case TagOp::UNLINK:
+			emit_order.push_back(qMakePair(entry.type, destroyed_link_list.size()));
+			destroyed_link_list.push_back(qMakePair(entry.tag_id, entry.media_id));
+
+			if (global_media_list.GetMediaTagCount(entry.media_id) == 0 && !tagless_media_id_set.contains(entry.media_id)) {
+				tagless_media_id_set.insert(entry.media_id);
+				global_media_list.GetMediaById(entry.media_id, &media_buff);
+				tagless_media_list.push_back(media_buff.FormModelMedia(abs_root_dir));
+			}
+			break;
+		}
+	}
+
+	for (ModelLinkBatch& batch : link_batch_list) {
+		for (auto iter = batch.tag_count_delta_table.constBegin(); iter != batch.tag_count_delta_table.constEnd(); iter++) {
+			global_tag_list.GetModelTagById(iter.key(), &m_tag_buff);
+			batch.tag_list.push_back(m_tag_buff);
+		}
+	}
+
+	media_list_lock.unlock();
+	tag_list_lock.unlock();
+
+	PublishIndexSnapshot();
+
+	for (const auto& signal : emit_order) {
+		switch (signal.first) {
+		case TagOp::ADD_TAG:
+			emit TagInserted(inserted_tag_list[signal.second]);
+			break;
+		case TagOp::RENAME_TAG:
+			emit TagNameUpdated(renamed_tag_list[signal.second].first, renamed_tag_list[signal.second].second);
+			break;
+		case TagOp::LINK:
+			emit LinksFormed(link_batch_list[signal.second]);
+			break;
+		case TagOp::UNLINK:
+			emit LinkDestroyed(destroyed_link_list[signal.second].first, destroyed_link_list[signal.second].second);
+			break;
 		}
 	}
 
+	for (const ModelMedia& m_media : tagless_media_list) {
+		emit TaglessMediaInserted(m_media);
+	}
+
+	Logger::Log("Applied " % QString::number(op_list.size()) % " tag ops", LogEntry::LT_SUCCESS);
+	return 1;
+}
+
+int 
+Daemon::AddMedia(const QString& sub_path, const QString& name, const QString& alt_name, const QString& hash /*optional*/) {
+
+	MediaInfo new_media(sub_path, name, alt_name, hash);
+	PathUtil::GetFileSizeW((abs_root_dir % new_media.GetSubpathLongName()).toStdWString(), &new_media.size);
+
+	//no hash yet means pending, media is usable right away and the hash is filled in once computed
 
 	if (media_db.InsertMedia(new_media) < 0) {
 		Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
@@ -374,7 +810,15 @@ Daemon::AddMedia(const QString& sub_path, const QString& name, const QString& al
 
 	emit TaglessMediaInserted(buff);
 
-	file_tracker.AddMediaSubPath(sub_path, new_media.id);
+	file_tracker_lock.lockForWrite();
+	file_tracker.AddMediaSubPath(sub_path, new_media.id, new_media.size);
+	file_tracker_lock.unlock();
+
+	BumpMediaGeneration();
+
+	if (new_media.hash.isEmpty()) {
+		SubmitMediaHash(new_media, HashService::LIVE);
+	}
 
 	Logger::Log("Media: " % buff.name % " id: " % QString::number(buff.id) % " added", LogEntry::LT_SUCCESS);
 	//return new media id
@@ -419,7 +863,15 @@ Daemon::AddMediaList(QVector<MediaInfo>& media_list) {
 		media_list_lock.unlock();
 
 		//insert into file tracker
-		file_tracker.AddMediaSubPath(iter->sub_path, iter->id);
+		file_tracker_lock.lockForWrite();
+		file_tracker.AddMediaSubPath(iter->sub_path, iter->id, iter->size);
+		file_tracker_lock.unlock();
+
+		BumpMediaGeneration();
+
+		if (iter->hash.isEmpty()) {
+			SubmitMediaHash(*iter, HashService::BACKFILL);
+		}
 
 		//emit new tagless media
 		ModelMedia buff = iter->FormModelMedia(abs_root_dir);
@@ -438,6 +890,7 @@ Daemon::UpdateMediaName(const unsigned int media_id, const QString& long_name, c
 	media_list_lock.lockForWrite();
 
 	global_media_list.UpdateMediaName(media_id, long_name, short_name);
+	BumpMediaGeneration();
 	global_media_list.GetMediaInfoById(media_id, &tmp);
 
 	media_list_lock.unlock();
@@ -462,6 +915,7 @@ Daemon::UpdateMediaSubdir(const unsigned int media_id, const QString& sub_dir) {
 	media_list_lock.lockForWrite();
 
 	global_media_list.UpdateMediaSubdir(media_id, sub_dir);
+	BumpMediaGeneration();
 	global_media_list.GetMediaInfoById(media_id, &tmp);
 
 	media_list_lock.unlock();
@@ -502,6 +956,7 @@ Daemon::UpdateMediaListSubdir(const QVector<unsigned int>& media_id_list, const
 		media_list_lock.lockForWrite();
 
 		global_media_list.UpdateMediaSubdir(*id_iter, *sub_dir_iter);
+		BumpMediaGeneration();
 		global_media_list.GetMediaInfoById(*id_iter, &tmp_media);
 
 		media_list_lock.unlock();
@@ -543,6 +998,8 @@ Daemon::RemoveMedia(const unsigned int media_id) {
 
 	global_media_list.GetMediaById(media_id, &media);
 
+	hash_service.Cancel(media_id);
+
 	//remove media ptr from tags that are linked with this media
 	for (auto iter = media.tag_id_list.begin(); iter != media.tag_id_list.end(); iter++) {
 		global_tag_list.RemoveTagMedia(*iter, media_id);
@@ -569,9 +1026,11 @@ Daemon::RemoveMedia(const unsigned int media_id) {
 
 	media_list_lock.unlock();
 
-	if (file_tracker.DirExist(media.sub_path)) {
-		file_tracker.RemoveMedia(media.sub_path, media_id);
-	}
+	file_tracker_lock.lockForWrite();
+	file_tracker.RemoveMedia(media.sub_path, media_id);
+	file_tracker_lock.unlock();
+
+	BumpMediaGeneration();
 
 	emit MediaRemoved(media_id);
 
@@ -592,6 +1051,8 @@ Daemon::RemoveMediaList(const QVector<unsigned int>& media_id_list) {
 
 		global_media_list.GetMediaById(*media_id_iter, &media);
 
+		hash_service.Cancel(*media_id_iter);
+
 		//remove media ptr from tags that are linked with this media
 		for (auto tag_id_iter = media.tag_id_list.begin(); tag_id_iter != media.tag_id_list.end(); tag_id_iter++) {
 			global_tag_list.RemoveTagMedia(*tag_id_iter, *media_id_iter);
@@ -606,9 +1067,11 @@ Daemon::RemoveMediaList(const QVector<unsigned int>& media_id_list) {
 
 		media_list_lock.unlock();
 
-		if (file_tracker.DirExist(media.sub_path)) {
-			file_tracker.RemoveMedia(media.sub_path, *media_id_iter);
-		}
+		file_tracker_lock.lockForWrite();
+		file_tracker.RemoveMedia(media.sub_path, *media_id_iter);
+		file_tracker_lock.unlock();
+
+		BumpMediaGeneration();
 
 		emit MediaRemoved(*media_id_iter);
 
@@ -628,36 +1091,149 @@ Daemon::RemoveMediaList(const QVector<unsigned int>& media_id_list) {
 	return 1;
 }
 
-int 
-Daemon::AddDir(const QString& sub_path, const QString& long_name, const QString& short_name) {
-
-	Logger::Log("New Dir: " % long_name % " added", LogEntry::LT_SUCCESS);
-	return file_tracker.AddDirSubPath(sub_path, long_name, short_name);
-}
-
-int 
-Daemon::UpdateDirName(const QString& sub_path_name, const QString& long_name, const QString& short_name) {
+int
+Daemon::RegenerateMediaHash(const unsigned int media_id) {
 
-	QVector<unsigned int> affected_media_id_list;
-	
-	file_tracker.GetDirMediaIdRecurByPath(sub_path_name, &affected_media_id_list);
-	file_tracker.UpdateDirName(sub_path_name, long_name, short_name);
+	MediaInfo media_buff;
 
-	Logger::Log("Directory: " % sub_path_name % " name update to: " % long_name, LogEntry::LT_SUCCESS);
+	media_list_lock.lockForRead();
 
-	if (affected_media_id_list.empty()) {
-		return 1;
+	if (!global_media_list.MediaExistById(media_id)) {
+		media_list_lock.unlock();
+		Logger::Log("Media id: " % QString::number(media_id) % " does not exist", LogEntry::LT_ERROR);
+		return -1;
 	}
 
-	QString dir_sub_path = sub_path_name.chopped(sub_path_name.size() - sub_path_name.lastIndexOf('\\'));
-	
-	//update name for all media
-	
-	MediaInfo info_buff;
-	QVector<QString>		new_subdir_list;
+	global_media_list.GetMediaInfoById(media_id, &media_buff);
 
-	int next_slash_idx;
-	int replace_len;
+	media_list_lock.unlock();
+
+	SubmitMediaHash(media_buff, HashService::INTERACTIVE);
+
+	Logger::Log("Media id: " % QString::number(media_id) % " queued for hashing");
+	return 1;
+}
+
+int
+Daemon::FindDuplicateMedia(QVector<QVector<unsigned int>>* group_list_out) {
+
+	QVector<Media*> media_ptr_list;
+	QHash<qint64, QVector<MediaInfo>> size_table;
+
+	media_list_lock.lockForRead();
+
+	global_media_list.GetAllMediaPtr(&media_ptr_list);
+
+	//empty files are all alike, nothing worth reporting
+	for (Media* media : media_ptr_list) {
+		if (media->size > 0) {
+			size_table[media->size].push_back(media->GetMediaInfo());
+		}
+	}
+
+	media_list_lock.unlock();
+
+	QVector<MediaInfo> size_match_list;
+	for (auto iter = size_table.cbegin(); iter != size_table.cend(); iter++) {
+		if (iter.value().size() > 1) {
+			size_match_list.append(iter.value());
+		}
+	}
+
+	//quick hash is cheap enough to fill in here for media still waiting on the hash service
+	QtConcurrent::blockingMap(size_match_list, [this](MediaInfo& media) -> void {
+
+		if (!media.quick_hash.isEmpty()) {
+			return;
+		}
+
+		Fingerprint fingerprint;
+		if (HashEngine::FileQuickHash(abs_root_dir % media.GetSubpathLongName(), &fingerprint) > 0) {
+			media.quick_hash = fingerprint.quick_hash;
+		}
+	});
+
+	//quick hash covers size as well
+	QHash<QString, QVector<const MediaInfo*>> quick_table;
+	for (const MediaInfo& media : size_match_list) {
+		if (!media.quick_hash.isEmpty()) {
+			quick_table[media.quick_hash].push_back(&media);
+		}
+	}
+
+	int pending_count = 0;
+
+	for (auto quick_iter = quick_table.cbegin(); quick_iter != quick_table.cend(); quick_iter++) {
+
+		if (quick_iter.value().size() < 2) {
+			continue;
+		}
+
+		//content hash settles it, asked for only now that both cheaper stages collide
+		QHash<QString, QVector<unsigned int>> hash_table;
+
+		for (const MediaInfo* media : quick_iter.value()) {
+			if (media->hash.isEmpty() || media->hash_algo != notify_config.hash_algo) {
+				SubmitMediaHash(*media, HashService::INTERACTIVE);
+				pending_count++;
+				continue;
+			}
+
+			hash_table[media->hash].push_back(media->id);
+		}
+
+		for (auto hash_iter = hash_table.cbegin(); hash_iter != hash_table.cend(); hash_iter++) {
+			if (hash_iter.value().size() > 1) {
+				group_list_out->push_back(hash_iter.value());
+			}
+		}
+	}
+
+	Logger::Log(QString::number(group_list_out->size()) % " duplicate groups found, " % QString::number(pending_count) % " media queued for hashing to confirm");
+	return 1;
+}
+
+int 
+Daemon::AddDir(const QString& sub_path, const QString& long_name, const QString& short_name) {
+
+	Logger::Log("New Dir: " % long_name % " added", LogEntry::LT_SUCCESS);
+
+	file_tracker_lock.lockForWrite();
+	int ret = file_tracker.AddDirSubPath(sub_path, long_name, short_name);
+	file_tracker_lock.unlock();
+
+	BumpGeneration();
+
+	return ret;
+}
+
+int 
+Daemon::UpdateDirName(const QString& sub_path_name, const QString& long_name, const QString& short_name) {
+
+	QVector<unsigned int> affected_media_id_list;
+	
+	file_tracker.GetDirMediaIdRecurByPath(sub_path_name, &affected_media_id_list);
+	file_tracker_lock.lockForWrite();
+	file_tracker.UpdateDirName(sub_path_name, long_name, short_name);
+	file_tracker_lock.unlock();
+
+	BumpGeneration();
+
+	Logger::Log("Directory: " % sub_path_name % " name update to: " % long_name, LogEntry::LT_SUCCESS);
+
+	if (affected_media_id_list.empty()) {
+		return 1;
+	}
+
+	QString dir_sub_path = sub_path_name.chopped(sub_path_name.size() - sub_path_name.lastIndexOf('\\'));
+	
+	//update name for all media
+	
+	MediaInfo info_buff;
+	QVector<QString>		new_subdir_list;
+
+	int next_slash_idx;
+	int replace_len;
 
 	for (auto iter = affected_media_id_list.begin(); iter != affected_media_id_list.end(); iter++) {
 		
@@ -696,7 +1272,11 @@ Daemon::UpdateDirSubDir(const QString& sub_path_name, const QString& new_sub_pat
 	QVector<unsigned int> affected_media_id_list;
 
 	file_tracker.GetDirMediaIdRecurByPath(sub_path_name, &affected_media_id_list);
+	file_tracker_lock.lockForWrite();
 	file_tracker.UpdateDirSubdir(sub_path_name, new_sub_path);
+	file_tracker_lock.unlock();
+
+	BumpGeneration();
 
 	Logger::Log("Directory: " % sub_path_name % " subdir updated to: " % new_sub_path, LogEntry::LT_SUCCESS);
 
@@ -749,57 +1329,69 @@ Daemon::RemoveDir(const QString& sub_path_name) {
 		RemoveMediaList(affected_media_id_list);
 	}
 
+	file_tracker_lock.lockForWrite();
 	file_tracker.RemoveDir(sub_path_name);
+	file_tracker_lock.unlock();
+
+	BumpGeneration();
 
 	Logger::Log("Directory: " % sub_path_name % " removed", LogEntry::LT_SUCCESS);
 	return 1;
 }
 
-MediaModelResult
-Daemon::GetAllMedia() {
+int
+Daemon::GetDirStats(const QString& sub_path_name, DirStats* out) {
+	file_tracker_lock.lockForRead();
+	int ret = file_tracker.GetDirStats(sub_path_name, out);
+	file_tracker_lock.unlock();
 
-	
-	QVector<Media*> tmp_media_vec;
-	
-	media_list_lock.lockForRead();
+	return ret;
+}
 
-	global_media_list.GetAllMediaPtr(&tmp_media_vec);
+void
+Daemon::GetStats(DaemonStats* out) {
+	tag_list_lock.lockForRead();
+	out->tag_count = global_tag_list.GetSize();
+	out->link_count = global_tag_list.GetLinkCount();
+	out->tag_list_bytes = global_tag_list.EstimateMemory();
+	tag_list_lock.unlock();
 
-	MediaModelResult result;
+	media_list_lock.lockForRead();
+	out->media_count = global_media_list.GetSize();
+	out->media_list_bytes = global_media_list.EstimateMemory();
+	media_list_lock.unlock();
 
-	result.model_media_list.reserve(tmp_media_vec.size());
+	file_tracker_lock.lockForRead();
+	out->dir_count = file_tracker.GetDirCount();
+	out->file_tracker_bytes = file_tracker.EstimateMemory();
+	file_tracker_lock.unlock();
+}
 
-	for (auto iter = tmp_media_vec.begin(); iter != tmp_media_vec.end(); iter++) {
+MediaModelResult
+Daemon::GetAllMedia() {
+	std::shared_ptr<const IndexSnapshot> snapshot = index_snapshot.Pin();
 
-		result.model_media_list.push_back((*iter)->FormModelMedia(abs_root_dir) );
-	}
+	MediaModelResult result;
+	result.model_media_list.reserve(snapshot->GetMediaCount());
 
-	media_list_lock.unlock();
+	snapshot->ForEachMedia([this, &result](const Media& media) {
+		result.model_media_list.push_back(media.FormModelMedia(abs_root_dir));
+	});
 
 	return result;
 }
 
 MediaModelResult
 Daemon::GetAllTaglessMedia() {
-	QVector<Media*> tmp_media_vec;
-
-	media_list_lock.lockForRead();
-
-	global_media_list.GetAllMediaPtr(&tmp_media_vec);
+	std::shared_ptr<const IndexSnapshot> snapshot = index_snapshot.Pin();
 
 	MediaModelResult result;
-	result.model_media_list.reserve(tmp_media_vec.size());
-
-	for (auto iter = tmp_media_vec.begin(); iter != tmp_media_vec.end(); iter++) {
 
-		if (!(*iter)->tag_id_list.empty()) {
-			continue;
+	snapshot->ForEachMedia([this, &result](const Media& media) {
+		if (media.tag_id_list.empty()) {
+			result.model_media_list.push_back(media.FormModelMedia(abs_root_dir));
 		}
-
-		result.model_media_list.push_back((*iter)->FormModelMedia(abs_root_dir));
-	}
-
-	media_list_lock.unlock();
+	});
 
 	return result;
 }
@@ -808,34 +1400,23 @@ MediaModelResult
 Daemon::GetTagMedias(const unsigned int tag_id) {
 	MediaModelResult result;
 
-	Tag tag_buff;
-
-	tag_list_lock.lockForRead();
-
-	if (!global_tag_list.TagExistById(tag_id)) {
-		tag_list_lock.unlock();
+	std::shared_ptr<const IndexSnapshot> snapshot = index_snapshot.Pin();
 
+	const Tag* tag = snapshot->GetTagById(tag_id);
+	if (tag == nullptr) {
 		return result;
 	}
 
-	media_list_lock.lockForRead();
-
-	global_tag_list.GetTagById(tag_id, &tag_buff);
-
-	result.model_media_list.reserve(tag_buff.media_id_list.size());
-
-	Media media_buff;
+	result.model_media_list.reserve(tag->media_id_list.size());
 
-	for (auto iter = tag_buff.media_id_list.begin(); iter != tag_buff.media_id_list.end(); iter++) {
-
-		global_media_list.GetMediaById(*iter, &media_buff);
-		
-		result.model_media_list.push_back(media_buff.FormModelMedia(abs_root_dir));
+	//both sides of a link are published together, every media of the tag is there
+	for (auto iter = tag->media_id_list.constBegin(); iter != tag->media_id_list.constEnd(); iter++) {
+		const Media* media = snapshot->GetMediaById(*iter);
+		if (media != nullptr) {
+			result.model_media_list.push_back(media->FormModelMedia(abs_root_dir));
+		}
 	}
 
-	tag_list_lock.unlock();
-	media_list_lock.unlock();
-
 	result.associated_tag_id_set.insert(tag_id);
 
 	return result;
@@ -847,31 +1428,44 @@ Daemon::GetQueryMedia(const QString& raw_query_str) {
 	MediaModelResult result;
 	Query query(raw_query_str);
 
+	//every tag term and the returned media come from one snapshot, dir terms do not, see header
+	std::shared_ptr<const IndexSnapshot> snapshot = index_snapshot.Pin();
 
-	auto get_tag_media_list_handler = [this, &result](const QString& tag_name, QSet<unsigned int> *out) {
-
-		Tag tag_buff;
-
-		this->tag_list_lock.lockForRead();
+	auto get_tag_media_list_handler = [&snapshot, &result](const QString& tag_name, QSet<unsigned int> *out) {
 
-		if (!this->global_tag_list.TagExistByName(tag_name)) {
+		const Tag* tag = snapshot->GetTagByName(tag_name);
+		if (tag == nullptr) {
 			Logger::Log("Tag name: " % tag_name % " doesn't exist", LogEntry::LT_ERROR);
-			this->tag_list_lock.unlock();
 			return -1;
 		}
 
-		this->global_tag_list.GetTagByName(tag_name, &tag_buff);
-		this->tag_list_lock.unlock();
-
-		*out = std::move(tag_buff.media_id_list);
-		result.associated_tag_id_set.insert(tag_buff.id);
+		*out = tag->media_id_list;
+		result.associated_tag_id_set.insert(tag->id);
 
 		return 1;
 	};
 
+	//dirs are not in the snapshot, read live under the file tracker lock
+	auto get_dir_media_list_handler = [this](const QString& sub_path, bool recursive, QSet<unsigned int> *out) {
+
+		QString native_sub_path = QDir::toNativeSeparators(sub_path);
+		if (native_sub_path.endsWith('\\')) {
+			native_sub_path.chop(1);
+		}
+
+		this->file_tracker_lock.lockForRead();
+		int ret = this->file_tracker.GetDirMediaIdSet(native_sub_path, recursive, out);
+		this->file_tracker_lock.unlock();
+
+		if (ret < 0) {
+			Logger::Log("Dir: " % sub_path % " is not tracked", LogEntry::LT_ERROR);
+			return -1;
+		}
 
+		return 1;
+	};
 
-	if (query.Tokenize(get_tag_media_list_handler) < 0) {
+	if (query.Tokenize(get_tag_media_list_handler, get_dir_media_list_handler) < 0) {
 		Logger::Log("Failed tokenizing query", LogEntry::LT_ERROR);
 		result.associated_tag_id_set.clear();
 		return result;
@@ -913,17 +1507,13 @@ Daemon::GetQueryMedia(const QString& raw_query_str) {
 		return result;
 	}
 
-	media_list_lock.lockForRead();
-
-	Media media_buff;
+	//dir terms may name media not published yet or already gone from the snapshot, those are left out
 	for (unsigned int media_id : query.result) {
-		if(global_media_list.MediaExistById(media_id)) {
-			global_media_list.GetMediaById(media_id, &media_buff);
-			
-			result.model_media_list.push_back(media_buff.FormModelMedia(abs_root_dir));
+		const Media* media = snapshot->GetMediaById(media_id);
+		if (media != nullptr) {
+			result.model_media_list.push_back(media->FormModelMedia(abs_root_dir));
 		}
 	}
-	media_list_lock.unlock();
 
 	Logger::Log("Query processed", LogEntry::LT_SUCCESS);
 	return result;
@@ -932,35 +1522,25 @@ Daemon::GetQueryMedia(const QString& raw_query_str) {
 QVector<ModelTag>
 Daemon::GetMediaTags(const unsigned int media_id) {
 	QVector<ModelTag> ret_vec;
-	QVector<unsigned int> tag_ids;
-
-	tag_list_lock.lockForRead();
-	media_list_lock.lockForRead();
 
-	if (!global_media_list.MediaExistById(media_id)) {
-		tag_list_lock.unlock();
-		media_list_lock.unlock();
+	std::shared_ptr<const IndexSnapshot> snapshot = index_snapshot.Pin();
 
+	const Media* media = snapshot->GetMediaById(media_id);
+	if (media == nullptr) {
 		return ret_vec;
 	}
 
-	global_media_list.GetMediaTagIds(media_id, &tag_ids);
-
-	ret_vec.reserve(tag_ids.size());
+	ret_vec.reserve(media->tag_id_list.size());
 
 	ModelTag m_tag_buff;
-	Tag tag_buff;
-	for (auto iter = tag_ids.begin(); iter != tag_ids.end(); iter++) {
-		global_tag_list.GetTagById(*iter, &tag_buff);
-
-		tag_buff.FormModelTag(&m_tag_buff);
-
-		ret_vec.push_back(m_tag_buff);
+	for (auto iter = media->tag_id_list.constBegin(); iter != media->tag_id_list.constEnd(); iter++) {
+		const Tag* tag = snapshot->GetTagById(*iter);
+		if (tag != nullptr) {
+			tag->FormModelTag(&m_tag_buff);
+			ret_vec.push_back(m_tag_buff);
+		}
 	}
 
-	tag_list_lock.unlock();
-	media_list_lock.unlock();
-
 	return ret_vec;
 }
 
@@ -968,19 +1548,15 @@ QVector<ModelTag>
 Daemon::GetAllTags() {
 	QVector<ModelTag> ret_vec;
 
-	QVector<Tag> tag_vec;
+	std::shared_ptr<const IndexSnapshot> snapshot = index_snapshot.Pin();
 
-	tag_list_lock.lockForRead();
-
-	global_tag_list.GetAllTags(&tag_vec);
+	ret_vec.reserve(snapshot->GetTagCount());
 
 	ModelTag m_tag_buff;
-	for (auto iter = tag_vec.begin(); iter != tag_vec.end(); iter++) {
-		iter->FormModelTag(&m_tag_buff);
+	snapshot->ForEachTag([&ret_vec, &m_tag_buff](const Tag& tag) {
+		tag.FormModelTag(&m_tag_buff);
 		ret_vec.push_back(m_tag_buff);
-	}
-
-	tag_list_lock.unlock();
+	});
 
 	return ret_vec;
 }
@@ -989,83 +1565,113 @@ Daemon::GetAllTags() {
 void
 Daemon::run() {
 
+	Metrics::SetThreadName("daemon");
+
 	Init();
 
+	//hash workers wake this thread up with an apc whenever a hash is ready
+	DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &monitor_thread_handle, 0, false, DUPLICATE_SAME_ACCESS);
+	hash_service.SetResultNotify([this]() {
+		QueueUserAPC(&HashResultReadyRoutine, monitor_thread_handle, 0);
+	});
+	hash_service.Start(notify_config.hash_workers);
+
 	//enters monitoring loop - calls ReadDirectoryChangesW and process results
 	Notify notifier(abs_root_dir.toStdWString());
+	notifier.SetBufferSize(notify_config.buffer_size_kb * 1024, notify_config.max_buffer_size_kb * 1024);
 	notifier.InitHandle();
 
+	//holds modify storms and short lived files back until they settle
+	EventCoalescer coalescer(notify_config.quiet_msec, notify_config.max_hold_msec);
+
+	//removed files wait here for a CREATE that turns them into a move
+	pending_remove_table.SetWindow(notify_config.move_window_msec);
+
 	NotifyEvent notify_event;
+	bool request_changes = true;		//only one io request outstanding at a time, issue a new one after its completion
+	bool request_failed = false;		//logged once per outage, notifier rescans the tree once watching again
 
 	for (;;) {
 
 		//immediate send an io request then tries to do somework 
-		notifier.RequestChanges();
+		if (request_changes) {
+			if (notifier.RequestChanges() > 0) {
+				if (request_failed) {
+					Logger::Log("Watching root dir again, rescanning", LogEntry::LT_ATTN);
+				}
 
-		//see if there's events to be processed
+				request_changes = false;
+				request_failed = false;
+			}
+			else if (!request_failed) {
+				Logger::Log("Failed to watch root dir, error " % QString::number(notifier.GetRequestError()) % ", retrying", LogEntry::LT_ERROR);
+				request_failed = true;
+			}
+		}
+
+		ApplyHashResults();
+
+		//everything notifier collected goes through coalescer first
 		while (notifier.HasEvent()) {
 			notifier.GetNextEvent(&notify_event);
+			coalescer.Push(notify_event);
+		}
 
-			//skip this event because it has been processed fron previous iteration
-			if (notify_event.event == NotifyEvent::RENAME_SKIP) {
-				Logger::Log("Evt: RENAME NEW: " % QString::fromStdWString(notify_event.file_wname) % "\tPath: " % QString::fromStdWString(notify_event.dir_wname), LogEntry::LT_MONITOR);
-				continue;
-			}
+		coalescer.ReleaseExpired();
 
-			ProcessNotifyEvent(notify_event, notifier);
-		}
+		//see if there's events to be processed
+		ProcessNotifyEvents(coalescer);
 
+		//removals nobody claimed within the window are real deletes
+		ExpirePendingRemoves(coalescer);
 
-		if (file_tracker.soft_del_flag) {
+		//everything this pass changed becomes visible to readers at once
+		PublishIndexSnapshot();
 
-			//put to alertable state wait
+		//wake up when the next removal expires or the next held event is due
+		DWORD wait_msec = INFINITE;
 
-			//give 1 second until next events come
-			int wait_ret = WaitForSingleObjectEx(monitor_terminate_event, 1000, true);
-			
-			if (wait_ret == WAIT_OBJECT_0) {
-				
-				//wait disturbed by terminate event being signaled
-				if (file_tracker.soft_del_dir_flag) {
-					RemoveDir(file_tracker.soft_del_dir_sub_path_name);
-				}
-				else {
-					RemoveMedia(file_tracker.soft_del_media.id);
-				}
-				
-				file_tracker.soft_del_flag = false;
-				break;
+		int next_expire_msec = pending_remove_table.NextExpireMsec(GetTickCount64());
+		if (next_expire_msec >= 0) {
+			wait_msec = next_expire_msec;
+		}
 
-			}
-			else if (wait_ret == WAIT_IO_COMPLETION) {
-				//receieved another event
-				continue;
-			}
-			else if (wait_ret == WAIT_TIMEOUT) {
-				
-				// no events within the waited period - hard delete
-				if (file_tracker.soft_del_dir_flag) {
-					RemoveDir(file_tracker.soft_del_dir_sub_path_name);
-				}
-				else {
-					RemoveMedia(file_tracker.soft_del_media.id);
-				}
-				file_tracker.soft_del_flag = false;
-			}
-			
+		int next_release_msec = coalescer.NextReleaseMsec();
+		if (next_release_msec >= 0 && (DWORD) next_release_msec < wait_msec) {
+			wait_msec = next_release_msec;
+		}
+
+		//no completion routine is coming to wake us for a request that failed
+		if (request_changes && wait_msec > NOTIFY_REQUEST_RETRY_MSEC) {
+			wait_msec = NOTIFY_REQUEST_RETRY_MSEC;
 		}
 
 		//put to alertable state wait
-		int wait_ret = WaitForSingleObjectEx(monitor_terminate_event, INFINITE, true);
+		int wait_ret = WaitForSingleObjectEx(monitor_terminate_event, wait_msec, true);
+
 		//wait disturbed by terminate event being signaled
 		if (wait_ret == WAIT_OBJECT_0) {
+
+			QVector<PendingRemove> pending_list;
+			pending_remove_table.TakeAll(&pending_list);
+			HardDeletePendingRemoves(pending_list);
+
+			//events still held are picked up by media validation and discovery on next start
 			break;
 		}
 		
-		//wait disturbed by completion routine here
+		//wait disturbed by completion routine or a finished hash here
+		if (wait_ret == WAIT_IO_COMPLETION) {
+			request_changes = !notifier.IsIoPending();
+		}
 	}
 
+	//hashes not stored yet stay empty in db and are picked up again on next start
+	hash_service.Stop();
+	io_scheduler.Stop();
+
 	//clean up after thread finishes
+	CloseHandle(monitor_thread_handle);
 	CloseHandle(monitor_terminate_event);
 
 	Logger::Log("Daemon thread ends", LogEntry::LT_SUCCESS);
@@ -1127,6 +1733,15 @@ Daemon::Init() {
 	}
 	Logger::Log(QString::number(db_media_vector.size()) % " media loaded", LogEntry::LT_SUCCESS);
 
+	//reads for every hash from here on, startup fingerprinting included
+	IOSchedulerConfig io_config;
+	io_config.rotational_readers = notify_config.io_readers_rotational;
+	io_config.solid_readers = notify_config.io_readers_solid;
+	io_config.network_readers = notify_config.io_readers_network;
+	io_config.pool_blocks = notify_config.io_buffers;
+	io_scheduler.SetConfig(io_config);
+	io_scheduler.Start();
+
 	Logger::Log("Validating loaded media...", LogEntry::LT_ATTN);
 	QVector<MediaInfo> soft_delete_media_vec;
 	ValidateMedia(db_media_vector, &soft_delete_media_vec);
@@ -1137,6 +1752,7 @@ Daemon::Init() {
 
 	if (!soft_delete_media_vec.empty()) {
 		Logger::Log("Resolving soft deleted media...", LogEntry::LT_ATTN);
+		FingerprintMoveCandidates(new_media_list, soft_delete_media_vec);
 		ResolveNewAndSoftDeletedMedia(soft_delete_media_vec, new_media_list);
 	}
 
@@ -1182,6 +1798,11 @@ Daemon::Init() {
 		return;
 	}
 
+	//anything read before loading finished is stale
+	BumpGeneration();
+	PublishIndexSnapshot();
+
+	initialized = true;
 	emit Initialized();
 
 	Logger::Log("Daemon intialized", LogEntry::LT_SUCCESS);
@@ -1298,8 +1919,10 @@ Daemon::ValidateMedia(QVector<MediaInfo>& db_media_vec, QVector<MediaInfo>* soft
 	while (iter != db_media_vec.end()) {
 
 		QString sub_path_name = iter->GetSubpathLongName();
+		qint64 last_size = iter->size;
 
-		if (!PathUtil::FileExistsW((abs_root_dir + sub_path_name).toStdWString())) {
+		//size in db is from when the file was last seen, vanished media keep it for move detection
+		if (!PathUtil::GetFileSizeW((abs_root_dir + sub_path_name).toStdWString(), &iter->size)) {
 			soft_delete_media_vec->push_back(std::move(*iter));
 
 			iter = db_media_vec.erase(iter);
@@ -1322,7 +1945,19 @@ Daemon::ValidateMedia(QVector<MediaInfo>& db_media_vec, QVector<MediaInfo>* soft
 			continue;
 		}
 
+		//changed while nobody was watching, hashes describe what it used to be
+		if (last_size != -1 && last_size != iter->size) {
+			iter->hash.clear();
+			iter->quick_hash.clear();
+		}
+
 		global_media_list.InsertMedia(*iter);	//TODO:: add move semantic to media list
+
+		//hash was still pending when last run ended, is stale, or was made by another algorithm than configured
+		if (iter->hash.isEmpty() || iter->quick_hash.isEmpty() || iter->hash_algo != notify_config.hash_algo) {
+			SubmitMediaHash(*iter, HashService::BACKFILL);
+		}
+
 		iter++;
 	}
 
@@ -1360,19 +1995,22 @@ Daemon::LoadFilenameToTagMap() {
 }
 
 int
-Daemon::DiscoverNewMedia(QVector<MediaInfo>& new_media_list) {
+Daemon::DiscoverNewMedia(QVector<MediaInfo>& new_media_list, const QString& sub_path /*= QString()*/) {
 
-	QStack<QString> dir_stack;
+	QStack<QPair<QString, IgnoreDirState>> dir_stack;		//dir to list and its ignore state, children are matched from it
 	QString curr_dir;
+	IgnoreDirState curr_ignore_state;
 	HANDLE find_handle;
 	WIN32_FIND_DATAW find_data_buff;
 
 	curr_dir = abs_root_dir;
+	curr_dir.append(sub_path);
 	curr_dir.append("\\*");
-	dir_stack.push(curr_dir);
+	dir_stack.push(qMakePair(curr_dir, ignore_list.GetDirState(sub_path)));
 
 	while (!dir_stack.empty()) {
-		curr_dir = dir_stack.top();
+		curr_dir = dir_stack.top().first;
+		curr_ignore_state = dir_stack.top().second;
 		dir_stack.pop();
 
 		MediaInfo m_info_buff;
@@ -1400,21 +2038,26 @@ Daemon::DiscoverNewMedia(QVector<MediaInfo>& new_media_list) {
 			//is directory
 			if (find_data_buff.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
 
-				//add this name to file tracker
-				file_tracker.AddDirAbsPath(curr_dir, QString::fromStdWString(find_data_buff.cFileName), QString::fromStdWString(find_data_buff.cAlternateFileName));
-
 				QString tmp_dir = curr_dir;
 				tmp_dir.push_back('\\');
 				tmp_dir.append(QString::fromStdWString(find_data_buff.cFileName));
 
+				//add this name to file tracker, rescan walks over dirs that are already tracked
+				if (!file_tracker.DirExistAbs(tmp_dir)) {
+					file_tracker_lock.lockForWrite();
+					file_tracker.AddDirAbsPath(curr_dir, QString::fromStdWString(find_data_buff.cFileName), QString::fromStdWString(find_data_buff.cAlternateFileName));
+					file_tracker_lock.unlock();
+				}
+
 				//if this dir is ignored then do not traverse
-				if (ignore_list.MatchIgnoreDir(tmp_dir.mid(abs_root_dir.size()))) {
+				IgnoreDirState dir_ignore_state;
+				if (ignore_list.MatchIgnoreDir(curr_ignore_state, QString::fromStdWString(find_data_buff.cFileName), &dir_ignore_state)) {
 					continue;
 				}
 
 				//add to traverse stack
 				tmp_dir.append("\\*");
-				dir_stack.push(tmp_dir);
+				dir_stack.push(qMakePair(tmp_dir, dir_ignore_state));
 				continue;
 			}
 
@@ -1425,28 +2068,35 @@ Daemon::DiscoverNewMedia(QVector<MediaInfo>& new_media_list) {
 				sub_path.clear();
 			}
 
+			QString long_name = QString::fromStdWString(find_data_buff.cFileName);
+
 			QString sub_path_name = sub_path;
 			sub_path_name.push_back(L'\\');
-			sub_path_name.append(QString::fromStdWString(find_data_buff.cFileName));
+			sub_path_name.append(long_name);
 
 			//QString res = sub_path_name;
 
 			//this media was found in lookup table
-			if (global_media_list.MediaExistBySubpathName(sub_path_name)) {
+			media_list_lock.lockForRead();
+			bool media_exist = global_media_list.MediaExistBySubpathName(sub_path_name);
+			media_list_lock.unlock();
+
+			if (media_exist) {
 				//res = res % "Exist";
 				continue;
 			}
 
 			//skip this file if ignored
-			if (ignore_list.MatchIgnore(sub_path_name)) {
+			if (ignore_list.MatchIgnore(curr_ignore_state, long_name)) {
 				continue;
 			}
 
 			//Logger::Log(res);
 		
 			m_info_buff.sub_path = sub_path;
-			m_info_buff.long_name = QString::fromStdWString(std::wstring(find_data_buff.cFileName));
+			m_info_buff.long_name = long_name;
 			m_info_buff.short_name = QString::fromStdWString(std::wstring(find_data_buff.cAlternateFileName));
+			m_info_buff.size = ((qint64) find_data_buff.nFileSizeHigh << 32) | find_data_buff.nFileSizeLow;
 			new_media_list.push_back(m_info_buff);
 
 		} while (FindNextFileW(find_handle, &find_data_buff) != 0);
@@ -1459,53 +2109,125 @@ Daemon::DiscoverNewMedia(QVector<MediaInfo>& new_media_list) {
 		FindClose(find_handle);
 	}
 
-	QtConcurrent::blockingMap(new_media_list, [this](MediaInfo& media) -> void {
-
-		if (FileUtil::GetFileSHA2(this->abs_root_dir, media) < 0) {
-			Logger::Log("Failed to calculate hash for file: " % media.long_name, LogEntry::LT_WARNING);
-			media.hash.clear();
-		}
-	});
-
+	//hashed by hash service once inserted, unless caller needs them to resolve moves
 	Logger::Log("New media discovery complete", LogEntry::LT_SUCCESS);
 	return 1;
 }
 
-int 
-Daemon::ResolveNewAndSoftDeletedMedia(QVector<MediaInfo>& soft_delete_media_vec, QVector<MediaInfo>& new_media_vec) {
-	
-	//TODO: find out how big is new media or deleted media assumption is they are small enough to use a naive linear search
-	auto find_hash = [&new_media_vec](const QString& hash, int* idx_out) -> bool {
-		for (int i = 0; i < new_media_vec.size(); i++) {
-			if (new_media_vec[i].hash == hash) {
-
-				*idx_out = i;
-				return true;
-			}
-		}
-		return false;
-	};
-
-	auto soft_delete_iter = soft_delete_media_vec.begin();
-	QVector<unsigned int> id_list;									//used to remove media from db
-	while (soft_delete_iter != soft_delete_media_vec.end()) {
+void
+Daemon::FingerprintMoveCandidates(QVector<MediaInfo>& new_media_list, const QVector<MediaInfo>& vanished_media_list) {
 
-		int idx;
-		if (find_hash(soft_delete_iter->hash, &idx)) {
+	//size first, vanished media of unknown size could be any size
+	QMultiHash<qint64, const MediaInfo*> vanished_size_table;
 
-			
-			new_media_vec[idx].id = soft_delete_iter->id;
-			global_media_list.InsertMedia(new_media_vec[idx]);	//TODO: move semantic in the future
-			media_db.UpdateMedia(new_media_vec[idx]);
-			Logger::Log("Media id: " % QString::number(soft_delete_iter->id) % " resolved. subpath: " % soft_delete_iter->sub_path % " -> " % new_media_vec[idx].sub_path
-																						  % ", name: " % soft_delete_iter->long_name % " -> " % new_media_vec[idx].long_name);
+	for (const MediaInfo& vanished_media : vanished_media_list) {
 
-			new_media_vec.remove(idx);											//new media will no longer hold it as new_media_vec will be used to add to medialist later 
-			soft_delete_iter = soft_delete_media_vec.erase(soft_delete_iter);	//remove resolved media from soft_delete_vec as the remaining media will be deleted from db later
+		//only a full hash can confirm a match, media still pending one when it vanished match nothing
+		if (vanished_media.hash.isEmpty()) {
 			continue;
 		}
 
-		id_list.push_back(soft_delete_iter->id);
+		vanished_size_table.insert(vanished_media.size, &vanished_media);
+	}
+
+	QVector<MediaInfo*> size_match_list;
+	for (MediaInfo& new_media : new_media_list) {
+		if (vanished_size_table.contains(new_media.size) || vanished_size_table.contains(-1)) {
+			size_match_list.push_back(&new_media);
+		}
+	}
+
+	if (size_match_list.empty()) {
+		return;
+	}
+
+	QtConcurrent::blockingMap(size_match_list, [this](MediaInfo* media) -> void {
+
+		Fingerprint fingerprint;
+		if (HashEngine::FileQuickHash(abs_root_dir % media->GetSubpathLongName(), &fingerprint) < 0) {
+			Logger::Log("Failed to calculate quick hash for file: " % media->long_name, LogEntry::LT_WARNING);
+			return;
+		}
+
+		media->quick_hash = fingerprint.quick_hash;
+	});
+
+	//content hash only where quick hash collides as well, or the vanished media never got a quick hash
+	QVector<MediaInfo*> quick_match_list;
+	for (MediaInfo* new_media : size_match_list) {
+
+		QList<const MediaInfo*> vanished_list = vanished_size_table.values(new_media->size) + vanished_size_table.values(-1);
+
+		for (const MediaInfo* vanished_media : vanished_list) {
+			if (new_media->quick_hash.isEmpty() || vanished_media->quick_hash.isEmpty() || new_media->quick_hash == vanished_media->quick_hash) {
+				quick_match_list.push_back(new_media);
+				break;
+			}
+		}
+	}
+
+	std::atomic_bool cancel_flag(false);
+
+	//pool threads only hash, reads go through the scheduler which sweeps each disk in path order
+	std::sort(quick_match_list.begin(), quick_match_list.end(), [](const MediaInfo* a, const MediaInfo* b) {
+		return a->GetSubpathLongName() < b->GetSubpathLongName();
+	});
+
+	QtConcurrent::blockingMap(quick_match_list, [this, &cancel_flag](MediaInfo* media) -> void {
+
+		Fingerprint fingerprint;
+		if (HashEngine::FileFingerprint(io_scheduler, abs_root_dir % media->GetSubpathLongName(), notify_config.hash_algo, cancel_flag, &fingerprint) < 0) {
+			Logger::Log("Failed to calculate hash for file: " % media->long_name, LogEntry::LT_WARNING);
+			return;
+		}
+
+		media->size = fingerprint.size;
+		media->quick_hash = fingerprint.quick_hash;
+		media->hash = fingerprint.hash;
+		media->hash_algo = fingerprint.hash_algo;
+	});
+
+	Logger::Log(QString::number(size_match_list.size()) % " new media matched a vanished size, " % QString::number(quick_match_list.size()) % " needed a full hash");
+}
+
+int 
+Daemon::ResolveNewAndSoftDeletedMedia(QVector<MediaInfo>& soft_delete_media_vec, QVector<MediaInfo>& new_media_vec) {
+	
+	//TODO: find out how big is new media or deleted media assumption is they are small enough to use a naive linear search
+	auto find_match = [&new_media_vec](const MediaInfo& vanished_media, int* idx_out) -> bool {
+
+		//media without a full hash matches nothing
+		for (int i = 0; i < new_media_vec.size(); i++) {
+			if (new_media_vec[i].SameContent(vanished_media)) {
+
+				*idx_out = i;
+				return true;
+			}
+		}
+		return false;
+	};
+
+	auto soft_delete_iter = soft_delete_media_vec.begin();
+	QVector<unsigned int> id_list;									//used to remove media from db
+	while (soft_delete_iter != soft_delete_media_vec.end()) {
+
+		int idx;
+		if (find_match(*soft_delete_iter, &idx)) {
+
+			
+			new_media_vec[idx].id = soft_delete_iter->id;
+			global_media_list.InsertMedia(new_media_vec[idx]);	//TODO: move semantic in the future
+			media_db.UpdateMedia(new_media_vec[idx]);
+
+			Logger::Log("Media id: " % QString::number(soft_delete_iter->id) % " resolved. subpath: " % soft_delete_iter->sub_path % " -> " % new_media_vec[idx].sub_path
+																						  % ", name: " % soft_delete_iter->long_name % " -> " % new_media_vec[idx].long_name);
+
+			new_media_vec.remove(idx);											//new media will no longer hold it as new_media_vec will be used to add to medialist later 
+			soft_delete_iter = soft_delete_media_vec.erase(soft_delete_iter);	//remove resolved media from soft_delete_vec as the remaining media will be deleted from db later
+			continue;
+		}
+
+		id_list.push_back(soft_delete_iter->id);
 		soft_delete_iter++;
 	}
 	
@@ -1550,47 +2272,93 @@ Daemon::PopulateDirMediaId() {
 	QVector<Media*> media_list;
 	global_media_list.GetAllMediaPtr(&media_list);
 
+	file_tracker_lock.lockForWrite();
+
 	for (const Media* m_info : media_list) {
-		file_tracker.AddMediaSubPath(m_info->sub_path, m_info->id);
+		file_tracker.AddMediaSubPath(m_info->sub_path, m_info->id, m_info->size);
 	}
 
+	file_tracker_lock.unlock();
+
 	Logger::Log("File tracker loaded", LogEntry::LT_SUCCESS);
 	return 1;
 }
 
+void
+Daemon::ProcessNotifyEvents(EventCoalescer& coalescer) {
+
+	MediaEventBatch batch;
+	NotifyEvent notify_event;
+
+	while (coalescer.HasEvent()) {
+		coalescer.GetNextEvent(&notify_event);
+
+		//skip this event because it has been processed fron previous iteration
+		if (notify_event.event == NotifyEvent::RENAME_SKIP) {
+			Logger::Log("Evt: RENAME NEW: " % QString::fromStdWString(notify_event.file_wname) % "\tPath: " % QString::fromStdWString(notify_event.dir_wname), LogEntry::LT_MONITOR);
+			continue;
+		}
+
+		if (BatchNotifyEvent(notify_event, &batch)) {
+			if (batch.Size() >= notify_config.batch_max_events) {
+				ApplyMediaEventBatch(batch);
+			}
+			continue;
+		}
+
+		//everything before this event has to be in place before it is processed
+		if (batch.Size() > 0) {
+			ApplyMediaEventBatch(batch);
+		}
+
+		ProcessNotifyEvent(notify_event, coalescer);
+	}
+
+	if (batch.Size() > 0) {
+		ApplyMediaEventBatch(batch);
+	}
+}
+
 int 
-Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
+Daemon::ProcessNotifyEvent(const NotifyEvent& event, EventCoalescer& coalescer) {
 
+	if (event.event == NotifyEvent::RESCAN) {
 
-	QString file_name = QString::fromStdWString(event.file_wname);
-	QString sub_path = QString::fromStdWString(event.dir_wname);
-	QString sub_path_name;
-	QString full_path = abs_root_dir;
+		Logger::Log("Evt: RESCAN: \tPath: " % QString::fromStdWString(event.dir_wname), LogEntry::LT_MONITOR);
 
-	MediaInfo media_buff;
-	bool dir_flag = false;
+		//the dir itself may be gone or never tracked, closest tracked ancestor still on disk covers it
+		QString rescan_sub_path = QString::fromStdWString(event.dir_wname);
+		while (!rescan_sub_path.isEmpty()) {
+			if (file_tracker.DirExist(rescan_sub_path) && PathUtil::DirectoryExistsW((abs_root_dir % '\\' % rescan_sub_path).toStdWString())) {
+				break;
+			}
 
-	if (!sub_path.isEmpty()) {
+			int slash_idx = rescan_sub_path.lastIndexOf('\\');
+			rescan_sub_path = slash_idx == -1 ? QString() : rescan_sub_path.left(slash_idx);
+		}
 
-		//if this sub path is not being tracked, it was ignored 
-		if (!file_tracker.DirExist(sub_path)) {
-			return 1;
+		if (!rescan_sub_path.isEmpty()) {
+			file_tracker.GetPathLongName(rescan_sub_path, &rescan_sub_path);
 		}
 
-		//expand path component short name if possible
-		file_tracker.GetPathLongName(sub_path, &sub_path);
+		//removals under the subtree are still tracked, rescan finds them vanished and matches them against disk itself
+		QVector<PendingRemove> pending_list;
+		pending_remove_table.TakeUnder(rescan_sub_path, &pending_list);
 
-		sub_path_name = sub_path;
-		full_path.append(sub_path_name);
+		return RescanSubtree(rescan_sub_path);
 	}
 
-	full_path.append('\\');
-	sub_path_name.append('\\');
-	sub_path_name.append(file_name);
-	full_path.append(file_name);
 
-	//skip processing if this file is ignored
-	if (ignore_list.MatchIgnore(sub_path_name)) {
+	QString file_name = QString::fromStdWString(event.file_wname);
+	QString sub_path;
+	QString sub_path_name;
+	QString full_path;
+
+	MediaInfo media_buff;
+	bool dir_flag = false;
+
+	//untracked sub path or ignored file, nothing to do
+	if (!ResolveNotifyEventPath(event, &sub_path, &sub_path_name, &full_path)) {
 		return 1;
 	}
 
@@ -1604,6 +2372,7 @@ Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
 
 			//this media doesnt exist in daemon, this file was somehow never tracked
 			if (!global_media_list.MediaExistBySubpathName(sub_path_name)) {
+				media_list_lock.unlock();
 				return -1;
 			}
 
@@ -1618,17 +2387,6 @@ Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
 		}
 	}
 
-	//need to take care of the previous soft remove first
-	if (file_tracker.soft_del_flag && event.event != NotifyEvent::CREATE) {
-		if (file_tracker.soft_del_dir_flag) {
-			RemoveDir(file_tracker.soft_del_dir_sub_path_name);
-		}
-		else {
-			RemoveMedia(file_tracker.soft_del_media.id);
-		}
-		file_tracker.soft_del_flag = false;
-	}
-
 	//call file tracker event handler
 	switch (event.event) {
 	case NotifyEvent::CREATE: {
@@ -1639,58 +2397,54 @@ Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
 		FileTracker::GetFileLongShortName(full_path, &media_buff.long_name, &media_buff.short_name);
 		media_buff.sub_path = sub_path;
 
-		if (file_tracker.soft_del_flag && (file_tracker.soft_del_dir_flag == dir_flag)) {
+		PendingRemove pending;
 
-			if (dir_flag) {
-
-				int slash_idx = file_tracker.soft_del_dir_sub_path_name.lastIndexOf('\\');
-				QString soft_del_dir_name = file_tracker.soft_del_dir_sub_path_name;
-				
-				if (slash_idx != -1) {
-					soft_del_dir_name = soft_del_dir_name.mid(slash_idx + 1);
-				}
+		if (dir_flag) {
 
-				
-				if (soft_del_dir_name == file_name) {
-					UpdateDirSubDir(file_tracker.soft_del_dir_sub_path_name, sub_path);
-					file_tracker.soft_del_flag = false;
-					break;
-				}
-			}
-			else {
-				QString new_file_hash;
-				FileUtil::GetFileSHA2(abs_root_dir, media_buff, &new_file_hash);
-				if (file_tracker.soft_del_media.long_name == media_buff.long_name && file_tracker.soft_del_media.hash == new_file_hash) {
-					//move file
-					UpdateMediaSubdir(file_tracker.soft_del_media.id, sub_path);
-					file_tracker.soft_del_flag = false;
-					break;
-				}
+			//dir removed elsewhere within the window, moved here
+			if (pending_remove_table.TakeDir(media_buff.long_name, &pending)) {
+				UpdateDirSubDir(pending.sub_path_name, sub_path);
+				break;
 			}
 
-			if (file_tracker.soft_del_dir_flag) {
-				RemoveDir(file_tracker.soft_del_dir_sub_path_name);
-			}
-			else {
-				//name does not match, hard delete
-				RemoveMedia(file_tracker.soft_del_media.id);
+			AddDir(sub_path, media_buff.long_name, media_buff.short_name);
+			break;
+		}
+
+		PathUtil::GetFileSizeW(full_path.toStdWString(), &media_buff.size);
+
+		//same name and size as a removal within the window may be a move. each stage runs only when the cheaper one collides,
+		//quick hash reads both ends of the file and only the full hash can confirm
+		if (pending_remove_table.MediaCandidateExist(media_buff.long_name, media_buff.size)) {
+
+			Fingerprint fingerprint;
+			if (HashEngine::FileQuickHash(full_path, &fingerprint) > 0) {
+				media_buff.quick_hash = fingerprint.quick_hash;
 			}
 
-			file_tracker.soft_del_flag = false;
+			//events behind this one wait for the whole file to be read, by now it is almost certainly the moved one
+			std::atomic_bool cancel_flag(false);
+			if (pending_remove_table.MediaCandidateExist(media_buff.long_name, media_buff.size, media_buff.quick_hash) &&
+				HashEngine::FileFingerprint(io_scheduler, full_path, notify_config.hash_algo, cancel_flag, &fingerprint) > 0) {
+				media_buff.hash = fingerprint.hash;
+				media_buff.hash_algo = fingerprint.hash_algo;
+			}
 
-			//dont break here because we want to perform add operation now
+			if (pending_remove_table.TakeMedia(media_buff, &pending)) {
+				MovePendingMedia(pending, sub_path);
+				break;
+			}
 		}
 
-		if (dir_flag) {
-			AddDir(sub_path, media_buff.long_name, media_buff.short_name);
+		//path taken by a new file, whatever was removed from here is gone for good
+		if (pending_remove_table.TakeBySubPathName(media_buff.GetSubpathLongName(), &pending)) {
+			HardDeletePendingRemoves({ pending });
 		}
-		else {
 
-			media_buff.id = AddMedia(sub_path, media_buff.long_name, media_buff.short_name);
+		media_buff.id = AddMedia(sub_path, media_buff.long_name, media_buff.short_name);
 
-			QVector<MediaInfo> tmp = { media_buff };
-			FormMediaMappedLink(tmp);
-		}
+		QVector<MediaInfo> tmp = { media_buff };
+		FormMediaMappedLink(tmp);
 
 		break;
 	}
@@ -1699,15 +2453,13 @@ Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
 		
 		Logger::Log("Evt: REMOVE: " % media_buff.long_name % "\tPath: " % sub_path, LogEntry::LT_MONITOR);
 
-		//need to make sure next event isnt create to actually delete, soft delete for now
-		file_tracker.soft_del_flag = true;
-		file_tracker.soft_del_dir_flag = dir_flag;
-
+		//could be the first half of a move, deleted only if no CREATE claims it within the window
 		if (dir_flag) {
-			file_tracker.soft_del_dir_sub_path_name = sub_path_name;
+			pending_remove_table.AddDir(sub_path_name, GetTickCount64());
 		}
 		else {
-			file_tracker.soft_del_media = media_buff;
+			hash_service.Cancel(media_buff.id);
+			pending_remove_table.AddMedia(media_buff, GetTickCount64());
 		}
 		
 		break;
@@ -1722,15 +2474,25 @@ Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
 
 		Logger::Log("Evt: MODIFY: " % media_buff.long_name % "\tPath: " % sub_path, LogEntry::LT_MONITOR);
 
-		QString new_hash;
-		FileUtil::GetFileSHA2(abs_root_dir, media_buff, &new_hash);
+		//old hashes no longer describe the file, pending until rehashed
+		media_buff.hash.clear();
+		media_buff.quick_hash.clear();
+		PathUtil::GetFileSizeW(full_path.toStdWString(), &media_buff.size);
 
 		media_list_lock.lockForWrite();
 
-		global_media_list.UpdateMediaHash(media_buff.id, new_hash);
+		global_media_list.UpdateMediaFingerprint(media_buff.id, MediaFingerprint(media_buff));
+		BumpMediaGeneration();
 
 		media_list_lock.unlock();
 
+		if (media_db.UpdateMedia(media_buff) < 0) {
+			Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
+			return -Error::DAEMON_DB;
+		}
+
+		SubmitMediaHash(media_buff, HashService::LIVE);
+
 		break;
 	}
 
@@ -1738,9 +2500,9 @@ Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
 
 		Logger::Log("Evt: RENAME OLD: " % media_buff.long_name % "\tPath: " % sub_path, LogEntry::LT_MONITOR);
 
-		if (notifier.HasEvent()) {
+		if (coalescer.HasEvent()) {
 			NotifyEvent next_event;
-			notifier.PeekNextEvent(&next_event);
+			coalescer.PeekNextEvent(&next_event);
 			if (next_event.event == NotifyEvent::RENAME_NEW) {
 
 				//find last back slash and replace the rest with new file name
@@ -1758,7 +2520,7 @@ Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
 					UpdateMediaName(media_buff.id, media_buff.long_name, media_buff.short_name);
 				}
 
-				notifier.UpdateNextEventTypeToSkip();
+				coalescer.UpdateNextEventTypeToSkip();
 				break;
 			}
 		}
@@ -1779,11 +2541,621 @@ Daemon::ProcessNotifyEvent(const NotifyEvent& event, Notify& notifier) {
 	return 1;
 }
 
+bool
+Daemon::ResolveNotifyEventPath(const NotifyEvent& event, QString* sub_path, QString* sub_path_name, QString* full_path) {
+
+	QString file_name = QString::fromStdWString(event.file_wname);
+
+	*sub_path = QString::fromStdWString(event.dir_wname);
+	sub_path_name->clear();
+	*full_path = abs_root_dir;
+
+	if (!sub_path->isEmpty()) {
+
+		//if this sub path is not being tracked, it was ignored 
+		if (!file_tracker.DirExist(*sub_path)) {
+			return false;
+		}
+
+		//expand path component short name if possible
+		file_tracker.GetPathLongName(*sub_path, sub_path);
+
+		*sub_path_name = *sub_path;
+		full_path->append(*sub_path_name);
+	}
+
+	full_path->append('\\');
+	sub_path_name->append('\\');
+	sub_path_name->append(file_name);
+	full_path->append(file_name);
+
+	//skip processing if this file is ignored
+	return !ignore_list.MatchIgnore(*sub_path_name);
+}
+
+bool
+Daemon::BatchNotifyEvent(const NotifyEvent& event, MediaEventBatch* batch) {
+
+	//dir events and renames change paths later events depend on
+	if (event.event != NotifyEvent::CREATE && event.event != NotifyEvent::REMOVE && event.event != NotifyEvent::MODIFY) {
+		return false;
+	}
+
+	QString sub_path;
+	QString sub_path_name;
+	QString full_path;
+
+	if (!ResolveNotifyEventPath(event, &sub_path, &sub_path_name, &full_path)) {
+		return true;
+	}
+
+	//second event on a path needs the first one applied
+	if (batch->sub_path_name_set.contains(sub_path_name)) {
+		return false;
+	}
+
+	MediaInfo media_buff;
+
+	if (event.event == NotifyEvent::CREATE) {
+
+		bool dir_flag = false;
+		FileTracker::IsDir(full_path, &dir_flag);
+		if (dir_flag) {
+			return false;
+		}
+
+		FileTracker::GetFileLongShortName(full_path, &media_buff.long_name, &media_buff.short_name);
+		media_buff.sub_path = sub_path;
+		PathUtil::GetFileSizeW(full_path.toStdWString(), &media_buff.size);
+
+		//may be the second half of a move, or take the place of a removed file
+		if (pending_remove_table.MediaCandidateExist(media_buff.long_name, media_buff.size) || pending_remove_table.SubPathNameExist(media_buff.GetSubpathLongName())) {
+			return false;
+		}
+
+		batch->add_list.push_back(media_buff);
+		batch->sub_path_name_set.insert(sub_path_name);
+		return true;
+	}
+
+	if (file_tracker.DirExist(sub_path_name)) {
+
+		//removed dir takes its subtree along unless a CREATE claims it
+		if (event.event == NotifyEvent::REMOVE) {
+			pending_remove_table.AddDir(sub_path_name, GetTickCount64());
+		}
+
+		//nothing to do for a modified dir
+		return true;
+	}
+
+	media_list_lock.lockForRead();
+
+	bool media_exist = global_media_list.MediaExistBySubpathName(sub_path_name);
+	if (media_exist) {
+		global_media_list.GetMediaInfoBySubpathName(sub_path_name, &media_buff);
+	}
+
+	media_list_lock.unlock();
+
+	//this file was somehow never tracked
+	if (!media_exist) {
+		return true;
+	}
+
+	if (event.event == NotifyEvent::MODIFY) {
+		media_buff.hash.clear();
+		media_buff.quick_hash.clear();
+		PathUtil::GetFileSizeW(full_path.toStdWString(), &media_buff.size);
+
+		batch->modify_list.push_back(media_buff);
+		batch->sub_path_name_set.insert(sub_path_name);
+		return true;
+	}
+
+	//could be the first half of a move, expired removals are deleted in batches later
+	hash_service.Cancel(media_buff.id);
+	pending_remove_table.AddMedia(media_buff, GetTickCount64());
+	return true;
+}
+
+int
+Daemon::ApplyMediaEventBatch(MediaEventBatch& batch) {
+
+	Metrics::Inc(Metrics::NOTIFY_BATCH_TOTAL);
+	Metrics::Set(Metrics::NOTIFY_BATCH_SIZE, batch.Size());
+
+	QVector<Media> removed_media_list;
+	QVector<unsigned int> link_tag_id_list;
+	QVector<unsigned int> link_media_id_list;
+	Media media_buff;
+
+	//patterns only need the path, run them before any lock is taken
+	QVector<QVector<QString>> mapped_tag_name_list;
+	mediamap.GetMappedTagsList(batch.add_list, &mapped_tag_name_list);
+
+	tag_list_lock.lockForWrite();
+	media_list_lock.lockForWrite();
+
+	for (unsigned int media_id : batch.remove_id_list) {
+
+		//removed already along with its dir
+		if (!global_media_list.MediaExistById(media_id)) {
+			continue;
+		}
+
+		global_media_list.GetMediaById(media_id, &media_buff);
+		removed_media_list.push_back(media_buff);
+	}
+
+	//databases first, memory is only touched once all of them committed
+	bool db_ok = tag_link_db.BeginTransaction() > 0 && media_db.BeginTransaction() > 0;
+
+	if (db_ok && !batch.remove_id_list.empty()) {
+		db_ok = tag_link_db.RemoveTagLinkByMediaIdList(batch.remove_id_list) > 0 && media_db.RemoveMediaList(batch.remove_id_list) > 0;
+	}
+
+	if (db_ok && !batch.modify_list.empty()) {
+		db_ok = media_db.UpdateMediaList(batch.modify_list) > 0;
+	}
+
+	if (db_ok && !batch.add_list.empty()) {
+		db_ok = media_db.InsertMediaList(batch.add_list) > 0;
+	}
+
+	if (db_ok && !batch.add_list.empty()) {
+
+		//rows inserted by one statement list get consecutive ids
+		unsigned int item_id = media_db.LastRowId();
+		for (auto iter = batch.add_list.rbegin(); iter != batch.add_list.rend(); iter++) {
+			iter->id = item_id;
+			item_id--;
+		}
+
+		for (int i = 0; i < batch.add_list.size(); i++) {
+			const MediaInfo& media = batch.add_list[i];
+
+			for (const QString& tag_name : mapped_tag_name_list[i]) {
+				if (!global_tag_list.TagExistByName(tag_name)) {
+					Logger::Log("Tag name: " % tag_name % " does not exist", LogEntry::LT_ERROR);
+					continue;
+				}
+
+				unsigned int tag_id;
+				global_tag_list.GetTagIdByName(tag_name, &tag_id);
+				link_tag_id_list.push_back(tag_id);
+				link_media_id_list.push_back(media.id);
+			}
+		}
+	}
+
+	if (db_ok && !link_tag_id_list.empty()) {
+		db_ok = tag_link_db.CreateTagLinkByTagMediaIdList(link_tag_id_list, link_media_id_list) > 0;
+	}
+
+	//media and tag link live in separate files, media go first so links on disk never point at media rows that were not written.
+	//if only the link commit fails, links of removed media are left behind and dropped by ResolveTagLinks on next start
+	bool media_db_ok = db_ok && media_db.CommitTransaction() > 0;
+	db_ok = media_db_ok && tag_link_db.CommitTransaction() > 0;
+
+	if (!db_ok) {
+		tag_link_db.RollbackTransaction();
+		Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
+
+		if (!media_db_ok) {
+			media_db.RollbackTransaction();
+
+			tag_list_lock.unlock();
+			media_list_lock.unlock();
+
+			batch.Clear();
+			return -Error::DAEMON_DB;
+		}
+
+		//media made it to disk, memory follows them without the links that didn't
+		link_tag_id_list.clear();
+		link_media_id_list.clear();
+	}
+
+	ModelMediaBatch model_batch;
+
+	file_tracker_lock.lockForWrite();
+
+	for (const Media& media : removed_media_list) {
+
+		//remove media ptr from tags that are linked with this media
+		for (unsigned int tag_id : media.tag_id_list) {
+			global_tag_list.RemoveTagMedia(tag_id, media.id);
+			model_batch.link_destroyed_list.push_back(qMakePair(tag_id, media.id));
+		}
+
+		global_media_list.RemoveMedia(media.id);
+		hash_service.Cancel(media.id);
+
+		file_tracker.RemoveMedia(media.sub_path, media.id);
+
+		model_batch.removed_id_list.push_back(media.id);
+	}
+
+	for (const MediaInfo& media : batch.modify_list) {
+		global_media_list.UpdateMediaFingerprint(media.id, MediaFingerprint(media));
+		file_tracker.UpdateMediaSize(media.sub_path, media.id, media.size);
+	}
+
+	for (const MediaInfo& media : batch.add_list) {
+		global_media_list.InsertMedia(media);
+		file_tracker.AddMediaSubPath(media.sub_path, media.id, media.size);
+		model_batch.inserted_list.push_back(media.FormModelMedia(abs_root_dir));
+	}
+
+	file_tracker_lock.unlock();
+
+	for (int i = 0; i < link_tag_id_list.size(); i++) {
+		global_media_list.InsertMediaTag(link_tag_id_list[i], link_media_id_list[i]);
+		global_tag_list.InsertTagMedia(link_tag_id_list[i], link_media_id_list[i]);
+	}
+
+	ModelTag m_tag_buff;
+	for (int i = 0; i < link_tag_id_list.size(); i++) {
+		global_tag_list.GetModelTagById(link_tag_id_list[i], &m_tag_buff);
+		model_batch.link_formed_list.push_back(qMakePair(m_tag_buff, link_media_id_list[i]));
+	}
+
+	tag_list_lock.unlock();
+	media_list_lock.unlock();
+
+	//added and modified media went in with an empty hash
+	for (const MediaInfo& media : batch.add_list) {
+		SubmitMediaHash(media, HashService::LIVE);
+	}
+
+	for (const MediaInfo& media : batch.modify_list) {
+		SubmitMediaHash(media, HashService::LIVE);
+	}
+
+	BumpMediaGeneration();
+
+	emit MediaBatchApplied(model_batch);
+
+	Logger::Log("Applied batch of " % QString::number(batch.Size()) % " events: " %
+				QString::number(batch.add_list.size()) % " added, " %
+				QString::number(batch.modify_list.size()) % " modified, " %
+				QString::number(batch.remove_id_list.size()) % " removed, " %
+				QString::number(link_tag_id_list.size()) % " links formed", db_ok ? LogEntry::LT_SUCCESS : LogEntry::LT_ERROR);
+
+	batch.Clear();
+	return db_ok ? 1 : -Error::DAEMON_DB;
+}
+
+void
+Daemon::ExpirePendingRemoves(EventCoalescer& coalescer) {
+
+	if (pending_remove_table.IsEmpty()) {
+		return;
+	}
+
+	//a CREATE still held back by coalescer may claim an expiring removal, let it through first
+	if (pending_remove_table.NextExpireMsec(GetTickCount64()) == 0 && coalescer.HeldCount() > 0) {
+		coalescer.ReleaseAll();
+		ProcessNotifyEvents(coalescer);
+	}
+
+	//sweeps the wheel even when nothing is due
+	QVector<PendingRemove> expired_list;
+	pending_remove_table.TakeExpired(GetTickCount64(), &expired_list);
+
+	HardDeletePendingRemoves(expired_list);
+}
+
+int
+Daemon::HardDeletePendingRemoves(const QVector<PendingRemove>& pending_list) {
+
+	MediaEventBatch batch;
+	QVector<QString> dir_sub_path_name_list;
+
+	for (const PendingRemove& pending : pending_list) {
+		if (pending.dir_flag) {
+			dir_sub_path_name_list.push_back(pending.sub_path_name);
+		}
+		else {
+			batch.remove_id_list.push_back(pending.media.id);
+		}
+	}
+
+	int ret = 1;
+
+	if (batch.Size() > 0) {
+		ret = ApplyMediaEventBatch(batch);
+	}
+
+	//takes along media still under the dir
+	for (const QString& dir_sub_path_name : dir_sub_path_name_list) {
+		if (file_tracker.DirExist(dir_sub_path_name)) {
+			RemoveDir(dir_sub_path_name);
+		}
+	}
+
+	return ret;
+}
+
+int
+Daemon::MovePendingMedia(const PendingRemove& pending, const QString& new_sub_path) {
+
+	//only claimed on a full hash match, the moved media keeps its hashes
+
+	if (pending.media.sub_path == new_sub_path) {
+		Logger::Log("Media id: " % QString::number(pending.media.id) % " restored in place", LogEntry::LT_SUCCESS);
+		return 1;
+	}
+
+	file_tracker_lock.lockForWrite();
+	file_tracker.RemoveMedia(pending.media.sub_path, pending.media.id);
+	file_tracker.AddMediaSubPath(new_sub_path, pending.media.id, pending.media.size);
+	file_tracker_lock.unlock();
+
+	return UpdateMediaSubdir(pending.media.id, new_sub_path);
+}
+
+void
+Daemon::SubmitMediaHash(const MediaInfo& media, HashService::Priority priority) {
+	hash_service.Submit(media.id, abs_root_dir % media.GetSubpathLongName(), priority);
+}
+
+int
+Daemon::ApplyHashResults() {
+
+	QVector<HashResult> result_list;
+	hash_service.TakeResults(&result_list);
+
+	if (result_list.empty()) {
+		return 1;
+	}
+
+	QVector<MediaInfo> hashed_media_list;
+	MediaInfo media_buff;
+
+	media_list_lock.lockForWrite();
+
+	for (const HashResult& result : result_list) {
+
+		//removed while it was being hashed
+		if (!global_media_list.MediaExistById(result.media_id)) {
+			continue;
+		}
+
+		global_media_list.GetMediaInfoById(result.media_id, &media_buff);
+
+		//moved or renamed while it was being hashed, the old path may not have been readable to the end
+		QString abs_path = abs_root_dir % media_buff.GetSubpathLongName();
+		if (abs_path != result.abs_path) {
+			hash_service.Submit(result.media_id, abs_path, HashService::LIVE);
+			continue;
+		}
+
+		if (result.ret < 0) {
+			Logger::Log("Failed to calculate hash for file: " % media_buff.long_name, LogEntry::LT_WARNING);
+			continue;
+		}
+
+		global_media_list.UpdateMediaFingerprint(result.media_id, result.fingerprint);
+
+		file_tracker_lock.lockForWrite();
+		file_tracker.UpdateMediaSize(media_buff.sub_path, result.media_id, result.fingerprint.size);
+		file_tracker_lock.unlock();
+
+		BumpMediaGeneration();
+
+		media_buff.size = result.fingerprint.size;
+		media_buff.quick_hash = result.fingerprint.quick_hash;
+		media_buff.hash = result.fingerprint.hash;
+		media_buff.hash_algo = result.fingerprint.hash_algo;
+		hashed_media_list.push_back(media_buff);
+	}
+
+	media_list_lock.unlock();
+
+	if (hashed_media_list.empty()) {
+		return 1;
+	}
+
+	int ret = hashed_media_list.size() > 1 ? media_db.UpdateMediaList(hashed_media_list) : media_db.UpdateMedia(hashed_media_list[0]);
+	if (ret < 0) {
+		Logger::Log(DAEMON_DB_MSG, LogEntry::LT_ERROR);
+		return -Error::DAEMON_DB;
+	}
+
+	for (const MediaInfo& media : hashed_media_list) {
+		emit MediaHashUpdated(media.id, media.hash);
+	}
+
+	Logger::Log(QString::number(hashed_media_list.size()) % " media hashed, " % QString::number(hash_service.GetPendingCount()) % " pending", LogEntry::LT_SUCCESS);
+	return 1;
+}
+
+int
+Daemon::RescanSubtree(const QString& sub_path) {
+
+	Metrics::Inc(Metrics::NOTIFY_RESCAN_TOTAL);
+	Logger::Log("Rescanning: " % (sub_path.isEmpty() ? QString("\\") : sub_path) % "...", LogEntry::LT_ATTN);
+
+	//media tracked under this subtree that are not on disk anymore
+	QVector<unsigned int> tracked_media_id_list;
+	QVector<MediaInfo> vanished_media_list;
+	MediaInfo media_buff;
+
+	file_tracker.GetDirMediaIdRecurByPath(sub_path, &tracked_media_id_list);
+
+	media_list_lock.lockForRead();
+	for (unsigned int media_id : tracked_media_id_list) {
+		if (!global_media_list.MediaExistById(media_id)) {
+			continue;
+		}
+
+		global_media_list.GetMediaInfoById(media_id, &media_buff);
+
+		if (!PathUtil::FileExistsW((abs_root_dir % media_buff.GetSubpathLongName()).toStdWString())) {
+			vanished_media_list.push_back(media_buff);
+		}
+	}
+	media_list_lock.unlock();
+
+	//dirs tracked under this subtree that are not on disk anymore
+	//list is pre order, descendants of a vanished dir go with it
+	QVector<QString> tracked_dir_list;
+	QVector<QString> vanished_dir_list;
+
+	file_tracker.GetDirSubPathRecur(sub_path, &tracked_dir_list);
+
+	for (const QString& dir_sub_path_name : tracked_dir_list) {
+		if (!vanished_dir_list.empty() && dir_sub_path_name.startsWith(vanished_dir_list.back() % '\\')) {
+			continue;
+		}
+
+		if (!PathUtil::DirectoryExistsW((abs_root_dir % dir_sub_path_name).toStdWString())) {
+			vanished_dir_list.push_back(dir_sub_path_name);
+		}
+	}
+
+	//files and dirs on disk that are not tracked yet
+	QVector<MediaInfo> new_media_list;
+	DiscoverNewMedia(new_media_list, sub_path);
+
+	if (!vanished_media_list.empty()) {
+		FingerprintMoveCandidates(new_media_list, vanished_media_list);
+	}
+
+	//vanished media showing up again with the same content was moved or renamed while events were lost
+	QVector<unsigned int> removed_media_id_list;
+	for (const MediaInfo& vanished_media : vanished_media_list) {
+
+		int found_idx = -1;
+		for (int i = 0; i < new_media_list.size(); i++) {
+			if (new_media_list[i].SameContent(vanished_media)) {
+				found_idx = i;
+				break;
+			}
+		}
+
+		if (found_idx == -1) {
+			removed_media_id_list.push_back(vanished_media.id);
+			continue;
+		}
+
+		const MediaInfo& found_media = new_media_list[found_idx];
+
+		if (found_media.sub_path != vanished_media.sub_path) {
+			file_tracker_lock.lockForWrite();
+			file_tracker.RemoveMedia(vanished_media.sub_path, vanished_media.id);
+			file_tracker.AddMediaSubPath(found_media.sub_path, vanished_media.id, found_media.size);
+			file_tracker_lock.unlock();
+			UpdateMediaSubdir(vanished_media.id, found_media.sub_path);
+		}
+
+		if (found_media.long_name != vanished_media.long_name) {
+			UpdateMediaName(vanished_media.id, found_media.long_name, found_media.short_name);
+		}
+
+		new_media_list.remove(found_idx);
+	}
+
+	if (removed_media_id_list.size() > 1) {
+		RemoveMediaList(removed_media_id_list);
+	}
+	else if (removed_media_id_list.size() == 1) {
+		RemoveMedia(removed_media_id_list[0]);
+	}
+
+	//media under these are handled above, this only drops the dir nodes
+	for (const QString& dir_sub_path_name : vanished_dir_list) {
+		RemoveDir(dir_sub_path_name);
+	}
+
+	if (!new_media_list.empty()) {
+
+		if (new_media_list.size() > 1) {
+			AddMediaList(new_media_list);
+		}
+		else if (new_media_list.size() == 1) {
+			new_media_list[0].id = AddMedia(new_media_list[0].sub_path,
+				new_media_list[0].long_name,
+				new_media_list[0].short_name,
+				new_media_list[0].hash);
+		}
+
+		FormMediaMappedLink(new_media_list);
+	}
+
+	Logger::Log("Rescan complete: " % QString::number(new_media_list.size()) % " added, " % QString::number(removed_media_id_list.size()) % " removed, " % QString::number(vanished_media_list.size() - removed_media_id_list.size()) % " moved", LogEntry::LT_SUCCESS);
+	return 1;
+}
+
+void
+Daemon::BumpGeneration() {
+	generation++;
+}
+
+void
+Daemon::BumpMediaGeneration() {
+	media_generation = ++generation;
+}
+
+void
+Daemon::BumpTagGeneration(const unsigned int tag_id) {
+	quint64 new_generation = ++generation;
+
+	tag_generation_lock.lock();
+	tag_generation_table.insert(tag_id, new_generation);
+	tag_generation_lock.unlock();
+}
+
+void
+Daemon::PublishIndexSnapshot() {
+	QSet<unsigned int> tag_id_set;
+	QSet<unsigned int> media_id_set;
+
+	Tag tag_buff;
+	Media media_buff;
+
+	//write locks keep other writers out while changed ids are taken, readers of the snapshot never wait on them
+	tag_list_lock.lockForWrite();
+	media_list_lock.lockForWrite();
+
+	global_tag_list.TakeChangedIds(&tag_id_set);
+	global_media_list.TakeChangedIds(&media_id_set);
+
+	for (unsigned int tag_id : tag_id_set) {
+		if (global_tag_list.TagExistById(tag_id)) {
+			global_tag_list.GetTagById(tag_id, &tag_buff);
+			index_snapshot.SetTag(tag_buff);
+		}
+		else {
+			index_snapshot.RemoveTag(tag_id);
+		}
+	}
+
+	for (unsigned int media_id : media_id_set) {
+		if (global_media_list.MediaExistById(media_id)) {
+			global_media_list.GetMediaById(media_id, &media_buff);
+			index_snapshot.SetMedia(media_buff);
+		}
+		else {
+			index_snapshot.RemoveMedia(media_id);
+		}
+	}
+
+	//every change made so far is in memory and taken above, so the snapshot is at least this new
+	index_snapshot.Publish(generation.load());
+
+	media_list_lock.unlock();
+	tag_list_lock.unlock();
+}
+
 int 
 Daemon::FormLink(const unsigned int tag_id, const unsigned int media_id) {
 
 	global_tag_list.InsertTagMedia(tag_id, media_id);
 	global_media_list.InsertMediaTag(tag_id, media_id);
+	BumpTagGeneration(tag_id);
 
 	//update to database
 	if (tag_link_db.CreateTagLink(tag_id, media_id) < 0) {
@@ -1796,6 +3168,8 @@ Daemon::FormLink(const unsigned int tag_id, const unsigned int media_id) {
 	tag_list_lock.unlock();
 	media_list_lock.unlock();
 
+	PublishIndexSnapshot();
+
 	Tag tag_buff;
 	ModelTag m_tag_buff;
 
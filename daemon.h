@@ -2,10 +2,17 @@
 
 #include <QThread>
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QHash>
 
 #include <list>
+#include <atomic>
 
 #include "notify.h"
+#include "event_coalescer.h"
+#include "pending_remove.h"
+#include "hash_service.h"
+#include "io_scheduler.h"
 #include "db.h"
 #include "config.h"
 #include "logger.h"
@@ -15,6 +22,8 @@
 #include "track_ignore.h"
 #include "file_tracker.h"
 #include "media_map.h"
+#include "metered_lock.h"
+#include "index_snapshot.h"
 
 
 
@@ -103,6 +112,18 @@
 	in critical sections in the thread where validity checking is involved.
 */
 
+//sizes of in memory structures, bytes are rough estimates
+struct DaemonStats {
+	quint64 tag_count = 0;
+	quint64 media_count = 0;
+	quint64 link_count = 0;
+	quint64 dir_count = 0;
+
+	quint64 tag_list_bytes = 0;
+	quint64 media_list_bytes = 0;
+	quint64 file_tracker_bytes = 0;
+};
+
 class Daemon : public QThread {
 
 	Q_OBJECT
@@ -113,6 +134,9 @@ public:
 	
 	void Stop();
 
+	//call before start()
+	void SetNotifyConfig(const NotifyConfig& config);
+
 	QString GetRootDirectory();
 
 	//tag ops 
@@ -131,8 +155,19 @@ public:
 
 	int FormMediaMappedLink(const QVector<MediaInfo>& media_list);
 
+	//links every (tag id, media id) pair under one lock and one db insert, unknown or existing links are skipped
+	int FormLinkList(const QVector<QPair<unsigned int, unsigned int>>& link_list);
+
 	int DestroyLink(const unsigned int tag_id, const unsigned int media_id);
 
+	/*
+		Applies every op in order under one lock and one transaction per database, later ops see
+		what earlier ones did. Either all of them are applied or none, result_list gets one entry
+		per op. Op failures: -1 tag missing or name taken, -2 media missing, -3 link already in
+		the state asked for.
+	*/
+	int ApplyTagOpList(const QVector<TagOp>& op_list, QVector<TagOpResult>* result_list);
+
 	//media ops
 
 	int AddMedia(const QString& sub_path, const QString& long_name, const QString& short_name, const QString& hash = QString());
@@ -149,6 +184,13 @@ public:
 
 	int RemoveMediaList(const QVector<unsigned int>& media_id_list);
 
+	//rehash ahead of everything else waiting, result arrives through MediaHashUpdated
+	int RegenerateMediaHash(const unsigned int media_id);
+
+	//groups of media ids with the same content. staged by size, quick hash, then content hash
+	//media whose content hash is still pending are queued for it and left out until a later call
+	int FindDuplicateMedia(QVector<QVector<unsigned int>>* group_list_out);
+
 	//filetracker ops
 
 	int AddDir(const QString& sub_path, const QString& long_name, const QString& short_name);
@@ -159,7 +201,35 @@ public:
 	
 	int RemoveDir(const QString& sub_path_name);
 
-	//thread callbacks
+	//counts and bytes of a dir and everything under it, kept up to date so callable from any thread
+	int GetDirStats(const QString& sub_path_name, DirStats* out);
+
+	//walks every structure under read locks, meant for occasional polling
+	void GetStats(DaemonStats* out);
+
+	/*
+		Generations, callable from any thread. The global one moves on every change the daemon
+		makes, a tag's one when its name or links change or when any media changes. Both only
+		ever go up, and start from the current time so they don't repeat across runs. They move
+		once the change is published to the index snapshot, anything read after seeing a
+		generation is at least that new.
+	*/
+	quint64 GetGeneration() const;
+
+	quint64 GetTagGeneration(const unsigned int tag_id) const;
+
+	//every tag with its media ids, returns the generation they are at least as new as
+	quint64 GetTagSnapshot(QVector<Tag>* tag_list_out);
+
+	//true once everything is loaded, right before Initialized is emitted
+	bool IsInitialized() const;
+
+	/*
+		Thread callbacks. Tags and media are read from the published index snapshot without
+		taking a list lock, so a long write batch never holds them up. Changes become visible
+		together when the op making them is done, or at the end of a monitor loop pass for
+		changes from the file system. Dir terms of a query are the exception, see GetQueryMedia.
+	*/
 
 	MediaModelResult	GetAllMedia();
 
@@ -167,6 +237,8 @@ public:
 
 	MediaModelResult	GetTagMedias(const unsigned int tag_id);
 
+	//tag terms come from one snapshot, dir terms from the live file tracker. the two can be a
+	//monitor loop pass apart, media moved in that time may be matched by its old or new dir
 	MediaModelResult	GetQueryMedia(const QString& query);
 
 	QVector<ModelTag>	GetMediaTags(const unsigned int media_id);
@@ -199,8 +271,14 @@ signals:
 
 	void MediaSubdirUpdated(const unsigned int media_id, const QString& new_subdir);
 
+	void MediaBatchApplied(const ModelMediaBatch& batch);
+
+	void MediaHashUpdated(const unsigned int media_id, const QString& new_hash);
+
 	void LinkFormed(const ModelTag& model_tag, const unsigned int media_id);
 
+	void LinksFormed(const ModelLinkBatch& batch);
+
 	void LinkDestroyed(const unsigned int tag_id, const unsigned int media_id);
 
 protected:
@@ -222,17 +300,29 @@ private:
 	MediaMap								mediamap;
 
 	HANDLE									monitor_terminate_event;
+	NotifyConfig							notify_config;
+	PendingRemoveTable						pending_remove_table;	//monitor thread only
+	IOScheduler								io_scheduler;			//reads for hash workers, declared first so it outlives them
+	HashService								hash_service;			//media inserted with empty hash get it filled in here
+	HANDLE									monitor_thread_handle;	//hash results are announced with an apc to it
 
 	TagDatabase								tag_db;
 	TagLinkDatabase							tag_link_db;
 	MediaDatabase							media_db;
 
-	QReadWriteLock							tag_list_lock;			//lock first - lock order to prevent deadlock
-	QReadWriteLock							media_list_lock;		//lock second
-	QReadWriteLock							file_tracker_lock;		//probabaly wont need it as file tracking will all run on the same thread
+	MeteredRWLock							tag_list_lock;			//lock first - lock order to prevent deadlock
+	MeteredRWLock							media_list_lock;		//lock second
+	QReadWriteLock							file_tracker_lock;		//lock third - only daemon thread writes, so its own reads go without
+
+	std::atomic_bool						initialized;
+	std::atomic<quint64>					generation;
+	std::atomic<quint64>					media_generation;
+	QHash<unsigned int, quint64>			tag_generation_table;	//tags changed since start
+	mutable QMutex							tag_generation_lock;
 
 	TagList									global_tag_list;
 	MediaList								global_media_list;
+	IndexSnapshotWriter						index_snapshot;			//readers' copy of both lists
 
 	//initialize daemon
 	//kick start all daemon routines
@@ -255,17 +345,78 @@ private:
 	int LoadFilenameToTagMap();
 
 	//recurssively search every directory monitored by daemon and adds new files to the database
-	int DiscoverNewMedia(QVector<MediaInfo>& new_media);
+	//sub_path limits the search to a subtree, dirs already tracked are left alone
+	int DiscoverNewMedia(QVector<MediaInfo>& new_media, const QString& sub_path = QString());
 
-	//try to match and see if media from database that doesnt exist anymore (soft deleted)'s hash matches with new media
+	//fingerprints new media that could be one of the vanished media moved. quick hash only where size collides,
+	//content hash only where quick hash collides as well
+	void FingerprintMoveCandidates(QVector<MediaInfo>& new_media_list, const QVector<MediaInfo>& vanished_media_list);
+
+	//try to match and see if media from database that doesnt exist anymore (soft deleted)'s content matches with new media
 	int ResolveNewAndSoftDeletedMedia(QVector<MediaInfo>& soft_delete_media_vec, QVector<MediaInfo>& new_media_vec);
 
 	//inserts all media id into appropreate dir struct
 	int PopulateDirMediaId();
 
-	//handles an event from notifier
-	int ProcessNotifyEvent(const NotifyEvent&, Notify&);
+	//file events released by coalescer that are applied together
+	struct MediaEventBatch {
+		QVector<MediaInfo>		add_list;			//CREATE of a file
+		QVector<MediaInfo>		modify_list;		//MODIFY of tracked media
+		QVector<unsigned int>	remove_id_list;		//removals that expired without a matching CREATE
+		QSet<QString>			sub_path_name_set;	//paths already in this batch
+
+		int Size() const {
+			return add_list.size() + modify_list.size() + remove_id_list.size();
+		}
+
+		void Clear() {
+			add_list.clear();
+			modify_list.clear();
+			remove_id_list.clear();
+			sub_path_name_set.clear();
+		}
+	};
+
+	//drains events released by coalescer, runs of file events are batched and anything else goes through ProcessNotifyEvent
+	void ProcessNotifyEvents(EventCoalescer&);
+
+	//handles an event released by coalescer
+	int ProcessNotifyEvent(const NotifyEvent&, EventCoalescer&);
+
+	//expands event path to long names, false if the event is under an untracked dir or ignored
+	bool ResolveNotifyEventPath(const NotifyEvent&, QString* sub_path, QString* sub_path_name, QString* full_path);
+
+	//true if the event was taken care of by adding it to batch, false if it has to go through ProcessNotifyEvent
+	bool BatchNotifyEvent(const NotifyEvent&, MediaEventBatch*);
+
+	//applies batch under one lock acquisition and one transaction per database, then clears it
+	int ApplyMediaEventBatch(MediaEventBatch&);
+
+	//hard deletes removals whose window is up, sweeps the wheel on every call
+	void ExpirePendingRemoves(EventCoalescer&);
+
+	//expired media go out in one batch, dirs one by one
+	int HardDeletePendingRemoves(const QVector<PendingRemove>& pending_list);
+
+	//removed media claimed by a CREATE under new_sub_path
+	int MovePendingMedia(const PendingRemove& pending, const QString& new_sub_path);
+
+	//queues media for hashing at its current path
+	void SubmitMediaHash(const MediaInfo& media, HashService::Priority priority);
+
+	//stores hashes finished by hash service
+	int ApplyHashResults();
+
+	//notifier lost events under sub_path, diff that subtree against disk and apply the difference
+	int RescanSubtree(const QString& sub_path);
 
 	//internal use of forming links
 	int FormLink(const unsigned int, const unsigned int);
+
+	void BumpGeneration();
+	void BumpMediaGeneration();
+	void BumpTagGeneration(const unsigned int tag_id);
+
+	//copies what changed in both lists into a new index snapshot version, takes the list write locks
+	void PublishIndexSnapshot();
 };
\ No newline at end of file
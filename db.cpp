@@ -3,12 +3,17 @@
 #include "db.h"
 #include "util.h"
 #include "error.h"
+#include "hash_engine.h"
+#include "metrics.h"
 
 #include <QStringBuilder>
+#include <QSet>
+#include <QPair>
 #include <memory>
 
 Database::Database() :
-	db_handle(nullptr)
+	db_handle(nullptr),
+	in_transaction(false)
 {
 }
 
@@ -43,6 +48,14 @@ Database::Init() {
 			Logger::Log(DB_DEFAULT_TABLE_MSG, LogEntry::LT_ERROR);
 			return -Error::DB_DEFAULT_TABLE;
 		}
+
+		return 1;
+	}
+
+	//file made by an older version may miss columns
+	if (UpgradeTable() < 0) {
+		Logger::Log(DB_DEFAULT_TABLE_MSG, LogEntry::LT_ERROR);
+		return -Error::DB_DEFAULT_TABLE;
 	}
 
 	return 1;
@@ -109,6 +122,8 @@ Database::LastRowId() {
 
 int 
 Database::SingleStepQuery(const QString& query) {
+	Metrics::ScopedTimer timer(Metrics::DB_STATEMENT);
+
 	sqlite3_stmt *statement;
 
 	//since sqlite3 takes wchar array we convert qstring to this array
@@ -142,6 +157,8 @@ Database::SingleStepQuery(const QString& query) {
 
 int 
 Database::MultiStepQuery(const QString& query, std::function< void(sqlite3_stmt* statement) > statement_result_handler) {
+	Metrics::ScopedTimer timer(Metrics::DB_STATEMENT);		//row handler time included
+
 	sqlite3_stmt *statement;
 
 	//since sqlite3 takes wchar array we convert qstring to this array
@@ -186,6 +203,7 @@ Database::MultiStepQuery(const QString& query, std::function< void(sqlite3_stmt*
 
 int 
 Database::SingleStepMultiStatementQuery(const QString& query) {
+	Metrics::ScopedTimer timer(Metrics::DB_STATEMENT);
 
 	char *errmsg_ptr;
 
@@ -205,6 +223,55 @@ Database::SingleStepMultiStatementQuery(const QString& query) {
 	return 1;
 }
 
+int
+Database::BeginTransaction() {
+	if (in_transaction) {
+		return 1;
+	}
+
+	int ret = SingleStepQuery("BEGIN TRANSACTION;");
+	if (ret < 0) {
+		return ret;
+	}
+
+	in_transaction = true;
+	return 1;
+}
+
+int
+Database::CommitTransaction() {
+	if (!in_transaction) {
+		return 1;
+	}
+
+	int ret = SingleStepQuery("COMMIT;");
+
+	//failed commit leaves the transaction open, undo it so the next one can begin
+	if (ret < 0) {
+		RollbackTransaction();
+		return ret;
+	}
+
+	in_transaction = false;
+	return 1;
+}
+
+int
+Database::RollbackTransaction() {
+	if (!in_transaction) {
+		return 1;
+	}
+
+	//transaction is over either way, sqlite may have rolled back on its own already
+	in_transaction = false;
+	return SingleStepQuery("ROLLBACK;");
+}
+
+bool
+Database::InTransaction() const {
+	return in_transaction;
+}
+
 
 //private
 
@@ -215,6 +282,16 @@ Database::LogSQLError(const QString& err_text, int sqlite_err_no) {
 	Logger::Log(err_text % ": " % QString::fromUtf8(sqlite_err_text) % " (" % QString::number(sqlite_err_no) % ')',  LogEntry::LT_ERROR);
 }
 
+QString
+Database::TransactionBeginStatement() const {
+	return in_transaction ? QString() : QString("BEGIN TRANSACTION;");
+}
+
+QString
+Database::TransactionEndStatement() const {
+	return in_transaction ? QString() : QString("COMMIT;");
+}
+
 //Tag Database
 
 TagDatabase::TagDatabase()
@@ -317,14 +394,14 @@ TagLinkDatabase::CreateTagLink(const unsigned int tag_id, const unsigned int med
 int 
 TagLinkDatabase::CreateTagLinkByTagMediaIdList(const QVector<unsigned int>& tag_id_list, const QVector<unsigned int>& media_id_list) {
 	const QString transaction_format_str = "INSERT INTO TAG_LINKS (tag_id, media_id) VALUES(%1, %2);";
-	QString query = "BEGIN TRANSACTION;";
+	QString query = TransactionBeginStatement();
 
 
 	for (int i = 0; i < tag_id_list.size(); i++) {
 		query.append(transaction_format_str.arg(QString::number(tag_id_list[i]), QString::number(media_id_list[i])));
 	}
 
-	query.append("COMMIT;");
+	query.append(TransactionEndStatement());
 
 	return SingleStepMultiStatementQuery(query);
 }
@@ -350,14 +427,14 @@ TagLinkDatabase::RemoveTagLinkByMediaId(const unsigned int media_id) {
 int 
 TagLinkDatabase::RemoveTagLinkByMediaIdList(const QVector<unsigned int>& media_id_list) {
 	const QString transaction_format_str = "DELETE FROM TAG_LINKS WHERE media_id = %1;";
-	QString query = "BEGIN TRANSACTION;";
+	QString query = TransactionBeginStatement();
 
 
 	for (auto iter = media_id_list.begin(); iter < media_id_list.end(); iter++) {
 		query.append(transaction_format_str.arg(QString::number(*iter)));
 	}
 
-	query.append("COMMIT;");
+	query.append(TransactionEndStatement());
 
 	return SingleStepMultiStatementQuery(query);
 }
@@ -376,15 +453,53 @@ MediaDatabase::CreateDefaultTable() {
 							"sub_path	TEXT							NOT NULL,"
 							"name		TEXT							NOT NULL,"
 							"alt_name	TEXT							NOT NULL,"
-							"hash		CHARACTER(64)					NOT NULL);";
+							"hash		CHARACTER(64)					NOT NULL,"
+							"size		INTEGER							NOT NULL DEFAULT -1,"
+							"quick_hash	TEXT							NOT NULL DEFAULT '',"
+							"hash_algo	TEXT							NOT NULL DEFAULT 'sha256');";
 
 	return SingleStepQuery(query);
 }
 
+int
+MediaDatabase::UpgradeTable() {
+
+	QSet<QString> column_set;
+	int ret = MultiStepQuery("PRAGMA table_info(MEDIA);", [&column_set](sqlite3_stmt* statement) {
+		column_set.insert(QString::fromUtf8((char*)sqlite3_column_text(statement, 1)));
+	});
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	//hashes made before the columns existed were all sha256
+	const QVector<QPair<QString, QString>> added_column_list = {
+		{ "size", "ALTER TABLE MEDIA ADD COLUMN size INTEGER NOT NULL DEFAULT -1;" },
+		{ "quick_hash", "ALTER TABLE MEDIA ADD COLUMN quick_hash TEXT NOT NULL DEFAULT '';" },
+		{ "hash_algo", "ALTER TABLE MEDIA ADD COLUMN hash_algo TEXT NOT NULL DEFAULT 'sha256';" }
+	};
+
+	for (const QPair<QString, QString>& column : added_column_list) {
+		if (column_set.contains(column.first)) {
+			continue;
+		}
+
+		ret = SingleStepQuery(column.second);
+		if (ret < 0) {
+			return ret;
+		}
+
+		Logger::Log("Media database column added: " % column.first, LogEntry::LT_ATTN);
+	}
+
+	return 1;
+}
+
 int 
 MediaDatabase::GetAllMedia(QVector<MediaInfo> *media_list) {
 
-	const QString query = "SELECT * FROM MEDIA;";
+	const QString query = "SELECT id, sub_path, name, alt_name, hash, size, quick_hash, hash_algo FROM MEDIA;";
 
 	MediaInfo tmp;
 	return MultiStepQuery(query, [&tmp, media_list](sqlite3_stmt* statement) {
@@ -400,7 +515,17 @@ MediaDatabase::GetAllMedia(QVector<MediaInfo> *media_list) {
 		tmp.short_name = QString::fromWCharArray((WCHAR*)sqlite3_column_text16(statement, 3),
 			sqlite3_column_bytes16(statement, 3) >> 1);
 		
-		tmp.hash = QString::fromLocal8Bit((char*)sqlite3_column_text(statement, 4), 64);	//256 bit hash to 32 bytes hash to 64 byte hex text
+		//hex text, empty while the hash is pending
+		tmp.hash = QString::fromLatin1((char*)sqlite3_column_text(statement, 4), sqlite3_column_bytes(statement, 4));
+		tmp.size = sqlite3_column_int64(statement, 5);
+		tmp.quick_hash = QString::fromLatin1((char*)sqlite3_column_text(statement, 6), sqlite3_column_bytes(statement, 6));
+
+		//hash from an algorithm this build doesnt know is as good as none
+		QString hash_algo_name = QString::fromLatin1((char*)sqlite3_column_text(statement, 7), sqlite3_column_bytes(statement, 7));
+		if (!HashEngine::AlgoFromName(hash_algo_name, &tmp.hash_algo)) {
+			tmp.hash.clear();
+			tmp.hash_algo = HashEngine::SHA256;
+		}
 
 		media_list->push_back(tmp);
 	});
@@ -414,11 +539,14 @@ MediaDatabase::InsertMedia(const MediaInfo& new_media) {
 	const QString clean_long_name = QString(new_media.long_name).replace('\'', "''");
 	const QString clean_short_name = QString(new_media.short_name).replace('\'', "''");
 
-	const QString query = "INSERT INTO MEDIA (sub_path, name, alt_name, hash) VALUES('" %
+	const QString query = "INSERT INTO MEDIA (sub_path, name, alt_name, hash, size, quick_hash, hash_algo) VALUES('" %
 							clean_sub_path % "','" %
 							clean_long_name % "','" %
 							clean_short_name % "','" %
-							new_media.hash % "');";
+							new_media.hash % "'," %
+							QString::number(new_media.size) % ",'" %
+							new_media.quick_hash % "','" %
+							HashEngine::AlgoName(new_media.hash_algo) % "');";
 
 	return SingleStepQuery(query);
 }
@@ -426,8 +554,8 @@ MediaDatabase::InsertMedia(const MediaInfo& new_media) {
 int	
 MediaDatabase::InsertMediaList(const QVector<MediaInfo>& new_media_list) {
 
-	const QString transaction_format_str = "INSERT INTO MEDIA (sub_path, name, alt_name, hash) VALUES('%1', '%2', '%3', '%4');";
-	QString query = "BEGIN TRANSACTION;";
+	const QString transaction_format_str = "INSERT INTO MEDIA (sub_path, name, alt_name, hash, size, quick_hash, hash_algo) VALUES('%1', '%2', '%3', '%4', %5, '%6', '%7');";
+	QString query = TransactionBeginStatement();
 
 
 	QString clean_sub_path, clean_long_name, clean_short_name;
@@ -440,10 +568,11 @@ MediaDatabase::InsertMediaList(const QVector<MediaInfo>& new_media_list) {
 		clean_long_name = QString(iter->long_name).replace('\'', "''");
 		clean_short_name = QString(iter->short_name).replace('\'', "''");
 		
-		query.append(transaction_format_str.arg(clean_sub_path, clean_long_name, clean_short_name, iter->hash));
+		query.append(transaction_format_str.arg(clean_sub_path, clean_long_name, clean_short_name, iter->hash,
+			QString::number(iter->size), iter->quick_hash, HashEngine::AlgoName(iter->hash_algo)));
 	}
 
-	query.append("COMMIT;");
+	query.append(TransactionEndStatement());
 
 	return SingleStepMultiStatementQuery(query);
 }
@@ -459,15 +588,18 @@ MediaDatabase::UpdateMedia(const MediaInfo& media) {
 	const QString query =		"UPDATE MEDIA SET sub_path = '" % clean_sub_path % "'," %
 								"name = '" % clean_long_name % "'," %
 								"alt_name = '" % clean_short_name % "'," %
-								"hash = '" % media.hash % "' WHERE id = " % QString::number(media.id) % ";";
+								"hash = '" % media.hash % "'," %
+								"size = " % QString::number(media.size) % "," %
+								"quick_hash = '" % media.quick_hash % "'," %
+								"hash_algo = '" % HashEngine::AlgoName(media.hash_algo) % "' WHERE id = " % QString::number(media.id) % ";";
 	
 	return SingleStepQuery(query);
 }
 
 int 
 MediaDatabase::UpdateMediaList(const QVector<MediaInfo>& media_list) {
-	const QString transaction_format_str = "UPDATE MEDIA SET sub_path = '%1', name = '%2', alt_name = '%3', hash = '%4' WHERE id = %5;";
-	QString query = "BEGIN TRANSACTION;";
+	const QString transaction_format_str = "UPDATE MEDIA SET sub_path = '%1', name = '%2', alt_name = '%3', hash = '%4', size = %5, quick_hash = '%6', hash_algo = '%7' WHERE id = %8;";
+	QString query = TransactionBeginStatement();
 
 	QString clean_sub_path, clean_long_name, clean_short_name;
 
@@ -478,10 +610,11 @@ MediaDatabase::UpdateMediaList(const QVector<MediaInfo>& media_list) {
 		clean_long_name = QString(iter->long_name).replace('\'', "''");
 		clean_short_name = QString(iter->short_name).replace('\'', "''");
 
-		query.append(transaction_format_str.arg(clean_sub_path, clean_long_name, clean_short_name, iter->hash, QString::number(iter->id)));
+		query.append(transaction_format_str.arg(clean_sub_path, clean_long_name, clean_short_name, iter->hash,
+			QString::number(iter->size), iter->quick_hash, HashEngine::AlgoName(iter->hash_algo), QString::number(iter->id)));
 	}
 
-	query.append("COMMIT;");
+	query.append(TransactionEndStatement());
 
 	return SingleStepMultiStatementQuery(query);
 }
@@ -495,14 +628,14 @@ MediaDatabase::RemoveMedia(const unsigned int media_id) {
 int 
 MediaDatabase::RemoveMediaList(const QVector<unsigned int>& media_id_list) {
 	const QString transaction_format_str = "DELETE FROM MEDIA WHERE id = %1;";
-	QString query = "BEGIN TRANSACTION;";
+	QString query = TransactionBeginStatement();
 
 
 	for (auto iter = media_id_list.begin(); iter < media_id_list.end(); iter++) {
 		query.append(transaction_format_str.arg(QString::number(*iter)));
 	}
 
-	query.append("COMMIT;");
+	query.append(TransactionEndStatement());
 
 	return SingleStepMultiStatementQuery(query);
 }
\ No newline at end of file
@@ -11,6 +11,9 @@
 	- Full_Name: STR
 	- Short_name: STR	the alternate name
 	- Hash: CHAR(64)	Hash of media
+	- Size: Integer		File size when last seen, -1 if unknown
+	- Quick_hash: STR	Hash of size, head and tail of media
+	- Hash_algo: STR	Name of algorithm that made hash
 
 	Tag Table
 	- ID: Integer
@@ -93,15 +96,33 @@ public:
 	int MultiStepQuery(const QString& query, std::function<void(sqlite3_stmt* statement)> statement_result_handler);
 
 	int SingleStepMultiStatementQuery(const QString& query);
+
+	//explicit transaction spanning several calls
+	//list operations skip their own BEGIN/COMMIT while one is open
+	int BeginTransaction();
+
+	int CommitTransaction();
+
+	int RollbackTransaction();
+
+	bool InTransaction() const;
 	
 	virtual int	CreateDefaultTable() = 0;
 
+	//brings a table made by an older version up to date, called when opening an existing file
+	virtual int	UpgradeTable() { return 1; }
+
 protected:
 	sqlite3*		db_handle;	//nullptr if not opened
 	QString			db_path;
 	Logger*			logger;
+	bool			in_transaction;
 
 	void LogSQLError(const QString& err_text, int sqlite_err_no);
+
+	//statement list wrappers, empty when an explicit transaction is open
+	QString TransactionBeginStatement() const;
+	QString TransactionEndStatement() const;
 };
 
 class TagDatabase : public Database {
@@ -138,6 +159,7 @@ public:
 	MediaDatabase();
 
 	int CreateDefaultTable() override;
+	int UpgradeTable() override;
 	int GetAllMedia(QVector<MediaInfo>* media_vec);
 	int InsertMedia(const MediaInfo& new_media);
 	int	InsertMediaList(const QVector<MediaInfo>& new_media_list);
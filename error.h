@@ -71,6 +71,7 @@ namespace Error {
 		FILENAME_MAP_INVALID_BLOCK,
 		
 		//misc error
-		QREGEX_INVALID
+		QREGEX_INVALID,
+		HASH_CANCELLED
 	};
 }
\ No newline at end of file
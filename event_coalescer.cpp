@@ -0,0 +1,406 @@
+#include "event_coalescer.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "metrics.h"
+
+EventCoalescer::EventCoalescer(int quiet_msec /*= COALESCE_QUIET_MSEC*/, int max_hold_msec /*= COALESCE_MAX_HOLD_MSEC*/) :
+	next_seq(0),
+	rename_pending(false)
+{
+	SetWindow(quiet_msec, max_hold_msec);
+}
+
+void
+EventCoalescer::SetWindow(int quiet_msec, int max_hold_msec) {
+	quiet_window = std::chrono::milliseconds(quiet_msec);
+	max_hold = std::chrono::milliseconds(std::max(quiet_msec, max_hold_msec));
+}
+
+void
+EventCoalescer::Push(const NotifyEvent& event) {
+	Push(event, std::chrono::steady_clock::now());
+}
+
+void
+EventCoalescer::Push(const NotifyEvent& event, TimePoint now) {
+
+	//RENAME_OLD is only meaningful with the RENAME_NEW right after it
+	if (rename_pending && event.event != NotifyEvent::RENAME_NEW) {
+		FlushRename();
+	}
+
+	std::wstring path_name = GetPathName(event);
+	auto held_iter = held_table.find(path_name);
+
+	switch (event.event) {
+	case NotifyEvent::CREATE: {
+
+		//move across dirs arrives as REMOVE followed by CREATE, keep the two adjacent for daemon to pair up
+		if (!last_remove_file_wname.empty() && last_remove_file_wname == event.file_wname && held_iter == held_table.end()) {
+			ReleaseAncestors(path_name);
+			Emit(event);
+			break;
+		}
+
+		if (held_iter != held_table.end()) {
+			held_iter->second.event.event = NotifyEvent::CREATE;
+			held_iter->second.last_seen = now;
+			Metrics::Inc(Metrics::NOTIFY_COALESCED_TOTAL);
+			break;
+		}
+
+		Hold(event, path_name, now);
+		break;
+	}
+
+	case NotifyEvent::MODIFY: {
+
+		//folds into whatever is held for this path and restarts its quiet window
+		if (held_iter != held_table.end()) {
+			held_iter->second.last_seen = now;
+			Metrics::Inc(Metrics::NOTIFY_COALESCED_TOTAL);
+			break;
+		}
+
+		Hold(event, path_name, now);
+		break;
+	}
+
+	case NotifyEvent::REMOVE: {
+
+		//created and removed within the window, daemon never needs to know
+		if (held_iter != held_table.end() && held_iter->second.event.event == NotifyEvent::CREATE) {
+			DropRecur(path_name);
+			Metrics::Inc(Metrics::NOTIFY_COALESCED_TOTAL);
+			break;
+		}
+
+		//no point hashing a file that is gone
+		if (held_iter != held_table.end()) {
+			Drop(path_name);
+			Metrics::Inc(Metrics::NOTIFY_COALESCED_TOTAL);
+		}
+
+		//held events under a removed dir are released first, the dir might have been moved rather than deleted
+		ReleaseRelated(path_name);
+		Emit(event);
+
+		last_remove_file_wname = event.file_wname;
+		break;
+	}
+
+	case NotifyEvent::RENAME_OLD: {
+		rename_pending = true;
+		rename_old_event = event;
+		break;
+	}
+
+	case NotifyEvent::RENAME_NEW: {
+
+		if (!rename_pending) {
+			ReleaseRelated(path_name);
+			Emit(event);
+			break;
+		}
+
+		rename_pending = false;
+
+		std::wstring old_path_name = GetPathName(rename_old_event);
+		auto old_held_iter = held_table.find(old_path_name);
+		bool old_held_create = old_held_iter != held_table.end() && old_held_iter->second.event.event == NotifyEvent::CREATE;
+
+		//whatever was held at the new name refers to the file that got replaced
+		ReleaseRelated(path_name);
+
+		//held events under the old name would point at paths that are gone, they follow the rename
+		RenameHeld(old_path_name, path_name);
+
+		//daemon has not seen the old name yet, the held CREATE simply takes the new name
+		if (old_held_create) {
+			Metrics::Inc(Metrics::NOTIFY_COALESCED_TOTAL, 2);
+			break;
+		}
+
+		ReleaseAncestors(old_path_name);
+
+		Emit(rename_old_event);
+		Emit(event);
+		break;
+	}
+
+	case NotifyEvent::RESCAN: {
+
+		//rescan diffs against disk anyway, just keep the order
+		ReleaseAll();
+		Emit(event);
+		break;
+	}
+
+	default:
+		Emit(event);
+	}
+
+	Metrics::Set(Metrics::NOTIFY_HELD_COUNT, held_table.size());
+}
+
+void
+EventCoalescer::ReleaseExpired() {
+	ReleaseExpired(std::chrono::steady_clock::now());
+}
+
+void
+EventCoalescer::ReleaseExpired(TimePoint now) {
+
+	//producer drained the notifier, a RENAME_OLD still waiting for its pair will not get one
+	if (rename_pending) {
+		FlushRename();
+	}
+
+	std::vector<std::wstring> expired_list;
+	for (const auto& entry : held_order) {
+		if (GetDeadline(held_table[entry.second]) <= now) {
+			expired_list.push_back(entry.second);
+		}
+	}
+
+	for (const std::wstring& path_name : expired_list) {
+		//may already be out as an ancestor of an earlier one
+		if (held_table.count(path_name)) {
+			Release(path_name);
+		}
+	}
+
+	Metrics::Set(Metrics::NOTIFY_HELD_COUNT, held_table.size());
+}
+
+void
+EventCoalescer::ReleaseAll() {
+
+	if (rename_pending) {
+		FlushRename();
+	}
+
+	while (!held_order.empty()) {
+		Release(held_order.begin()->second);
+	}
+
+	Metrics::Set(Metrics::NOTIFY_HELD_COUNT, held_table.size());
+}
+
+int
+EventCoalescer::NextReleaseMsec() const {
+	return NextReleaseMsec(std::chrono::steady_clock::now());
+}
+
+int
+EventCoalescer::NextReleaseMsec(TimePoint now) const {
+
+	if (rename_pending) {
+		return 0;
+	}
+
+	if (held_table.empty()) {
+		return -1;
+	}
+
+	TimePoint next_deadline = TimePoint::max();
+	for (const auto& entry : held_table) {
+		next_deadline = std::min(next_deadline, GetDeadline(entry.second));
+	}
+
+	if (next_deadline <= now) {
+		return 0;
+	}
+
+	//round up so the wait does not wake a hair before the deadline
+	auto remain = std::chrono::duration_cast<std::chrono::milliseconds>(next_deadline - now + std::chrono::microseconds(999));
+	return (int) remain.count();
+}
+
+size_t
+EventCoalescer::HeldCount() const {
+	return held_table.size();
+}
+
+bool
+EventCoalescer::HasEvent() const {
+	return !ready_queue.empty();
+}
+
+int
+EventCoalescer::GetNextEvent(NotifyEvent* out) {
+	*out = ready_queue.front();
+	ready_queue.pop_front();
+	return 1;
+}
+
+int
+EventCoalescer::PeekNextEvent(NotifyEvent* out) const {
+	*out = ready_queue.front();
+	return 1;
+}
+
+int
+EventCoalescer::UpdateNextEventTypeToSkip() {
+	if (ready_queue.front().event == NotifyEvent::CREATE) {
+		ready_queue.front().event = NotifyEvent::CREATE_SKIP;
+		return 1;
+	}
+
+	if (ready_queue.front().event == NotifyEvent::RENAME_NEW) {
+		ready_queue.front().event = NotifyEvent::RENAME_SKIP;
+		return 1;
+	}
+
+	return -1;
+}
+
+//private
+
+std::wstring
+EventCoalescer::GetPathName(const NotifyEvent& event) {
+	if (event.dir_wname.empty()) {
+		return event.file_wname;
+	}
+
+	if (event.file_wname.empty()) {
+		return event.dir_wname;
+	}
+
+	return event.dir_wname + L'\\' + event.file_wname;
+}
+
+EventCoalescer::TimePoint
+EventCoalescer::GetDeadline(const HeldEvent& held) const {
+	return std::min(held.last_seen + quiet_window, held.first_seen + max_hold);
+}
+
+void
+EventCoalescer::Hold(const NotifyEvent& event, const std::wstring& path_name, TimePoint now) {
+
+	HeldEvent held;
+	held.event = event;
+	held.seq = next_seq++;
+	held.first_seen = now;
+	held.last_seen = now;
+
+	held_order.emplace(held.seq, path_name);
+	held_table.emplace(path_name, std::move(held));
+}
+
+void
+EventCoalescer::Drop(const std::wstring& path_name) {
+	auto held_iter = held_table.find(path_name);
+	if (held_iter == held_table.end()) {
+		return;
+	}
+
+	held_order.erase(held_iter->second.seq);
+	held_table.erase(held_iter);
+}
+
+void
+EventCoalescer::DropRecur(const std::wstring& path_name) {
+	std::vector<std::wstring> drop_list;
+	for (const auto& entry : held_table) {
+		if (NotifyRecentDirs::IsSubPathOf(entry.first, path_name)) {
+			drop_list.push_back(entry.first);
+		}
+	}
+
+	for (const std::wstring& drop_path_name : drop_list) {
+		Drop(drop_path_name);
+	}
+}
+
+void
+EventCoalescer::RenameHeld(const std::wstring& old_path_name, const std::wstring& new_path_name) {
+
+	std::vector<std::wstring> renamed_list;
+	for (const auto& entry : held_table) {
+		if (NotifyRecentDirs::IsSubPathOf(entry.first, old_path_name)) {
+			renamed_list.push_back(entry.first);
+		}
+	}
+
+	for (const std::wstring& old_key : renamed_list) {
+		HeldEvent held = std::move(held_table[old_key]);
+		held_table.erase(old_key);
+
+		std::wstring new_key = new_path_name + old_key.substr(old_path_name.size());
+		size_t slash_idx = new_key.rfind(L'\\');
+		held.event.dir_wname = slash_idx == std::wstring::npos ? std::wstring() : new_key.substr(0, slash_idx);
+		held.event.file_wname = slash_idx == std::wstring::npos ? new_key : new_key.substr(slash_idx + 1);
+
+		held_order[held.seq] = new_key;
+		held_table.emplace(std::move(new_key), std::move(held));
+	}
+}
+
+void
+EventCoalescer::Release(const std::wstring& path_name) {
+
+	//daemon ignores events under dirs it does not track yet, held parent dir goes out first
+	ReleaseAncestors(path_name);
+
+	auto held_iter = held_table.find(path_name);
+	if (held_iter == held_table.end()) {
+		return;
+	}
+
+	Emit(held_iter->second.event);
+
+	held_order.erase(held_iter->second.seq);
+	held_table.erase(held_iter);
+}
+
+void
+EventCoalescer::ReleaseAncestors(const std::wstring& path_name) {
+	size_t slash_idx = path_name.find(L'\\');
+
+	while (slash_idx != std::wstring::npos) {
+		std::wstring ancestor = path_name.substr(0, slash_idx);
+
+		if (held_table.count(ancestor)) {
+			Release(ancestor);
+		}
+
+		slash_idx = path_name.find(L'\\', slash_idx + 1);
+	}
+}
+
+//held ancestors, the path itself, and held descendants in arrival order
+void
+EventCoalescer::ReleaseRelated(const std::wstring& path_name) {
+
+	ReleaseAncestors(path_name);
+
+	std::vector<std::wstring> release_list;
+	for (const auto& entry : held_order) {
+		if (NotifyRecentDirs::IsSubPathOf(entry.second, path_name)) {
+			release_list.push_back(entry.second);
+		}
+	}
+
+	for (const std::wstring& release_path_name : release_list) {
+		if (held_table.count(release_path_name)) {
+			Release(release_path_name);
+		}
+	}
+}
+
+void
+EventCoalescer::Emit(const NotifyEvent& event) {
+	ready_queue.push_back(event);
+	last_remove_file_wname.clear();
+}
+
+void
+EventCoalescer::FlushRename() {
+	rename_pending = false;
+
+	ReleaseRelated(GetPathName(rename_old_event));
+	Emit(rename_old_event);
+}
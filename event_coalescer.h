@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+	Coalescing stage between Notify and daemon
+
+	Copies and downloads produce storms of MODIFY for the same file and every
+	one of them would cost daemon a full rehash. Coalescer holds CREATE and
+	MODIFY per path until the path has been quiet for a while, folding repeats
+	into one event. Everything else passes through in order, releasing any held
+	event it depends on first.
+
+	Rules:
+		CREATE, MODIFY			held until quiet_msec without new events for that path,
+								or max_hold_msec after it was first seen
+		MODIFY on held path		absorbed, restarts the quiet window
+		REMOVE on held CREATE	both dropped along with anything held under that path (temp files)
+		REMOVE					held MODIFY for the path is dropped, held events under it are released first
+		CREATE right after a REMOVE of the same name
+								released immediately so daemon sees the move as an adjacent pair
+		RENAME_OLD/RENAME_NEW	passed through as an adjacent pair, held events under the old name follow the rename
+		RENAME of a held CREATE	folded into the CREATE, daemon only ever sees the final name
+		RESCAN					releases everything held first
+
+	Consumer side mirrors Notify (HasEvent, GetNextEvent, PeekNextEvent, UpdateNextEventTypeToSkip)
+	so daemon can process events from either one.
+*/
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "notify.h"
+
+#define COALESCE_QUIET_MSEC		500
+#define COALESCE_MAX_HOLD_MSEC	5000
+
+class EventCoalescer {
+public:
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	EventCoalescer(int quiet_msec = COALESCE_QUIET_MSEC, int max_hold_msec = COALESCE_MAX_HOLD_MSEC);
+
+	void	SetWindow(int quiet_msec, int max_hold_msec);
+
+	//producer side
+	void	Push(const NotifyEvent& event);
+	void	Push(const NotifyEvent& event, TimePoint now);
+	void	ReleaseExpired();
+	void	ReleaseExpired(TimePoint now);
+	void	ReleaseAll();
+
+	//msec until next held event is due, -1 if nothing is held
+	int		NextReleaseMsec() const;
+	int		NextReleaseMsec(TimePoint now) const;
+	size_t	HeldCount() const;
+
+	//consumer side, same as Notify
+	bool	HasEvent() const;
+	int		GetNextEvent(NotifyEvent*);
+	int		PeekNextEvent(NotifyEvent*) const;
+	int		UpdateNextEventTypeToSkip();
+
+private:
+	struct HeldEvent {
+		NotifyEvent		event;
+		uint64_t		seq;
+		TimePoint		first_seen;
+		TimePoint		last_seen;
+	};
+
+	std::chrono::milliseconds						quiet_window;
+	std::chrono::milliseconds						max_hold;
+
+	std::unordered_map<std::wstring, HeldEvent>		held_table;		//root relative path name -> held event
+	std::map<uint64_t, std::wstring>				held_order;		//arrival order of held events
+	uint64_t										next_seq;
+
+	std::deque<NotifyEvent>							ready_queue;
+
+	bool											rename_pending;
+	NotifyEvent										rename_old_event;
+
+	std::wstring									last_remove_file_wname;	//name of the REMOVE released last, empty when anything else came after
+
+	static std::wstring	GetPathName(const NotifyEvent&);
+	TimePoint			GetDeadline(const HeldEvent&) const;
+
+	void	Hold(const NotifyEvent&, const std::wstring& path_name, TimePoint now);
+	void	Drop(const std::wstring& path_name);
+	void	DropRecur(const std::wstring& path_name);
+	void	RenameHeld(const std::wstring& old_path_name, const std::wstring& new_path_name);
+	void	Release(const std::wstring& path_name);
+	void	ReleaseAncestors(const std::wstring& path_name);
+	void	ReleaseRelated(const std::wstring& path_name);
+	void	Emit(const NotifyEvent&);
+	void	FlushRename();
+};
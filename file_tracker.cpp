@@ -1,5 +1,6 @@
 #include "file_tracker.h"
 #include "error.h"
+#include "mem_estimate.h"
 #include <Windows.h>
 #include <QQueue>
 #include <QStringBuilder>
@@ -40,6 +41,7 @@ FileTracker::IsDir(const QString& abs_path, bool *out) {
 
 FileTracker::FileTracker()
 {
+	path_to_node_table.insert("", &dir_tree.root_dir_node);
 }
 
 FileTracker::~FileTracker()
@@ -78,6 +80,7 @@ FileTracker::AddDirSubPath(const QString& sub_path, const QString& long_name, co
 
 	new_node->long_name = long_name;
 	new_node->short_name = short_name;
+	new_node->parent = node_ptr;
 
 	node_ptr->child_dir_name_to_node_table.insert(long_name, new_node.get());
 
@@ -85,18 +88,22 @@ FileTracker::AddDirSubPath(const QString& sub_path, const QString& long_name, co
 		node_ptr->child_dir_short_name_to_node_table.insert(short_name, new_node.get());
 	}
 
+	IndexDir(node_ptr, new_node.get());
+	AddRecurStats(node_ptr, 0, 0, 1);
+
 	node_ptr->child_dir_list.push_back(std::move(new_node));
 	
 	return 1;
 }
 
 int		
-FileTracker::AddMediaAbsPath(const QString& abs_path, const unsigned int media_id) {
-	return AddMediaSubPath(abs_path.mid(dir_tree.root_dir_abs_path.size()), media_id);
+FileTracker::AddMediaAbsPath(const QString& abs_path, const unsigned int media_id, const qint64 size /* = -1 */) {
+	return AddMediaSubPath(abs_path.mid(dir_tree.root_dir_abs_path.size()), media_id, size);
 }
 
+//size -1 if unknown, counts as 0 bytes until UpdateMediaSize
 int
-FileTracker::AddMediaSubPath(const QString& sub_path, const unsigned int media_id) {
+FileTracker::AddMediaSubPath(const QString& sub_path, const unsigned int media_id, const qint64 size /* = -1 */) {
 	DirTreeNode *node_ptr;
 
 	if (sub_path.size() > 0) {
@@ -108,8 +115,16 @@ FileTracker::AddMediaSubPath(const QString& sub_path, const unsigned int media_i
 		node_ptr = &dir_tree.root_dir_node;
 	}
 
+	if (node_ptr->media_id_set.contains(media_id)) {
+		return 1;
+	}
+
 	node_ptr->media_id_set.insert(media_id);
 
+	quint64 byte_count = size > 0 ? size : 0;
+	media_size_table.insert(media_id, byte_count);
+	AddRecurStats(node_ptr, 1, byte_count, 0);
+
 	return 1;
 }
 
@@ -126,7 +141,28 @@ FileTracker::RemoveMedia(const QString& sub_path, const unsigned int media_id) {
 		node_ptr = &dir_tree.root_dir_node;
 	}
 
-	node_ptr->media_id_set.remove(media_id);
+	if (!node_ptr->media_id_set.remove(media_id)) {
+		return 1;
+	}
+
+	AddRecurStats(node_ptr, -1, -(qint64) media_size_table.take(media_id), 0);
+
+	return 1;
+}
+
+int
+FileTracker::UpdateMediaSize(const QString& sub_path, const unsigned int media_id, const qint64 size) {
+	DirTreeNode *node_ptr;
+
+	if (GetDirNodePtr(sub_path, &node_ptr) < 0 || !node_ptr->media_id_set.contains(media_id)) {
+		return -1;
+	}
+
+	quint64 byte_count = size > 0 ? size : 0;
+	quint64& curr_byte_count = media_size_table[media_id];
+
+	AddRecurStats(node_ptr, 0, (qint64) byte_count - (qint64) curr_byte_count, 0);
+	curr_byte_count = byte_count;
 
 	return 1;
 }
@@ -163,6 +199,9 @@ FileTracker::UpdateDirName(const QString& sub_path_name, const QString& long_nam
 		parent_node_ptr->child_dir_short_name_to_node_table.remove(dir_node_ptr->short_name);
 	}
 
+	//every path under the dir changes with it
+	UnindexDir(dir_node_ptr);
+
 	//rename node
 	dir_node_ptr->long_name = long_name;
 	dir_node_ptr->short_name = short_name;
@@ -173,6 +212,8 @@ FileTracker::UpdateDirName(const QString& sub_path_name, const QString& long_nam
 		parent_node_ptr->child_dir_short_name_to_node_table.insert(short_name, dir_node_ptr);
 	}
 
+	IndexDir(parent_node_ptr, dir_node_ptr);
+
 	return 1;
 }
 
@@ -220,6 +261,14 @@ FileTracker::UpdateDirSubdir(const QString& sub_path_name, const QString& new_su
 		new_parent_node_ptr->child_dir_short_name_to_node_table.insert(dir_node_ptr->short_name, dir_node_ptr);
 	}
 
+	UnindexDir(dir_node_ptr);
+	IndexDir(new_parent_node_ptr, dir_node_ptr);
+
+	//subtree totals move from the old ancestors to the new ones
+	AddRecurStats(parent_node_ptr, -(qint64) dir_node_ptr->recur_media_count, -(qint64) dir_node_ptr->recur_byte_count, -(qint64) (dir_node_ptr->recur_dir_count + 1));
+	AddRecurStats(new_parent_node_ptr, dir_node_ptr->recur_media_count, dir_node_ptr->recur_byte_count, dir_node_ptr->recur_dir_count + 1);
+	dir_node_ptr->parent = new_parent_node_ptr;
+
 	//find and move unique ptr
 
 	auto iter = parent_node_ptr->child_dir_list.begin();
@@ -268,6 +317,17 @@ FileTracker::RemoveDir(const QString& sub_path_name) {
 		parent_node_ptr->child_dir_short_name_to_node_table.remove(dir_node_ptr->short_name);
 	}
 
+	UnindexDir(dir_node_ptr);
+
+	//media still tracked under the dir go with it
+	QVector<unsigned int> media_id_list;
+	GetDirMediaIdRecurByNode(dir_node_ptr, &media_id_list);
+	for (unsigned int media_id : media_id_list) {
+		media_size_table.remove(media_id);
+	}
+
+	AddRecurStats(parent_node_ptr, -(qint64) dir_node_ptr->recur_media_count, -(qint64) dir_node_ptr->recur_byte_count, -(qint64) (dir_node_ptr->recur_dir_count + 1));
+
 	//find and remove dir node
 	auto iter = parent_node_ptr->child_dir_list.begin();
 	for (; iter != parent_node_ptr->child_dir_list.end(); iter++) {
@@ -298,6 +358,12 @@ FileTracker::DirExistAbs(const QString& abs_path) {
 
 void 
 FileTracker::GetPathLongName(const QString& path, QString* out) {
+	DirTreeNode *dir_node = path_to_node_table.value(path.startsWith('\\') ? path.mid(1) : path, nullptr);
+	if (dir_node != nullptr) {
+		*out = dir_node->long_path.isEmpty() ? QString() : '\\' % dir_node->long_path;
+		return;
+	}
+
 	QStringList sub_path_component_list = path.split("\\", QString::SkipEmptyParts);
 
 	out->clear();
@@ -330,68 +396,235 @@ FileTracker::GetDirMediaIdRecurByPath(const QString& path, QVector<unsigned int>
 	return GetDirMediaIdRecurByNode(dir_node, out);
 }
 
+//media directly in the dir, or in the dir and everything under it
+int
+FileTracker::GetDirMediaIdSet(const QString& sub_path, bool recursive, QSet<unsigned int>* out) {
+	DirTreeNode *dir_node;
+
+	if (GetDirNodePtr(sub_path, &dir_node) < 0) {
+		return -1;
+	}
+
+	if (!recursive || dir_node->recur_media_count == dir_node->media_id_set.size()) {
+		*out = dir_node->media_id_set;		//shared, no copy unless changed
+		return 1;
+	}
+
+	QVector<DirTreeNode*> node_stack;
+	node_stack.push_back(dir_node);
+
+	out->clear();
+	out->reserve(dir_node->recur_media_count);
+
+	while (!node_stack.empty()) {
+		DirTreeNode *curr_node = node_stack.takeLast();
+
+		out->unite(curr_node->media_id_set);
+
+		for (auto iter = curr_node->child_dir_list.begin(); iter != curr_node->child_dir_list.end(); iter++) {
+			if ((*iter)->recur_media_count > 0) {
+				node_stack.push_back(iter->get());
+			}
+		}
+	}
+
+	return 1;
+}
+
+//long name sub path of every dir under sub_path, not including sub_path itself
+//DFS pre order so a dir's descendants always directly follow it
+int
+FileTracker::GetDirSubPathRecur(const QString& sub_path, QVector<QString>* out) {
+	DirTreeNode *dir_node;
+
+	//get dir node
+	if (GetDirNodePtr(sub_path, &dir_node) < 0) {
+		return -1;
+	}
+
+	QString start_path;
+	GetPathLongName(sub_path, &start_path);
+
+	QVector<QPair<DirTreeNode*, QString>> node_stack;
+	node_stack.push_back(qMakePair(dir_node, start_path));
+
+	while (!node_stack.empty()) {
+		QPair<DirTreeNode*, QString> curr = node_stack.takeLast();
+
+		if (curr.first != dir_node) {
+			out->push_back(curr.second);
+		}
+
+		for (auto iter = curr.first->child_dir_list.begin(); iter != curr.first->child_dir_list.end(); iter++) {
+			node_stack.push_back(qMakePair(iter->get(), curr.second % '\\' % (*iter)->long_name));
+		}
+	}
+
+	return 1;
+}
+
 void
 FileTracker::Clear() {
 
 	dir_tree.root_dir_node.child_dir_list.clear();
 	dir_tree.root_dir_node.child_dir_name_to_node_table.clear();
 	dir_tree.root_dir_node.child_dir_short_name_to_node_table.clear();
+	dir_tree.root_dir_node.media_id_set.clear();
+	dir_tree.root_dir_node.recur_media_count = 0;
+	dir_tree.root_dir_node.recur_byte_count = 0;
+	dir_tree.root_dir_node.recur_dir_count = 0;
+
+	media_size_table.clear();
+	path_to_node_table.clear();
+	path_to_node_table.insert("", &dir_tree.root_dir_node);
 }
 
 //private
 
 int	
 FileTracker::GetDirNodePtr(const QString& sub_path, DirTreeNode** out) {
+	
+	//all long or all short name path, found without walking the tree
+	const QString key = sub_path.startsWith('\\') ? sub_path.mid(1) : sub_path;
+	DirTreeNode *dir_node = path_to_node_table.value(key, nullptr);
+	if (dir_node != nullptr) {
+		*out = dir_node;
+		return 1;
+	}
+
+	//file paths end up here, their parent dir settles it in one more lookup
+	int separator_index = key.lastIndexOf('\\');
+	if (separator_index != key.size() - 1) {
+		DirTreeNode *parent_node = path_to_node_table.value(separator_index < 0 ? QString() : key.left(separator_index), nullptr);
+		if (parent_node != nullptr) {
+			return GetChildDirNodePtr(parent_node, key.mid(separator_index + 1), out);
+		}
+	}
+
+	//long and short names mixed in one path, or stray separators
 	QStringList path_component_list = sub_path.split('\\', QString::SkipEmptyParts);
 
 	DirTreeNode *curr_node = &dir_tree.root_dir_node;
-	for (QString component : path_component_list) {
-		if (curr_node->child_dir_name_to_node_table.contains(component)) {
-			curr_node = curr_node->child_dir_name_to_node_table.value(component);
-			continue;
+	for (const QString& component : path_component_list) {
+		if (GetChildDirNodePtr(curr_node, component, &curr_node) < 0) {
+			//this path leads to non existing dir
+			return -1;
 		}
+	}
 
-		if (curr_node->child_dir_short_name_to_node_table.contains(component)) {
-			curr_node = curr_node->child_dir_short_name_to_node_table.value(component);
-			continue;
-		}
+	*out = curr_node;
+	return 1;
+}
 
-		//this path leads to non existing dir
+int
+FileTracker::GetChildDirNodePtr(DirTreeNode* parent_node, const QString& name, DirTreeNode** out) {
+	DirTreeNode *dir_node = parent_node->child_dir_name_to_node_table.value(name, nullptr);
+	if (dir_node == nullptr) {
+		dir_node = parent_node->child_dir_short_name_to_node_table.value(name, nullptr);
+	}
+
+	if (dir_node == nullptr) {
 		return -1;
 	}
 
-	*out = curr_node;
+	*out = dir_node;
 	return 1;
 }
 
+//sets the paths of dir_node and everything under it from parent_node and adds them to the index
+void
+FileTracker::IndexDir(DirTreeNode* parent_node, DirTreeNode* dir_node) {
+	QVector<QPair<DirTreeNode*, DirTreeNode*>> node_stack;		//parent, dir
+	node_stack.push_back(qMakePair(parent_node, dir_node));
+
+	while (!node_stack.empty()) {
+		QPair<DirTreeNode*, DirTreeNode*> curr = node_stack.takeLast();
+		DirTreeNode *parent = curr.first;
+		DirTreeNode *node = curr.second;
+
+		const QString& short_name = node->short_name.isEmpty() ? node->long_name : node->short_name;
+
+		node->long_path = parent->long_path.isEmpty() ? node->long_name : parent->long_path % '\\' % node->long_name;
+		node->short_path = parent->short_path.isEmpty() ? short_name : parent->short_path % '\\' % short_name;
+
+		//long names win over a short name spelled the same, as in the walk
+		path_to_node_table.insert(node->long_path, node);
+		if (!path_to_node_table.contains(node->short_path)) {
+			path_to_node_table.insert(node->short_path, node);
+		}
+
+		for (auto iter = node->child_dir_list.begin(); iter != node->child_dir_list.end(); iter++) {
+			node_stack.push_back(qMakePair(node, iter->get()));
+		}
+	}
+}
+
+//removes dir_node and everything under it from the index
+void
+FileTracker::UnindexDir(DirTreeNode* dir_node) {
+	QVector<DirTreeNode*> node_stack;
+	node_stack.push_back(dir_node);
+
+	while (!node_stack.empty()) {
+		DirTreeNode *node = node_stack.takeLast();
+
+		auto iter = path_to_node_table.find(node->long_path);
+		if (iter != path_to_node_table.end() && iter.value() == node) {
+			path_to_node_table.erase(iter);
+		}
+
+		iter = path_to_node_table.find(node->short_path);
+		if (iter != path_to_node_table.end() && iter.value() == node) {
+			path_to_node_table.erase(iter);
+		}
+
+		for (auto child_iter = node->child_dir_list.begin(); child_iter != node->child_dir_list.end(); child_iter++) {
+			node_stack.push_back(child_iter->get());
+		}
+	}
+}
+
 int 
 FileTracker::GetDirMediaIdRecurByNode(DirTreeNode *root_node, QVector<unsigned int>* out) {
-	//BFS all child dirs
+	//BFS child dirs, skipping subtrees without media
 
 	QQueue<DirTreeNode*> node_queue;
 	DirTreeNode *curr_node;
 
-	node_queue.enqueue(root_node);
+	out->reserve(out->size() + root_node->recur_media_count);
+
+	if (root_node->recur_media_count > 0) {
+		node_queue.enqueue(root_node);
+	}
 
 	while (!node_queue.empty()) {
 		curr_node = node_queue.dequeue();
 
 		//enqueue child dirs
 		for (auto iter = curr_node->child_dir_list.begin(); iter != curr_node->child_dir_list.end(); iter++) {
-			node_queue.enqueue(iter->get());
+			if ((*iter)->recur_media_count > 0) {
+				node_queue.enqueue(iter->get());
+			}
 		}
 
-		if (curr_node->media_id_set.empty()) {
-			continue;
+		for (unsigned int media_id : curr_node->media_id_set) {
+			out->push_back(media_id);
 		}
-
-		out->reserve(out->size() + curr_node->media_id_set.size());
-		out->append(curr_node->media_id_set.toList().toVector());
 	}
 
 	return 1;
 }
 
+//dir_node and every dir above it
+void
+FileTracker::AddRecurStats(DirTreeNode* dir_node, qint64 media_delta, qint64 byte_delta, qint64 dir_delta) {
+	for (DirTreeNode *node = dir_node; node != nullptr; node = node->parent) {
+		node->recur_media_count += media_delta;
+		node->recur_byte_count += byte_delta;
+		node->recur_dir_count += dir_delta;
+	}
+}
+
 int		
 FileTracker::GetDirName(const QString& sub_path_name, QString* long_name, QString* short_name) {
 	DirTreeNode *dir_node;
@@ -405,4 +638,59 @@ FileTracker::GetDirName(const QString& sub_path_name, QString* long_name, QStrin
 	*short_name = dir_node->short_name;
 	
 	return 1;
-}
\ No newline at end of file
+}
+
+int
+FileTracker::GetDirStats(const QString& sub_path_name, DirStats* out) {
+	DirTreeNode *dir_node;
+
+	if (GetDirNodePtr(sub_path_name, &dir_node) < 0) {
+		return -1;
+	}
+
+	out->media_count = dir_node->media_id_set.size();
+	out->child_dir_count = dir_node->child_dir_list.size();
+	out->recur_media_count = dir_node->recur_media_count;
+	out->recur_byte_count = dir_node->recur_byte_count;
+	out->recur_dir_count = dir_node->recur_dir_count;
+
+	return 1;
+}
+
+quint64
+FileTracker::GetDirCount() const {
+	return dir_tree.root_dir_node.recur_dir_count + 1;
+}
+
+quint64
+FileTracker::EstimateMemory() const {
+	quint64 bytes = 0;
+
+	QVector<const DirTreeNode*> node_stack = { &dir_tree.root_dir_node };
+	while (!node_stack.isEmpty()) {
+		const DirTreeNode* dir_node = node_stack.takeLast();
+
+		//root lives in the tree itself
+		if (dir_node != &dir_tree.root_dir_node) {
+			bytes += sizeof(DirTreeNode);
+		}
+
+		bytes += MemEstimate::StringBytes(dir_node->long_name) + MemEstimate::StringBytes(dir_node->short_name);
+		bytes += MemEstimate::StringBytes(dir_node->long_path) + MemEstimate::StringBytes(dir_node->short_path);
+		bytes += MemEstimate::SetBytes(dir_node->media_id_set);
+		bytes += MemEstimate::HashBytes(dir_node->child_dir_name_to_node_table) + MemEstimate::HashBytes(dir_node->child_dir_short_name_to_node_table);
+
+		//std list node: prev, next and the unique ptr
+		bytes += (quint64) dir_node->child_dir_list.size() * 3 * sizeof(void*);
+
+		for (const std::unique_ptr<DirTreeNode>& child_node : dir_node->child_dir_list) {
+			node_stack.push_back(child_node.get());
+		}
+	}
+
+	//path keys share their data with node paths
+	bytes += MemEstimate::HashBytes(path_to_node_table);
+	bytes += MemEstimate::HashBytes(media_size_table);
+
+	return bytes;
+}
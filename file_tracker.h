@@ -14,6 +14,14 @@
 struct DirTreeNode {
 	QString long_name;
 	QString short_name;
+	QString long_path;		//sub path with every component in long name, key in the path index
+	QString short_path;		//same with short names where a component has one
+	DirTreeNode* parent = nullptr;
+
+	//kept up to date on every change below this dir, itself included
+	quint64 recur_media_count = 0;
+	quint64 recur_byte_count = 0;
+	quint64 recur_dir_count = 0;	//not counting itself
 
 	std::list<std::unique_ptr<DirTreeNode>>		child_dir_list;	//std list since qlist cannot hold smart ptr (look into Qt smart pointers)
 	QSet<unsigned int>							media_id_set;
@@ -22,6 +30,14 @@ struct DirTreeNode {
 	QHash<QString, DirTreeNode*>				child_dir_short_name_to_node_table;
 };
 
+struct DirStats {
+	quint64 media_count = 0;			//directly in the dir
+	quint64 child_dir_count = 0;
+	quint64 recur_media_count = 0;		//whole subtree
+	quint64 recur_byte_count = 0;
+	quint64 recur_dir_count = 0;
+};
+
 struct DirTree {
 	QString root_dir_abs_path;
 	DirTreeNode root_dir_node;
@@ -31,14 +47,6 @@ class FileTracker
 {
 public:
 
-	//annoying remove delay shit
-
-	bool		soft_del_flag = false;
-	bool		soft_del_dir_flag = false;
-	QString		soft_del_dir_sub_path_name;
-	MediaInfo	soft_del_media;
-
-
 	enum FileAction {
 		NONE,
 		MOVE,
@@ -58,9 +66,10 @@ public:
 
 	int		AddDirAbsPath(const QString& abs_path, const QString& long_name, const QString& short_name);
 	int		AddDirSubPath(const QString& sub_path, const QString& long_name, const QString& short_name);
-	int		AddMediaAbsPath(const QString& abs_path, const unsigned int media_id);
-	int		AddMediaSubPath(const QString& sub_path, const unsigned int media_id);
+	int		AddMediaAbsPath(const QString& abs_path, const unsigned int media_id, const qint64 size = -1);
+	int		AddMediaSubPath(const QString& sub_path, const unsigned int media_id, const qint64 size = -1);
 	int		RemoveMedia(const QString& sub_path, const unsigned int media_id);
+	int		UpdateMediaSize(const QString& sub_path, const unsigned int media_id, const qint64 size);
 	int		UpdateDirName(const QString& sub_path_name, const QString& long_name, const QString& short_name);
 	int		UpdateDirSubdir(const QString& sub_path_name, const QString& new_sub_dir);
 	int		RemoveDir(const QString& sub_path_name);
@@ -68,14 +77,25 @@ public:
 	bool	DirExistAbs(const QString& abs_path);
 	void	GetPathLongName(const QString& sub_path, QString* out);
 	int		GetDirMediaIdRecurByPath(const QString& path, QVector<unsigned int>* out);
+	int		GetDirMediaIdSet(const QString& sub_path, bool recursive, QSet<unsigned int>* out);
+	int		GetDirSubPathRecur(const QString& sub_path, QVector<QString>* out);
 	int		GetDirName(const QString& sub_path_name, QString* long_name, QString* short_name);
+	int		GetDirStats(const QString& sub_path_name, DirStats* out);
+	quint64	GetDirCount() const;			//root included
+	quint64	EstimateMemory() const;			//rough heap bytes, see MemEstimate
 	void	Clear();
 
 private:
 
 	DirTree						dir_tree;
+	QHash<QString, DirTreeNode*>	path_to_node_table;		//long and short sub path (no leading \\) -> node, root is ""
+	QHash<unsigned int, quint64>	media_size_table;		//bytes each tracked media adds to its dirs
 
 	int	GetDirNodePtr(const QString& path, DirTreeNode** out);
+	int	GetChildDirNodePtr(DirTreeNode* parent_node, const QString& name, DirTreeNode** out);
+	void IndexDir(DirTreeNode* parent_node, DirTreeNode* dir_node);
+	void UnindexDir(DirTreeNode* dir_node);
+	void AddRecurStats(DirTreeNode* dir_node, qint64 media_delta, qint64 byte_delta, qint64 dir_delta);
 	int GetDirMediaIdRecurByNode(DirTreeNode* root_node, QVector<unsigned int>* out);
 };
 
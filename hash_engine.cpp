@@ -0,0 +1,745 @@
+#include "hash_engine.h"
+
+#include <QFile>
+
+#include <algorithm>
+
+#include "blake3.h"
+#include "io_scheduler.h"
+#include "error.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <bcrypt.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#endif
+
+namespace {
+
+	size_t
+	RoundUp(size_t size, size_t align) {
+		return (size + align - 1) / align * align;
+	}
+
+	//small files get a block their own size instead of the full one
+	size_t
+	FitBlockSize(size_t block_size, quint64 file_size) {
+		block_size = RoundUp(std::max<size_t>(block_size, 1), HASH_ENGINE_ALIGNMENT);
+
+		if (file_size < block_size) {
+			block_size = RoundUp(std::max<size_t>((size_t) file_size, 1), HASH_ENGINE_ALIGNMENT);
+		}
+
+		return block_size;
+	}
+
+#ifdef _WIN32
+
+	//opened once, algorithm handles can be shared between threads
+	BCRYPT_ALG_HANDLE
+	GetSha256Provider(bool* reusable_out) {
+
+		static bool reusable = true;
+		static BCRYPT_ALG_HANDLE alg_handle = []() -> BCRYPT_ALG_HANDLE {
+			BCRYPT_ALG_HANDLE handle = NULL;
+
+			if (BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&handle, BCRYPT_SHA256_ALGORITHM, NULL, BCRYPT_HASH_REUSABLE_FLAG))) {
+				return handle;
+			}
+
+			//reusable hashes need windows 8
+			reusable = false;
+			if (BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&handle, BCRYPT_SHA256_ALGORITHM, NULL, 0))) {
+				return handle;
+			}
+
+			return NULL;
+		}();
+
+		*reusable_out = reusable;
+		return alg_handle;
+	}
+
+	//two aligned blocks read with overlapped io, one is hashed while the other is being filled
+	class BlockReader {
+	public:
+
+		BlockReader() :
+			file_handle(INVALID_HANDLE_VALUE),
+			buffer(nullptr),
+			block_size(0),
+			file_size(0),
+			next_offset(0),
+			eof(false)
+		{
+			for (int i = 0; i < 2; i++) {
+				ZeroMemory(&overlapped_arr[i], sizeof(OVERLAPPED));
+				overlapped_arr[i].hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+				pending_arr[i] = false;
+				error_arr[i] = ERROR_SUCCESS;
+			}
+		}
+
+		~BlockReader() {
+			Close();
+
+			for (int i = 0; i < 2; i++) {
+				if (overlapped_arr[i].hEvent != NULL) {
+					CloseHandle(overlapped_arr[i].hEvent);
+				}
+			}
+		}
+
+		int
+		Open(const QString& abs_path, size_t max_block_size) {
+
+			if (overlapped_arr[0].hEvent == NULL || overlapped_arr[1].hEvent == NULL) {
+				return -Error::QFILE_OPEN;
+			}
+
+			//share delete so hashing never gets in the way of the user moving or deleting the file
+			file_handle = CreateFileW(abs_path.toStdWString().c_str(),
+				GENERIC_READ,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL,
+				OPEN_EXISTING,
+				FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN,
+				NULL);
+
+			if (file_handle == INVALID_HANDLE_VALUE) {
+				return -Error::QFILE_OPEN;
+			}
+
+			LARGE_INTEGER size_buff;
+			if (!GetFileSizeEx(file_handle, &size_buff)) {
+				return -Error::QFILE_READ;
+			}
+
+			file_size = size_buff.QuadPart;
+			block_size = FitBlockSize(max_block_size, file_size);
+
+			//page aligned, which covers any sector size
+			buffer = (char*) VirtualAlloc(NULL, block_size * 2, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			if (buffer == nullptr) {
+				return -Error::QFILE_READ;
+			}
+
+			return 1;
+		}
+
+		//starts filling buffer idx with the next block
+		void
+		Issue(int idx) {
+
+			if (eof) {
+				return;
+			}
+
+			OVERLAPPED& overlapped = overlapped_arr[idx];
+			overlapped.Offset = (DWORD) next_offset;
+			overlapped.OffsetHigh = (DWORD) (next_offset >> 32);
+			ResetEvent(overlapped.hEvent);
+
+			next_offset += block_size;
+			error_arr[idx] = ERROR_SUCCESS;
+
+			if (!ReadFile(file_handle, GetBuffer(idx), (DWORD) block_size, NULL, &overlapped) && GetLastError() != ERROR_IO_PENDING) {
+				error_arr[idx] = GetLastError();
+				return;
+			}
+
+			pending_arr[idx] = true;
+		}
+
+		//waits for buffer idx, 0 bytes at end of file
+		int
+		Wait(int idx, DWORD* bytes_out) {
+
+			*bytes_out = 0;
+
+			if (pending_arr[idx]) {
+				pending_arr[idx] = false;
+
+				if (!GetOverlappedResult(file_handle, &overlapped_arr[idx], bytes_out, TRUE)) {
+					error_arr[idx] = GetLastError();
+				}
+			}
+
+			if (error_arr[idx] != ERROR_SUCCESS && error_arr[idx] != ERROR_HANDLE_EOF) {
+				return -Error::QFILE_READ;
+			}
+
+			//short read is the tail of the file
+			if (*bytes_out < block_size) {
+				eof = true;
+			}
+
+			return 1;
+		}
+
+		char*
+		GetBuffer(int idx) {
+			return buffer + idx * block_size;
+		}
+
+		size_t
+		GetBlockSize() const {
+			return block_size;
+		}
+
+		quint64
+		GetFileSize() const {
+			return file_size;
+		}
+
+		//buffers can only go once no read is writing into them
+		void
+		Close() {
+			DWORD bytes;
+
+			for (int i = 0; i < 2; i++) {
+				if (pending_arr[i]) {
+					CancelIoEx(file_handle, &overlapped_arr[i]);
+					GetOverlappedResult(file_handle, &overlapped_arr[i], &bytes, TRUE);
+					pending_arr[i] = false;
+				}
+			}
+
+			if (file_handle != INVALID_HANDLE_VALUE) {
+				CloseHandle(file_handle);
+				file_handle = INVALID_HANDLE_VALUE;
+			}
+
+			if (buffer != nullptr) {
+				VirtualFree(buffer, 0, MEM_RELEASE);
+				buffer = nullptr;
+			}
+		}
+
+	private:
+		HANDLE		file_handle;
+		char*		buffer;				//two blocks back to back
+		size_t		block_size;
+		quint64		file_size;			//at open
+		quint64		next_offset;
+		bool		eof;
+
+		OVERLAPPED	overlapped_arr[2];
+		bool		pending_arr[2];
+		DWORD		error_arr[2];
+	};
+
+#else
+
+	//pread into an aligned block, kernel reads the next block ahead while this one is hashed
+	class BlockReader {
+	public:
+
+		BlockReader() :
+			fd(-1),
+			buffer(nullptr),
+			block_size(0),
+			file_size(0),
+			offset(0)
+		{
+		}
+
+		~BlockReader() {
+			Close();
+		}
+
+		int
+		Open(const QString& abs_path, size_t max_block_size) {
+
+			fd = open(abs_path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				return -Error::QFILE_OPEN;
+			}
+
+			struct stat stat_buff;
+			if (fstat(fd, &stat_buff) < 0) {
+				return -Error::QFILE_READ;
+			}
+
+			file_size = stat_buff.st_size;
+			block_size = FitBlockSize(max_block_size, file_size);
+
+			if (posix_memalign((void**) &buffer, HASH_ENGINE_ALIGNMENT, block_size) != 0) {
+				buffer = nullptr;
+				return -Error::QFILE_READ;
+			}
+
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+			return 1;
+		}
+
+		//next block, 0 bytes at end of file
+		int
+		Read(size_t* bytes_out) {
+
+			*bytes_out = 0;
+
+			posix_fadvise(fd, offset + block_size, block_size, POSIX_FADV_WILLNEED);
+
+			while (*bytes_out < block_size) {
+				ssize_t ret = pread(fd, buffer + *bytes_out, block_size - *bytes_out, offset + *bytes_out);
+
+				if (ret < 0) {
+					return -Error::QFILE_READ;
+				}
+
+				if (ret == 0) {
+					break;
+				}
+
+				*bytes_out += ret;
+			}
+
+			offset += *bytes_out;
+			return 1;
+		}
+
+		const char*
+		GetBuffer() const {
+			return buffer;
+		}
+
+		size_t
+		GetBlockSize() const {
+			return block_size;
+		}
+
+		quint64
+		GetFileSize() const {
+			return file_size;
+		}
+
+		void
+		Close() {
+			if (fd >= 0) {
+				close(fd);
+				fd = -1;
+			}
+
+			free(buffer);
+			buffer = nullptr;
+		}
+
+	private:
+		int			fd;
+		char*		buffer;
+		size_t		block_size;
+		quint64		file_size;			//at open
+		quint64		offset;
+	};
+
+#endif
+
+	//hands every block of an opened file to block func in order, with its offset
+	template<typename BlockFunc>
+	int
+	ReadBlocks(BlockReader& reader, const std::atomic_bool& cancel_flag, BlockFunc block_func) {
+
+		quint64 offset = 0;
+		int ret;
+
+#ifdef _WIN32
+		DWORD bytes_read;
+		int curr = 0;
+
+		reader.Issue(0);
+		reader.Issue(1);
+
+		for (;;) {
+			ret = reader.Wait(curr, &bytes_read);
+			if (ret < 0) {
+				return ret;
+			}
+
+			if (bytes_read == 0) {
+				break;
+			}
+
+			if (cancel_flag.load(std::memory_order_relaxed)) {
+				return -Error::HASH_CANCELLED;
+			}
+
+			block_func(offset, reader.GetBuffer(curr), (size_t) bytes_read);
+			offset += bytes_read;
+
+			if (bytes_read < reader.GetBlockSize()) {
+				break;
+			}
+
+			//other buffer is being filled meanwhile, this one goes after it
+			reader.Issue(curr);
+			curr ^= 1;
+		}
+#else
+		size_t bytes_read;
+
+		for (;;) {
+			ret = reader.Read(&bytes_read);
+			if (ret < 0) {
+				return ret;
+			}
+
+			if (bytes_read == 0) {
+				break;
+			}
+
+			if (cancel_flag.load(std::memory_order_relaxed)) {
+				return -Error::HASH_CANCELLED;
+			}
+
+			block_func(offset, reader.GetBuffer(), bytes_read);
+			offset += bytes_read;
+
+			if (bytes_read < reader.GetBlockSize()) {
+				break;
+			}
+		}
+#endif
+
+		return 1;
+	}
+
+	//blake3 of little endian size, the head span and the tail span, spans never overlap
+	class QuickHasher {
+	public:
+
+		explicit QuickHasher(quint64 file_size) :
+			head_end(std::min<quint64>(HASH_ENGINE_QUICK_SPAN, file_size)),
+			tail_begin(std::max<quint64>(HASH_ENGINE_QUICK_SPAN, file_size < HASH_ENGINE_QUICK_SPAN ? 0 : file_size - HASH_ENGINE_QUICK_SPAN)),
+			file_size(file_size)
+		{
+			hasher.SetParallel(false);
+
+			char size_bytes[8];
+			for (int i = 0; i < 8; i++) {
+				size_bytes[i] = (char) (file_size >> (8 * i));
+			}
+			hasher.AddData(size_bytes, sizeof(size_bytes));
+		}
+
+		//blocks come in file order
+		void
+		AddBlock(quint64 offset, const char* data, size_t size) {
+			AddRange(offset, data, size, 0, head_end);
+			AddRange(offset, data, size, tail_begin, file_size);
+		}
+
+		QString
+		Result() {
+			return QString::fromLatin1(hasher.Result(HASH_ENGINE_QUICK_LEN).toHex());
+		}
+
+	private:
+		Blake3		hasher;
+		quint64		head_end;
+		quint64		tail_begin;
+		quint64		file_size;
+
+		void
+		AddRange(quint64 offset, const char* data, size_t size, quint64 range_begin, quint64 range_end) {
+			quint64 begin = std::max(offset, range_begin);
+			quint64 end = std::min(offset + size, range_end);
+
+			if (begin < end) {
+				hasher.AddData(data + (begin - offset), (size_t) (end - begin));
+			}
+		}
+	};
+
+	//quick hash and content hash of one file fed block by block
+	class FingerprintHasher {
+	public:
+
+		FingerprintHasher(int algo, quint64 file_size) :
+			algo(algo == HashEngine::BLAKE3 ? HashEngine::BLAKE3 : HashEngine::SHA256),
+			file_size(file_size),
+			quick_hasher(file_size)
+		{
+		}
+
+		//blocks come in file order
+		void
+		AddBlock(quint64 offset, const char* data, size_t size) {
+			quick_hasher.AddBlock(offset, data, size);
+
+			if (algo == HashEngine::BLAKE3) {
+				blake3_hasher.AddData(data, size);
+			}
+			else {
+				sha256_hasher.AddData(data, size);
+			}
+		}
+
+		void
+		Result(Fingerprint* out) {
+			out->size = (qint64) file_size;
+			out->quick_hash = quick_hasher.Result();
+			out->hash = QString::fromLatin1((algo == HashEngine::BLAKE3 ? blake3_hasher.Result() : sha256_hasher.Result()).toHex());
+			out->hash_algo = algo;
+		}
+
+	private:
+		int				algo;
+		quint64			file_size;
+		QuickHasher		quick_hasher;
+		Sha256			sha256_hasher;
+		Blake3			blake3_hasher;
+	};
+}
+
+Sha256::Sha256() :
+	hash_handle(nullptr),
+	reusable(false),
+	fallback(QCryptographicHash::Sha256)
+{
+	CreateSystemHash();
+}
+
+Sha256::~Sha256() {
+	DestroySystemHash();
+}
+
+void
+Sha256::AddData(const char* data, size_t size) {
+
+#ifdef _WIN32
+	if (hash_handle != nullptr) {
+		BCryptHashData((BCRYPT_HASH_HANDLE) hash_handle, (PUCHAR) data, (ULONG) size, 0);
+		return;
+	}
+#endif
+
+	fallback.addData(data, (int) size);
+}
+
+QByteArray
+Sha256::Result() {
+
+#ifdef _WIN32
+	if (hash_handle != nullptr) {
+		QByteArray digest(32, '\0');
+		BCryptFinishHash((BCRYPT_HASH_HANDLE) hash_handle, (PUCHAR) digest.data(), (ULONG) digest.size(), 0);
+
+		//finished hash can not take more data unless it was created reusable
+		if (!reusable) {
+			DestroySystemHash();
+			CreateSystemHash();
+		}
+
+		return digest;
+	}
+#endif
+
+	QByteArray digest = fallback.result();
+	fallback.reset();
+	return digest;
+}
+
+bool
+Sha256::IsSystemProvider() const {
+	return hash_handle != nullptr;
+}
+
+//private
+
+bool
+Sha256::CreateSystemHash() {
+
+#ifdef _WIN32
+	BCRYPT_ALG_HANDLE alg_handle = GetSha256Provider(&reusable);
+	if (alg_handle == NULL) {
+		return false;
+	}
+
+	DWORD object_size = 0;
+	ULONG ret_size = 0;
+	if (!BCRYPT_SUCCESS(BCryptGetProperty(alg_handle, BCRYPT_OBJECT_LENGTH, (PUCHAR) &object_size, sizeof(DWORD), &ret_size, 0))) {
+		return false;
+	}
+
+	hash_object.reset(new unsigned char[object_size]);
+
+	BCRYPT_HASH_HANDLE handle = NULL;
+	if (!BCRYPT_SUCCESS(BCryptCreateHash(alg_handle, &handle, hash_object.get(), object_size, NULL, 0, reusable ? BCRYPT_HASH_REUSABLE_FLAG : 0))) {
+		hash_object.reset();
+		return false;
+	}
+
+	hash_handle = handle;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void
+Sha256::DestroySystemHash() {
+
+#ifdef _WIN32
+	if (hash_handle != nullptr) {
+		BCryptDestroyHash((BCRYPT_HASH_HANDLE) hash_handle);
+		hash_handle = nullptr;
+	}
+#endif
+
+	hash_object.reset();
+}
+
+QString
+HashEngine::AlgoName(int algo) {
+	switch (algo) {
+	case BLAKE3:
+		return "blake3";
+	default:
+		return "sha256";
+	}
+}
+
+bool
+HashEngine::AlgoFromName(const QString& name, int* algo_out) {
+	for (int algo = 0; algo < ALGO_COUNT; algo++) {
+		if (name == AlgoName(algo)) {
+			*algo_out = algo;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int
+HashEngine::FileSHA256(const QString& abs_path, const std::atomic_bool& cancel_flag, QString* hash_out, size_t block_size /*= HASH_ENGINE_BLOCK_SIZE*/) {
+
+	BlockReader reader;
+	Sha256 hasher;
+
+	int ret = reader.Open(abs_path, block_size);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = ReadBlocks(reader, cancel_flag, [&hasher](quint64, const char* data, size_t size) {
+		hasher.AddData(data, size);
+	});
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	*hash_out = QString::fromLatin1(hasher.Result().toHex());
+	return 1;
+}
+
+int
+HashEngine::FileFingerprint(const QString& abs_path, int algo, const std::atomic_bool& cancel_flag, Fingerprint* out, size_t block_size /*= HASH_ENGINE_BLOCK_SIZE*/) {
+
+	BlockReader reader;
+
+	int ret = reader.Open(abs_path, block_size);
+	if (ret < 0) {
+		return ret;
+	}
+
+	FingerprintHasher hasher(algo, reader.GetFileSize());
+
+	ret = ReadBlocks(reader, cancel_flag, [&hasher](quint64 offset, const char* data, size_t size) {
+		hasher.AddBlock(offset, data, size);
+	});
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	hasher.Result(out);
+	return 1;
+}
+
+int
+HashEngine::FileFingerprint(IOScheduler& io_scheduler, const QString& abs_path, int algo, const std::atomic_bool& cancel_flag, Fingerprint* out) {
+
+	if (!io_scheduler.IsRunning()) {
+		return FileFingerprint(abs_path, algo, cancel_flag, out);
+	}
+
+	std::unique_ptr<ReadStream> stream;
+
+	int ret = io_scheduler.Open(abs_path, &stream);
+	if (ret < 0) {
+		return ret;
+	}
+
+	FingerprintHasher hasher(algo, stream->GetFileSize());
+	quint64 offset = 0;
+
+	for (;;) {
+		const char* data;
+		size_t size;
+
+		ret = stream->Next(&data, &size);
+		if (ret < 0) {
+			return ret;
+		}
+
+		if (size == 0) {
+			break;
+		}
+
+		if (cancel_flag.load(std::memory_order_relaxed)) {
+			return -Error::HASH_CANCELLED;
+		}
+
+		hasher.AddBlock(offset, data, size);
+		offset += size;
+	}
+
+	hasher.Result(out);
+	return 1;
+}
+
+int
+HashEngine::FileQuickHash(const QString& abs_path, Fingerprint* out) {
+
+	QFile file(abs_path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return -Error::QFILE_OPEN;
+	}
+
+	quint64 file_size = file.size();
+	QuickHasher quick_hasher(file_size);
+
+	//head, then whatever of the tail it did not cover
+	QByteArray head = file.read(std::min<quint64>(HASH_ENGINE_QUICK_SPAN, file_size));
+	if ((quint64) head.size() != std::min<quint64>(HASH_ENGINE_QUICK_SPAN, file_size)) {
+		return -Error::QFILE_READ;
+	}
+
+	quick_hasher.AddBlock(0, head.constData(), head.size());
+
+	if (file_size > HASH_ENGINE_QUICK_SPAN) {
+		quint64 tail_begin = std::max<quint64>(HASH_ENGINE_QUICK_SPAN, file_size - HASH_ENGINE_QUICK_SPAN);
+
+		if (!file.seek(tail_begin)) {
+			return -Error::QFILE_READ;
+		}
+
+		QByteArray tail = file.read(file_size - tail_begin);
+		if ((quint64) tail.size() != file_size - tail_begin) {
+			return -Error::QFILE_READ;
+		}
+
+		quick_hasher.AddBlock(tail_begin, tail.constData(), tail.size());
+	}
+
+	out->size = (qint64) file_size;
+	out->quick_hash = quick_hasher.Result();
+	return 1;
+}
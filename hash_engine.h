@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+	File hashing engine
+
+	Reads go straight from disk in large aligned blocks. On Windows the file is
+	opened unbuffered and two blocks are kept in flight with overlapped io, one
+	is hashed while the other is being filled, so the disk never waits on the
+	hash and the hash never waits on a small read. Elsewhere blocks are read
+	with pread and the kernel is asked to read the next block ahead while the
+	current one is hashed.
+
+	SHA-256 comes from Windows CNG (bcrypt) which takes the SHA-NI path on cpus
+	that have it, QCryptographicHash is the fallback when CNG is unavailable
+	and on other platforms. BLAKE3 is the faster choice, one file is spread
+	over several cores.
+
+	Files are fingerprinted in stages that get more expensive: size, then the
+	quick hash of size, first and last 64KB, then the full content hash. Each
+	stage is only needed when the cheaper one collides. Quick hash is always
+	BLAKE3 so it stays comparable when the content hash algorithm changes, it
+	is computed from the same reads as the full hash.
+
+	Given an IOScheduler the reads are left to its per device readers and the
+	calling thread only hashes, see io_scheduler.h.
+*/
+
+#include <QString>
+#include <QByteArray>
+#include <QCryptographicHash>
+
+#include <atomic>
+#include <memory>
+
+#define HASH_ENGINE_BLOCK_SIZE		(4 * 1024 * 1024)	//per read, two of these are in flight per file
+#define HASH_ENGINE_ALIGNMENT		4096				//unbuffered io wants sector aligned buffers, offsets and sizes
+#define HASH_ENGINE_QUICK_SPAN		(64 * 1024)			//bytes from each end of file in quick hash
+#define HASH_ENGINE_QUICK_LEN		16					//raw quick hash bytes, 32 hex chars
+
+class IOScheduler;
+
+//incremental sha256
+class Sha256 {
+public:
+	Sha256();
+	~Sha256();
+
+	Sha256(const Sha256&) = delete;
+	Sha256& operator=(const Sha256&) = delete;
+
+	void		AddData(const char* data, size_t size);
+
+	//raw 32 byte digest, hasher starts over afterwards
+	QByteArray	Result();
+
+	//true if digests come from the system provider rather than the fallback
+	bool		IsSystemProvider() const;
+
+private:
+	void*							hash_handle;		//BCRYPT_HASH_HANDLE, null when falling back
+	std::unique_ptr<unsigned char[]>	hash_object;
+	bool							reusable;			//system hash resets itself after Result
+	QCryptographicHash				fallback;
+
+	bool	CreateSystemHash();
+	void	DestroySystemHash();
+};
+
+struct Fingerprint {
+	qint64		size = -1;
+	QString		quick_hash;			//hex, empty if unknown
+	QString		hash;				//hex content hash, empty if unknown
+	int			hash_algo = 0;		//HashEngine::Algo of hash
+};
+
+namespace HashEngine {
+
+	//stored by name, values are only used in memory
+	enum Algo {
+		SHA256 = 0,
+		BLAKE3,
+		ALGO_COUNT
+	};
+
+	QString	AlgoName(int algo);
+	bool	AlgoFromName(const QString& name, int* algo_out);
+
+	//hex sha256 of file contents, -Error::HASH_CANCELLED once cancel flag is seen between blocks
+	int		FileSHA256(const QString& abs_path, const std::atomic_bool& cancel_flag, QString* hash_out, size_t block_size = HASH_ENGINE_BLOCK_SIZE);
+
+	//size, quick hash and content hash made with algo in one pass over the file
+	int		FileFingerprint(const QString& abs_path, int algo, const std::atomic_bool& cancel_flag, Fingerprint* out, size_t block_size = HASH_ENGINE_BLOCK_SIZE);
+
+	//same, blocks come from the scheduler's readers and this thread only hashes. reads directly when the scheduler is not running
+	int		FileFingerprint(IOScheduler& io_scheduler, const QString& abs_path, int algo, const std::atomic_bool& cancel_flag, Fingerprint* out);
+
+	//size and quick hash only, reads two small ranges
+	int		FileQuickHash(const QString& abs_path, Fingerprint* out);
+}
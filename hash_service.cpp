@@ -0,0 +1,221 @@
+#include "hash_service.h"
+
+#include "metrics.h"
+
+#include <algorithm>
+
+HashService::HashService(HashFunc hash_func) :
+	hash_func(std::move(hash_func)),
+	stop_flag(false),
+	next_seq(0)
+{
+}
+
+HashService::~HashService() {
+	Stop();
+}
+
+void
+HashService::SetResultNotify(NotifyFunc notify_func) {
+	this->notify_func = std::move(notify_func);
+}
+
+void
+HashService::Start(int worker_count /*= HASH_SERVICE_WORKER_COUNT*/) {
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop_flag = false;
+	}
+
+	for (int i = 0; i < std::max(worker_count, 1); i++) {
+		worker_list.emplace_back(&HashService::WorkerLoop, this);
+	}
+}
+
+void
+HashService::Stop() {
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop_flag = true;
+
+		for (auto iter = in_flight_table.begin(); iter != in_flight_table.end(); iter++) {
+			iter.value()->store(true);
+		}
+
+		queue.clear();
+		queued_table.clear();
+		UpdateQueueMetrics();
+	}
+
+	cond.notify_all();
+
+	for (std::thread& worker : worker_list) {
+		worker.join();
+	}
+
+	worker_list.clear();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	in_flight_table.clear();
+	result_list.clear();
+}
+
+void
+HashService::Submit(unsigned int media_id, const QString& abs_path, Priority priority) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	//file changed while being hashed, that run is stale
+	CancelInFlight(media_id);
+
+	auto queued_iter = queued_table.find(media_id);
+	if (queued_iter != queued_table.end()) {
+		QueuedRequest& request = queued_iter.value();
+		request.abs_path = abs_path;
+
+		//keeps its seq, it has been waiting longer than anything submitted after it
+		if (priority < request.priority) {
+			queue.erase(QueueKey(request.priority, request.seq));
+			request.priority = priority;
+			queue.emplace(QueueKey(request.priority, request.seq), media_id);
+		}
+
+		Metrics::Inc(Metrics::HASH_COALESCED_TOTAL);
+		return;
+	}
+
+	QueuedRequest request;
+	request.abs_path = abs_path;
+	request.priority = priority;
+	request.seq = next_seq++;
+
+	queue.emplace(QueueKey(request.priority, request.seq), media_id);
+	queued_table.insert(media_id, request);
+	UpdateQueueMetrics();
+
+	lock.unlock();
+	cond.notify_one();
+}
+
+void
+HashService::Cancel(unsigned int media_id) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto queued_iter = queued_table.find(media_id);
+	if (queued_iter != queued_table.end()) {
+		queue.erase(QueueKey(queued_iter.value().priority, queued_iter.value().seq));
+		queued_table.erase(queued_iter);
+		UpdateQueueMetrics();
+	}
+
+	CancelInFlight(media_id);
+}
+
+bool
+HashService::IsPending(unsigned int media_id) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return queued_table.contains(media_id) || in_flight_table.contains(media_id);
+}
+
+int
+HashService::GetPendingCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return queued_table.size() + in_flight_table.size();
+}
+
+void
+HashService::TakeResults(QVector<HashResult>* out) {
+	std::lock_guard<std::mutex> lock(mutex);
+	out->swap(result_list);
+	result_list.clear();
+}
+
+//private
+
+void
+HashService::WorkerLoop() {
+
+	Metrics::SetThreadName("hash");
+
+	for (;;) {
+
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait(lock, [this]() { return stop_flag || !queue.empty(); });
+
+		if (stop_flag) {
+			return;
+		}
+
+		unsigned int media_id = queue.begin()->second;
+		queue.erase(queue.begin());
+
+		auto queued_iter = queued_table.find(media_id);
+		QString abs_path = queued_iter.value().abs_path;
+		queued_table.erase(queued_iter);
+
+		std::shared_ptr<std::atomic_bool> cancel_flag = std::make_shared<std::atomic_bool>(false);
+		in_flight_table.insert(media_id, cancel_flag);
+		UpdateQueueMetrics();
+
+		lock.unlock();
+
+		HashResult result;
+		result.media_id = media_id;
+		result.abs_path = abs_path;
+		int64_t begin_usec = Metrics::NowUsec();
+		result.ret = hash_func(abs_path, *cancel_flag, &result.fingerprint);
+		Metrics::Inc(Metrics::HASH_BUSY_USEC_TOTAL, Metrics::NowUsec() - begin_usec);
+
+		if (result.ret < 0) {
+			result.fingerprint = Fingerprint();
+		}
+		else if (result.fingerprint.size > 0) {
+			Metrics::Inc(Metrics::HASH_BYTES_TOTAL, result.fingerprint.size);
+		}
+
+		lock.lock();
+
+		//a resubmit may have started another run for the same media already, only remove our own
+		auto flight_iter = in_flight_table.find(media_id);
+		if (flight_iter != in_flight_table.end() && flight_iter.value() == cancel_flag) {
+			in_flight_table.erase(flight_iter);
+		}
+
+		if (cancel_flag->load()) {
+			continue;
+		}
+
+		result_list.push_back(std::move(result));
+		Metrics::Inc(Metrics::HASH_TOTAL);
+
+		lock.unlock();
+
+		if (notify_func) {
+			notify_func();
+		}
+	}
+}
+
+bool
+HashService::CancelInFlight(unsigned int media_id) {
+
+	auto flight_iter = in_flight_table.find(media_id);
+	if (flight_iter == in_flight_table.end()) {
+		return false;
+	}
+
+	//worker drops the result when it notices
+	flight_iter.value()->store(true);
+	in_flight_table.erase(flight_iter);
+
+	Metrics::Inc(Metrics::HASH_CANCELLED_TOTAL);
+	return true;
+}
+
+void
+HashService::UpdateQueueMetrics() {
+	Metrics::Set(Metrics::HASH_QUEUE_LENGTH, queued_table.size());
+}
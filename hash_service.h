@@ -0,0 +1,111 @@
+#pragma once
+
+/*
+	Hashes media files off the monitor thread
+
+	Monitor thread inserts new media right away with an empty hash (pending)
+	and submits the file here. A fixed number of workers pick requests in
+	priority order, interactive before live events before backfill, oldest
+	first within a priority.
+
+	Requests are keyed by media id. Submitting media that is already queued
+	only updates its path and raises its priority. Submitting media that is
+	being hashed right now cancels that run, the file changed since and its
+	result would be stale. Cancel drops a removed file from the queue and stops
+	its run at the next block read.
+
+	Finished hashes pile up until the owner takes them. Owner is told through
+	the notify callback, which runs on a worker thread and should do nothing
+	more than wake the owner up.
+*/
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+#include "hash_engine.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define HASH_SERVICE_WORKER_COUNT	2		//hashing is bound by disk reads, more workers mostly add seeks
+
+struct HashResult {
+	unsigned int	media_id = 0;
+	QString			abs_path;		//path that was hashed, media may have moved since
+	Fingerprint		fingerprint;	//empty hashes if hashing failed
+	int				ret = 0;		//what hash func returned
+};
+
+class HashService {
+public:
+
+	enum Priority {
+		INTERACTIVE = 0,	//user asked for it
+		LIVE,				//file events
+		BACKFILL			//startup discovery, rescans, hashes left pending by last run
+	};
+
+	//hash func reads abs path and fills in fingerprint, gives up with a negative return once cancel flag is set
+	using HashFunc = std::function<int(const QString& abs_path, const std::atomic_bool& cancel_flag, Fingerprint* fingerprint_out)>;
+	using NotifyFunc = std::function<void()>;
+
+	explicit HashService(HashFunc hash_func);
+	~HashService();
+
+	//call before Start
+	void	SetResultNotify(NotifyFunc notify_func);
+
+	//requests submitted before Start wait for it
+	void	Start(int worker_count = HASH_SERVICE_WORKER_COUNT);
+
+	//drops queued requests and results, cancels and waits for runs in flight
+	void	Stop();
+
+	void	Submit(unsigned int media_id, const QString& abs_path, Priority priority);
+	void	Cancel(unsigned int media_id);
+
+	//queued or being hashed
+	bool	IsPending(unsigned int media_id) const;
+	int		GetPendingCount() const;
+
+	void	TakeResults(QVector<HashResult>* out);
+
+private:
+
+	struct QueuedRequest {
+		QString		abs_path;
+		Priority	priority;
+		quint64		seq;
+	};
+
+	using QueueKey = std::pair<int, quint64>;	//priority, seq
+
+	HashFunc											hash_func;
+	NotifyFunc											notify_func;
+
+	mutable std::mutex									mutex;
+	std::condition_variable								cond;
+	bool												stop_flag;
+	quint64												next_seq;
+
+	std::map<QueueKey, unsigned int>					queue;				//lowest key goes first
+	QHash<unsigned int, QueuedRequest>					queued_table;		//media id -> request in queue
+	QHash<unsigned int, std::shared_ptr<std::atomic_bool>>	in_flight_table;	//media id -> cancel flag of its run
+	QVector<HashResult>									result_list;
+
+	std::vector<std::thread>							worker_list;
+
+	void	WorkerLoop();
+
+	//caller holds mutex
+	bool	CancelInFlight(unsigned int media_id);
+	void	UpdateQueueMetrics();
+};
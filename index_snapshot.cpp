@@ -0,0 +1,179 @@
+#include "index_snapshot.h"
+
+//IndexSnapshot
+
+quint64
+IndexSnapshot::GetGeneration() const {
+	return generation;
+}
+
+int
+IndexSnapshot::GetTagCount() const {
+	return tag_table.size();
+}
+
+int
+IndexSnapshot::GetMediaCount() const {
+	return media_count;
+}
+
+const Tag*
+IndexSnapshot::GetTagById(const unsigned int tag_id) const {
+	auto iter = tag_table.constFind(tag_id);
+	if (iter == tag_table.constEnd()) {
+		return nullptr;
+	}
+
+	return &iter.value();
+}
+
+const Tag*
+IndexSnapshot::GetTagByName(const QString& tag_name) const {
+	auto iter = tag_name_table.constFind(tag_name);
+	if (iter == tag_name_table.constEnd()) {
+		return nullptr;
+	}
+
+	return GetTagById(iter.value());
+}
+
+const Media*
+IndexSnapshot::GetMediaById(const unsigned int media_id) const {
+	const MediaShard& shard = *media_shard_arr[GetShardIndex(media_id)];
+
+	auto iter = shard.constFind(media_id);
+	if (iter == shard.constEnd()) {
+		return nullptr;
+	}
+
+	return &iter.value();
+}
+
+//static
+int
+IndexSnapshot::GetShardIndex(const unsigned int media_id) {
+	return media_id % INDEX_SNAPSHOT_MEDIA_SHARD_COUNT;
+}
+
+//IndexSnapshotWriter
+
+IndexSnapshotWriter::IndexSnapshotWriter() {
+	std::shared_ptr<const IndexSnapshot::MediaShard> empty_shard = std::make_shared<IndexSnapshot::MediaShard>();
+
+	std::shared_ptr<IndexSnapshot> snapshot = std::make_shared<IndexSnapshot>();
+	for (std::shared_ptr<const IndexSnapshot::MediaShard>& shard : snapshot->media_shard_arr) {
+		shard = empty_shard;
+	}
+
+	published = std::move(snapshot);
+}
+
+std::shared_ptr<const IndexSnapshot>
+IndexSnapshotWriter::Pin() const {
+	return std::atomic_load(&published);
+}
+
+void
+IndexSnapshotWriter::SetTag(const Tag& tag) {
+	IndexSnapshot* snapshot = Stage();
+
+	auto iter = snapshot->tag_table.find(tag.id);
+	if (iter != snapshot->tag_table.end()) {
+		RemoveTagName(iter->name, tag.id);
+		*iter = tag;
+	}
+	else {
+		snapshot->tag_table.insert(tag.id, tag);
+	}
+
+	snapshot->tag_name_table.insert(tag.name, tag.id);
+}
+
+void
+IndexSnapshotWriter::RemoveTag(const unsigned int tag_id) {
+	IndexSnapshot* snapshot = Stage();
+
+	auto iter = snapshot->tag_table.find(tag_id);
+	if (iter == snapshot->tag_table.end()) {
+		return;
+	}
+
+	RemoveTagName(iter->name, tag_id);
+	snapshot->tag_table.erase(iter);
+}
+
+void
+IndexSnapshotWriter::SetMedia(const Media& media) {
+	IndexSnapshot::MediaShard* shard = StageShard(media.id);
+
+	if (!shard->contains(media.id)) {
+		staged->media_count++;
+	}
+
+	shard->insert(media.id, media);
+}
+
+void
+IndexSnapshotWriter::RemoveMedia(const unsigned int media_id) {
+	IndexSnapshot::MediaShard* shard = StageShard(media_id);
+
+	if (shard->remove(media_id) > 0) {
+		staged->media_count--;
+	}
+}
+
+void
+IndexSnapshotWriter::Publish(quint64 generation) {
+	if (!staged) {
+		if (generation == published->generation) {
+			return;
+		}
+
+		Stage();
+	}
+
+	staged->generation = generation;
+
+	std::shared_ptr<const IndexSnapshot> new_snapshot(staged.release());
+	std::atomic_store(&published, new_snapshot);
+
+	//next change copies again, published shards are never written
+	for (std::shared_ptr<IndexSnapshot::MediaShard>& shard : staged_shard_arr) {
+		shard.reset();
+	}
+}
+
+//private
+
+IndexSnapshot*
+IndexSnapshotWriter::Stage() {
+	if (!staged) {
+		staged.reset(new IndexSnapshot(*published));
+	}
+
+	return staged.get();
+}
+
+void
+IndexSnapshotWriter::RemoveTagName(const QString& tag_name, const unsigned int tag_id) {
+
+	//changed ids arrive in no particular order, the name may already belong to a tag set earlier
+	auto iter = staged->tag_name_table.find(tag_name);
+	if (iter != staged->tag_name_table.end() && iter.value() == tag_id) {
+		staged->tag_name_table.erase(iter);
+	}
+}
+
+IndexSnapshot::MediaShard*
+IndexSnapshotWriter::StageShard(const unsigned int media_id) {
+	IndexSnapshot* snapshot = Stage();
+	int shard_idx = IndexSnapshot::GetShardIndex(media_id);
+
+	std::shared_ptr<IndexSnapshot::MediaShard>& shard = staged_shard_arr[shard_idx];
+	if (!shard) {
+		shard = std::make_shared<IndexSnapshot::MediaShard>(*snapshot->media_shard_arr[shard_idx]);
+		snapshot->media_shard_arr[shard_idx] = shard;
+	}
+
+	return shard.get();
+}
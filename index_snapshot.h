@@ -0,0 +1,104 @@
+#pragma once
+
+/*
+	Immutable copies of the tag and media lists that readers use without taking any lock
+
+	A reader pins the published snapshot, a shared_ptr loaded atomically, and reads it for as
+	long as it likes. Nothing in a published snapshot ever changes, the writer stages changes on
+	a copy and publishes that as a new version, the old one goes away with its last reader.
+
+	Copying has to stay cheap however many media there are. Tags, names and media sets are
+	implicitly shared so a copy only duplicates what was changed. Media are split into
+	INDEX_SNAPSHOT_MEDIA_SHARD_COUNT shards by id, a shard is copied the first time one of its
+	media changes in a version and the rest are shared with the previous one.
+
+	Writer side calls must come from one thread at a time, daemon makes them under its list
+	write locks. Pin and everything on a pinned snapshot is callable from any thread.
+*/
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+
+#include <memory>
+
+#include "tag_structs.h"
+#include "media_structs.h"
+
+#define INDEX_SNAPSHOT_MEDIA_SHARD_COUNT	256
+
+class IndexSnapshot {
+public:
+	quint64			GetGeneration() const;
+
+	int				GetTagCount() const;
+	int				GetMediaCount() const;
+
+	//nullptr if missing, pointers live as long as the snapshot
+	const Tag*		GetTagById(const unsigned int tag_id) const;
+	const Tag*		GetTagByName(const QString& tag_name) const;
+	const Media*	GetMediaById(const unsigned int media_id) const;
+
+	template<typename Func>
+	void			ForEachTag(Func func) const;
+
+	template<typename Func>
+	void			ForEachMedia(Func func) const;
+
+private:
+	friend class IndexSnapshotWriter;
+
+	typedef QHash<unsigned int, Media> MediaShard;
+
+	quint64								generation = 0;
+	QHash<unsigned int, Tag>			tag_table;
+	QHash<QString, unsigned int>		tag_name_table;
+	std::shared_ptr<const MediaShard>	media_shard_arr[INDEX_SNAPSHOT_MEDIA_SHARD_COUNT];
+	int									media_count = 0;
+
+	static int	GetShardIndex(const unsigned int media_id);
+};
+
+class IndexSnapshotWriter {
+public:
+	IndexSnapshotWriter();
+
+	//current version, lock free
+	std::shared_ptr<const IndexSnapshot>	Pin() const;
+
+	//staged until Publish
+	void	SetTag(const Tag& tag);
+	void	RemoveTag(const unsigned int tag_id);
+	void	SetMedia(const Media& media);
+	void	RemoveMedia(const unsigned int media_id);
+
+	//makes staged changes visible, a new generation alone publishes a new version too
+	void	Publish(quint64 generation);
+
+private:
+	std::shared_ptr<const IndexSnapshot>				published;		//only touched with std::atomic_load/store
+	std::unique_ptr<IndexSnapshot>						staged;			//copy of published with changes, null when nothing is staged
+	std::shared_ptr<IndexSnapshot::MediaShard>			staged_shard_arr[INDEX_SNAPSHOT_MEDIA_SHARD_COUNT];	//shards already copied into staged
+
+	IndexSnapshot*				Stage();
+	void						RemoveTagName(const QString& tag_name, const unsigned int tag_id);
+	IndexSnapshot::MediaShard*	StageShard(const unsigned int media_id);
+};
+
+template<typename Func>
+void
+IndexSnapshot::ForEachTag(Func func) const {
+	for (auto iter = tag_table.constBegin(); iter != tag_table.constEnd(); iter++) {
+		func(iter.value());
+	}
+}
+
+template<typename Func>
+void
+IndexSnapshot::ForEachMedia(Func func) const {
+	for (const std::shared_ptr<const MediaShard>& shard : media_shard_arr) {
+		for (auto iter = shard->constBegin(); iter != shard->constEnd(); iter++) {
+			func(iter.value());
+		}
+	}
+}
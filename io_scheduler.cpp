@@ -0,0 +1,621 @@
+#include "io_scheduler.h"
+
+#include <QDir>
+#include <QStringBuilder>
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+
+#include "error.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <cstdlib>
+#endif
+
+//everything but cond is guarded by the scheduler mutex
+struct ReadStream::State {
+	quint64							id = 0;
+	QString							path;
+	QString							device_key;
+
+#ifdef _WIN32
+	HANDLE							file_handle = INVALID_HANDLE_VALUE;
+#else
+	int								fd = -1;
+#endif
+
+	quint64							file_size = 0;
+	quint64							next_offset = 0;
+
+	std::deque<std::pair<char*, size_t>>	ready_list;		//filled blocks in file order
+	char*							current_block = nullptr;	//block the hasher is on
+
+	bool							reading = false;	//a reader is filling a block for this stream
+	bool							eof = false;		//last block is in ready list
+	bool							closed = false;
+	int								error = 0;
+
+	std::condition_variable			cond;
+
+	~State() {
+		CloseFile();
+	}
+
+	//only once no reader is on it
+	void
+	CloseFile() {
+#ifdef _WIN32
+		if (file_handle != INVALID_HANDLE_VALUE) {
+			CloseHandle(file_handle);
+			file_handle = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+#endif
+	}
+
+	//whole block at offset, fewer bytes only at end of file
+	int
+	ReadBlock(char* block, quint64 offset, size_t* bytes_out) {
+
+		*bytes_out = 0;
+
+#ifdef _WIN32
+		OVERLAPPED overlapped;
+		ZeroMemory(&overlapped, sizeof(OVERLAPPED));
+		overlapped.Offset = (DWORD) offset;
+		overlapped.OffsetHigh = (DWORD) (offset >> 32);
+
+		DWORD bytes_read = 0;
+		if (!ReadFile(file_handle, block, IO_BLOCK_SIZE, &bytes_read, &overlapped) && GetLastError() != ERROR_HANDLE_EOF) {
+			return -Error::QFILE_READ;
+		}
+
+		*bytes_out = bytes_read;
+#else
+		while (*bytes_out < (size_t) IO_BLOCK_SIZE) {
+			ssize_t ret = pread(fd, block + *bytes_out, IO_BLOCK_SIZE - *bytes_out, offset + *bytes_out);
+
+			if (ret < 0) {
+				return -Error::QFILE_READ;
+			}
+
+			if (ret == 0) {
+				break;
+			}
+
+			*bytes_out += ret;
+		}
+#endif
+
+		return 1;
+	}
+};
+
+namespace {
+
+	char*
+	AllocBlock() {
+#ifdef _WIN32
+		//page aligned, which covers any sector size unbuffered reads ask for
+		return (char*) VirtualAlloc(NULL, IO_BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+		void* block = nullptr;
+		if (posix_memalign(&block, IO_BLOCK_ALIGNMENT, IO_BLOCK_SIZE) != 0) {
+			return nullptr;
+		}
+		return (char*) block;
+#endif
+	}
+
+	void
+	FreeBlock(char* block) {
+#ifdef _WIN32
+		VirtualFree(block, 0, MEM_RELEASE);
+#else
+		free(block);
+#endif
+	}
+
+#ifndef _WIN32
+
+	//first char of a sysfs file, 0 if it can not be read
+	char
+	ReadSysChar(const QString& path) {
+		FILE* file = fopen(path.toLocal8Bit().constData(), "r");
+		if (file == nullptr) {
+			return 0;
+		}
+
+		int c = fgetc(file);
+		fclose(file);
+		return c == EOF ? 0 : (char) c;
+	}
+
+#endif
+}
+
+ReadStream::ReadStream(IOScheduler* scheduler, std::shared_ptr<State> state) :
+	scheduler(scheduler),
+	state(std::move(state))
+{
+}
+
+ReadStream::~ReadStream() {
+	Close();
+}
+
+int
+ReadStream::Next(const char** data_out, size_t* size_out) {
+
+	*data_out = nullptr;
+	*size_out = 0;
+
+	std::unique_lock<std::mutex> lock(scheduler->mutex);
+
+	if (state->closed) {
+		return -Error::QFILE_READ;
+	}
+
+	if (state->current_block != nullptr) {
+		scheduler->ReleaseBlock(state->current_block);
+		state->current_block = nullptr;
+	}
+
+	state->cond.wait(lock, [this]() {
+		return !state->ready_list.empty() || state->eof || state->error < 0;
+	});
+
+	if (!state->ready_list.empty()) {
+		state->current_block = state->ready_list.front().first;
+		*data_out = state->current_block;
+		*size_out = state->ready_list.front().second;
+		state->ready_list.pop_front();
+
+		//stream has room for another block
+		scheduler->reader_cond.notify_all();
+		return 1;
+	}
+
+	if (state->error < 0) {
+		return state->error;
+	}
+
+	return 1;
+}
+
+quint64
+ReadStream::GetFileSize() const {
+	return state->file_size;
+}
+
+void
+ReadStream::Close() {
+
+	std::lock_guard<std::mutex> lock(scheduler->mutex);
+
+	if (state->closed) {
+		return;
+	}
+
+	state->closed = true;
+
+	if (state->current_block != nullptr) {
+		scheduler->ReleaseBlock(state->current_block);
+		state->current_block = nullptr;
+	}
+
+	for (const auto& block : state->ready_list) {
+		scheduler->ReleaseBlock(block.first);
+	}
+	state->ready_list.clear();
+
+	scheduler->RemoveStream(*state);
+
+	//reader closes it once its read finishes
+	if (!state->reading) {
+		state->CloseFile();
+	}
+}
+
+IOScheduler::IOScheduler() :
+	running(false),
+	next_stream_id(0)
+{
+}
+
+IOScheduler::~IOScheduler() {
+	Stop();
+
+	for (char* block : block_list) {
+		FreeBlock(block);
+	}
+}
+
+void
+IOScheduler::SetConfig(const IOSchedulerConfig& config) {
+	this->config = config;
+	this->config.rotational_readers = std::max(this->config.rotational_readers, 1);
+	this->config.solid_readers = std::max(this->config.solid_readers, 1);
+	this->config.network_readers = std::max(this->config.network_readers, 1);
+	this->config.pool_blocks = std::max(this->config.pool_blocks, 1);
+}
+
+void
+IOScheduler::Start() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (running) {
+		return;
+	}
+
+	//pool is kept across restarts
+	while ((int) block_list.size() < config.pool_blocks) {
+		char* block = AllocBlock();
+		if (block == nullptr) {
+			break;
+		}
+
+		block_list.push_back(block);
+		free_block_list.push_back(block);
+	}
+
+	running = true;
+}
+
+void
+IOScheduler::Stop() {
+
+	std::vector<std::thread> reader_list;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (!running) {
+			return;
+		}
+
+		running = false;
+
+		//hashers still waiting on a stream get an error instead of a block
+		for (const auto& device : device_table) {
+			for (const auto& stream : device->stream_table) {
+				if (stream.second->error == 0) {
+					stream.second->error = -Error::QFILE_READ;
+				}
+				stream.second->cond.notify_all();
+			}
+
+			for (std::thread& reader : device->reader_list) {
+				reader_list.push_back(std::move(reader));
+			}
+		}
+
+		device_table.clear();
+		reader_cond.notify_all();
+	}
+
+	for (std::thread& reader : reader_list) {
+		reader.join();
+	}
+}
+
+bool
+IOScheduler::IsRunning() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return running;
+}
+
+int
+IOScheduler::Open(const QString& abs_path, std::unique_ptr<ReadStream>* stream_out) {
+
+	std::shared_ptr<ReadStream::State> state = std::make_shared<ReadStream::State>();
+	state->path = abs_path;
+	state->device_key = GetDeviceKey(abs_path);
+
+#ifdef _WIN32
+	//share delete so reading never gets in the way of the user moving or deleting the file
+	state->file_handle = CreateFileW(QDir::toNativeSeparators(abs_path).toStdWString().c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN,
+		NULL);
+
+	if (state->file_handle == INVALID_HANDLE_VALUE) {
+		return -Error::QFILE_OPEN;
+	}
+
+	LARGE_INTEGER size_buff;
+	if (!GetFileSizeEx(state->file_handle, &size_buff)) {
+		state->CloseFile();
+		return -Error::QFILE_READ;
+	}
+
+	state->file_size = size_buff.QuadPart;
+#else
+	state->fd = open(abs_path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+	if (state->fd < 0) {
+		return -Error::QFILE_OPEN;
+	}
+
+	struct stat stat_buff;
+	if (fstat(state->fd, &stat_buff) < 0) {
+		state->CloseFile();
+		return -Error::QFILE_READ;
+	}
+
+	state->file_size = stat_buff.st_size;
+	posix_fadvise(state->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!running) {
+		state->CloseFile();
+		return -Error::QFILE_OPEN;
+	}
+
+	std::shared_ptr<Device> device = GetDevice(state->device_key, abs_path);
+
+	state->id = next_stream_id++;
+	device->stream_table.emplace(std::make_pair(state->path, state->id), state);
+
+	stream_out->reset(new ReadStream(this, state));
+	reader_cond.notify_all();
+	return 1;
+}
+
+QString
+IOScheduler::GetDeviceKey(const QString& abs_path) {
+
+#ifdef _WIN32
+	wchar_t volume_path[MAX_PATH + 1];
+	if (GetVolumePathNameW(QDir::toNativeSeparators(abs_path).toStdWString().c_str(), volume_path, MAX_PATH + 1)) {
+		return QString::fromWCharArray(volume_path).toLower();
+	}
+
+	return QString();
+#else
+	struct stat stat_buff;
+	if (stat(abs_path.toLocal8Bit().constData(), &stat_buff) < 0) {
+		return QString();
+	}
+
+	return QString::number((quint64) stat_buff.st_dev);
+#endif
+}
+
+IOScheduler::DeviceKind
+IOScheduler::DetectDeviceKind(const QString& abs_path) {
+
+#ifdef _WIN32
+	wchar_t volume_path[MAX_PATH + 1];
+	if (!GetVolumePathNameW(QDir::toNativeSeparators(abs_path).toStdWString().c_str(), volume_path, MAX_PATH + 1)) {
+		return ROTATIONAL;
+	}
+
+	if (GetDriveTypeW(volume_path) == DRIVE_REMOTE) {
+		return NETWORK;
+	}
+
+	//\\?\Volume{guid}\ without the trailing slash opens the volume itself
+	wchar_t volume_name[MAX_PATH + 1];
+	if (!GetVolumeNameForVolumeMountPointW(volume_path, volume_name, MAX_PATH + 1)) {
+		return ROTATIONAL;
+	}
+
+	size_t len = wcslen(volume_name);
+	if (len > 0 && volume_name[len - 1] == L'\\') {
+		volume_name[len - 1] = L'\0';
+	}
+
+	//no access rights needed to query properties
+	HANDLE volume_handle = CreateFileW(volume_name, 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+	if (volume_handle == INVALID_HANDLE_VALUE) {
+		return ROTATIONAL;
+	}
+
+	STORAGE_PROPERTY_QUERY query;
+	ZeroMemory(&query, sizeof(query));
+	query.PropertyId = StorageDeviceSeekPenaltyProperty;
+	query.QueryType = PropertyStandardQuery;
+
+	DEVICE_SEEK_PENALTY_DESCRIPTOR descriptor;
+	ZeroMemory(&descriptor, sizeof(descriptor));
+
+	DWORD bytes_returned = 0;
+	BOOL ret = DeviceIoControl(volume_handle, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query), &descriptor, sizeof(descriptor), &bytes_returned, NULL);
+	CloseHandle(volume_handle);
+
+	if (!ret || bytes_returned < sizeof(descriptor)) {
+		return ROTATIONAL;
+	}
+
+	return descriptor.IncursSeekPenalty ? ROTATIONAL : SOLID;
+#else
+	struct stat stat_buff;
+	if (stat(abs_path.toLocal8Bit().constData(), &stat_buff) < 0) {
+		return ROTATIONAL;
+	}
+
+	//no block device behind it: nfs, smb, fuse
+	if (major(stat_buff.st_dev) == 0) {
+		return NETWORK;
+	}
+
+	QString block_dir = "/sys/dev/block/" % QString::number(major(stat_buff.st_dev)) % ":" % QString::number(minor(stat_buff.st_dev));
+
+	//partitions keep the queue on their parent disk
+	char rotational = ReadSysChar(block_dir % "/queue/rotational");
+	if (rotational == 0) {
+		rotational = ReadSysChar(block_dir % "/../queue/rotational");
+	}
+
+	return rotational == '0' ? SOLID : ROTATIONAL;
+#endif
+}
+
+int
+IOScheduler::GetDeviceCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return device_table.size();
+}
+
+int
+IOScheduler::GetFreeBlockCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return (int) free_block_list.size();
+}
+
+//private
+
+void
+IOScheduler::ReaderLoop(std::shared_ptr<Device> device) {
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (running) {
+
+		std::shared_ptr<ReadStream::State> state = PickStream(*device);
+		if (!state) {
+			reader_cond.wait(lock);
+			continue;
+		}
+
+		char* block = free_block_list.back();
+		free_block_list.pop_back();
+
+		quint64 offset = state->next_offset;
+		state->next_offset += IO_BLOCK_SIZE;
+		state->reading = true;
+		device->last_path = state->path;
+
+		lock.unlock();
+
+		size_t bytes_read;
+		int ret = state->ReadBlock(block, offset, &bytes_read);
+
+		lock.lock();
+
+		state->reading = false;
+
+		if (state->closed) {
+			ReleaseBlock(block);
+			state->CloseFile();
+			continue;
+		}
+
+		if (ret < 0) {
+			ReleaseBlock(block);
+			state->error = ret;
+		}
+		else {
+			if (bytes_read > 0) {
+				state->ready_list.emplace_back(block, bytes_read);
+			}
+			else {
+				ReleaseBlock(block);
+			}
+
+			if (bytes_read < (size_t) IO_BLOCK_SIZE) {
+				state->eof = true;
+			}
+		}
+
+		state->cond.notify_all();
+	}
+}
+
+std::shared_ptr<ReadStream::State>
+IOScheduler::PickStream(Device& device) {
+
+	if (free_block_list.empty() || device.stream_table.empty()) {
+		return nullptr;
+	}
+
+	auto wants_block = [](const ReadStream::State& state) -> bool {
+		return !state.reading && !state.eof && state.error == 0 && (int) state.ready_list.size() < IO_STREAM_MAX_BLOCKS;
+	};
+
+	//elevator: keep going upward from the last path read, file being read comes first
+	auto start = device.stream_table.lower_bound(std::make_pair(device.last_path, (quint64) 0));
+
+	for (auto iter = start; iter != device.stream_table.end(); iter++) {
+		if (wants_block(*iter->second)) {
+			return iter->second;
+		}
+	}
+
+	for (auto iter = device.stream_table.begin(); iter != start; iter++) {
+		if (wants_block(*iter->second)) {
+			return iter->second;
+		}
+	}
+
+	return nullptr;
+}
+
+std::shared_ptr<IOScheduler::Device>
+IOScheduler::GetDevice(const QString& device_key, const QString& abs_path) {
+
+	auto iter = device_table.constFind(device_key);
+	if (iter != device_table.constEnd()) {
+		return *iter;
+	}
+
+	//once per device, later opens skip detection
+	std::shared_ptr<Device> device = std::make_shared<Device>();
+	device->key = device_key;
+	device->kind = DetectDeviceKind(abs_path);
+
+	int reader_count = GetReaderCount(device->kind);
+	for (int i = 0; i < reader_count; i++) {
+		device->reader_list.emplace_back(&IOScheduler::ReaderLoop, this, device);
+	}
+
+	device_table.insert(device_key, device);
+	return device;
+}
+
+void
+IOScheduler::ReleaseBlock(char* block) {
+	free_block_list.push_back(block);
+	reader_cond.notify_all();
+}
+
+void
+IOScheduler::RemoveStream(ReadStream::State& state) {
+
+	auto iter = device_table.constFind(state.device_key);
+	if (iter == device_table.constEnd()) {
+		return;
+	}
+
+	(*iter)->stream_table.erase(std::make_pair(state.path, state.id));
+}
+
+int
+IOScheduler::GetReaderCount(DeviceKind kind) const {
+	switch (kind) {
+	case SOLID:
+		return config.solid_readers;
+	case NETWORK:
+		return config.network_readers;
+	default:
+		return config.rotational_readers;
+	}
+}
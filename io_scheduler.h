@@ -0,0 +1,143 @@
+#pragma once
+
+/*
+	Reads files for the hashers, one set of reader threads per device
+
+	Hashing used to have every hashing thread do its own blocking reads. On a
+	spinning disk or a network share several threads reading different files
+	make the head seek back and forth, on nvme a couple of threads are not
+	enough queue depth. Reads and hashing are split here into two stages:
+	reader threads owned by the scheduler fill blocks, hashing threads take
+	them through a ReadStream as they come.
+
+	Each device (volume on windows, st_dev elsewhere) gets its own readers,
+	how many depends on what kind of device it is: one for spinning disks,
+	more for solid state and network shares. A reader keeps reading the file
+	it is on while that file has room for more blocks and then moves on to
+	the next open file in path order, so sequential files on a disk are read
+	in a sweep rather than interleaved.
+
+	Blocks come out of a fixed pool, readers wait once it is empty. A stream
+	never has more than IO_STREAM_MAX_BLOCKS blocks filled ahead, so one slow
+	hasher can not take the whole pool.
+*/
+
+#include <QString>
+#include <QHash>
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define IO_BLOCK_SIZE			(4 * 1024 * 1024)
+#define IO_BLOCK_ALIGNMENT		4096
+#define IO_POOL_BLOCKS			16		//blocks shared by all streams
+#define IO_STREAM_MAX_BLOCKS	2		//read ahead per stream
+
+struct IOSchedulerConfig {
+	int	rotational_readers = 1;		//spinning disks and anything undetected
+	int	solid_readers = 4;
+	int	network_readers = 2;
+	int	pool_blocks = IO_POOL_BLOCKS;
+};
+
+class IOScheduler;
+
+//blocks of one file in order, used by a single hashing thread
+class ReadStream {
+public:
+	~ReadStream();
+
+	ReadStream(const ReadStream&) = delete;
+	ReadStream& operator=(const ReadStream&) = delete;
+
+	//waits for the next block, size 0 at end of file. block stays valid until the next call or Close
+	int		Next(const char** data_out, size_t* size_out);
+
+	//file size when opened
+	quint64	GetFileSize() const;
+
+	//returns blocks to the pool, a read in progress finishes on its own
+	void	Close();
+
+private:
+	friend class IOScheduler;
+
+	struct State;
+
+	explicit ReadStream(IOScheduler* scheduler, std::shared_ptr<State> state);
+
+	IOScheduler*				scheduler;
+	std::shared_ptr<State>		state;
+};
+
+class IOScheduler {
+public:
+
+	enum DeviceKind {
+		ROTATIONAL = 0,
+		SOLID,
+		NETWORK
+	};
+
+	IOScheduler();
+	~IOScheduler();
+
+	IOScheduler(const IOScheduler&) = delete;
+	IOScheduler& operator=(const IOScheduler&) = delete;
+
+	//call before Start
+	void	SetConfig(const IOSchedulerConfig& config);
+
+	void	Start();
+
+	//fails streams still open, joins readers
+	void	Stop();
+
+	bool	IsRunning() const;
+
+	//-Error::QFILE_OPEN if file can not be opened
+	int		Open(const QString& abs_path, std::unique_ptr<ReadStream>* stream_out);
+
+	//what device path is on and what kind it is
+	static QString		GetDeviceKey(const QString& abs_path);
+	static DeviceKind	DetectDeviceKind(const QString& abs_path);
+
+	int		GetDeviceCount() const;
+	int		GetFreeBlockCount() const;
+
+private:
+	friend class ReadStream;
+
+	struct Device {
+		QString												key;
+		DeviceKind											kind;
+		std::map<std::pair<QString, quint64>, std::shared_ptr<ReadStream::State>>	stream_table;	//path, stream id. open streams in path order
+		QString												last_path;		//readers sweep upward from here
+		std::vector<std::thread>							reader_list;
+	};
+
+	IOSchedulerConfig									config;
+
+	mutable std::mutex									mutex;
+	std::condition_variable								reader_cond;
+	bool												running;
+	quint64												next_stream_id;
+
+	QHash<QString, std::shared_ptr<Device>>				device_table;		//device key -> device
+	std::vector<char*>									free_block_list;
+	std::vector<char*>									block_list;			//everything allocated, freed on Stop
+
+	void	ReaderLoop(std::shared_ptr<Device> device);
+
+	//caller holds mutex
+	std::shared_ptr<ReadStream::State>	PickStream(Device& device);
+	std::shared_ptr<Device>				GetDevice(const QString& device_key, const QString& abs_path);	//detects and starts readers on first use
+	void								ReleaseBlock(char* block);
+	void								RemoveStream(ReadStream::State& state);
+	int									GetReaderCount(DeviceKind kind) const;
+};
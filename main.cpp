@@ -3,11 +3,14 @@
 #include "mainUI.h"
 #include "daemon.h"
 #include "config.h"
+#include "metrics.h"
 
 int main(int argc, char *argv[])
 {
 	QApplication app(argc, argv);
 
+	Metrics::SetThreadName("gui");
+
 	Logger* logger = Logger::GetInstancePtr();	//make sure logger lives on main thread to recv signals from timer
 	qDebug() << "Logger thead affinity: " << logger->thread();
 
@@ -18,6 +21,10 @@ int main(int argc, char *argv[])
 	if (config.Load() < 0) { 	//loading it early... logs still come through to main ui event loop when it starts up
 		Logger::Log("Error loading config file. Using default values...", LogEntry::LT_WARNING);
 	}
+
+	if (config.SubconfigExist(Config::MONITOR)) {
+		daemon.SetNotifyConfig(config.GetEffectiveSubconfig(Config::MONITOR).notify_config);
+	}
 	
 	mainUI main_window(&config, logger, &daemon);
 	main_window.show();
@@ -25,6 +32,8 @@ int main(int argc, char *argv[])
 	//register custom types
 	qRegisterMetaType<ModelTag>();
 	qRegisterMetaType<ModelMedia>();
+	qRegisterMetaType<ModelMediaBatch>();
+	qRegisterMetaType<ModelLinkBatch>();
 	qRegisterMetaType<LogEntry::LogType>(); 
 	qRegisterMetaType<LogEntry>();
 
@@ -151,6 +151,16 @@ mainUI::mainUI(Config* config, Logger* logger, Daemon* daemon, QWidget *parent)
 
 	ui.log_docked_widget->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable);		//docked widget should not be closable, log is always present
 
+	/*
+		Stats panel related
+	*/
+
+	ui.stats_docked_widget->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable);
+	tabifyDockWidget(ui.log_docked_widget, ui.stats_docked_widget);		//shares the log's spot, only polls while its tab is up
+	ui.log_docked_widget->raise();
+
+	ui.stats_panel->SetDaemon(daemon);
+
 
 	/*
 		Global Shortcuts
@@ -297,7 +307,7 @@ mainUI::OnMediaTagSet(const ModelMedia& m_media) {
 	ui.media_info_subdir_line_edit->home(false);		
 	ui.media_info_hash_line_edit->home(false);
 
-	//ui.media_info_hash_regen_push_button->setEnabled(true);
+	ui.media_info_hash_regen_push_button->setEnabled(true);
 
 	ui.media_tag_search_line_edit->setEnabled(true);
 	ui.add_media_tag_push_button->setEnabled(true);
@@ -316,8 +326,15 @@ mainUI::OnMediaTagReset() {
 
 void 
 mainUI::OnGenerateHashButtonRelease() {
-	LogWindow *log = new LogWindow(this);
-	log->show();
+
+	if (!media_tag_model.HasMedia()) {
+		return;
+	}
+
+	//hash line edit is filled in again by OnDaemonMediaHashUpdated
+	if (daemon->RegenerateMediaHash(media_tag_model.GetMediaId()) > 0) {
+		ui.media_info_hash_line_edit->setText("");
+	}
 }
 
 /*
@@ -437,8 +454,11 @@ mainUI::OnDaemonInitialized() {
 	connect(daemon, &Daemon::MediaNameUpdated, this, &mainUI::OnDaemonMediaNameUpdated);			//media name change
 	connect(daemon, &Daemon::MediaSubdirUpdated, this, &mainUI::OnDaemonMediaSubdirUpdated);		//media moved
 	connect(daemon, &Daemon::MediaRemoved, this, &mainUI::OnDaemonMediaRemoved);					//media removed
+	connect(daemon, &Daemon::MediaBatchApplied, this, &mainUI::OnDaemonMediaBatchApplied);			//monitor events applied in bulk
+	connect(daemon, &Daemon::MediaHashUpdated, this, &mainUI::OnDaemonMediaHashUpdated);			//hash computed
 
 	connect(daemon, &Daemon::LinkFormed, this, &mainUI::OnDaemonLinkFormed);						//link formed
+	connect(daemon, &Daemon::LinksFormed, this, &mainUI::OnDaemonLinksFormed);						//links formed in bulk
 	connect(daemon, &Daemon::LinkDestroyed, this, &mainUI::OnDaemonLinkDestroyed);					//link broken
 
 	ui.all_media_push_button->setEnabled(true);
@@ -542,6 +562,66 @@ mainUI::OnDaemonMediaRemoved(const unsigned int media_id) {
 	thumbnail_provider.RemoveMediaThumbnail(media_id);
 }
 
+void
+mainUI::OnDaemonMediaBatchApplied(const ModelMediaBatch& batch) {
+
+	for (const auto& link : batch.link_destroyed_list) {
+		if (tag_model.TagExistById(link.first)) {
+			tag_model.DecTagMediaCount(link.first);
+		}
+	}
+
+	media_model.RemoveMediaList(batch.removed_id_list);
+
+	for (unsigned int media_id : batch.removed_id_list) {
+
+		//reset media tag list if this media no longer exist
+		if (media_tag_model.HasMedia() && media_tag_model.GetMediaId() == media_id) {
+			media_tag_model.Reset();
+		}
+
+		thumbnail_provider.RemoveMediaThumbnail(media_id);
+	}
+
+	//media linked by filename map are not tagless, keep them out of tagless view
+	QSet<unsigned int> linked_media_id_set;
+	for (const auto& link : batch.link_formed_list) {
+		linked_media_id_set.insert(link.second);
+	}
+
+	if (media_model.GetDisplayMode() == MediaModel::ALL) {
+		media_model.InsertMediaList(batch.inserted_list);
+	}
+	else if (media_model.GetDisplayMode() == MediaModel::TAGLESS) {
+		QVector<ModelMedia> tagless_list;
+		for (const ModelMedia& media : batch.inserted_list) {
+			if (!linked_media_id_set.contains(media.id)) {
+				tagless_list.push_back(media);
+			}
+		}
+
+		media_model.InsertMediaList(tagless_list);
+	}
+
+	for (const auto& link : batch.link_formed_list) {
+		tag_model.IncTagMediaCount(link.first.id);
+	}
+}
+
+void
+mainUI::OnDaemonMediaHashUpdated(const unsigned int media_id, const QString& new_hash) {
+
+	if (media_model.IsMediaInModel(media_id)) {
+		media_model.UpdateMediaHash(media_id, new_hash);
+	}
+
+	//media info shows this media
+	if (media_tag_model.HasMedia() && media_tag_model.GetMediaId() == media_id) {
+		ui.media_info_hash_line_edit->setText(new_hash);
+		ui.media_info_hash_line_edit->home(false);
+	}
+}
+
 void 
 mainUI::OnDaemonLinkFormed(const ModelTag& tag, const unsigned int media_id) {
 
@@ -576,6 +656,50 @@ mainUI::OnDaemonLinkFormed(const ModelTag& tag, const unsigned int media_id) {
 	tag_model.IncTagMediaCount(tag.id);
 }
 
+void
+mainUI::OnDaemonLinksFormed(const ModelLinkBatch& batch) {
+
+	if (media_model.GetDisplayMode() == MediaModel::TAGLESS) {
+
+		//these media are no longer tagless, remove them from view
+		QVector<unsigned int> linked_media_id_list;
+		QSet<unsigned int> linked_media_id_set;
+		for (const auto& link : batch.link_list) {
+			if (!linked_media_id_set.contains(link.second) && media_model.IsMediaInModel(link.second)) {
+				linked_media_id_set.insert(link.second);
+				linked_media_id_list.push_back(link.second);
+			}
+		}
+
+		if (!linked_media_id_list.empty()) {
+			int prev_pos = ui.media_list_view->verticalScrollBar()->value();
+
+			media_model.RemoveMediaList(linked_media_id_list);
+
+			//restore scroll position
+			ui.media_list_view->verticalScrollBar()->setValue(qMin(prev_pos, ui.media_list_view->verticalScrollBar()->maximum()));
+		}
+	}
+
+	//current media tag model is focused on one of these media
+	if (media_tag_model.HasMedia()) {
+		for (const auto& link : batch.link_list) {
+			if (link.second != media_tag_model.GetMediaId()) {
+				continue;
+			}
+
+			for (const ModelTag& tag : batch.tag_list) {
+				if (tag.id == link.first) {
+					media_tag_model.InsertMediaTag(tag);
+					break;
+				}
+			}
+		}
+	}
+
+	tag_model.AddTagMediaCounts(batch.tag_count_delta_table);
+}
+
 void 
 mainUI::OnDaemonLinkDestroyed(const unsigned int tag_id, const unsigned int media_id) {
 
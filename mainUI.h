@@ -108,7 +108,12 @@ public slots:
 
 	void OnDaemonMediaRemoved(const unsigned int);
 
+	void OnDaemonMediaBatchApplied(const ModelMediaBatch&);
+
+	void OnDaemonMediaHashUpdated(const unsigned int, const QString&);
+
 	void OnDaemonLinkFormed(const ModelTag&, const unsigned int);
+	void OnDaemonLinksFormed(const ModelLinkBatch&);
 
 	void OnDaemonLinkDestroyed(const unsigned int, const unsigned int);
 
@@ -1,4 +1,5 @@
 #include "media_list.h"
+#include "mem_estimate.h"
 
 
 /*
@@ -10,6 +11,33 @@ MediaList::GetSize() {
 	return list_store.size();
 }
 
+quint64
+MediaList::EstimateMemory() const {
+
+	//linked list node: prev, next and the media
+	quint64 bytes = (quint64) list_store.size() * (2 * sizeof(void*) + sizeof(Media));
+
+	for (const Media& media : list_store) {
+		bytes += MemEstimate::StringBytes(media.sub_path) + MemEstimate::StringBytes(media.long_name) + MemEstimate::StringBytes(media.short_name);
+		bytes += MemEstimate::StringBytes(media.hash) + MemEstimate::StringBytes(media.quick_hash);
+		bytes += MemEstimate::SetBytes(media.tag_id_list);
+	}
+
+	bytes += MemEstimate::HashBytes(id_to_media_table);
+	bytes += MemEstimate::HashBytes(subpathname_to_media_table) + MemEstimate::HashBytes(subpathaltname_to_media_table);
+
+	//path keys are built for the tables, not shared with the media
+	for (auto iter = subpathname_to_media_table.constBegin(); iter != subpathname_to_media_table.constEnd(); iter++) {
+		bytes += MemEstimate::StringBytes(iter.key());
+	}
+
+	for (auto iter = subpathaltname_to_media_table.constBegin(); iter != subpathaltname_to_media_table.constEnd(); iter++) {
+		bytes += MemEstimate::StringBytes(iter.key());
+	}
+
+	return bytes;
+}
+
 int
 MediaList::InsertMedia(const MediaInfo& new_media) {
 	Media *media_ptr;
@@ -28,6 +56,7 @@ MediaList::InsertMedia(const MediaInfo& new_media) {
 		subpathaltname_to_media_table.insert(new_media.GetSubpathAltname(), media_ptr);
 	}
 
+	changed_id_set.insert(new_media.id);
 	return 1;
 }
 
@@ -50,6 +79,7 @@ MediaList::RemoveMedia(const unsigned int media_id) {
 	}
 
 	list_store.erase(iter);
+	changed_id_set.insert(media_id);
 	return 1;
 }
 
@@ -121,6 +151,7 @@ MediaList::GetAllMediaPtr(QVector<Media*> *out) {
 void
 MediaList::UpdateMediaName(const unsigned int media_id, const QString& long_name, const QString& alt_name) {
 	Media *media_ptr = *(id_to_media_table.find(media_id));
+	changed_id_set.insert(media_id);
 
 	QString sub_path_name;
 	subpathname_to_media_table.remove(media_ptr->GetSubpathLongName());
@@ -145,6 +176,7 @@ MediaList::UpdateMediaName(const unsigned int media_id, const QString& long_name
 void
 MediaList::UpdateMediaSubdir(const unsigned int media_id, const QString& sub_dir) {
 	Media *media_ptr = *(id_to_media_table.find(media_id));
+	changed_id_set.insert(media_id);
 	
 	subpathname_to_media_table.remove(media_ptr->GetSubpathLongName());
 
@@ -165,10 +197,30 @@ MediaList::UpdateMediaSubdir(const unsigned int media_id, const QString& sub_dir
 void 
 MediaList::UpdateMediaHash(const unsigned int media_id, const QString& new_hash) {
 	Media *media_ptr = *(id_to_media_table.find(media_id));
+	changed_id_set.insert(media_id);
 
 	media_ptr->hash = new_hash;
 }
 
+void
+MediaList::UpdateMediaSize(const unsigned int media_id, const qint64 new_size) {
+	Media *media_ptr = *(id_to_media_table.find(media_id));
+	changed_id_set.insert(media_id);
+
+	media_ptr->size = new_size;
+}
+
+void
+MediaList::UpdateMediaFingerprint(const unsigned int media_id, const Fingerprint& fingerprint) {
+	Media *media_ptr = *(id_to_media_table.find(media_id));
+	changed_id_set.insert(media_id);
+
+	media_ptr->size = fingerprint.size;
+	media_ptr->quick_hash = fingerprint.quick_hash;
+	media_ptr->hash = fingerprint.hash;
+	media_ptr->hash_algo = fingerprint.hash_algo;
+}
+
 int
 MediaList::GetMediaTagCount(const unsigned int media_id) {
 	Media *media_ptr = *(id_to_media_table.find(media_id));
@@ -198,12 +250,20 @@ void
 MediaList::InsertMediaTag(const unsigned int tag_id, const unsigned int media_id) {
 	auto iter = id_to_media_table.find(media_id);
 	(*iter)->AddTagId(tag_id);
+	changed_id_set.insert(media_id);
 }
 
 void
 MediaList::RemoveMediaTag(const unsigned int tag_id, const unsigned int media_id) {
 	auto iter = id_to_media_table.find(media_id);
 	(*iter)->RemoveTagId(tag_id);
+	changed_id_set.insert(media_id);
+}
+
+void
+MediaList::TakeChangedIds(QSet<unsigned int>* out) {
+	*out = std::move(changed_id_set);
+	changed_id_set.clear();
 }
 
 void
@@ -4,12 +4,15 @@
 #include <QHash>
 
 #include "media_structs.h"
+#include "hash_engine.h"
 
 class MediaList {
 public:
 
 	int		GetSize();
 
+	quint64	EstimateMemory() const;		//rough heap bytes, see MemEstimate
+
 	int		InsertMedia(const MediaInfo&);
 	int		RemoveMedia(const unsigned int);
 
@@ -27,6 +30,8 @@ public:
 	void	UpdateMediaName(const unsigned int media_id, const QString& long_name, const QString& short_name);
 	void	UpdateMediaSubdir(const unsigned int media_id, const QString& sub_dir);
 	void	UpdateMediaHash(const unsigned int media_id, const QString& new_hash);
+	void	UpdateMediaSize(const unsigned int media_id, const qint64 new_size);
+	void	UpdateMediaFingerprint(const unsigned int media_id, const Fingerprint& fingerprint);	//size, both hashes and algo
 
 	//media tag related
 	int		GetMediaTagCount(const unsigned int);
@@ -35,6 +40,9 @@ public:
 	void	InsertMediaTag(const unsigned int, const unsigned int);
 	void	RemoveMediaTag(const unsigned int, const unsigned int);
 
+	//ids of media inserted, removed or changed since the last call
+	void	TakeChangedIds(QSet<unsigned int>*);
+
 	void Dump();
 
 private:
@@ -45,4 +53,6 @@ private:
 	QHash<QString, Media*>	subpathname_to_media_table;
 	QHash<QString, Media*>	subpathaltname_to_media_table;
 
+	QSet<unsigned int>		changed_id_set;		//since last TakeChangedIds
+
 };
\ No newline at end of file
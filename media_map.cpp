@@ -3,6 +3,95 @@
 
 #include <QRegularExpression>
 #include <QStringBuilder>
+#include <QtConcurrent>
+
+#include <numeric>
+
+LiteralMatcher::LiteralMatcher()
+{
+	Reset();
+}
+
+void
+LiteralMatcher::AddLiteral(const QString& literal, int id) {
+
+	int node_idx = 0;
+	for (QChar c : literal) {
+		auto iter = node_vec[node_idx].child_table.constFind(c.unicode());
+		if (iter != node_vec[node_idx].child_table.constEnd()) {
+			node_idx = *iter;
+			continue;
+		}
+
+		node_vec.push_back(Node());
+		node_vec[node_idx].child_table.insert(c.unicode(), node_vec.size() - 1);
+		node_idx = node_vec.size() - 1;
+	}
+
+	node_vec[node_idx].id_list.push_back(id);
+}
+
+void
+LiteralMatcher::Build() {
+
+	//breadth first so every fail link points at a node already done
+	QVector<int> queue;
+	for (int child_idx : node_vec[0].child_table) {
+		node_vec[child_idx].fail = 0;
+		node_vec[child_idx].output_link = -1;
+		queue.push_back(child_idx);
+	}
+
+	for (int i = 0; i < queue.size(); i++) {
+		int node_idx = queue[i];
+
+		for (auto iter = node_vec[node_idx].child_table.constBegin(); iter != node_vec[node_idx].child_table.constEnd(); iter++) {
+			ushort c = iter.key();
+			int child_idx = iter.value();
+
+			//longest proper suffix that is also a path from root
+			int fail = node_vec[node_idx].fail;
+			while (fail != 0 && !node_vec[fail].child_table.contains(c)) {
+				fail = node_vec[fail].fail;
+			}
+
+			auto fail_iter = node_vec[fail].child_table.constFind(c);
+			fail = fail_iter != node_vec[fail].child_table.constEnd() ? *fail_iter : 0;
+
+			node_vec[child_idx].fail = fail;
+			node_vec[child_idx].output_link = node_vec[fail].id_list.isEmpty() ? node_vec[fail].output_link : fail;
+			queue.push_back(child_idx);
+		}
+	}
+}
+
+void
+LiteralMatcher::Match(const QString& str, QBitArray* id_bits) const {
+
+	int node_idx = 0;
+	for (QChar c : str) {
+
+		while (node_idx != 0 && !node_vec[node_idx].child_table.contains(c.unicode())) {
+			node_idx = node_vec[node_idx].fail;
+		}
+
+		auto iter = node_vec[node_idx].child_table.constFind(c.unicode());
+		node_idx = iter != node_vec[node_idx].child_table.constEnd() ? *iter : 0;
+
+		//every literal ending at this char
+		for (int out_idx = node_idx; out_idx > 0; out_idx = node_vec[out_idx].output_link) {
+			for (int id : node_vec[out_idx].id_list) {
+				id_bits->setBit(id);
+			}
+		}
+	}
+}
+
+void
+LiteralMatcher::Reset() {
+	node_vec.clear();
+	node_vec.push_back(Node());
+}
 
 
 MediaMap::MediaMap() 
@@ -14,6 +103,136 @@ MediaMap::~MediaMap()
 {
 }
 
+//static
+
+QString
+MediaMap::RequiredLiteral(const QString& pattern) {
+
+	QString best;
+	QString run;		//literal chars since the last thing that is not one
+	int depth = 0;		//group contents may be optional or repeated, only top level counts
+
+	auto end_run = [&best, &run]() {
+		if (run.size() > best.size()) {
+			best = run;
+		}
+		run.clear();
+	};
+
+	for (int i = 0; i < pattern.size(); i++) {
+		QChar c = pattern[i];
+
+		if (c == '\\') {
+			if (i + 1 == pattern.size()) {
+				return QString();
+			}
+
+			QChar next = pattern[++i];
+
+			//\Q quoting is not worth following, neither are escapes taking an argument (\x41, \cX, \k<name>, \p{L}, \012, \1...)
+			//whose argument would otherwise be read as literal text
+			if (next == 'Q' || next.isDigit() || QString("xckgpPNo").contains(next)) {
+				return QString();
+			}
+
+			//classes, assertions and back references
+			if (next.isLetterOrNumber()) {
+				end_run();
+				continue;
+			}
+
+			if (depth == 0) {
+				run.push_back(next);
+			}
+			continue;
+		}
+
+		if (c == '[') {
+			end_run();
+
+			int j = i + 1;
+			if (j < pattern.size() && pattern[j] == '^') {
+				j++;
+			}
+			if (j < pattern.size() && pattern[j] == ']') {
+				j++;
+			}
+			while (j < pattern.size() && pattern[j] != ']') {
+				if (pattern[j] == '\\') {
+					j++;
+				}
+				//[:digit:] and the like end with their own ]
+				else if (pattern[j] == '[' && j + 1 < pattern.size() && QString(":=.").contains(pattern[j + 1])) {
+					QString close = QString(pattern[j + 1]) + ']';
+					int close_idx = pattern.indexOf(close, j + 2);
+					if (close_idx < 0) {
+						return QString();
+					}
+					j = close_idx + 1;
+				}
+				j++;
+			}
+
+			i = j;
+			continue;
+		}
+
+		if (c == '(') {
+			//inline options can turn on case insensitivity for everything after them
+			if (i + 1 < pattern.size() && pattern[i + 1] == '?' && (i + 2 >= pattern.size() || pattern[i + 2] != ':')) {
+				return QString();
+			}
+
+			end_run();
+			depth++;
+			continue;
+		}
+
+		if (c == ')') {
+			end_run();
+			depth--;
+			if (depth < 0) {
+				return QString();
+			}
+			continue;
+		}
+
+		if (depth > 0) {
+			continue;
+		}
+
+		//any top level alternative could be the one that matches
+		if (c == '|') {
+			return QString();
+		}
+
+		//char before an optional quantifier may not be there at all
+		if (c == '*' || c == '?' || c == '{') {
+			if (!run.isEmpty()) {
+				run.chop(1);
+			}
+			end_run();
+
+			if (c == '{') {
+				while (i < pattern.size() && pattern[i] != '}') {
+					i++;
+				}
+			}
+			continue;
+		}
+
+		if (c == '+' || c == '.' || c == '^' || c == '$') {
+			end_run();
+			continue;
+		}
+
+		run.push_back(c);
+	}
+
+	end_run();
+	return best;
+}
+
 int		
 MediaMap::LoadFile() {
 	QFile file(FILENAME_MAP_FILE_NAME);
@@ -40,21 +259,34 @@ MediaMap::LoadFile() {
 	}
 
 	file.close();
+
+	BuildPrefilter();
 	return 1;
 }
 
 void	
-MediaMap::GetMappedTags(const QString& media_subpathname, QVector<QString>* out) {
-	QRegularExpression regex;
-	
-	for (auto iter = map_entry_vec.cbegin(); iter != map_entry_vec.cend(); iter++) {
-		regex.setPattern(iter->pattern);
+MediaMap::GetMappedTags(const QString& media_subpathname, QVector<QString>* out) const {
+
+	QBitArray candidate_bits(map_entry_vec.size());
+	literal_matcher.Match(media_subpathname, &candidate_bits);
+
+	for (int entry_idx : unfiltered_entry_list) {
+		candidate_bits.setBit(entry_idx);
+	}
+
+	//entries stay in file order so tags come out in the same order as before
+	for (int i = 0; i < map_entry_vec.size(); i++) {
+		if (!candidate_bits.testBit(i)) {
+			continue;
+		}
+
+		const MapEntry& entry = map_entry_vec[i];
 
-		if (!regex.match(media_subpathname).hasMatch()) {
+		if (!entry.regex.match(media_subpathname).hasMatch()) {
 			continue;
 		}
 
-		for (auto tag_iter = iter->tag_name_list.cbegin(); tag_iter != iter->tag_name_list.cend(); tag_iter++) {
+		for (auto tag_iter = entry.tag_name_list.cbegin(); tag_iter != entry.tag_name_list.cend(); tag_iter++) {
 			if (!out->contains(*tag_iter)) {
 				out->push_back(*tag_iter);
 			}
@@ -62,10 +294,33 @@ MediaMap::GetMappedTags(const QString& media_subpathname, QVector<QString>* out)
 	}
 }
 
+void
+MediaMap::GetMappedTagsList(const QVector<MediaInfo>& media_list, QVector<QVector<QString>>* out) const {
+
+	out->clear();
+	out->resize(media_list.size());
+
+	if (map_entry_vec.empty()) {
+		return;
+	}
+
+	//each media only writes its own slot
+	QVector<QString>* out_data = out->data();
+
+	QVector<int> index_list(media_list.size());
+	std::iota(index_list.begin(), index_list.end(), 0);
+
+	QtConcurrent::blockingMap(index_list, [this, &media_list, out_data](int idx) {
+		GetMappedTags(media_list[idx].GetSubpathLongName(), &out_data[idx]);
+	});
+}
+
 
 void	
 MediaMap::Reset() {
 	map_entry_vec.clear();
+	literal_matcher.Reset();
+	unfiltered_entry_list.clear();
 }
 
 //private
@@ -169,6 +424,33 @@ MediaMap::ProcessMapBlock(const QSet<QString>& pattern_list, const QSet<QString>
 	for (auto iter = pattern_list.begin(); iter != pattern_list.end(); iter++) {
 
 		entry_buff.pattern = std::move(*iter);
+
+		//compiled once here instead of for every media it is matched against
+		entry_buff.regex.setPattern(entry_buff.pattern);
+		entry_buff.regex.optimize();
+
 		map_entry_vec.push_back(entry_buff);
 	}
+}
+
+void
+MediaMap::BuildPrefilter() {
+
+	literal_matcher.Reset();
+	unfiltered_entry_list.clear();
+
+	for (int i = 0; i < map_entry_vec.size(); i++) {
+		QString literal = RequiredLiteral(map_entry_vec[i].pattern);
+
+		if (literal.isEmpty()) {
+			unfiltered_entry_list.push_back(i);
+			continue;
+		}
+
+		literal_matcher.AddLiteral(literal, i);
+	}
+
+	literal_matcher.Build();
+
+	Logger::Log(QString::number(map_entry_vec.size() - unfiltered_entry_list.size()) % " of " % QString::number(map_entry_vec.size()) % " map patterns prefiltered by literal");
 }
\ No newline at end of file
@@ -4,16 +4,45 @@
 #include <QString>
 #include <QFile>
 #include <QSet>
+#include <QHash>
+#include <QBitArray>
+#include <QRegularExpression>
 
 #include "logger.h"
+#include "media_structs.h"
 
 #define FILENAME_MAP_FILE_NAME	"mediamap"
 
 struct MapEntry {
 	QString				pattern;
+	QRegularExpression	regex;				//compiled and optimized once when loaded
 	QVector<QString>	tag_name_list;
 };
 
+//aho-corasick automaton, finds every literal that occurs in a string in one pass over it
+class LiteralMatcher {
+public:
+	LiteralMatcher();
+
+	void	AddLiteral(const QString& literal, int id);
+	void	Build();
+
+	//sets the bit of every id whose literal occurs in str, bits array must cover all ids
+	void	Match(const QString& str, QBitArray* id_bits) const;
+
+	void	Reset();
+
+private:
+	struct Node {
+		QHash<ushort, int>	child_table;
+		int					fail = 0;
+		int					output_link = -1;	//closest node down the fail chain with ids of its own
+		QVector<int>		id_list;			//literals ending here
+	};
+
+	QVector<Node>	node_vec;
+};
+
 struct MapBlockStatus {
 	QSet<QString>	pattern_buff;
 	QSet<QString>	tag_buff;
@@ -29,8 +58,15 @@ public:
 	MediaMap();
 	~MediaMap();
 
+	//literal every match of pattern contains, empty when none can be told apart from the pattern
+	static QString	RequiredLiteral(const QString& pattern);
+
 	int				LoadFile();
-	void			GetMappedTags(const QString& media_subpathname, QVector<QString>* out);
+	void			GetMappedTags(const QString& media_subpathname, QVector<QString>* out) const;
+
+	//tags of every media, index for index, patterns run in parallel across media
+	void			GetMappedTagsList(const QVector<MediaInfo>& media_list, QVector<QVector<QString>>* out) const;
+
 	inline	int		GetSize() { return map_entry_vec.size(); };
 	void			Reset();
 
@@ -38,7 +74,12 @@ private:
 
 	QVector<MapEntry>	map_entry_vec;
 
+	//patterns only run when their required literal is in the path
+	LiteralMatcher		literal_matcher;
+	QVector<int>		unfiltered_entry_list;		//entries without a literal, always run
+
 	int		ParseLine(const QString& line, MapBlockStatus* status);
 	void	ProcessMapBlock(const QSet<QString>& pattern_list, const QSet<QString>& tag_list );
+	void	BuildPrefilter();
 };
 
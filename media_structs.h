@@ -4,8 +4,11 @@
 #include <QVector>
 #include <QSet>
 #include <QStringBuilder>
+#include <QPair>
 #include <QMetaType>
 
+#include "tag_structs.h"
+
 /*
 	Structs related to media
 */
@@ -35,7 +38,10 @@ struct MediaInfo {
 	QString long_name;		//name includes extension (no slash in front of the name unlike path)
 							//ex. if file A's absolute path is C:\dir1\A.ext file name is A.ext
 	QString short_name;		
-	QString	hash;			//SHA2 hash of the media
+	QString	hash;			//content hash of the media, empty while pending
+	QString	quick_hash;		//hash of size, head and tail, empty while pending
+	int		hash_algo = 0;	//HashEngine::Algo that made hash
+	qint64	size = -1;		//file size in bytes, -1 if unknown. refreshed from disk on load
 
 
 	MediaInfo() = default;
@@ -68,6 +74,21 @@ struct MediaInfo {
 	QString GetSubpathAltname() const {
 		return sub_path % '\\' % short_name;
 	}
+
+	//staged compare, cheap stages first. size and quick hash only rule a match out, stages one side has no
+	//value for are skipped. only the full hash of the same algorithm can confirm, a quick hash covers both ends of the file only
+	bool SameContent(const MediaInfo& other) const {
+
+		if (size != -1 && other.size != -1 && size != other.size) {
+			return false;
+		}
+
+		if (!quick_hash.isEmpty() && !other.quick_hash.isEmpty() && quick_hash != other.quick_hash) {
+			return false;
+		}
+
+		return !hash.isEmpty() && hash_algo == other.hash_algo && hash == other.hash;
+	}
 };
 
 struct Media : MediaInfo {
@@ -94,7 +115,11 @@ struct Media : MediaInfo {
 	}
 
 	MediaInfo GetMediaInfo() {
-		return MediaInfo{id, sub_path, long_name, short_name, hash};
+		MediaInfo info{id, sub_path, long_name, short_name, hash};
+		info.quick_hash = quick_hash;
+		info.hash_algo = hash_algo;
+		info.size = size;
+		return info;
 	}
 };
 
@@ -104,3 +129,12 @@ struct MediaModelResult {
 	QVector<ModelMedia> model_media_list;
 };
 
+//media changes daemon applied together from one batch of monitor events, sent to gui in one signal
+struct ModelMediaBatch {
+	QVector<unsigned int>							removed_id_list;
+	QVector<ModelMedia>								inserted_list;			//new media are always tagless
+	QVector<QPair<unsigned int, unsigned int>>		link_destroyed_list;	//tag id, media id of links dropped with removed media
+	QVector<QPair<ModelTag, unsigned int>>			link_formed_list;		//filename mapped links of inserted media
+};
+
+Q_DECLARE_METATYPE(ModelMediaBatch);
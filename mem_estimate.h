@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+/*
+	Rough heap bytes behind Qt containers, for stats only
+
+	Implicitly shared data is counted every time it's seen and allocator
+	overhead is left out, numbers are good for telling which structure
+	grows, not for adding up to the process size.
+*/
+
+namespace MemEstimate {
+
+	//the QString itself is counted by whatever holds it
+	inline quint64
+	StringBytes(const QString& str) {
+		if (str.isNull()) {
+			return 0;
+		}
+
+		return sizeof(QArrayData) + (quint64) (str.capacity() + 1) * sizeof(QChar);
+	}
+
+	//bucket array plus one node per entry: next, hash, key and value. heap behind keys and values not included
+	template <class Key, class T>
+	inline quint64
+	HashBytes(const QHash<Key, T>& hash) {
+		return (quint64) hash.capacity() * sizeof(void*) + (quint64) hash.size() * (sizeof(void*) + sizeof(uint) + sizeof(Key) + sizeof(T));
+	}
+
+	template <class T>
+	inline quint64
+	SetBytes(const QSet<T>& set) {
+		return (quint64) set.capacity() * sizeof(void*) + (quint64) set.size() * (sizeof(void*) + sizeof(uint) + sizeof(T));
+	}
+
+	template <class T>
+	inline quint64
+	VectorBytes(const QVector<T>& vector) {
+		return sizeof(QArrayData) + (quint64) vector.capacity() * sizeof(T);
+	}
+}
@@ -0,0 +1,67 @@
+#include "metered_lock.h"
+
+namespace {
+
+	struct HeldLock {
+		const MeteredRWLock*	lock;
+		int64_t					acquire_usec;
+	};
+
+	thread_local HeldLock	held_arr[METERED_LOCK_DEPTH];
+	thread_local int		held_count = 0;
+}
+
+MeteredRWLock::MeteredRWLock(Metrics::Histogram wait_histogram, Metrics::Histogram hold_histogram) :
+	wait_histogram(wait_histogram),
+	hold_histogram(hold_histogram)
+{
+}
+
+void
+MeteredRWLock::lockForRead() {
+	int64_t begin_usec = Metrics::NowUsec();
+	lock.lockForRead();
+	Acquired(begin_usec);
+}
+
+void
+MeteredRWLock::lockForWrite() {
+	int64_t begin_usec = Metrics::NowUsec();
+	lock.lockForWrite();
+	Acquired(begin_usec);
+}
+
+void
+MeteredRWLock::unlock() {
+	int64_t now_usec = Metrics::NowUsec();
+
+	//locks are mostly released in reverse order, look from the top
+	for (int i = held_count - 1; i >= 0; i--) {
+		if (held_arr[i].lock != this) {
+			continue;
+		}
+
+		Metrics::Record(hold_histogram, now_usec - held_arr[i].acquire_usec);
+
+		for (int j = i + 1; j < held_count; j++) {
+			held_arr[j - 1] = held_arr[j];
+		}
+		held_count--;
+		break;
+	}
+
+	lock.unlock();
+}
+
+//private
+
+void
+MeteredRWLock::Acquired(int64_t begin_usec) {
+	int64_t now_usec = Metrics::NowUsec();
+
+	Metrics::Record(wait_histogram, now_usec - begin_usec);
+
+	if (held_count < METERED_LOCK_DEPTH) {
+		held_arr[held_count++] = { this, now_usec };
+	}
+}
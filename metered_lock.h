@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QReadWriteLock>
+
+#include "metrics.h"
+
+/*
+	Read write lock that reports how long callers waited for it and how long they held it
+
+	Has the calls daemon makes on its list locks, so it drops in for QReadWriteLock there.
+	Readers hold it together and each needs its own acquire time, those are kept on a
+	small per thread stack instead of in the lock. A thread holding more than
+	METERED_LOCK_DEPTH metered locks at once still locks fine, only its hold times
+	beyond that depth go unrecorded.
+*/
+
+#define METERED_LOCK_DEPTH		8
+
+class MeteredRWLock {
+public:
+	MeteredRWLock(Metrics::Histogram wait_histogram, Metrics::Histogram hold_histogram);
+
+	MeteredRWLock(const MeteredRWLock&) = delete;
+	MeteredRWLock& operator=(const MeteredRWLock&) = delete;
+
+	void	lockForRead();
+	void	lockForWrite();
+	void	unlock();
+
+private:
+	QReadWriteLock		lock;
+	Metrics::Histogram	wait_histogram;
+	Metrics::Histogram	hold_histogram;
+
+	void	Acquired(int64_t begin_usec);
+};
@@ -0,0 +1,323 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+	//written only by the thread that owns it
+	struct Shard {
+		std::atomic<int64_t>	counter_arr[Metrics::COUNTER_COUNT];
+		std::atomic<int64_t>	bucket_arr[Metrics::HISTOGRAM_COUNT][Metrics::HISTOGRAM_BUCKET_COUNT];
+		std::atomic<int64_t>	sum_arr[Metrics::HISTOGRAM_COUNT];
+		std::atomic<int64_t>	max_arr[Metrics::HISTOGRAM_COUNT];
+
+		std::string				name;			//shard_list_lock
+		bool					in_use = true;	//shard_list_lock
+
+		Shard() {
+			for (std::atomic<int64_t>& value : counter_arr) {
+				value.store(0, std::memory_order_relaxed);
+			}
+
+			for (int i = 0; i < Metrics::HISTOGRAM_COUNT; i++) {
+				for (std::atomic<int64_t>& value : bucket_arr[i]) {
+					value.store(0, std::memory_order_relaxed);
+				}
+
+				sum_arr[i].store(0, std::memory_order_relaxed);
+				max_arr[i].store(0, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	//gives the shard back when its thread exits
+	struct ShardHolder {
+		Shard* shard = nullptr;
+
+		~ShardHolder();
+	};
+
+	std::mutex							shard_list_lock;
+	std::vector<std::unique_ptr<Shard>>	shard_list;		//never shrinks, readers can walk it while threads come and go
+
+	thread_local ShardHolder			local_holder;
+
+	std::atomic<int64_t> gauge_arr[Metrics::GAUGE_COUNT];
+
+	const char* counter_name_arr[Metrics::COUNTER_COUNT] = {
+		"notify.event.total",
+		"notify.overflow.total",
+		"notify.rescan.total",
+		"notify.coalesced.total",
+		"notify.batch.total",
+		"hash.total",
+		"hash.coalesced.total",
+		"hash.cancelled.total",
+		"hash.bytes.total",
+		"hash.busy.usec.total",
+		"thumbnail.cache.hit.total",
+		"thumbnail.cache.miss.total",
+		"api.cache.hit.total"
+	};
+
+	const char* gauge_name_arr[Metrics::GAUGE_COUNT] = {
+		"notify.event.rate",
+		"notify.queue.depth",
+		"notify.queue.depth.peak",
+		"notify.buffer.size",
+		"notify.held.count",
+		"notify.batch.size",
+		"hash.queue.length",
+		"thumbnail.cache.size",
+		"api.connection.count",
+		"api.subscriber.count",
+		"api.cache.bytes"
+	};
+
+	const char* histogram_name_arr[Metrics::HISTOGRAM_COUNT] = {
+		"lock.tag.wait",
+		"lock.tag.hold",
+		"lock.media.wait",
+		"lock.media.hold",
+		"db.statement",
+		"api.request"
+	};
+
+	ShardHolder::~ShardHolder() {
+		if (shard == nullptr) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(shard_list_lock);
+		shard->in_use = false;
+		shard->name.clear();
+	}
+
+	Shard*
+	GetLocalShard() {
+		if (local_holder.shard != nullptr) {
+			return local_holder.shard;
+		}
+
+		std::lock_guard<std::mutex> lock(shard_list_lock);
+
+		auto iter = std::find_if(shard_list.begin(), shard_list.end(), [](const std::unique_ptr<Shard>& shard) {
+			return !shard->in_use;
+		});
+
+		if (iter != shard_list.end()) {
+			(*iter)->in_use = true;
+			local_holder.shard = iter->get();
+		}
+		else {
+			shard_list.push_back(std::make_unique<Shard>());
+			local_holder.shard = shard_list.back().get();
+		}
+
+		return local_holder.shard;
+	}
+
+	//only the owning thread writes, no need for a locked add
+	inline void
+	LocalAdd(std::atomic<int64_t>& value, int64_t amount) {
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+}
+
+void
+Metrics::Inc(Counter counter, int64_t amount /*= 1*/) {
+	LocalAdd(GetLocalShard()->counter_arr[counter], amount);
+}
+
+int64_t
+Metrics::Get(Counter counter) {
+	std::lock_guard<std::mutex> lock(shard_list_lock);
+
+	int64_t total = 0;
+	for (const std::unique_ptr<Shard>& shard : shard_list) {
+		total += shard->counter_arr[counter].load(std::memory_order_relaxed);
+	}
+
+	return total;
+}
+
+void
+Metrics::Set(Gauge gauge, int64_t value) {
+	gauge_arr[gauge].store(value, std::memory_order_relaxed);
+}
+
+void
+Metrics::SetMax(Gauge gauge, int64_t value) {
+	int64_t curr = gauge_arr[gauge].load(std::memory_order_relaxed);
+
+	//retry until either we stored the value or someone else stored a bigger one
+	while (curr < value && !gauge_arr[gauge].compare_exchange_weak(curr, value, std::memory_order_relaxed)) {
+	}
+}
+
+int64_t
+Metrics::Get(Gauge gauge) {
+	return gauge_arr[gauge].load(std::memory_order_relaxed);
+}
+
+void
+Metrics::Record(Histogram histogram, int64_t usec) {
+	usec = std::max<int64_t>(usec, 0);
+
+	int bucket = 0;
+	while (bucket < HISTOGRAM_BUCKET_COUNT - 1 && (usec >> bucket) != 0) {
+		bucket++;
+	}
+
+	Shard* shard = GetLocalShard();
+	LocalAdd(shard->bucket_arr[histogram][bucket], 1);
+	LocalAdd(shard->sum_arr[histogram], usec);
+
+	if (usec > shard->max_arr[histogram].load(std::memory_order_relaxed)) {
+		shard->max_arr[histogram].store(usec, std::memory_order_relaxed);
+	}
+}
+
+Metrics::HistogramSnapshot
+Metrics::Get(Histogram histogram) {
+	std::lock_guard<std::mutex> lock(shard_list_lock);
+
+	HistogramSnapshot snapshot;
+	for (const std::unique_ptr<Shard>& shard : shard_list) {
+		for (int i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+			int64_t bucket_count = shard->bucket_arr[histogram][i].load(std::memory_order_relaxed);
+			snapshot.bucket_arr[i] += bucket_count;
+			snapshot.count += bucket_count;
+		}
+
+		snapshot.sum += shard->sum_arr[histogram].load(std::memory_order_relaxed);
+		snapshot.max = std::max(snapshot.max, shard->max_arr[histogram].load(std::memory_order_relaxed));
+	}
+
+	return snapshot;
+}
+
+void
+Metrics::SetThreadName(const char* name) {
+	Shard* shard = GetLocalShard();
+
+	std::lock_guard<std::mutex> lock(shard_list_lock);
+	shard->name = name;
+}
+
+std::vector<Metrics::ThreadSnapshot>
+Metrics::GetThreadList() {
+	std::lock_guard<std::mutex> lock(shard_list_lock);
+
+	std::vector<ThreadSnapshot> thread_list(shard_list.size());
+	for (size_t i = 0; i < shard_list.size(); i++) {
+		const Shard& shard = *shard_list[i];
+		ThreadSnapshot& snapshot = thread_list[i];
+
+		snapshot.name = shard.name;
+
+		for (int j = 0; j < COUNTER_COUNT; j++) {
+			snapshot.counter_arr[j] = shard.counter_arr[j].load(std::memory_order_relaxed);
+		}
+
+		for (int j = 0; j < HISTOGRAM_COUNT; j++) {
+			for (int k = 0; k < HISTOGRAM_BUCKET_COUNT; k++) {
+				snapshot.record_count += shard.bucket_arr[j][k].load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	return thread_list;
+}
+
+const char*
+Metrics::GetName(Counter counter) {
+	return counter_name_arr[counter];
+}
+
+const char*
+Metrics::GetName(Gauge gauge) {
+	return gauge_name_arr[gauge];
+}
+
+const char*
+Metrics::GetName(Histogram histogram) {
+	return histogram_name_arr[histogram];
+}
+
+int64_t
+Metrics::NowUsec() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//HistogramSnapshot
+
+int64_t
+Metrics::HistogramSnapshot::Percentile(double fraction) const {
+	if (count == 0) {
+		return 0;
+	}
+
+	int64_t target = std::max<int64_t>((int64_t) (count * fraction + 0.5), 1);
+	int64_t seen = 0;
+
+	for (int i = 0; i < HISTOGRAM_BUCKET_COUNT - 1; i++) {
+		seen += bucket_arr[i];
+		if (seen >= target) {
+			return std::min<int64_t>(int64_t(1) << i, max);
+		}
+	}
+
+	return max;
+}
+
+//ScopedTimer
+
+Metrics::ScopedTimer::ScopedTimer(Histogram target) :
+	target(target),
+	begin_usec(NowUsec())
+{
+}
+
+Metrics::ScopedTimer::~ScopedTimer() {
+	Record(target, NowUsec() - begin_usec);
+}
+
+//RateMeter
+
+Metrics::RateMeter::RateMeter(Gauge target) :
+	target(target),
+	window_begin(std::chrono::steady_clock::now())
+{
+}
+
+void
+Metrics::RateMeter::Mark(int64_t amount /*= 1*/) {
+	Tick();
+	window_count += amount;
+}
+
+void
+Metrics::RateMeter::Tick() {
+	auto now = std::chrono::steady_clock::now();
+	auto elapsed_msec = std::chrono::duration_cast<std::chrono::milliseconds>(now - window_begin).count();
+
+	if (elapsed_msec < 1000) {
+		return;
+	}
+
+	Metrics::Set(target, window_count * 1000 / elapsed_msec);
+
+	window_begin = now;
+	window_count = 0;
+	rolled = true;
+}
+
+bool
+Metrics::RateMeter::Rolled() {
+	bool ret = rolled;
+	rolled = false;
+	return ret;
+}
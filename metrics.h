@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+	Metrics: process wide counters, gauges and histograms any subsystem can update
+
+	Counters only ever grow, gauges hold the last reported value, histograms
+	count durations in power of two microsecond buckets. Updating any of them
+	never takes a lock and can be done from any thread (monitor thread, api
+	server thread, gui thread...).
+
+	Counters and histograms are kept per thread: each thread writes only its
+	own shard with plain loads and stores, readers add every shard up. So a
+	hot path pays for a couple of uncontended stores, not a locked add on a
+	cache line every other thread is hitting too. A shard is handed to the
+	next new thread once its own exits, its counts keep adding to the totals.
+	Gauges are last value wins and stay single atomics.
+
+	Kept free of Qt so platform backends like notify can report without
+	pulling in anything else.
+*/
+
+namespace Metrics {
+
+	enum Counter {
+		NOTIFY_EVENT_TOTAL,			//events produced by notifier
+		NOTIFY_OVERFLOW_TOTAL,		//times the notifier lost events
+		NOTIFY_RESCAN_TOTAL,		//subtree rescans performed by daemon to recover lost events
+		NOTIFY_COALESCED_TOTAL,		//events folded into or cancelled by another before reaching daemon
+		NOTIFY_BATCH_TOTAL,			//file event batches daemon applied
+		HASH_TOTAL,					//files hashed by hash service
+		HASH_COALESCED_TOTAL,		//hash requests folded into one already queued
+		HASH_CANCELLED_TOTAL,		//hash runs stopped because the file was removed or changed
+		HASH_BYTES_TOTAL,			//bytes of files hashed
+		HASH_BUSY_USEC_TOTAL,		//time hash workers spent hashing, all workers added up
+		THUMBNAIL_CACHE_HIT_TOTAL,
+		THUMBNAIL_CACHE_MISS_TOTAL,
+		API_CACHE_HIT_TOTAL,		//read responses served from the api response cache, not modified included
+
+		COUNTER_COUNT
+	};
+
+	enum Gauge {
+		NOTIFY_EVENT_RATE,			//events per second over the last full second
+		NOTIFY_QUEUE_DEPTH,			//events waiting to be processed by daemon
+		NOTIFY_QUEUE_DEPTH_PEAK,
+		NOTIFY_BUFFER_SIZE,			//bytes, change buffer grows on overflow
+		NOTIFY_HELD_COUNT,			//events coalescer is holding for their quiet window
+		NOTIFY_BATCH_SIZE,			//file events in the last applied batch
+		HASH_QUEUE_LENGTH,			//files waiting for a hash worker
+		THUMBNAIL_CACHE_SIZE,		//thumbnails held by the cache
+		API_CONNECTION_COUNT,
+		API_SUBSCRIBER_COUNT,
+		API_CACHE_BYTES,			//serialized results held by the api response cache
+
+		GAUGE_COUNT
+	};
+
+	enum Histogram {
+		TAG_LOCK_WAIT,				//usec to acquire daemon tag list lock
+		TAG_LOCK_HOLD,
+		MEDIA_LOCK_WAIT,			//usec to acquire daemon media list lock
+		MEDIA_LOCK_HOLD,
+		DB_STATEMENT,				//usec to run one query through sqlite, prepare to finalize
+		API_REQUEST,				//usec to execute one api request, streamed ones not included
+
+		HISTOGRAM_COUNT
+	};
+
+	//bucket i counts values below 2^i usec, the last one everything from 2^(count - 2) up
+	const int HISTOGRAM_BUCKET_COUNT = 26;
+
+	struct HistogramSnapshot {
+		int64_t		count = 0;
+		int64_t		sum = 0;		//usec
+		int64_t		max = 0;
+		int64_t		bucket_arr[HISTOGRAM_BUCKET_COUNT] = {};
+
+		//upper bound of the bucket the fraction (0 - 1) of values falls in, 0 if empty
+		int64_t		Percentile(double fraction) const;
+	};
+
+	struct ThreadSnapshot {
+		std::string			name;			//empty if the thread never named itself, or exited and nobody took its shard yet
+		int64_t				counter_arr[COUNTER_COUNT] = {};
+		int64_t				record_count = 0;	//histogram values recorded, every histogram added up
+	};
+
+	void		Inc(Counter counter, int64_t amount = 1);
+	int64_t		Get(Counter counter);
+
+	void		Set(Gauge gauge, int64_t value);
+	void		SetMax(Gauge gauge, int64_t value);		//only stores value if it's bigger than current
+	int64_t		Get(Gauge gauge);
+
+	void				Record(Histogram histogram, int64_t usec);
+	HistogramSnapshot	Get(Histogram histogram);
+
+	//names the calling thread in thread snapshots
+	void						SetThreadName(const char* name);
+	std::vector<ThreadSnapshot>	GetThreadList();
+
+	const char*	GetName(Counter counter);
+	const char*	GetName(Gauge gauge);
+	const char*	GetName(Histogram histogram);
+
+	int64_t		NowUsec();		//steady clock, only differences mean anything
+
+	//records how long it lived to a histogram
+	class ScopedTimer {
+	public:
+		explicit ScopedTimer(Histogram target);
+		~ScopedTimer();
+
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	private:
+		Histogram	target;
+		int64_t		begin_usec;
+	};
+
+	//counts marks within one second windows and reports the rate to a gauge when a window rolls over
+	//not thread safe, each producer owns its meter
+	class RateMeter {
+	public:
+		explicit RateMeter(Gauge target);
+
+		void Mark(int64_t amount = 1);
+
+		//call when producer is idle so the rate decays to 0 instead of keeping the last busy value
+		void Tick();
+
+		//true once per window roll over, lets producer piggyback per second book keeping
+		bool Rolled();
+
+	private:
+		Gauge									target;
+		std::chrono::steady_clock::time_point	window_begin;
+		int64_t									window_count = 0;
+		bool									rolled = false;
+	};
+}
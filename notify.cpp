@@ -1,20 +1,36 @@
 #include "pch.h"
 
 #include "notify.h"
+
+#ifdef _WIN32
+
 #include "util.h"
 
 Notify::Notify( std::wstring& wpath ) :
 	root_wpath ( wpath ),
+	root_handle(INVALID_HANDLE_VALUE),
 	io_pending(false),
+	request_error(ERROR_SUCCESS),
 	dir_change_buffer(nullptr),
-	overlap_notify(nullptr)
+	dir_change_buffer_size(DIR_CHANGE_BUFF_SIZE),
+	dir_change_buffer_max_size(DIR_CHANGE_BUFF_MAX_SIZE),
+	grow_buffer(false),
+	overlap_notify(nullptr),
+	event_rate_meter(Metrics::NOTIFY_EVENT_RATE)
 {
 }
 
-Notify::Notify(LPWSTR wpath, DWORD len) {
+Notify::Notify(LPWSTR wpath, DWORD len) :
+	dir_change_buffer_size(DIR_CHANGE_BUFF_SIZE),
+	dir_change_buffer_max_size(DIR_CHANGE_BUFF_MAX_SIZE),
+	grow_buffer(false),
+	event_rate_meter(Metrics::NOTIFY_EVENT_RATE)
+{
 	root_wpath.assign(wpath, len);
+	root_handle = INVALID_HANDLE_VALUE;
 	dir_change_buffer = nullptr;
 	io_pending = false;
+	request_error = ERROR_SUCCESS;
 	overlap_notify = nullptr;
 }
 
@@ -30,7 +46,18 @@ Notify::~Notify() {
 
 
 
-	CloseHandle(root_handle);
+	if (root_handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(root_handle);
+	}
+}
+
+void
+Notify::SetBufferSize(unsigned int initial_size, unsigned int max_size) {
+
+	//buffer has to hold at least one FILE_NOTIFY_INFORMATION with a MAX_PATH name
+	dir_change_buffer_size = max(initial_size, (unsigned int) (sizeof(FILE_NOTIFY_INFORMATION) + MAX_PATH * sizeof(WCHAR)));
+	dir_change_buffer_size = (dir_change_buffer_size + sizeof(DWORD) - 1) & ~(sizeof(DWORD) - 1);	//dword aligned length
+	dir_change_buffer_max_size = max(max_size, dir_change_buffer_size);
 }
 
 int
@@ -38,20 +65,15 @@ Notify::InitHandle() {
 
 	//this is completely by passing raii 
 	//TODO: change this if switched to exception in the future
-	dir_change_buffer = (char*) HeapAlloc(GetProcessHeap(), 0, DIR_CHANGE_BUFF_SIZE);
+	dir_change_buffer = (char*) HeapAlloc(GetProcessHeap(), 0, dir_change_buffer_size);
 	overlap_notify = (OVERLAPPED_NOTIFY*)HeapAlloc(GetProcessHeap(), 0, sizeof(OVERLAPPED_NOTIFY));
 
-	root_handle = CreateFileW(	root_wpath.c_str(), 
-								FILE_LIST_DIRECTORY, 
-								FILE_SHARE_DELETE | FILE_SHARE_READ | FILE_SHARE_WRITE, 
-								nullptr, 
-								OPEN_EXISTING, 
-								FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, 
-								nullptr );
-
-	if (root_handle == INVALID_HANDLE_VALUE) {
+	if (OpenRootHandle() < 0) {
+		request_error = GetLastError();
 		return -1;
 	}
+
+	Metrics::Set(Metrics::NOTIFY_BUFFER_SIZE, dir_change_buffer_size);
 	return 0;
 }
 
@@ -64,6 +86,8 @@ int
 Notify::GetNextEvent(NotifyEvent *out) {
 	*out = event_queue.front();
 	event_queue.pop();
+
+	Metrics::Set(Metrics::NOTIFY_QUEUE_DEPTH, event_queue.size());
 	return 1;
 }
 
@@ -94,26 +118,71 @@ int Notify::RequestChanges() {
 	
 	DWORD bytes_returned; //not used in async
 
+	//previous completion asked for a bigger buffer, no io is outstanding at this point
+	if (grow_buffer) {
+		GrowBuffer();
+		grow_buffer = false;
+	}
+
+	//root was not watchable last time, deleted and recreated or its volume went away. an old handle never recovers
+	if (request_error != ERROR_SUCCESS && OpenRootHandle() < 0) {
+		request_error = GetLastError();
+		return -1;
+	}
+
 	overlap_notify->notifier = this;
 	
-	int ret = ReadDirectoryChangesW(	root_handle, 
+	BOOL ret = ReadDirectoryChangesW(	root_handle, 
 										dir_change_buffer, 
-										DIR_CHANGE_BUFF_SIZE, 
+										dir_change_buffer_size, 
 										true, 
 										FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_CREATION, 
 										&bytes_returned, 
 										(LPOVERLAPPED) overlap_notify, 
 										(LPOVERLAPPED_COMPLETION_ROUTINE) &ReadDirChangeCompleteRoutine);
 
-	if (ret < 0) {
-		//TODO: error
-		return GetLastError();
+	//no completion routine runs for a request that was never issued
+	if (!ret) {
+		request_error = GetLastError();
+		return -1;
 	}
 
+	io_pending = true;
+
+	//nothing was watching since the failure, whatever changed meanwhile is only found by diffing the whole tree
+	if (request_error != ERROR_SUCCESS) {
+		request_error = ERROR_SUCCESS;
+
+		NotifyEvent notify_event_buff;
+		notify_event_buff.event = NotifyEvent::RESCAN;
+		event_queue.push(notify_event_buff);
+
+		Metrics::Inc(Metrics::NOTIFY_OVERFLOW_TOTAL);
+	}
 
 	return 1;
 }
 
+DWORD
+Notify::GetRequestError() const {
+	return request_error;
+}
+
+bool
+Notify::IsIoPending() const {
+	return io_pending;
+}
+
+void
+Notify::CompleteRequest(DWORD error) {
+	io_pending = false;
+
+	//overflow is reported separately, anything else means the request ended without watching
+	if (error != ERROR_SUCCESS && error != ERROR_NOTIFY_ENUM_DIR) {
+		request_error = error;
+	}
+}
+
 int
 Notify::ProcessEventBuffer(unsigned int data_size) {
 
@@ -138,6 +207,80 @@ Notify::ProcessEventBuffer(unsigned int data_size) {
 
 	//printf("%d notices processed this routine\n", notify_amount);
 
+	Metrics::Inc(Metrics::NOTIFY_EVENT_TOTAL, notify_amount);
+	Metrics::Set(Metrics::NOTIFY_QUEUE_DEPTH, event_queue.size());
+	Metrics::SetMax(Metrics::NOTIFY_QUEUE_DEPTH_PEAK, event_queue.size());
+	event_rate_meter.Mark(notify_amount);
+
+	//running close to full, grow before it actually overflows
+	if (data_size > dir_change_buffer_size / 4 * 3) {
+		grow_buffer = true;
+	}
+
+	return 1;
+}
+
+//system could not fit the changes in our buffer and threw all of them away
+//nothing tells which files changed, ask daemon to rescan the whole tree, dirs that were busy recently first
+int
+Notify::ProcessOverflow() {
+
+	Metrics::Inc(Metrics::NOTIFY_OVERFLOW_TOTAL);
+
+	grow_buffer = true;
+
+	std::vector<std::wstring> rescan_list;
+	recent_dirs.TakeRescanList(&rescan_list);
+
+	NotifyEvent notify_event_buff;
+	notify_event_buff.event = NotifyEvent::RESCAN;
+
+	for (const std::wstring& dir_wname : rescan_list) {
+		notify_event_buff.dir_wname = dir_wname;
+		event_queue.push(notify_event_buff);
+	}
+
+	Metrics::Set(Metrics::NOTIFY_QUEUE_DEPTH, event_queue.size());
+	return 1;
+}
+
+int
+Notify::OpenRootHandle() {
+
+	if (root_handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(root_handle);
+	}
+
+	root_handle = CreateFileW(	root_wpath.c_str(), 
+								FILE_LIST_DIRECTORY, 
+								FILE_SHARE_DELETE | FILE_SHARE_READ | FILE_SHARE_WRITE, 
+								nullptr, 
+								OPEN_EXISTING, 
+								FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, 
+								nullptr );
+
+	return root_handle == INVALID_HANDLE_VALUE ? -1 : 1;
+}
+
+int
+Notify::GrowBuffer() {
+
+	if (dir_change_buffer_size >= dir_change_buffer_max_size) {
+		return -1;
+	}
+
+	unsigned int new_size = min(dir_change_buffer_size * 2, dir_change_buffer_max_size);
+
+	char* new_buffer = (char*) HeapReAlloc(GetProcessHeap(), 0, dir_change_buffer, new_size);
+	if (new_buffer == nullptr) {
+		//keep using the old one
+		return -1;
+	}
+
+	dir_change_buffer = new_buffer;
+	dir_change_buffer_size = new_size;
+
+	Metrics::Set(Metrics::NOTIFY_BUFFER_SIZE, dir_change_buffer_size);
 	return 1;
 }
 
@@ -153,9 +296,71 @@ Notify::FormNotifyEvent(FILE_NOTIFY_INFORMATION* f_notify, NotifyEvent *out) {
 	//filename field is not null terminated
 	PathUtil::SplitDirFilenameCW(f_notify->FileName, ( f_notify->FileNameLength ) / 2 , out->dir_wname, out->file_wname);
 
+	recent_dirs.Touch(out->dir_wname, event_rate_meter.Rolled());
+
 	return 1;
 }
 
+#endif
+
+//NotifyRecentDirs
+
+void
+NotifyRecentDirs::Touch(const std::wstring& dir_wname, bool window_rolled) {
+
+	if (window_rolled) {
+		prev_dir_set = std::move(curr_dir_set);
+		curr_dir_set.clear();
+		saturated = false;
+	}
+
+	if (saturated) {
+		return;
+	}
+
+	if (curr_dir_set.size() + prev_dir_set.size() >= NOTIFY_RECENT_DIR_MAX) {
+		saturated = true;
+		return;
+	}
+
+	curr_dir_set.insert(dir_wname);
+}
+
+void
+NotifyRecentDirs::TakeRescanList(std::vector<std::wstring>* out) {
+
+	if (!saturated) {
+		std::unordered_set<std::wstring> candidate_set(curr_dir_set);
+		candidate_set.insert(prev_dir_set.begin(), prev_dir_set.end());
+
+		//a rescan covers the whole subtree, drop dirs that already have an ancestor in the set
+		for (const std::wstring& candidate : candidate_set) {
+			bool covered = false;
+
+			for (const std::wstring& other : candidate_set) {
+				if (other != candidate && (other.empty() || IsSubPathOf(candidate, other))) {
+					covered = true;
+					break;
+				}
+			}
+
+			if (!covered) {
+				out->push_back(candidate);
+			}
+		}
+	}
+
+	//lost events were never seen so they tell nothing about where they happened, a quiet dir may have
+	//changed during the burst just the same. busy dirs above only go first, root covers everything
+	if (out->empty() || !out->back().empty()) {
+		out->push_back(std::wstring());
+	}
+
+	curr_dir_set.clear();
+	prev_dir_set.clear();
+	saturated = false;
+}
+
 void EventTypeToString(const NotifyEvent::EventType event, std::wstring *result) {
 	switch (event) {
 		case NotifyEvent::CREATE:
@@ -175,21 +380,34 @@ void EventTypeToString(const NotifyEvent::EventType event, std::wstring *result)
 		case NotifyEvent::RENAME_SKIP:
 			result->assign(L"RENAME_NEW");
 			break;
+		case NotifyEvent::RESCAN:
+			result->assign(L"RESCAN");
+			break;
 		default:
 			result->assign(L"ERR");
 	}
 }
 
+#ifdef _WIN32
+
 void WINAPI
 ReadDirChangeCompleteRoutine(DWORD error, DWORD bytes_transfered, LPOVERLAPPED overlapped) {
-	if (error != 0) {
+
+	OVERLAPPED_NOTIFY *overlap_notify = (OVERLAPPED_NOTIFY*)overlapped;
+	overlap_notify->notifier->CompleteRequest(error);
+
+	//changes did not fit in the buffer. reported as success with nothing transfered,
+	//or as ERROR_NOTIFY_ENUM_DIR depending on the system
+	if ((error == ERROR_SUCCESS && bytes_transfered == 0) || error == ERROR_NOTIFY_ENUM_DIR) {
+		overlap_notify->notifier->ProcessOverflow();
 		return;
 	}
 
-	if (bytes_transfered == 0) {
+	if (error != 0) {
 		return;
 	}
 
-	OVERLAPPED_NOTIFY *overlap_notify = (OVERLAPPED_NOTIFY*)overlapped;
 	overlap_notify->notifier->ProcessEventBuffer(bytes_transfered);
-}
\ No newline at end of file
+}
+
+#endif
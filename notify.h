@@ -1,29 +1,45 @@
 #pragma once
 
 /*
-	Library that utilizes Winapi ReadDirectoryChangesW
+	Library that produces file system change events for the daemon
+
+	Windows backend utilizes Winapi ReadDirectoryChangesW (notify.cpp)
+	Linux backend utilizes inotify driven by epoll (notify_inotify.cpp)
+
+	Both backends produce the same NotifyEvent stream: names relative to the
+	watched root, backslash separated, split into dir and file name
 */
 
 #include <string>
 #include <queue>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
+
+#include "metrics.h"
 
+#ifdef _WIN32
 #include <Windows.h>
 
 #define DWORD_ALIGN __declspec(align(sizeof DWORD))
 
 //how big should the buffer be? hardest question in programming
-//8kb for now
+//start at 8kb and double whenever it overflows or runs close to full
 #define DIR_CHANGE_BUFF_SIZE (1024 * 8)
 
+//ReadDirectoryChangesW fails with ERROR_INVALID_PARAMETER above 64kb when monitoring a network share
+#define DIR_CHANGE_BUFF_MAX_SIZE (1024 * 64)
+
+//how long to wait before asking again after a request failed
+#define NOTIFY_REQUEST_RETRY_MSEC 1000
+
 class Notify;
 
 struct OVERLAPPED_NOTIFY {
 	OVERLAPPED	overlapped;
 	Notify*		notifier;
 };
-
-
+#endif
 
 struct NotifyPathEntry {
 	std::string entry_wpath;
@@ -39,7 +55,8 @@ struct NotifyEvent {
 		RENAME_OLD,
 		RENAME_NEW,
 		CREATE_SKIP,
-		RENAME_SKIP
+		RENAME_SKIP,
+		RESCAN			//events under dir_wname were lost, file_wname is empty. daemon has to diff that subtree against disk
 	};
 
 	EventType			event;
@@ -48,6 +65,38 @@ struct NotifyEvent {
 	std::wstring		file_wname;
 };
 
+//dirs with activity in the last couple seconds are rescanned first when the notifier loses events
+//past this many they are not told apart any more
+#define NOTIFY_RECENT_DIR_MAX 64
+
+//remembers which dirs saw events this second and last second, those are rescanned ahead of the
+//rest of the tree when events are lost
+class NotifyRecentDirs {
+public:
+	void	Touch(const std::wstring& dir_wname, bool window_rolled);
+
+	//top most dirs touched recently, always followed by root (empty name) which covers the dirs lost events went to. resets tracking
+	void	TakeRescanList(std::vector<std::wstring>* out);
+
+	//true if sub_wpath is parent_wpath itself or anything under it
+	static bool IsSubPathOf(const std::wstring& sub_wpath, const std::wstring& parent_wpath) {
+		if (sub_wpath.size() == parent_wpath.size()) {
+			return sub_wpath == parent_wpath;
+		}
+
+		return	sub_wpath.size() > parent_wpath.size() &&
+				sub_wpath[parent_wpath.size()] == L'\\' &&
+				sub_wpath.compare(0, parent_wpath.size(), parent_wpath) == 0;
+	}
+
+private:
+	std::unordered_set<std::wstring>	curr_dir_set;
+	std::unordered_set<std::wstring>	prev_dir_set;
+	bool								saturated = false;
+};
+
+#ifdef _WIN32
+
 class Notify {
 public:
 	explicit Notify( std::wstring& );
@@ -56,13 +105,20 @@ public:
 	explicit Notify(LPWSTR, DWORD);
 	~Notify();
 
+	//call before InitHandle, sizes in bytes
+	void	SetBufferSize(unsigned int initial_size, unsigned int max_size);
+
 	int		InitHandle();
 	bool	HasEvent() const;
-	int		RequestChanges();
+	int		RequestChanges();			//-1 if the request could not be issued, call again later
+	DWORD	GetRequestError() const;	//why the last request failed, ERROR_SUCCESS once one goes through again
+	bool	IsIoPending() const;		//a request is outstanding, its completion routine has not run yet
+	void	CompleteRequest(DWORD);		//called by completion routine with its error code
 	int		GetNextEvent(NotifyEvent*);
 	int		PeekNextEvent(NotifyEvent*) const;
 	int		UpdateNextEventTypeToSkip();
 	int		ProcessEventBuffer(unsigned int);
+	int		ProcessOverflow();
 	int		FormNotifyEvent(FILE_NOTIFY_INFORMATION*, NotifyEvent*);
 
 private:
@@ -71,10 +127,87 @@ private:
 	std::vector<std::wstring>		wexclusion_wpaths;
 	std::queue<NotifyEvent>			event_queue;
 
-	bool							io_pending;		//useful for restarting daemon need to clear outstanding io result before restart. but not needed if daemon can't be restarted.
+	bool							io_pending;		//other apcs wake the monitor thread too, only issue a new request once this one completed
+	DWORD							request_error;	//set while nothing is watching the tree, changes in that time are lost
 	char							*dir_change_buffer;
+	unsigned int					dir_change_buffer_size;
+	unsigned int					dir_change_buffer_max_size;
+	bool							grow_buffer;	//grown before the next request, never while io is outstanding
 	OVERLAPPED_NOTIFY				*overlap_notify;
+
+	NotifyRecentDirs				recent_dirs;
+	Metrics::RateMeter				event_rate_meter;
+
+	int		OpenRootHandle();
+	int		GrowBuffer();
+};
+
+void WINAPI ReadDirChangeCompleteRoutine(DWORD, DWORD, LPOVERLAPPED);
+
+#elif defined(__linux__)
+
+//inotify buffer, big enough for a few hundred events with long names
+#define INOTIFY_BUFF_SIZE (1024 * 64)
+
+enum NotifyWaitResult {
+	NOTIFY_WAIT_EVENT,
+	NOTIFY_WAIT_TIMEOUT,
+	NOTIFY_WAIT_INTERRUPT,
+	NOTIFY_WAIT_ERROR
+};
+
+class Notify {
+public:
+	explicit Notify(const std::wstring&);
+	~Notify();
+
+	int		InitHandle();
+	bool	HasEvent() const;
+	int		RequestChanges();			//drain whatever inotify has queued, never blocks
+	int		WaitChanges(int);			//block up to timeout msec (-1 infinite) for changes or Interrupt(), returns NotifyWaitResult
+	void	Interrupt();				//wake WaitChanges from another thread
+	int		GetNextEvent(NotifyEvent*);
+	int		PeekNextEvent(NotifyEvent*) const;
+	int		UpdateNextEventTypeToSkip();
+
+private:
+	int		AddWatch(const std::wstring&);
+	int		AddWatchRecur(const std::wstring&, bool);
+	void	RemoveWatchMapping(int);
+	void	RemoveWatchRecur(const std::wstring&);
+	void	RenameWatchRecur(const std::wstring&, const std::wstring&);
+	int		ProcessEventBuffer(unsigned int);
+	void	PushEvent(NotifyEvent::EventType, const std::wstring&, const std::wstring&);
+	void	PushRescan();
+	void	FlushPendingMove();
+
+	std::wstring							root_wpath;
+	std::string								root_path;		//utf8, what the kernel speaks
+
+	int										inotify_fd;
+	int										epoll_fd;
+	int										interrupt_fd;	//eventfd
+
+	//inotify watches are per dir. map watch descriptors to root relative dir names and back
+	std::unordered_map<int, std::wstring>	wd_to_sub_wpath;
+	std::unordered_map<std::wstring, int>	sub_wpath_to_wd;
+
+	std::queue<NotifyEvent>					event_queue;
+
+	//IN_MOVED_FROM waiting for its IN_MOVED_TO with the same cookie
+	bool									move_pending;
+	bool									move_is_dir;
+	uint32_t								move_cookie;
+	std::wstring							move_dir_wname;
+	std::wstring							move_file_wname;
+
+	NotifyRecentDirs						recent_dirs;
+
+	std::vector<char>						dir_change_buffer;
+
+	Metrics::RateMeter						event_rate_meter;
 };
 
-void EventTypeToString(const NotifyEvent::EventType, std::wstring*);
-void WINAPI ReadDirChangeCompleteRoutine(DWORD, DWORD, LPOVERLAPPED);
\ No newline at end of file
+#endif
+
+void EventTypeToString(const NotifyEvent::EventType, std::wstring*);
\ No newline at end of file
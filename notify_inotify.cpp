@@ -0,0 +1,602 @@
+#include "pch.h"
+
+#include "notify.h"
+
+#ifdef __linux__
+
+#include <sys/inotify.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <vector>
+
+//IN_ATTRIB and friends are left out, windows backend only reports name, creation and last write changes
+#define INOTIFY_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO | IN_DONT_FOLLOW | IN_EXCL_UNLINK | IN_ONLYDIR)
+
+namespace {
+
+	//kernel hands out utf8 bytes while NotifyEvent carries wide strings like the windows backend
+	std::wstring
+	Utf8ToWide(const char* str, size_t len) {
+
+		std::wstring ret;
+		ret.reserve(len);
+
+		size_t i = 0;
+		while (i < len) {
+			unsigned char c = str[i];
+			unsigned int code_point;
+			size_t extra;
+
+			if (c < 0x80) {
+				code_point = c;
+				extra = 0;
+			} else if ((c & 0xE0) == 0xC0) {
+				code_point = c & 0x1F;
+				extra = 1;
+			} else if ((c & 0xF0) == 0xE0) {
+				code_point = c & 0x0F;
+				extra = 2;
+			} else if ((c & 0xF8) == 0xF0) {
+				code_point = c & 0x07;
+				extra = 3;
+			} else {
+				//not utf8, keep the byte as is so the name still round trips
+				code_point = c;
+				extra = 0;
+			}
+
+			if (i + extra >= len && extra != 0) {
+				code_point = c;
+				extra = 0;
+			}
+
+			for (size_t j = 1; j <= extra; j++) {
+				code_point = (code_point << 6) | (str[i + j] & 0x3F);
+			}
+
+			ret.push_back((wchar_t)code_point);
+			i += extra + 1;
+		}
+
+		return ret;
+	}
+
+	std::string
+	WideToUtf8(const std::wstring& wstr) {
+
+		std::string ret;
+		ret.reserve(wstr.size());
+
+		for (wchar_t wc : wstr) {
+			unsigned int code_point = (unsigned int)wc;
+
+			if (code_point < 0x80) {
+				ret.push_back((char)code_point);
+			} else if (code_point < 0x800) {
+				ret.push_back((char)(0xC0 | (code_point >> 6)));
+				ret.push_back((char)(0x80 | (code_point & 0x3F)));
+			} else if (code_point < 0x10000) {
+				ret.push_back((char)(0xE0 | (code_point >> 12)));
+				ret.push_back((char)(0x80 | ((code_point >> 6) & 0x3F)));
+				ret.push_back((char)(0x80 | (code_point & 0x3F)));
+			} else {
+				ret.push_back((char)(0xF0 | (code_point >> 18)));
+				ret.push_back((char)(0x80 | ((code_point >> 12) & 0x3F)));
+				ret.push_back((char)(0x80 | ((code_point >> 6) & 0x3F)));
+				ret.push_back((char)(0x80 | (code_point & 0x3F)));
+			}
+		}
+
+		return ret;
+	}
+
+	std::wstring
+	JoinSubPath(const std::wstring& dir_wname, const std::wstring& file_wname) {
+		if (dir_wname.empty()) {
+			return file_wname;
+		}
+		return dir_wname + L'\\' + file_wname;
+	}
+}
+
+Notify::Notify(const std::wstring& wpath) :
+	root_wpath(wpath),
+	root_path(WideToUtf8(wpath)),
+	inotify_fd(-1),
+	epoll_fd(-1),
+	interrupt_fd(-1),
+	move_pending(false),
+	move_is_dir(false),
+	move_cookie(0),
+	event_rate_meter(Metrics::NOTIFY_EVENT_RATE)
+{
+}
+
+Notify::~Notify() {
+
+	if (interrupt_fd != -1) {
+		close(interrupt_fd);
+	}
+
+	if (epoll_fd != -1) {
+		close(epoll_fd);
+	}
+
+	//closing inotify fd drops every watch
+	if (inotify_fd != -1) {
+		close(inotify_fd);
+	}
+}
+
+int
+Notify::InitHandle() {
+
+	dir_change_buffer.resize(INOTIFY_BUFF_SIZE);
+
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd == -1) {
+		return -1;
+	}
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		return -1;
+	}
+
+	interrupt_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (interrupt_fd == -1) {
+		return -1;
+	}
+
+	struct epoll_event epoll_evt_buff;
+	memset(&epoll_evt_buff, 0, sizeof(epoll_evt_buff));
+	epoll_evt_buff.events = EPOLLIN;
+
+	epoll_evt_buff.data.fd = inotify_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &epoll_evt_buff) == -1) {
+		return -1;
+	}
+
+	epoll_evt_buff.data.fd = interrupt_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, interrupt_fd, &epoll_evt_buff) == -1) {
+		return -1;
+	}
+
+	//unlike ReadDirectoryChangesW inotify is not recursive, every dir under root needs its own watch
+	if (AddWatchRecur(std::wstring(), false) < 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+bool
+Notify::HasEvent() const {
+	return !event_queue.empty();
+}
+
+int
+Notify::GetNextEvent(NotifyEvent* out) {
+	*out = event_queue.front();
+	event_queue.pop();
+
+	Metrics::Set(Metrics::NOTIFY_QUEUE_DEPTH, event_queue.size());
+	return 1;
+}
+
+int
+Notify::PeekNextEvent(NotifyEvent* out) const {
+	*out = event_queue.front();
+	return 1;
+}
+
+int
+Notify::UpdateNextEventTypeToSkip() {
+	if (event_queue.front().event == NotifyEvent::CREATE) {
+		event_queue.front().event = NotifyEvent::CREATE_SKIP;
+		return 1;
+	}
+
+	if (event_queue.front().event == NotifyEvent::RENAME_NEW) {
+		event_queue.front().event = NotifyEvent::RENAME_SKIP;
+		return 1;
+	}
+
+	return -1;
+}
+
+int
+Notify::RequestChanges() {
+
+	for (;;) {
+		ssize_t read_size = read(inotify_fd, dir_change_buffer.data(), dir_change_buffer.size());
+
+		if (read_size == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno == EAGAIN) {
+				break;
+			}
+
+			return -1;
+		}
+
+		ProcessEventBuffer(read_size);
+	}
+
+	//kernel queues IN_MOVED_FROM and IN_MOVED_TO back to back, a lone one at the end of the drain was moved out of root
+	FlushPendingMove();
+
+	return 1;
+}
+
+int
+Notify::WaitChanges(int timeout_msec) {
+
+	struct epoll_event epoll_evt_arr[2];
+
+	int ready_amount = epoll_wait(epoll_fd, epoll_evt_arr, 2, timeout_msec);
+
+	if (ready_amount == -1) {
+		return errno == EINTR ? NOTIFY_WAIT_TIMEOUT : NOTIFY_WAIT_ERROR;
+	}
+
+	if (ready_amount == 0) {
+		event_rate_meter.Tick();
+		return NOTIFY_WAIT_TIMEOUT;
+	}
+
+	int ret = NOTIFY_WAIT_EVENT;
+
+	for (int i = 0; i < ready_amount; i++) {
+		if (epoll_evt_arr[i].data.fd == interrupt_fd) {
+			//resets the counter, EAGAIN only means another wait drained it first
+			uint64_t counter_buff;
+			if (read(interrupt_fd, &counter_buff, sizeof(counter_buff)) == -1 && errno != EAGAIN) {
+				return NOTIFY_WAIT_ERROR;
+			}
+
+			ret = NOTIFY_WAIT_INTERRUPT;
+			continue;
+		}
+
+		if (RequestChanges() < 0) {
+			return NOTIFY_WAIT_ERROR;
+		}
+	}
+
+	return ret;
+}
+
+void
+Notify::Interrupt() {
+	uint64_t one = 1;
+
+	//can only fail with EAGAIN once the counter is full, a wake is pending then so nothing is lost.
+	//kept in a variable, gcc warns about a plain (void) cast of write
+	ssize_t write_size = write(interrupt_fd, &one, sizeof(one));
+	(void)write_size;
+}
+
+int
+Notify::AddWatch(const std::wstring& sub_wpath) {
+
+	std::string abs_path = root_path;
+	if (!sub_wpath.empty()) {
+		std::wstring slash_sub_wpath = sub_wpath;
+		for (wchar_t& wc : slash_sub_wpath) {
+			if (wc == L'\\') {
+				wc = L'/';
+			}
+		}
+
+		abs_path.push_back('/');
+		abs_path.append(WideToUtf8(slash_sub_wpath));
+	}
+
+	int wd = inotify_add_watch(inotify_fd, abs_path.c_str(), INOTIFY_WATCH_MASK);
+	if (wd == -1) {
+		//ENOSPC means fs.inotify.max_user_watches is exhausted, nothing we can do from here
+		return -1;
+	}
+
+	//same inode watched again (dir moved back in) hands back the old wd, drop the stale name
+	auto wd_iter = wd_to_sub_wpath.find(wd);
+	if (wd_iter != wd_to_sub_wpath.end()) {
+		sub_wpath_to_wd.erase(wd_iter->second);
+	}
+
+	wd_to_sub_wpath[wd] = sub_wpath;
+	sub_wpath_to_wd[sub_wpath] = wd;
+
+	return wd;
+}
+
+//watches dir and every dir under it
+//report_entries pushes CREATE for whatever already exists, which covers files created in a new dir before its watch was added
+int
+Notify::AddWatchRecur(const std::wstring& sub_wpath, bool report_entries) {
+
+	std::vector<std::wstring> dir_stack;
+	dir_stack.push_back(sub_wpath);
+
+	int ret = 1;
+
+	while (!dir_stack.empty()) {
+		std::wstring curr_sub_wpath = std::move(dir_stack.back());
+		dir_stack.pop_back();
+
+		if (AddWatch(curr_sub_wpath) < 0) {
+			ret = -1;
+			continue;
+		}
+
+		std::string abs_path = root_path;
+		if (!curr_sub_wpath.empty()) {
+			std::wstring slash_sub_wpath = curr_sub_wpath;
+			for (wchar_t& wc : slash_sub_wpath) {
+				if (wc == L'\\') {
+					wc = L'/';
+				}
+			}
+
+			abs_path.push_back('/');
+			abs_path.append(WideToUtf8(slash_sub_wpath));
+		}
+
+		DIR* dir_handle = opendir(abs_path.c_str());
+		if (dir_handle == nullptr) {
+			//removed before we got here, its REMOVE is on the way
+			continue;
+		}
+
+		struct dirent* entry;
+		while ((entry = readdir(dir_handle)) != nullptr) {
+			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+				continue;
+			}
+
+			bool is_dir = entry->d_type == DT_DIR;
+			if (entry->d_type == DT_UNKNOWN) {
+				struct stat stat_buff;
+				std::string entry_path = abs_path + '/' + entry->d_name;
+				is_dir = lstat(entry_path.c_str(), &stat_buff) == 0 && S_ISDIR(stat_buff.st_mode);
+			}
+
+			std::wstring entry_wname = Utf8ToWide(entry->d_name, strlen(entry->d_name));
+
+			if (report_entries) {
+				PushEvent(NotifyEvent::CREATE, curr_sub_wpath, entry_wname);
+			}
+
+			if (is_dir) {
+				dir_stack.push_back(JoinSubPath(curr_sub_wpath, entry_wname));
+			}
+		}
+
+		closedir(dir_handle);
+	}
+
+	return ret;
+}
+
+void
+Notify::RemoveWatchMapping(int wd) {
+	auto wd_iter = wd_to_sub_wpath.find(wd);
+	if (wd_iter == wd_to_sub_wpath.end()) {
+		return;
+	}
+
+	auto sub_iter = sub_wpath_to_wd.find(wd_iter->second);
+	if (sub_iter != sub_wpath_to_wd.end() && sub_iter->second == wd) {
+		sub_wpath_to_wd.erase(sub_iter);
+	}
+
+	wd_to_sub_wpath.erase(wd_iter);
+}
+
+//dir left root, kernel keeps watching it wherever it went so drop the watches ourselves
+void
+Notify::RemoveWatchRecur(const std::wstring& sub_wpath) {
+
+	std::vector<int> wd_list;
+	for (const auto& entry : sub_wpath_to_wd) {
+		if (NotifyRecentDirs::IsSubPathOf(entry.first, sub_wpath)) {
+			wd_list.push_back(entry.second);
+		}
+	}
+
+	for (int wd : wd_list) {
+		inotify_rm_watch(inotify_fd, wd);
+		RemoveWatchMapping(wd);
+	}
+}
+
+//watch descriptors follow the inode, only the names we keep for them change
+void
+Notify::RenameWatchRecur(const std::wstring& old_sub_wpath, const std::wstring& new_sub_wpath) {
+
+	std::vector<std::pair<std::wstring, int>> renamed_list;
+	for (const auto& entry : sub_wpath_to_wd) {
+		if (NotifyRecentDirs::IsSubPathOf(entry.first, old_sub_wpath)) {
+			renamed_list.emplace_back(new_sub_wpath + entry.first.substr(old_sub_wpath.size()), entry.second);
+		}
+	}
+
+	for (const auto& entry : renamed_list) {
+		sub_wpath_to_wd.erase(wd_to_sub_wpath[entry.second]);
+	}
+
+	for (const auto& entry : renamed_list) {
+		wd_to_sub_wpath[entry.second] = entry.first;
+		sub_wpath_to_wd[entry.first] = entry.second;
+	}
+}
+
+int
+Notify::ProcessEventBuffer(unsigned int data_size) {
+
+	const char* ptr = dir_change_buffer.data();
+	const char* end = ptr + data_size;
+
+	while (ptr < end) {
+		const struct inotify_event* evt = (const struct inotify_event*)ptr;
+		ptr += sizeof(struct inotify_event) + evt->len;
+
+		if (evt->mask & IN_Q_OVERFLOW) {
+			PushRescan();
+			continue;
+		}
+
+		if (evt->mask & IN_IGNORED) {
+			RemoveWatchMapping(evt->wd);
+			continue;
+		}
+
+		//events about the watched dir itself (IN_DELETE_SELF...) are reported by its parent as well
+		if (evt->len == 0) {
+			continue;
+		}
+
+		auto wd_iter = wd_to_sub_wpath.find(evt->wd);
+		if (wd_iter == wd_to_sub_wpath.end()) {
+			continue;
+		}
+
+		//copy, AddWatchRecur below can rehash the map
+		std::wstring dir_wname = wd_iter->second;
+		std::wstring file_wname = Utf8ToWide(evt->name, strnlen(evt->name, evt->len));
+		bool is_dir = (evt->mask & IN_ISDIR) != 0;
+
+		if (move_pending && !((evt->mask & IN_MOVED_TO) && evt->cookie == move_cookie)) {
+			FlushPendingMove();
+		}
+
+		if (evt->mask & IN_CREATE) {
+			PushEvent(NotifyEvent::CREATE, dir_wname, file_wname);
+
+			if (is_dir) {
+				AddWatchRecur(JoinSubPath(dir_wname, file_wname), true);
+			}
+			continue;
+		}
+
+		if (evt->mask & IN_DELETE) {
+			//watches under a removed dir clean themselves up through IN_IGNORED
+			PushEvent(NotifyEvent::REMOVE, dir_wname, file_wname);
+			continue;
+		}
+
+		if (evt->mask & IN_MODIFY) {
+			PushEvent(NotifyEvent::MODIFY, dir_wname, file_wname);
+			continue;
+		}
+
+		if (evt->mask & IN_MOVED_FROM) {
+			move_pending = true;
+			move_is_dir = is_dir;
+			move_cookie = evt->cookie;
+			move_dir_wname = dir_wname;
+			move_file_wname = file_wname;
+			continue;
+		}
+
+		if (evt->mask & IN_MOVED_TO) {
+
+			if (!move_pending) {
+				//moved in from outside root. windows reports the same as a plain CREATE
+				PushEvent(NotifyEvent::CREATE, dir_wname, file_wname);
+
+				if (is_dir) {
+					AddWatchRecur(JoinSubPath(dir_wname, file_wname), false);
+				}
+				continue;
+			}
+
+			//windows reports rename within a dir as RENAME_OLD RENAME_NEW pair and a move across dirs as REMOVE CREATE
+			if (move_dir_wname == dir_wname) {
+				PushEvent(NotifyEvent::RENAME_OLD, move_dir_wname, move_file_wname);
+				PushEvent(NotifyEvent::RENAME_NEW, dir_wname, file_wname);
+			} else {
+				PushEvent(NotifyEvent::REMOVE, move_dir_wname, move_file_wname);
+				PushEvent(NotifyEvent::CREATE, dir_wname, file_wname);
+			}
+
+			if (move_is_dir) {
+				RenameWatchRecur(JoinSubPath(move_dir_wname, move_file_wname), JoinSubPath(dir_wname, file_wname));
+			}
+
+			move_pending = false;
+			continue;
+		}
+	}
+
+	Metrics::Set(Metrics::NOTIFY_QUEUE_DEPTH, event_queue.size());
+	Metrics::SetMax(Metrics::NOTIFY_QUEUE_DEPTH_PEAK, event_queue.size());
+
+	return 1;
+}
+
+void
+Notify::PushEvent(NotifyEvent::EventType type, const std::wstring& dir_wname, const std::wstring& file_wname) {
+
+	NotifyEvent notify_event_buff;
+	notify_event_buff.event = type;
+	notify_event_buff.dir_wname = dir_wname;
+	notify_event_buff.file_wname = file_wname;
+
+	event_queue.push(std::move(notify_event_buff));
+
+	Metrics::Inc(Metrics::NOTIFY_EVENT_TOTAL);
+	event_rate_meter.Mark();
+
+	recent_dirs.Touch(dir_wname, event_rate_meter.Rolled());
+}
+
+//kernel dropped events and nothing tells where they happened, whole root is rescanned with
+//dirs that were busy right before going first
+void
+Notify::PushRescan() {
+
+	Metrics::Inc(Metrics::NOTIFY_OVERFLOW_TOTAL);
+
+	FlushPendingMove();
+
+	std::vector<std::wstring> rescan_list;
+	recent_dirs.TakeRescanList(&rescan_list);
+
+	for (const std::wstring& dir_wname : rescan_list) {
+		NotifyEvent notify_event_buff;
+		notify_event_buff.event = NotifyEvent::RESCAN;
+		notify_event_buff.dir_wname = dir_wname;
+
+		event_queue.push(std::move(notify_event_buff));
+	}
+}
+
+//IN_MOVED_FROM never got its IN_MOVED_TO, entry was moved out of root
+void
+Notify::FlushPendingMove() {
+
+	if (!move_pending) {
+		return;
+	}
+
+	move_pending = false;
+
+	PushEvent(NotifyEvent::REMOVE, move_dir_wname, move_file_wname);
+
+	if (move_is_dir) {
+		RemoveWatchRecur(JoinSubPath(move_dir_wname, move_file_wname));
+	}
+}
+
+#endif
@@ -0,0 +1,284 @@
+#include "pending_remove.h"
+
+#include <QStringBuilder>
+
+#include <algorithm>
+
+PendingRemoveTable::PendingRemoveTable(int window_msec /*= PENDING_REMOVE_WINDOW_MSEC*/, int slot_msec /*= PENDING_REMOVE_SLOT_MSEC*/) :
+	wheel_tick(0),
+	next_entry_id(0)
+{
+	SetWindow(window_msec, slot_msec);
+}
+
+void
+PendingRemoveTable::SetWindow(int window_msec, int slot_msec /*= PENDING_REMOVE_SLOT_MSEC*/) {
+	this->window_msec = qMax(window_msec, 0);
+	this->slot_msec = qMax(slot_msec, 1);
+
+	entry_table.clear();
+	media_name_table.clear();
+	dir_name_table.clear();
+	sub_path_name_table.clear();
+
+	//deadlines stay within two windows of the last sweep, see header
+	wheel.clear();
+	wheel.resize(2 * (this->window_msec / this->slot_msec) + 2);
+	wheel_tick = 0;
+}
+
+void
+PendingRemoveTable::AddMedia(const MediaInfo& media, quint64 now_msec) {
+	PendingRemove entry;
+	entry.dir_flag = false;
+	entry.sub_path_name = media.GetSubpathLongName();
+	entry.media = media;
+
+	Add(std::move(entry), media.long_name, now_msec);
+}
+
+void
+PendingRemoveTable::AddDir(const QString& sub_path_name, quint64 now_msec) {
+	PendingRemove entry;
+	entry.dir_flag = true;
+	entry.sub_path_name = sub_path_name;
+
+	Add(std::move(entry), sub_path_name.mid(sub_path_name.lastIndexOf('\\') + 1), now_msec);
+}
+
+bool
+PendingRemoveTable::MediaCandidateExist(const QString& long_name, qint64 size, const QString& quick_hash /*= QString()*/) const {
+	for (auto iter = media_name_table.constFind(long_name); iter != media_name_table.cend() && iter.key() == long_name; iter++) {
+		const MediaInfo& entry_media = entry_table.constFind(iter.value())->media;
+
+		if (size != -1 && entry_media.size != -1 && size != entry_media.size) {
+			continue;
+		}
+
+		if (quick_hash.isEmpty() || entry_media.quick_hash.isEmpty() || quick_hash == entry_media.quick_hash) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool
+PendingRemoveTable::DirCandidateExist(const QString& long_name) const {
+	return dir_name_table.contains(long_name);
+}
+
+bool
+PendingRemoveTable::SubPathNameExist(const QString& sub_path_name) const {
+	return sub_path_name_table.contains(sub_path_name);
+}
+
+bool
+PendingRemoveTable::TakeMedia(const MediaInfo& media, PendingRemove* out) {
+	return TakeOldest(media_name_table, media.long_name, &media, out);
+}
+
+bool
+PendingRemoveTable::TakeDir(const QString& long_name, PendingRemove* out) {
+	return TakeOldest(dir_name_table, long_name, nullptr, out);
+}
+
+bool
+PendingRemoveTable::TakeBySubPathName(const QString& sub_path_name, PendingRemove* out) {
+	auto iter = sub_path_name_table.constFind(sub_path_name);
+	if (iter == sub_path_name_table.cend()) {
+		return false;
+	}
+
+	Take(iter.value(), out);
+	return true;
+}
+
+void
+PendingRemoveTable::TakeUnder(const QString& sub_path, QVector<PendingRemove>* out) {
+	QVector<quint64> taken_id_list;
+
+	for (auto iter = entry_table.cbegin(); iter != entry_table.cend(); iter++) {
+		const QString& sub_path_name = iter->sub_path_name;
+
+		if (sub_path.isEmpty() || sub_path_name == sub_path || sub_path_name.startsWith(sub_path % '\\')) {
+			taken_id_list.push_back(iter.key());
+		}
+	}
+
+	//oldest first like the rest of the table
+	std::sort(taken_id_list.begin(), taken_id_list.end());
+
+	PendingRemove entry;
+	for (quint64 entry_id : taken_id_list) {
+		Take(entry_id, &entry);
+		out->push_back(entry);
+	}
+}
+
+void
+PendingRemoveTable::TakeExpired(quint64 now_msec, QVector<PendingRemove>* out) {
+	quint64 now_tick = now_msec / slot_msec;
+
+	if (entry_table.empty() || now_tick < wheel_tick) {
+		return;
+	}
+
+	//long gap since last sweep, one revolution covers every slot
+	quint64 sweep_count = qMin<quint64>(now_tick - wheel_tick + 1, wheel.size());
+
+	PendingRemove entry;
+	for (quint64 i = 0; i < sweep_count; i++) {
+		QVector<quint64>& slot = wheel[(wheel_tick + i) % wheel.size()];
+		QVector<quint64> keep_id_list;
+
+		for (quint64 entry_id : slot) {
+			auto iter = entry_table.constFind(entry_id);
+
+			//claimed by a CREATE already
+			if (iter == entry_table.cend()) {
+				continue;
+			}
+
+			//current slot is only partly due
+			if (iter->deadline_msec > now_msec) {
+				keep_id_list.push_back(entry_id);
+				continue;
+			}
+
+			Take(entry_id, &entry);
+			out->push_back(entry);
+		}
+
+		slot.swap(keep_id_list);
+	}
+
+	wheel_tick = now_tick;
+}
+
+void
+PendingRemoveTable::TakeAll(QVector<PendingRemove>* out) {
+	TakeUnder(QString(), out);
+
+	for (QVector<quint64>& slot : wheel) {
+		slot.clear();
+	}
+}
+
+int
+PendingRemoveTable::NextExpireMsec(quint64 now_msec) const {
+	if (entry_table.empty()) {
+		return -1;
+	}
+
+	//live deadlines are all after the last sweep and within one revolution, first slot holding one has the earliest
+	for (int i = 0; i < wheel.size(); i++) {
+		const QVector<quint64>& slot = wheel[(wheel_tick + i) % wheel.size()];
+
+		quint64 next_deadline = 0;
+		bool found = false;
+
+		for (quint64 entry_id : slot) {
+			auto iter = entry_table.constFind(entry_id);
+			if (iter == entry_table.cend()) {
+				continue;
+			}
+
+			if (!found || iter->deadline_msec < next_deadline) {
+				next_deadline = iter->deadline_msec;
+				found = true;
+			}
+		}
+
+		if (found) {
+			return next_deadline <= now_msec ? 0 : (int) (next_deadline - now_msec);
+		}
+	}
+
+	return 0;
+}
+
+int
+PendingRemoveTable::GetSize() const {
+	return entry_table.size();
+}
+
+bool
+PendingRemoveTable::IsEmpty() const {
+	return entry_table.empty();
+}
+
+//private
+
+void
+PendingRemoveTable::Add(PendingRemove entry, const QString& long_name, quint64 now_msec) {
+
+	//nothing pending, wheel can start over from now
+	if (entry_table.empty()) {
+		wheel_tick = now_msec / slot_msec;
+	}
+
+	quint64 entry_id = next_entry_id++;
+	entry.deadline_msec = now_msec + window_msec;
+
+	//a second removal of the same path replaces the index entry, the older one still expires on its own
+	sub_path_name_table.insert(entry.sub_path_name, entry_id);
+
+	if (entry.dir_flag) {
+		dir_name_table.insert(long_name, entry_id);
+	}
+	else {
+		media_name_table.insert(long_name, entry_id);
+	}
+
+	wheel[(entry.deadline_msec / slot_msec) % wheel.size()].push_back(entry_id);
+	entry_table.insert(entry_id, std::move(entry));
+}
+
+void
+PendingRemoveTable::Take(quint64 entry_id, PendingRemove* out) {
+	auto iter = entry_table.find(entry_id);
+
+	*out = std::move(iter.value());
+	entry_table.erase(iter);
+
+	QString long_name = out->dir_flag ? out->sub_path_name.mid(out->sub_path_name.lastIndexOf('\\') + 1) : out->media.long_name;
+
+	if (out->dir_flag) {
+		dir_name_table.remove(long_name, entry_id);
+	}
+	else {
+		media_name_table.remove(long_name, entry_id);
+	}
+
+	auto path_iter = sub_path_name_table.find(out->sub_path_name);
+	if (path_iter != sub_path_name_table.end() && path_iter.value() == entry_id) {
+		sub_path_name_table.erase(path_iter);
+	}
+}
+
+bool
+PendingRemoveTable::TakeOldest(const QMultiHash<QString, quint64>& name_table, const QString& long_name, const MediaInfo* media, PendingRemove* out) {
+	quint64 found_id = 0;
+	bool found = false;
+
+	for (auto iter = name_table.constFind(long_name); iter != name_table.cend() && iter.key() == long_name; iter++) {
+		const PendingRemove& entry = *entry_table.constFind(iter.value());
+
+		if (media != nullptr && !media->SameContent(entry.media)) {
+			continue;
+		}
+
+		if (!found || iter.value() < found_id) {
+			found_id = iter.value();
+			found = true;
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	Take(found_id, out);
+	return true;
+}
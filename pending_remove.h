@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+	Removals waiting to be claimed by a CREATE
+
+	A move across dirs shows up as REMOVE followed by CREATE. Removed files and
+	dirs are parked here for a window instead of being deleted right away, so a
+	CREATE of the same name, size and content can be turned back into a move and
+	the media keeps its id and tags. Many moves can be in flight at once.
+
+	Media are matched by long name and content, see MediaInfo::SameContent.
+	Size and quick hash only narrow down the candidates, the created side
+	computes the full hash once name, size and quick hash all collide and
+	only a full hash match claims a removal. Dirs are matched by long name.
+
+	Expiry runs on a timer wheel of slot_msec slots covering twice the window,
+	entries taken by a match are dropped from their slot lazily when it comes
+	around. TakeExpired has to be called at least once per window while the
+	table is not empty so no deadline gets more than one revolution ahead.
+	Times are plain msec ticks supplied by caller.
+*/
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMultiHash>
+
+#include "media_structs.h"
+
+#define PENDING_REMOVE_WINDOW_MSEC	1000
+#define PENDING_REMOVE_SLOT_MSEC	50
+
+struct PendingRemove {
+	bool		dir_flag = false;
+	QString		sub_path_name;		//where the removed file or dir used to be
+	MediaInfo	media;				//removed media, unused for dirs
+	quint64		deadline_msec = 0;	//hard deleted if nothing claimed it by then
+};
+
+class PendingRemoveTable {
+public:
+
+	PendingRemoveTable(int window_msec = PENDING_REMOVE_WINDOW_MSEC, int slot_msec = PENDING_REMOVE_SLOT_MSEC);
+
+	//clears the table
+	void	SetWindow(int window_msec, int slot_msec = PENDING_REMOVE_SLOT_MSEC);
+
+	void	AddMedia(const MediaInfo& media, quint64 now_msec);
+	void	AddDir(const QString& sub_path_name, quint64 now_msec);
+
+	//size -1 and empty quick hash match anything
+	bool	MediaCandidateExist(const QString& long_name, qint64 size, const QString& quick_hash = QString()) const;
+	bool	DirCandidateExist(const QString& long_name) const;
+	bool	SubPathNameExist(const QString& sub_path_name) const;
+
+	//oldest entry matching, removed from table. media needs its full hash to match anything
+	bool	TakeMedia(const MediaInfo& media, PendingRemove* out);
+	bool	TakeDir(const QString& long_name, PendingRemove* out);
+	bool	TakeBySubPathName(const QString& sub_path_name, PendingRemove* out);
+
+	//entries at or under sub path, everything if sub path is empty
+	void	TakeUnder(const QString& sub_path, QVector<PendingRemove>* out);
+
+	void	TakeExpired(quint64 now_msec, QVector<PendingRemove>* out);
+	void	TakeAll(QVector<PendingRemove>* out);
+
+	//msec until the next entry expires, -1 if table is empty
+	int		NextExpireMsec(quint64 now_msec) const;
+
+	int		GetSize() const;
+	bool	IsEmpty() const;
+
+private:
+
+	int										window_msec;
+	int										slot_msec;
+
+	QHash<quint64, PendingRemove>			entry_table;			//entry id -> removal, ids increase with time
+	QMultiHash<QString, quint64>			media_name_table;		//long name -> entry id
+	QMultiHash<QString, quint64>			dir_name_table;			//long name -> entry id
+	QHash<QString, quint64>					sub_path_name_table;	//sub path name -> entry id
+
+	QVector<QVector<quint64>>				wheel;					//entry ids by deadline slot
+	quint64									wheel_tick;				//slot swept last, in slot_msec units
+	quint64									next_entry_id;
+
+	void	Add(PendingRemove entry, const QString& long_name, quint64 now_msec);
+	void	Take(quint64 entry_id, PendingRemove* out);
+	bool	TakeOldest(const QMultiHash<QString, quint64>& name_table, const QString& long_name, const MediaInfo* media, PendingRemove* out);
+};
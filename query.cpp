@@ -18,7 +18,7 @@ Query::~Query()
 
 //tokenize() can detect mismatching number of parenthesis
 int
-Query::Tokenize(std::function< int(const QString& tag_name, QSet<unsigned int>* out) > get_tag_media_list_handler) {
+Query::Tokenize(QueryTagHandler get_tag_media_list_handler, QueryDirHandler get_dir_media_list_handler /* = nullptr */) {
 	token_vec.clear();
 
 	QChar curr_char;
@@ -27,6 +27,7 @@ Query::Tokenize(std::function< int(const QString& tag_name, QSet<unsigned int>*
 	QStack<int> open_paren_stack;
 
 	bool quote_override_mode = false;
+	bool quoted_prefix = false;		//operand started inside quotes, never a dir: operand
 
 	for (int i = 0; i < raw_str.size(); i++) {
 
@@ -40,6 +41,10 @@ Query::Tokenize(std::function< int(const QString& tag_name, QSet<unsigned int>*
 		}
 
 		if (quote_override_mode) {
+			if (tag_name_buff.isEmpty()) {
+				quoted_prefix = true;
+			}
+
 			tag_name_buff.push_back(curr_char);
 			continue;
 		}
@@ -52,18 +57,12 @@ Query::Tokenize(std::function< int(const QString& tag_name, QSet<unsigned int>*
 		if (curr_char == '+' || curr_char == '*' || curr_char == '-' || curr_char == '(' || curr_char == ')') {
 			if (tag_name_buff.size() > 0) {
 
-				token_buff = std::make_shared<ASTNode>();
-
-				token_buff->type = TAG;
-				//token_buff->tag_name = tag_name_buff;
-
-				if (get_tag_media_list_handler(tag_name_buff, &(token_buff->result)) < 0) {
+				if (AddOperandToken(tag_name_buff, quoted_prefix, get_tag_media_list_handler, get_dir_media_list_handler) < 0) {
 					return -1;
 				}
 
-				token_vec.push_back(token_buff);
-				//tag_name_to_tag_media_id_map.insert(tag_name_buff, QSet<unsigned int>());
 				tag_name_buff.clear();
+				quoted_prefix = false;
 			}
 
 			token_buff = std::make_shared<ASTNode>();
@@ -102,17 +101,9 @@ Query::Tokenize(std::function< int(const QString& tag_name, QSet<unsigned int>*
 
 	if (tag_name_buff.size() > 0) {
 
-		token_buff = std::make_shared<ASTNode>();
-
-		token_buff->type = TAG;
-		//token_buff->tag_name = tag_name_buff;
-
-		if (get_tag_media_list_handler(tag_name_buff, &(token_buff->result)) < 0) {
+		if (AddOperandToken(tag_name_buff, quoted_prefix, get_tag_media_list_handler, get_dir_media_list_handler) < 0) {
 			return -1;
 		}
-
-		token_vec.push_back(token_buff);
-		//tag_name_to_tag_media_id_map.insert(tag_name_buff, QSet<unsigned int>());
 	}
 
 	if (!open_paren_stack.isEmpty()) {
@@ -159,6 +150,39 @@ Query::InsertTagMediaIds(const QString& tag_name, const QSet<unsigned int>& medi
 
 //private
 
+//a tag name or a dir: / indir: operand, its media id set is filled in right away
+int
+Query::AddOperandToken(const QString& operand, bool quoted_prefix, const QueryTagHandler& get_tag_media_list_handler, const QueryDirHandler& get_dir_media_list_handler) {
+
+	std::shared_ptr<ASTNode> token_buff = std::make_shared<ASTNode>();
+
+	bool recursive = operand.startsWith(QUERY_DIR_PREFIX);
+	if (!quoted_prefix && (recursive || operand.startsWith(QUERY_INDIR_PREFIX))) {
+
+		if (!get_dir_media_list_handler) {
+			return -1;
+		}
+
+		token_buff->type = DIRECTORY;
+
+		QString sub_path = operand.mid(recursive ? sizeof(QUERY_DIR_PREFIX) - 1 : sizeof(QUERY_INDIR_PREFIX) - 1);
+		if (get_dir_media_list_handler(sub_path, recursive, &(token_buff->result)) < 0) {
+			return -1;
+		}
+	}
+	else {
+
+		token_buff->type = TAG;
+
+		if (get_tag_media_list_handler(operand, &(token_buff->result)) < 0) {
+			return -1;
+		}
+	}
+
+	token_vec.push_back(token_buff);
+	return 1;
+}
+
 int
 Query::ProcessASTRecur(std::shared_ptr<ASTNode>& node) {
 	if (node->left != nullptr) {
@@ -173,6 +197,7 @@ Query::ProcessASTRecur(std::shared_ptr<ASTNode>& node) {
 	
 	switch (node->type) {
 	case TAG:
+	case DIRECTORY:
 		//do nothing
 		return 1;
 	case UNION:
@@ -224,7 +249,7 @@ Query::GenerateASTRecur(int begin, int end, std::shared_ptr<ASTNode>* out_node)
 			continue;
 		}
 
-		if (curr_node->type == TAG) {
+		if (curr_node->type == TAG || curr_node->type == DIRECTORY) {
 
 			if (local_root == nullptr) {
 				local_root = curr_node;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <functional>
 
 #include <QString>
 #include <QSet>
@@ -15,10 +16,19 @@
 	- Supports quotation to denote tagnames containing reserved syntax
 	- Default order of operation left to right
 	- All operators have the same precedence
+	- dir:<sub path> is every media under a directory, indir:<sub path> only the ones directly in it
+	  ex. dir:"\photos\2020" * cat. a quoted "dir:..." is still a tag name
 */
 
+#define QUERY_DIR_PREFIX		"dir:"
+#define QUERY_INDIR_PREFIX		"indir:"
+
+typedef std::function< int(const QString& tag_name, QSet<unsigned int>* out) >						QueryTagHandler;
+typedef std::function< int(const QString& sub_path, bool recursive, QSet<unsigned int>* out) >	QueryDirHandler;
+
 enum NodeType {
 	TAG,
+	DIRECTORY,
 	UNION,
 	INTERSECT,
 	DIFF,
@@ -53,7 +63,7 @@ public:
 	explicit Query(const QString&);
 	~Query();
 
-	int Tokenize( std::function< int(const QString& tag_name, QSet<unsigned int>* out) > get_tag_media_list_handler );
+	int Tokenize(QueryTagHandler get_tag_media_list_handler, QueryDirHandler get_dir_media_list_handler = nullptr);
 	int	GenerateAST();
 	int ProcessAST();
 
@@ -62,6 +72,7 @@ public:
 
 private:
 
+	int AddOperandToken(const QString& operand, bool quoted_prefix, const QueryTagHandler& get_tag_media_list_handler, const QueryDirHandler& get_dir_media_list_handler);
 	int ProcessASTRecur(std::shared_ptr<ASTNode>&);
 	int GenerateASTRecur(int begin, int end, std::shared_ptr<ASTNode>*);
 };
@@ -0,0 +1,236 @@
+#include "shared_index.h"
+#include "query.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+	inline quint64
+	NameBlockBytes(quint64 name_unit_count) {
+		return (name_unit_count * sizeof(ushort) + 3) & ~quint64(3);
+	}
+}
+
+//static
+QByteArray
+SharedIndex::Serialize(quint64 generation, const QVector<Tag>& tag_list) {
+
+	QVector<const Tag*> sorted_tag_list;
+	sorted_tag_list.reserve(tag_list.size());
+
+	quint64 name_unit_count = 0;
+	quint64 posting_count = 0;
+
+	for (const Tag& tag : tag_list) {
+		sorted_tag_list.push_back(&tag);
+		name_unit_count += tag.name.size();
+		posting_count += tag.media_id_list.size();
+	}
+
+	std::sort(sorted_tag_list.begin(), sorted_tag_list.end(), [](const Tag* left, const Tag* right) {
+		return left->name < right->name;
+	});
+
+	quint64 tag_bytes = (quint64) sorted_tag_list.size() * sizeof(SharedIndexTag);
+	quint64 total_size = sizeof(SharedIndexHeader) + tag_bytes + NameBlockBytes(name_unit_count) + posting_count * sizeof(quint32);
+
+	QByteArray snapshot(total_size, '\0');
+
+	SharedIndexHeader* header = reinterpret_cast<SharedIndexHeader*>(snapshot.data());
+	header->magic = SHARED_INDEX_MAGIC;
+	header->format_version = SHARED_INDEX_FORMAT_VERSION;
+	header->generation = generation;
+	header->tag_count = sorted_tag_list.size();
+	header->name_unit_count = name_unit_count;
+	header->posting_count = posting_count;
+	header->total_size = total_size;
+
+	SharedIndexTag* tag_arr = reinterpret_cast<SharedIndexTag*>(header + 1);
+	ushort* name_arr = reinterpret_cast<ushort*>(reinterpret_cast<char*>(tag_arr) + tag_bytes);
+	quint32* posting_arr = reinterpret_cast<quint32*>(reinterpret_cast<char*>(name_arr) + NameBlockBytes(name_unit_count));
+
+	quint32 name_pos = 0;
+	quint32 posting_pos = 0;
+
+	for (int i = 0; i < sorted_tag_list.size(); i++) {
+		const Tag& tag = *sorted_tag_list[i];
+
+		tag_arr[i].id = tag.id;
+		tag_arr[i].name_begin = name_pos;
+		tag_arr[i].name_length = tag.name.size();
+		tag_arr[i].posting_begin = posting_pos;
+		tag_arr[i].posting_count = tag.media_id_list.size();
+
+		std::memcpy(name_arr + name_pos, tag.name.utf16(), tag.name.size() * sizeof(ushort));
+		name_pos += tag.name.size();
+
+		quint32* posting_begin = posting_arr + posting_pos;
+		for (unsigned int media_id : tag.media_id_list) {
+			posting_arr[posting_pos++] = media_id;
+		}
+		std::sort(posting_begin, posting_arr + posting_pos);
+	}
+
+	return snapshot;
+}
+
+//SharedIndexView
+
+bool
+SharedIndexView::Open(const char* data, qint64 size) {
+	Close();
+
+	if (data == nullptr || size < (qint64) sizeof(SharedIndexHeader)) {
+		return false;
+	}
+
+	const SharedIndexHeader* new_header = reinterpret_cast<const SharedIndexHeader*>(data);
+	if (new_header->magic != SHARED_INDEX_MAGIC || new_header->format_version != SHARED_INDEX_FORMAT_VERSION) {
+		return false;
+	}
+
+	quint64 tag_bytes = (quint64) new_header->tag_count * sizeof(SharedIndexTag);
+	quint64 name_bytes = NameBlockBytes(new_header->name_unit_count);
+	quint64 expected_size = sizeof(SharedIndexHeader) + tag_bytes + name_bytes + (quint64) new_header->posting_count * sizeof(quint32);
+
+	//segments can be bigger than asked for, never smaller
+	if (new_header->total_size != expected_size || expected_size > (quint64) size) {
+		return false;
+	}
+
+	const SharedIndexTag* new_tag_arr = reinterpret_cast<const SharedIndexTag*>(new_header + 1);
+
+	for (quint32 i = 0; i < new_header->tag_count; i++) {
+		const SharedIndexTag& tag = new_tag_arr[i];
+
+		if ((quint64) tag.name_begin + tag.name_length > new_header->name_unit_count) {
+			return false;
+		}
+
+		if ((quint64) tag.posting_begin + tag.posting_count > new_header->posting_count) {
+			return false;
+		}
+	}
+
+	header = new_header;
+	tag_arr = new_tag_arr;
+	name_arr = reinterpret_cast<const ushort*>(data + sizeof(SharedIndexHeader) + tag_bytes);
+	posting_arr = reinterpret_cast<const quint32*>(data + sizeof(SharedIndexHeader) + tag_bytes + name_bytes);
+
+	return true;
+}
+
+void
+SharedIndexView::Close() {
+	header = nullptr;
+	tag_arr = nullptr;
+	name_arr = nullptr;
+	posting_arr = nullptr;
+}
+
+bool
+SharedIndexView::IsOpen() const {
+	return header != nullptr;
+}
+
+quint64
+SharedIndexView::GetGeneration() const {
+	return IsOpen() ? header->generation : 0;
+}
+
+int
+SharedIndexView::GetTagCount() const {
+	return IsOpen() ? header->tag_count : 0;
+}
+
+void
+SharedIndexView::GetTagList(QVector<ModelTag>* out) const {
+	out->clear();
+	out->reserve(GetTagCount());
+
+	//names are copied out, they have to outlive the snapshot
+	for (int i = 0; i < GetTagCount(); i++) {
+		const SharedIndexTag& tag = tag_arr[i];
+		out->push_back({ tag.id, QString(reinterpret_cast<const QChar*>(name_arr + tag.name_begin), tag.name_length), tag.posting_count });
+	}
+}
+
+int
+SharedIndexView::GetTagMediaIdList(const QString& tag_name, QVector<unsigned int>* out) const {
+	int tag_idx = FindTag(tag_name);
+	if (tag_idx < 0) {
+		return -1;
+	}
+
+	const SharedIndexTag& tag = tag_arr[tag_idx];
+
+	out->resize(tag.posting_count);
+	std::copy(posting_arr + tag.posting_begin, posting_arr + tag.posting_begin + tag.posting_count, out->begin());
+
+	return 1;
+}
+
+int
+SharedIndexView::GetTagMediaIdSet(const QString& tag_name, QSet<unsigned int>* out) const {
+	int tag_idx = FindTag(tag_name);
+	if (tag_idx < 0) {
+		return -1;
+	}
+
+	const SharedIndexTag& tag = tag_arr[tag_idx];
+
+	out->clear();
+	out->reserve(tag.posting_count);
+	for (quint32 i = 0; i < tag.posting_count; i++) {
+		out->insert(posting_arr[tag.posting_begin + i]);
+	}
+
+	return 1;
+}
+
+int
+SharedIndexView::RunQuery(const QString& raw_query_str, QSet<unsigned int>* out) const {
+	if (!IsOpen()) {
+		return -1;
+	}
+
+	Query query(raw_query_str);
+
+	auto get_tag_media_list_handler = [this](const QString& tag_name, QSet<unsigned int>* tag_out) {
+		return GetTagMediaIdSet(tag_name, tag_out);
+	};
+
+	if (query.Tokenize(get_tag_media_list_handler) < 0 || query.GenerateAST() < 0 || query.ProcessAST() < 0) {
+		return -1;
+	}
+
+	*out = std::move(query.result);
+	return 1;
+}
+
+//private
+
+int
+SharedIndexView::FindTag(const QString& tag_name) const {
+	if (!IsOpen()) {
+		return -1;
+	}
+
+	const SharedIndexTag* tag_end = tag_arr + header->tag_count;
+
+	const SharedIndexTag* iter = std::lower_bound(tag_arr, tag_end, tag_name, [this](const SharedIndexTag& tag, const QString& name) {
+		return GetTagName(tag) < name;
+	});
+
+	if (iter == tag_end || GetTagName(*iter) != tag_name) {
+		return -1;
+	}
+
+	return iter - tag_arr;
+}
+
+QString
+SharedIndexView::GetTagName(const SharedIndexTag& tag) const {
+	return QString::fromRawData(reinterpret_cast<const QChar*>(name_arr + tag.name_begin), tag.name_length);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QSet>
+#include <QByteArray>
+
+#include "tag_structs.h"
+
+/*
+	Read only snapshot of every tag and the media ids linked to it, laid out to be read in place
+
+	The api server publishes one into shared memory after the daemon changes tags or links,
+	so local tools can look tags up and run queries without going through the pipe. See
+	shared_index_segment.h for how snapshots are published and picked up.
+
+	A snapshot is never written again once published, a newer one replaces it. Layout, all
+	integers native byte order since it never leaves the host:
+
+		SharedIndexHeader
+		SharedIndexTag		[tag_count]			sorted by name, utf16 code unit order
+		utf16 names			[name_unit_count]	padded to 4 bytes
+		media ids			[posting_count]		each tag's ids sorted ascending
+*/
+
+#define SHARED_INDEX_KEY				"TAGSEARCH_INDEX"
+#define SHARED_INDEX_MAGIC				0x49534654			//"TFSI"
+#define SHARED_INDEX_FORMAT_VERSION		1
+
+struct SharedIndexHeader {
+	quint32		magic;
+	quint32		format_version;
+	quint64		generation;			//daemon generation the snapshot was taken at
+	quint32		tag_count;
+	quint32		name_unit_count;
+	quint32		posting_count;
+	quint32		reserved;
+	quint64		total_size;			//bytes, header included
+};
+
+struct SharedIndexTag {
+	quint32		id;
+	quint32		name_begin;			//index into names
+	quint32		name_length;		//utf16 code units
+	quint32		posting_begin;		//index into media ids
+	quint32		posting_count;
+};
+
+static_assert(sizeof(SharedIndexHeader) == 40, "shared index header layout changed");
+static_assert(sizeof(SharedIndexTag) == 20, "shared index tag layout changed");
+
+namespace SharedIndex {
+
+	QByteArray	Serialize(quint64 generation, const QVector<Tag>& tag_list);
+}
+
+/*
+	Reads a snapshot in place, nothing is copied. The memory has to stay put and unchanged
+	for as long as the view is used.
+*/
+class SharedIndexView {
+public:
+
+	//false if data is not a whole snapshot of this format, every offset in it is checked
+	bool	Open(const char* data, qint64 size);
+	void	Close();
+	bool	IsOpen() const;
+
+	quint64	GetGeneration() const;
+	int		GetTagCount() const;
+
+	void	GetTagList(QVector<ModelTag>* out) const;
+
+	//-1 if there's no such tag
+	int		GetTagMediaIdList(const QString& tag_name, QVector<unsigned int>* out) const;	//sorted
+	int		GetTagMediaIdSet(const QString& tag_name, QSet<unsigned int>* out) const;
+
+	//same query language the daemon runs, dir: terms are not in the snapshot and fail the query
+	int		RunQuery(const QString& raw_query_str, QSet<unsigned int>* out) const;
+
+private:
+	const SharedIndexHeader*	header = nullptr;
+	const SharedIndexTag*		tag_arr = nullptr;
+	const ushort*				name_arr = nullptr;
+	const quint32*				posting_arr = nullptr;
+
+	int		FindTag(const QString& tag_name) const;		//index into tag_arr, -1 if none
+	QString	GetTagName(const SharedIndexTag& tag) const;	//points into the snapshot, no copy
+};
@@ -0,0 +1,155 @@
+#include "shared_index_segment.h"
+
+#include <QCoreApplication>
+#include <QStringBuilder>
+
+#include <cstring>
+
+SharedIndexPublisher::SharedIndexPublisher(const QString& key /*= SHARED_INDEX_KEY*/) :
+	key(key),
+	head_memory(key),
+	sequence(0),
+	published_generation(0)
+{
+}
+
+int
+SharedIndexPublisher::Publish(const QByteArray& snapshot, quint64 generation) {
+	if (InitHead() < 0) {
+		return -1;
+	}
+
+	QString data_key = key % '.' % QString::number(QCoreApplication::applicationPid()) % '.' % QString::number(sequence + 1);
+
+	std::unique_ptr<QSharedMemory> new_data_memory = std::make_unique<QSharedMemory>(data_key);
+	if (!new_data_memory->create(snapshot.size())) {
+		last_error = new_data_memory->errorString();
+		return -1;
+	}
+
+	//nobody knows the key yet, no need to lock
+	std::memcpy(new_data_memory->data(), snapshot.constData(), snapshot.size());
+
+	SharedIndexHead head = {};
+	head.magic = SHARED_INDEX_MAGIC;
+	head.format_version = SHARED_INDEX_FORMAT_VERSION;
+	head.sequence = sequence + 1;
+	head.generation = generation;
+
+	QByteArray data_key_bytes = data_key.toLatin1();
+	std::memcpy(head.data_key, data_key_bytes.constData(), qMin<int>(data_key_bytes.size(), sizeof(head.data_key) - 1));
+
+	head_memory.lock();
+	std::memcpy(head_memory.data(), &head, sizeof(head));
+	head_memory.unlock();
+
+	//clients still attached to the old one keep it alive
+	data_memory = std::move(new_data_memory);
+	sequence++;
+	published_generation = generation;
+
+	return 1;
+}
+
+quint64
+SharedIndexPublisher::GetPublishedGeneration() const {
+	return published_generation;
+}
+
+QString
+SharedIndexPublisher::GetLastError() const {
+	return last_error;
+}
+
+//private
+
+int
+SharedIndexPublisher::InitHead() {
+	if (head_memory.isAttached()) {
+		return 1;
+	}
+
+	if (head_memory.create(sizeof(SharedIndexHead))) {
+		head_memory.lock();
+		std::memset(head_memory.data(), 0, sizeof(SharedIndexHead));
+		head_memory.unlock();
+		return 1;
+	}
+
+	//left behind by a previous run or kept alive by its clients, taken over
+	if (head_memory.error() == QSharedMemory::AlreadyExists && head_memory.attach()) {
+		SharedIndexHead head;
+
+		head_memory.lock();
+		std::memcpy(&head, head_memory.constData(), sizeof(head));
+		head_memory.unlock();
+
+		//clients compare sequences only, starting over at 1 would look like nothing changed to them
+		if (head.magic == SHARED_INDEX_MAGIC && head.format_version == SHARED_INDEX_FORMAT_VERSION) {
+			sequence = head.sequence;
+		}
+
+		return 1;
+	}
+
+	last_error = head_memory.errorString();
+	return -1;
+}
+
+//SharedIndexClient
+
+SharedIndexClient::SharedIndexClient(const QString& key /*= SHARED_INDEX_KEY*/) :
+	head_memory(key),
+	sequence(0)
+{
+}
+
+int
+SharedIndexClient::Refresh() {
+	if (!head_memory.isAttached() && !head_memory.attach(QSharedMemory::ReadOnly)) {
+		return -1;
+	}
+
+	for (int i = 0; i < SHARED_INDEX_ATTACH_RETRY; i++) {
+		SharedIndexHead head;
+
+		head_memory.lock();
+		std::memcpy(&head, head_memory.constData(), sizeof(head));
+		head_memory.unlock();
+
+		if (head.magic != SHARED_INDEX_MAGIC || head.format_version != SHARED_INDEX_FORMAT_VERSION || head.sequence == 0) {
+			return -1;
+		}
+
+		if (head.sequence == sequence && view.IsOpen()) {
+			return 1;
+		}
+
+		head.data_key[sizeof(head.data_key) - 1] = '\0';
+
+		std::unique_ptr<QSharedMemory> new_data_memory = std::make_unique<QSharedMemory>(QString::fromLatin1(head.data_key));
+
+		//swapped and dropped since the head was read
+		if (!new_data_memory->attach(QSharedMemory::ReadOnly)) {
+			continue;
+		}
+
+		SharedIndexView new_view;
+		if (!new_view.Open(static_cast<const char*>(new_data_memory->constData()), new_data_memory->size())) {
+			return -1;
+		}
+
+		view = new_view;
+		data_memory = std::move(new_data_memory);
+		sequence = head.sequence;
+
+		return 1;
+	}
+
+	return -1;
+}
+
+const SharedIndexView&
+SharedIndexClient::GetView() const {
+	return view;
+}
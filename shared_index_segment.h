@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QSharedMemory>
+#include <QString>
+#include <QByteArray>
+
+#include <memory>
+
+#include "shared_index.h"
+
+/*
+	Publishing shared index snapshots and picking them up from another process
+
+	Every snapshot gets a shared memory segment of its own that is never written
+	again. A small head segment under SHARED_INDEX_KEY names the current one, the
+	publisher swaps that name under the head's lock once the new segment is filled
+	in, so a client sees either the old snapshot or the new one whole.
+
+	The publisher lets go of the old segment right after the swap. A segment lives
+	on while anyone is attached to it, so a client keeps reading the snapshot it has
+	until it refreshes. A client that read the head just before a swap may find the
+	segment it names gone already, it reads the head again.
+
+	Usage from a local tool:
+
+		SharedIndexClient client;
+		if (client.Refresh() > 0) {
+			QSet<unsigned int> media_id_set;
+			client.GetView().RunQuery("cat * (dog + bird)", &media_id_set);
+		}
+
+	Refresh is cheap when nothing was published since, call it before every read that
+	should see the latest state.
+*/
+
+#define SHARED_INDEX_ATTACH_RETRY		4
+
+struct SharedIndexHead {
+	quint32		magic;
+	quint32		format_version;
+	quint64		sequence;			//goes up by one per publish and carries on across daemon restarts, 0 until the first one
+	quint64		generation;			//of the current snapshot
+	char		data_key[64];		//latin1, 0 terminated
+};
+
+class SharedIndexPublisher {
+public:
+	explicit SharedIndexPublisher(const QString& key = SHARED_INDEX_KEY);
+
+	SharedIndexPublisher(const SharedIndexPublisher&) = delete;
+	SharedIndexPublisher& operator=(const SharedIndexPublisher&) = delete;
+
+	int		Publish(const QByteArray& snapshot, quint64 generation);
+	quint64	GetPublishedGeneration() const;		//0 before the first publish
+	QString	GetLastError() const;				//why the last failed publish failed
+
+private:
+	QString							key;
+	QSharedMemory					head_memory;
+	std::unique_ptr<QSharedMemory>	data_memory;		//current snapshot
+	quint64							sequence;
+	quint64							published_generation;
+	QString							last_error;
+
+	int		InitHead();
+};
+
+class SharedIndexClient {
+public:
+	explicit SharedIndexClient(const QString& key = SHARED_INDEX_KEY);
+
+	SharedIndexClient(const SharedIndexClient&) = delete;
+	SharedIndexClient& operator=(const SharedIndexClient&) = delete;
+
+	//moves to the latest snapshot if a newer one was published. -1 if there is none to read,
+	//the view then stays on whatever snapshot it had
+	int						Refresh();
+
+	const SharedIndexView&	GetView() const;
+
+private:
+	QSharedMemory					head_memory;
+	std::unique_ptr<QSharedMemory>	data_memory;
+	quint64							sequence;
+	SharedIndexView					view;
+};
@@ -0,0 +1,103 @@
+#include "stats.h"
+#include "metrics.h"
+
+#include <QJsonArray>
+
+namespace {
+
+	QJsonObject
+	HistogramToJson(const Metrics::HistogramSnapshot& snapshot) {
+		QJsonObject result;
+		result.insert("count", (double) snapshot.count);
+		result.insert("sum", (double) snapshot.sum);
+		result.insert("max", (double) snapshot.max);
+		result.insert("p50", (double) snapshot.Percentile(0.5));
+		result.insert("p90", (double) snapshot.Percentile(0.9));
+		result.insert("p99", (double) snapshot.Percentile(0.99));
+
+		//trailing empty buckets left out
+		int bucket_count = Metrics::HISTOGRAM_BUCKET_COUNT;
+		while (bucket_count > 0 && snapshot.bucket_arr[bucket_count - 1] == 0) {
+			bucket_count--;
+		}
+
+		QJsonArray bucket_array;
+		for (int i = 0; i < bucket_count; i++) {
+			bucket_array.append((double) snapshot.bucket_arr[i]);
+		}
+		result.insert("buckets", bucket_array);
+
+		return result;
+	}
+}
+
+QJsonObject
+Stats::Collect(Daemon* daemon) {
+	QJsonObject result;
+
+	DaemonStats daemon_stats;
+	daemon->GetStats(&daemon_stats);
+
+	result.insert("counts", QJsonObject {
+		{ "tags", (double) daemon_stats.tag_count },
+		{ "media", (double) daemon_stats.media_count },
+		{ "links", (double) daemon_stats.link_count },
+		{ "dirs", (double) daemon_stats.dir_count }
+	});
+
+	result.insert("memory", QJsonObject {
+		{ "tag_list", (double) daemon_stats.tag_list_bytes },
+		{ "media_list", (double) daemon_stats.media_list_bytes },
+		{ "file_tracker", (double) daemon_stats.file_tracker_bytes }
+	});
+
+	QJsonObject counter_object;
+	for (int i = 0; i < Metrics::COUNTER_COUNT; i++) {
+		Metrics::Counter counter = static_cast<Metrics::Counter>(i);
+		counter_object.insert(Metrics::GetName(counter), (double) Metrics::Get(counter));
+	}
+	result.insert("counters", counter_object);
+
+	QJsonObject gauge_object;
+	for (int i = 0; i < Metrics::GAUGE_COUNT; i++) {
+		Metrics::Gauge gauge = static_cast<Metrics::Gauge>(i);
+		gauge_object.insert(Metrics::GetName(gauge), (double) Metrics::Get(gauge));
+	}
+	result.insert("gauges", gauge_object);
+
+	QJsonObject histogram_object;
+	for (int i = 0; i < Metrics::HISTOGRAM_COUNT; i++) {
+		Metrics::Histogram histogram = static_cast<Metrics::Histogram>(i);
+		histogram_object.insert(Metrics::GetName(histogram), HistogramToJson(Metrics::Get(histogram)));
+	}
+	result.insert("histograms", histogram_object);
+
+	double hit_count = counter_object.value(Metrics::GetName(Metrics::THUMBNAIL_CACHE_HIT_TOTAL)).toDouble();
+	double miss_count = counter_object.value(Metrics::GetName(Metrics::THUMBNAIL_CACHE_MISS_TOTAL)).toDouble();
+	double hash_bytes = counter_object.value(Metrics::GetName(Metrics::HASH_BYTES_TOTAL)).toDouble();
+	double hash_busy_usec = counter_object.value(Metrics::GetName(Metrics::HASH_BUSY_USEC_TOTAL)).toDouble();
+
+	result.insert("ratios", QJsonObject {
+		{ "thumbnail.cache.hit", hit_count + miss_count > 0 ? hit_count / (hit_count + miss_count) : 0 },
+		{ "hash.bytes.per.sec", hash_busy_usec > 0 ? hash_bytes * 1000000 / hash_busy_usec : 0 }
+	});
+
+	QJsonArray thread_array;
+	for (const Metrics::ThreadSnapshot& snapshot : Metrics::GetThreadList()) {
+		QJsonObject thread_counter_object;
+		for (int i = 0; i < Metrics::COUNTER_COUNT; i++) {
+			if (snapshot.counter_arr[i] != 0) {
+				thread_counter_object.insert(Metrics::GetName(static_cast<Metrics::Counter>(i)), (double) snapshot.counter_arr[i]);
+			}
+		}
+
+		thread_array.append(QJsonObject {
+			{ "name", QString::fromStdString(snapshot.name) },
+			{ "records", (double) snapshot.record_count },
+			{ "counters", thread_counter_object }
+		});
+	}
+	result.insert("threads", thread_array);
+
+	return result;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QJsonObject>
+
+#include "daemon.h"
+
+/*
+	Everything daemon and metrics can tell about the running process, as one JSON object
+
+	{
+		counts: { tags, media, links, dirs },
+		memory: { tag_list, media_list, file_tracker },		//rough bytes
+		counters: { <name>: <n> },
+		gauges: { <name>: <n> },
+		histograms: { <name>: { count, sum, max, p50, p90, p99, buckets: [] } },	//usec, bucket i counts values below 2^i
+		ratios: { thumbnail.cache.hit, hash.bytes.per.sec },	//hash rate is per busy worker
+		threads: [ { name, records, counters: { <name>: <n> } } ]	//counters that are not 0 only
+	}
+
+	Served by the STATS api command and shown by the stats panel. Walks daemon
+	structures under read locks, fine to poll every second or so, not in a loop.
+*/
+
+namespace Stats {
+
+	QJsonObject	Collect(Daemon* daemon);
+}
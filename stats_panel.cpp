@@ -0,0 +1,173 @@
+#include "stats_panel.h"
+#include "stats.h"
+
+#include <QVBoxLayout>
+#include <QHeaderView>
+#include <QJsonArray>
+#include <QLocale>
+#include <QStringBuilder>
+#include <QtConcurrent/qtconcurrentrun.h>
+
+StatsPanel::StatsPanel(QWidget* parent) :
+	QWidget(parent)
+{
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->addWidget(&tree_widget);
+
+	tree_widget.setColumnCount(3);
+	tree_widget.setHeaderLabels({ "Name", "Value", "Per sec" });
+	tree_widget.header()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+
+	refresh_timer.setInterval(STATS_PANEL_REFRESH_MSEC);
+
+	connect(&refresh_timer, &QTimer::timeout, this, &StatsPanel::OnRefreshTimerTimeout);
+	connect(&collect_future_watcher, &QFutureWatcher<QJsonObject>::finished, this, &StatsPanel::OnCollectFinished);
+}
+
+StatsPanel::~StatsPanel() {
+	refresh_timer.stop();
+	collect_future_watcher.waitForFinished();
+}
+
+void
+StatsPanel::SetDaemon(Daemon* daemon) {
+	this->daemon = daemon;
+	refresh_timer.start();
+}
+
+//private slots
+
+void
+StatsPanel::OnRefreshTimerTimeout() {
+
+	//nobody is looking or the last one is still going
+	if (!isVisible() || collect_future_watcher.isRunning()) {
+		return;
+	}
+
+	collect_future_watcher.setFuture(QtConcurrent::run(&Stats::Collect, daemon));
+}
+
+void
+StatsPanel::OnCollectFinished() {
+	QJsonObject stats = collect_future_watcher.result();
+
+	double elapsed_sec = 0;
+	if (collect_elapsed_timer.isValid()) {
+		elapsed_sec = collect_elapsed_timer.restart() / 1000.0;
+	}
+	else {
+		collect_elapsed_timer.start();
+	}
+
+	for (auto iter = stats.constBegin(); iter != stats.constEnd(); iter++) {
+		UpdateItem(nullptr, iter.key(), iter.key(), iter.value(), elapsed_sec);
+	}
+}
+
+//private
+
+void
+StatsPanel::UpdateItem(QTreeWidgetItem* parent, const QString& path, const QString& name, const QJsonValue& value, double elapsed_sec) {
+
+	if (value.isObject()) {
+		QTreeWidgetItem* item = GetItem(parent, path, name);
+		QJsonObject object = value.toObject();
+
+		for (auto iter = object.constBegin(); iter != object.constEnd(); iter++) {
+			UpdateItem(item, path % '/' % iter.key(), iter.key(), iter.value(), elapsed_sec);
+		}
+		return;
+	}
+
+	if (value.isArray()) {
+		QJsonArray array = value.toArray();
+
+		//plain numbers like histogram buckets fit on one line
+		if (array.isEmpty() || !array.first().isObject()) {
+			QStringList text_list;
+			for (const QJsonValue& element : array) {
+				text_list.append(QString::number(element.toDouble(), 'f', 0));
+			}
+
+			GetItem(parent, path, name)->setText(1, text_list.join(' '));
+			return;
+		}
+
+		QTreeWidgetItem* item = GetItem(parent, path, name);
+		for (int i = 0; i < array.size(); i++) {
+			QJsonObject element = array.at(i).toObject();
+
+			QString element_name = element.value("name").toString();
+			if (element_name.isEmpty()) {
+				element_name = "unnamed";
+			}
+
+			UpdateItem(item, path % '/' % QString::number(i), element_name % " #" % QString::number(i), element, elapsed_sec);
+		}
+		return;
+	}
+
+	QTreeWidgetItem* item = GetItem(parent, path, name);
+
+	if (!value.isDouble()) {
+		item->setText(1, value.toVariant().toString());
+		return;
+	}
+
+	double number = value.toDouble();
+	item->setText(1, FormatValue(path, number));
+
+	if (IsRateShown(name)) {
+		auto last_iter = path_to_last_value_table.find(path);
+		if (last_iter != path_to_last_value_table.end() && elapsed_sec > 0) {
+			item->setText(2, FormatValue(path, (number - last_iter.value()) / elapsed_sec));
+		}
+
+		path_to_last_value_table.insert(path, number);
+	}
+}
+
+QTreeWidgetItem*
+StatsPanel::GetItem(QTreeWidgetItem* parent, const QString& path, const QString& name) {
+	QTreeWidgetItem*& item = path_to_item_table[path];
+
+	if (item == nullptr) {
+		if (parent == nullptr) {
+			item = new QTreeWidgetItem(&tree_widget);
+			item->setExpanded(true);
+		}
+		else {
+			item = new QTreeWidgetItem(parent);
+		}
+	}
+
+	item->setText(0, name);
+	return item;
+}
+
+//static
+bool
+StatsPanel::IsRateShown(const QString& name) {
+	return name.endsWith(".total") || name == "count" || name == "records";
+}
+
+//static
+QString
+StatsPanel::FormatValue(const QString& path, double value) {
+	if (path.startsWith("memory/") || path.contains("bytes")) {
+		QString text = QLocale().formattedDataSize((qint64) value);
+		return path.endsWith(".per.sec") ? text % "/s" : text;
+	}
+
+	if (path.startsWith("histograms/") && !path.endsWith("/count")) {
+		return QString::number(value, 'f', 0) % " us";
+	}
+
+	if (value != (qint64) value) {
+		return QString::number(value, 'f', 2);
+	}
+
+	return QString::number((qint64) value);
+}
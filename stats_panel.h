@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QWidget>
+#include <QTreeWidget>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QJsonObject>
+#include <QHash>
+
+class Daemon;
+
+#define STATS_PANEL_REFRESH_MSEC	1000
+
+/*
+	Shows what Stats::Collect reports as a tree, refreshed while the panel is visible
+
+	Totals and counts get a per second rate next to them, worked out from the
+	previous refresh. Collecting runs off the gui thread since it walks daemon
+	structures under their locks.
+*/
+
+class StatsPanel : public QWidget
+{
+	Q_OBJECT
+
+public:
+	StatsPanel(QWidget* parent = nullptr);
+	~StatsPanel();
+
+	void SetDaemon(Daemon* daemon);		//polling starts once set
+
+private slots:
+	void OnRefreshTimerTimeout();
+	void OnCollectFinished();
+
+private:
+	Daemon*								daemon = nullptr;
+
+	QTreeWidget							tree_widget;
+	QTimer								refresh_timer;
+	QFutureWatcher<QJsonObject>			collect_future_watcher;
+	QElapsedTimer						collect_elapsed_timer;		//since the previous collect finished
+
+	QHash<QString, QTreeWidgetItem*>	path_to_item_table;			//items are kept so expanded ones stay expanded
+	QHash<QString, double>				path_to_last_value_table;
+
+	void				UpdateItem(QTreeWidgetItem* parent, const QString& path, const QString& name, const QJsonValue& value, double elapsed_sec);
+	QTreeWidgetItem*	GetItem(QTreeWidgetItem* parent, const QString& path, const QString& name);
+
+	static bool			IsRateShown(const QString& name);
+	static QString		FormatValue(const QString& path, double value);
+};
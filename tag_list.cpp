@@ -1,4 +1,5 @@
 #include "tag_list.h"
+#include "mem_estimate.h"
 
 bool
 TagList::Empty() const {
@@ -22,6 +23,34 @@ TagList::GetSize() const {
 	return tag_vector.size() - free_index_queue.size();
 }
 
+unsigned int
+TagList::GetLinkCount() const {
+	unsigned int link_count = 0;
+
+	for (int i = 0; i < tag_vector.size(); i++) {
+		if (!free_index_set.contains(i)) {
+			link_count += tag_vector[i].media_id_list.size();
+		}
+	}
+
+	return link_count;
+}
+
+quint64
+TagList::EstimateMemory() const {
+	quint64 bytes = MemEstimate::VectorBytes(tag_vector);
+
+	for (const Tag& tag : tag_vector) {
+		bytes += MemEstimate::StringBytes(tag.name) + MemEstimate::SetBytes(tag.media_id_list);
+	}
+
+	//name keys share their data with tag names
+	bytes += MemEstimate::HashBytes(tag_name_to_id_table);
+	bytes += MemEstimate::SetBytes(free_index_set) + (quint64) free_index_queue.size() * sizeof(void*);
+
+	return bytes;
+}
+
 void
 TagList::InsertSavedTag(const Tag& tag) {
 
@@ -42,6 +71,7 @@ TagList::InsertSavedTag(const Tag& tag) {
 
 	//add entry to tag_table
 	tag_name_to_id_table.insert(tag.name, tag.id);
+	changed_id_set.insert(tag.id);
 }
 
 void
@@ -68,6 +98,7 @@ TagList::InsertNewTag(const QString& name, unsigned int *id) {
 
 	//add entry to tag_table
 	tag_name_to_id_table.insert(name, next_id);
+	changed_id_set.insert(next_id);
 }
 
 void
@@ -81,6 +112,7 @@ TagList::RemoveTagById(const unsigned int id) {
 	//this id is now free
 	free_index_queue.enqueue(id);
 	free_index_set.insert(id);
+	changed_id_set.insert(id);
 }
 
 void
@@ -104,6 +136,11 @@ TagList::GetTagById(const unsigned int id, Tag *out) const {
 	*out = tag_vector[id];
 }
 
+void
+TagList::GetModelTagById(const unsigned int id, ModelTag* out) const {
+	tag_vector[id].FormModelTag(out);
+}
+
 void
 TagList::GetTagByName(const QString& name, Tag *out) const {
 	auto iter = tag_name_to_id_table.find(name);
@@ -120,6 +157,7 @@ int
 TagList::InsertTagMedia(const unsigned int tag_id, const unsigned int media_id) {
 	tag_vector[tag_id].count++;
 	tag_vector[tag_id].AddMediaId(media_id);
+	changed_id_set.insert(tag_id);
 	return 1;
 }
 
@@ -127,6 +165,7 @@ int
 TagList::RemoveTagMedia(const unsigned int tag_id, const unsigned int media_id) {
 
 	tag_vector[tag_id].RemoveMediaId(media_id);
+	changed_id_set.insert(tag_id);
 	return 1;
 }
 
@@ -137,10 +176,17 @@ TagList::UpdateTagName(const unsigned int tag_id, const QString& new_name) {
 	tag_name_to_id_table.remove(tmp->name);
 	tmp->name = new_name;
 	tag_name_to_id_table.insert(new_name, tmp->id);
+	changed_id_set.insert(tag_id);
 
 	return 1;
 }
 
+void
+TagList::TakeChangedIds(QSet<unsigned int>* out) {
+	*out = std::move(changed_id_set);
+	changed_id_set.clear();
+}
+
 void
 TagList::DumpTags(bool show_hole_entry) const {
 	printf("Dumping Tag List:\n\n");
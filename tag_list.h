@@ -49,6 +49,10 @@ public:
 
 	unsigned int GetSize() const;
 
+	unsigned int GetLinkCount() const;				//media ids held by every tag added up
+
+	quint64 EstimateMemory() const;					//rough heap bytes, see MemEstimate
+
 	//insert tag loaded from database, might create holes (free indexes)
 	void InsertSavedTag(const Tag&);
 
@@ -64,12 +68,16 @@ public:
 	void GetTagById(const unsigned int, Tag*) const;
 	void GetTagByName(const QString&, Tag*) const;
 	void GetTagIdByName(const QString&, unsigned int*) const;
+	void GetModelTagById(const unsigned int, ModelTag*) const;		//no copy of the media id list
 
 	int InsertTagMedia(const unsigned int, const unsigned int);
 	int RemoveTagMedia(const unsigned int, const unsigned int);
 
 	int UpdateTagName(const unsigned int, const QString&);
 
+	//ids of tags inserted, removed or changed since the last call
+	void TakeChangedIds(QSet<unsigned int>*);
+
 	inline bool TagExistByName(const QString& name) const {
 		return (tag_name_to_id_table.find(name) != tag_name_to_id_table.end());
 	}
@@ -86,4 +94,5 @@ private:
 	QHash<QString, unsigned int>		tag_name_to_id_table;			//tag name lookup table
 	QQueue<unsigned int>							free_index_queue;				//next free index is top of this queue
 	QSet<unsigned int>								free_index_set;		//set of free indexes
+	QSet<unsigned int>								changed_id_set;		//since last TakeChangedIds
 };
@@ -7,6 +7,8 @@
 #include <QString>
 #include <QVector>
 #include <QSet>
+#include <QHash>
+#include <QPair>
 #include <QMetaType>
 
 /*
@@ -22,6 +24,37 @@ struct ModelTag {
 
 Q_DECLARE_METATYPE(ModelTag);
 
+//links daemon formed together, sent to gui in one signal instead of one per link
+struct ModelLinkBatch {
+	QVector<QPair<unsigned int, unsigned int>>	link_list;				//tag id, media id
+	QVector<ModelTag>							tag_list;				//every tag in link list, counts include the new links
+	QHash<unsigned int, int>					tag_count_delta_table;	//tag id -> media gained
+};
+
+Q_DECLARE_METATYPE(ModelLinkBatch);
+
+//one step of Daemon::ApplyTagOpList, tag is named by tag_name when it isn't empty, tag_id otherwise
+struct TagOp {
+
+	enum Type {
+		ADD_TAG,		//tag_name is the new name
+		RENAME_TAG,
+		LINK,
+		UNLINK
+	};
+
+	Type			type = ADD_TAG;
+	unsigned int	tag_id = 0;
+	QString			tag_name;
+	QString			new_name;		//RENAME_TAG
+	unsigned int	media_id = 0;	//LINK, UNLINK
+};
+
+struct TagOpResult {
+	int				ret = 0;		//1 applied, 0 not applied because another op failed, negative why this one failed
+	unsigned int	tag_id = 0;		//tag the op ended up on, the new tag for ADD_TAG
+};
+
 
 /*
 	Daemon in memory representation of tag
@@ -42,7 +75,7 @@ struct Tag {
 		media_id_list.remove(media_id);
 	}
 
-	void FormModelTag(ModelTag* out) {
+	void FormModelTag(ModelTag* out) const {
 		out->id = this->id;
 		out->name = this->name;
 		out->media_count = this->media_id_list.size();
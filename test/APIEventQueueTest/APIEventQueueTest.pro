@@ -0,0 +1,10 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_apieventqueuetest.cpp \
+    ../../api_events.cpp
@@ -0,0 +1,243 @@
+#include <QtTest>
+#include <vector>
+#include "../../api_events.h"
+
+// add necessary includes here
+
+class APIEventQueueTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    APIEventQueueTest();
+    ~APIEventQueueTest();
+
+    static APIEvent Event(APIEvent::Type type, unsigned int tag_id, unsigned int media_id, const QString& value = QString());
+    static std::vector<APIEvent> Drain(APIEventQueue& queue);
+
+private slots:
+
+    void InOrderWithSeq();
+    void UpdatesFolded();
+    void LinkPairCancelled();
+    void LinkPairKeptAroundTagless();
+    void TagInsertRemoveDropped();
+    void TagRemoveDropsLinks();
+    void MediaRemoveDropsUpdates();
+    void OverflowResync();
+    void SeqContinuesAfterResync();
+};
+
+APIEventQueueTest::APIEventQueueTest()
+{
+
+}
+
+APIEventQueueTest::~APIEventQueueTest()
+{
+
+}
+
+APIEvent
+APIEventQueueTest::Event(APIEvent::Type type, unsigned int tag_id, unsigned int media_id, const QString& value) {
+    APIEvent event;
+    event.type = type;
+    event.tag_id = tag_id;
+    event.media_id = media_id;
+    event.value = value;
+    return event;
+}
+
+std::vector<APIEvent>
+APIEventQueueTest::Drain(APIEventQueue& queue) {
+    std::vector<APIEvent> event_list;
+    while (queue.HasEvent()) {
+        event_list.push_back(queue.Take());
+    }
+    return event_list;
+}
+
+void
+APIEventQueueTest::InOrderWithSeq() {
+    APIEventQueue queue;
+
+    queue.Push(Event(APIEvent::TAG_INSERTED, 1, 0, "a"));
+    queue.Push(Event(APIEvent::MEDIA_NAME_UPDATED, 0, 7, "x.jpg"));
+    queue.Push(Event(APIEvent::LINK_FORMED, 1, 7));
+
+    QCOMPARE(queue.Size(), 3);
+
+    std::vector<APIEvent> event_list = Drain(queue);
+
+    QCOMPARE((int) event_list.size(), 3);
+    QCOMPARE(event_list[0].type, APIEvent::TAG_INSERTED);
+    QCOMPARE(event_list[1].type, APIEvent::MEDIA_NAME_UPDATED);
+    QCOMPARE(event_list[2].type, APIEvent::LINK_FORMED);
+
+    QCOMPARE(event_list[0].seq, (quint64) 1);
+    QCOMPARE(event_list[1].seq, (quint64) 2);
+    QCOMPARE(event_list[2].seq, (quint64) 3);
+    QCOMPARE(queue.LastSeq(), (quint64) 3);
+}
+
+void
+APIEventQueueTest::UpdatesFolded() {
+    APIEventQueue queue;
+
+    queue.Push(Event(APIEvent::MEDIA_NAME_UPDATED, 0, 7, "a.jpg"));
+    queue.Push(Event(APIEvent::TAG_NAME_UPDATED, 2, 0, "t"));
+    queue.Push(Event(APIEvent::MEDIA_NAME_UPDATED, 0, 7, "b.jpg"));
+    queue.Push(Event(APIEvent::MEDIA_HASH_UPDATED, 0, 7, "h"));
+    queue.Push(Event(APIEvent::MEDIA_NAME_UPDATED, 0, 7, "c.jpg"));
+
+    std::vector<APIEvent> event_list = Drain(queue);
+
+    //latest name in the first one's place, hash is a different update
+    QCOMPARE((int) event_list.size(), 3);
+    QCOMPARE(event_list[0].type, APIEvent::MEDIA_NAME_UPDATED);
+    QCOMPARE(event_list[0].value, QString("c.jpg"));
+    QCOMPARE(event_list[1].type, APIEvent::TAG_NAME_UPDATED);
+    QCOMPARE(event_list[2].type, APIEvent::MEDIA_HASH_UPDATED);
+}
+
+void
+APIEventQueueTest::LinkPairCancelled() {
+    APIEventQueue queue;
+
+    queue.Push(Event(APIEvent::LINK_FORMED, 1, 7));
+    queue.Push(Event(APIEvent::LINK_FORMED, 1, 8));
+    queue.Push(Event(APIEvent::LINK_DESTROYED, 1, 7));
+
+    std::vector<APIEvent> event_list = Drain(queue);
+
+    QCOMPARE((int) event_list.size(), 1);
+    QCOMPARE(event_list[0].media_id, 8u);
+
+    //destroyed then formed again is no change either
+    queue.Push(Event(APIEvent::LINK_DESTROYED, 1, 8));
+    queue.Push(Event(APIEvent::LINK_FORMED, 1, 8));
+
+    QVERIFY(!queue.HasEvent());
+}
+
+void
+APIEventQueueTest::LinkPairKeptAroundTagless() {
+    APIEventQueue queue;
+
+    queue.Push(Event(APIEvent::LINK_DESTROYED, 1, 7));
+    queue.Push(Event(APIEvent::MEDIA_TAGLESS, 0, 7));
+    queue.Push(Event(APIEvent::LINK_FORMED, 1, 7));
+
+    std::vector<APIEvent> event_list = Drain(queue);
+
+    QCOMPARE((int) event_list.size(), 3);
+    QCOMPARE(event_list[2].type, APIEvent::LINK_FORMED);
+}
+
+void
+APIEventQueueTest::TagInsertRemoveDropped() {
+    APIEventQueue queue;
+
+    queue.Push(Event(APIEvent::TAG_INSERTED, 3, 0, "new"));
+    queue.Push(Event(APIEvent::TAG_NAME_UPDATED, 3, 0, "newer"));
+    queue.Push(Event(APIEvent::TAG_REMOVED, 3, 0));
+
+    QVERIFY(!queue.HasEvent());
+
+    //tag client already knows about is removed as usual
+    queue.Push(Event(APIEvent::TAG_NAME_UPDATED, 4, 0, "old"));
+    queue.Push(Event(APIEvent::TAG_REMOVED, 4, 0));
+
+    std::vector<APIEvent> event_list = Drain(queue);
+
+    QCOMPARE((int) event_list.size(), 1);
+    QCOMPARE(event_list[0].type, APIEvent::TAG_REMOVED);
+    QCOMPARE(event_list[0].tag_id, 4u);
+}
+
+void
+APIEventQueueTest::TagRemoveDropsLinks() {
+    APIEventQueue queue;
+
+    queue.Push(Event(APIEvent::LINK_FORMED, 1, 7));
+    queue.Push(Event(APIEvent::LINK_FORMED, 2, 7));
+    queue.Push(Event(APIEvent::LINK_DESTROYED, 1, 8));
+    queue.Push(Event(APIEvent::TAG_REMOVED, 1, 0));
+
+    std::vector<APIEvent> event_list = Drain(queue);
+
+    QCOMPARE((int) event_list.size(), 2);
+    QCOMPARE(event_list[0].type, APIEvent::LINK_FORMED);
+    QCOMPARE(event_list[0].tag_id, 2u);
+    QCOMPARE(event_list[1].type, APIEvent::TAG_REMOVED);
+
+    //dropped link is not folded into later
+    queue.Push(Event(APIEvent::LINK_DESTROYED, 1, 7));
+
+    event_list = Drain(queue);
+    QCOMPARE((int) event_list.size(), 1);
+}
+
+void
+APIEventQueueTest::MediaRemoveDropsUpdates() {
+    APIEventQueue queue;
+
+    queue.Push(Event(APIEvent::MEDIA_TAGLESS, 0, 7));
+    queue.Push(Event(APIEvent::MEDIA_SUBDIR_UPDATED, 0, 7, "a"));
+    queue.Push(Event(APIEvent::MEDIA_HASH_UPDATED, 0, 8, "h"));
+    queue.Push(Event(APIEvent::MEDIA_REMOVED, 0, 7));
+
+    std::vector<APIEvent> event_list = Drain(queue);
+
+    QCOMPARE((int) event_list.size(), 2);
+    QCOMPARE(event_list[0].type, APIEvent::MEDIA_HASH_UPDATED);
+    QCOMPARE(event_list[1].type, APIEvent::MEDIA_REMOVED);
+    QCOMPARE(event_list[1].media_id, 7u);
+}
+
+void
+APIEventQueueTest::OverflowResync() {
+    APIEventQueue queue(4);
+
+    for (unsigned int i = 1; i <= 3; i++) {
+        queue.Push(Event(APIEvent::MEDIA_REMOVED, 0, i));
+    }
+    queue.Push(Event(APIEvent::MEDIA_NAME_UPDATED, 0, 9, "a.jpg"));
+
+    //folded events still fit
+    queue.Push(Event(APIEvent::MEDIA_NAME_UPDATED, 0, 9, "b.jpg"));
+    QCOMPARE(queue.Size(), 4);
+
+    queue.Push(Event(APIEvent::MEDIA_REMOVED, 0, 5));
+    queue.Push(Event(APIEvent::MEDIA_REMOVED, 0, 6));
+
+    std::vector<APIEvent> event_list = Drain(queue);
+
+    QCOMPARE((int) event_list.size(), 1);
+    QCOMPARE(event_list[0].type, APIEvent::RESYNC);
+}
+
+void
+APIEventQueueTest::SeqContinuesAfterResync() {
+    APIEventQueue queue(1);
+
+    queue.Push(Event(APIEvent::MEDIA_REMOVED, 0, 1));
+    QCOMPARE(queue.Take().seq, (quint64) 1);
+
+    queue.Push(Event(APIEvent::MEDIA_REMOVED, 0, 2));
+    queue.Push(Event(APIEvent::MEDIA_REMOVED, 0, 3));
+
+    APIEvent resync = queue.Take();
+    QCOMPARE(resync.type, APIEvent::RESYNC);
+    QCOMPARE(resync.seq, (quint64) 2);
+
+    queue.Push(Event(APIEvent::MEDIA_REMOVED, 0, 4));
+
+    APIEvent next = queue.Take();
+    QCOMPARE(next.media_id, 4u);
+    QCOMPARE(next.seq, (quint64) 3);
+}
+
+QTEST_APPLESS_MAIN(APIEventQueueTest)
+
+#include "tst_apieventqueuetest.moc"
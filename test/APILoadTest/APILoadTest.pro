@@ -0,0 +1,11 @@
+QT += testlib network
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_apiloadtest.cpp
+
+HEADERS +=
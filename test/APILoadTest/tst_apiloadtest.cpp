@@ -0,0 +1,382 @@
+#include <QtTest>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// add necessary includes here
+
+/*
+	Latency of the API server under concurrent clients. Needs a running tagsearchUI,
+	skipped otherwise. Each client sends one request, waits for its response and repeats.
+*/
+
+#define LOAD_PIPE_NAME              "\\\\.\\pipe\\TAGSEARCH_PIPE"
+#define LOAD_REQUESTS_PER_CLIENT    200
+#define LOAD_PIPELINE_REQUESTS      5000
+
+//values of APICommand / GetMediaType
+#define LOAD_CMD_GETALLTAG          3
+#define LOAD_CMD_GETMEDIA           8
+#define LOAD_MEDIA_TYPE_ALL         0
+
+class APILoadTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    APILoadTest();
+    ~APILoadTest();
+
+    static QByteArray Request(int cmd, const QJsonArray& args = QJsonArray());
+
+    //latency in usec of every request, -1 on any failure
+    static bool RunClient(const QByteArray& request, int request_count, std::vector<qint64>* latency_out);
+
+    static qint64 Percentile(std::vector<qint64>& latency_list, double percentile);
+
+    static QByteArray Frame(const QByteArray& payload);
+
+    //keeps in_flight framed requests outstanding, returns requests per second or -1
+    static double RunPipelinedClient(int cmd, int request_count, int in_flight);
+
+    //one framed GET MEDIA, usec until the first frame and until the last, false on failure
+    static bool RunMediaRequest(bool stream, qint64* first_frame_out, qint64* done_out);
+
+private slots:
+
+    void initTestCase();
+
+    void GetAllTagLatency_data();
+    void GetAllTagLatency();
+    void GetMediaLatency_data();
+    void GetMediaLatency();
+
+    void LegacyThroughput();
+    void FramedThroughput_data();
+    void FramedThroughput();
+
+    void StreamedMediaFirstFrame();
+
+private:
+
+    void RunLoad(const QByteArray& request, int connection_count);
+    void AddConnectionCounts();
+};
+
+APILoadTest::APILoadTest()
+{
+
+}
+
+APILoadTest::~APILoadTest()
+{
+
+}
+
+QByteArray
+APILoadTest::Request(int cmd, const QJsonArray& args) {
+    QJsonObject json;
+    json.insert("cmd", cmd);
+    json.insert("args", args);
+    return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
+
+bool
+APILoadTest::RunClient(const QByteArray& request, int request_count, std::vector<qint64>* latency_out) {
+    QLocalSocket socket;
+    socket.connectToServer(LOAD_PIPE_NAME);
+    if (!socket.waitForConnected(3000)) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+
+    for (int i = 0; i < request_count; i++) {
+        timer.start();
+
+        socket.write(request);
+        if (!socket.waitForBytesWritten(10000)) {
+            return false;
+        }
+
+        //response is one json document, read until it parses
+        QByteArray response;
+        for (;;) {
+            if (!socket.waitForReadyRead(10000)) {
+                return false;
+            }
+
+            response.append(socket.readAll());
+            if (!QJsonDocument::fromJson(response).isNull()) {
+                break;
+            }
+        }
+
+        latency_out->push_back(timer.nsecsElapsed() / 1000);
+    }
+
+    socket.disconnectFromServer();
+    return true;
+}
+
+qint64
+APILoadTest::Percentile(std::vector<qint64>& latency_list, double percentile) {
+    size_t idx = (size_t) (percentile * (latency_list.size() - 1));
+    std::nth_element(latency_list.begin(), latency_list.begin() + idx, latency_list.end());
+    return latency_list[idx];
+}
+
+void
+APILoadTest::initTestCase() {
+    QLocalSocket socket;
+    socket.connectToServer(LOAD_PIPE_NAME);
+    if (!socket.waitForConnected(1000)) {
+        QSKIP("API server is not running");
+    }
+}
+
+void
+APILoadTest::AddConnectionCounts() {
+    QTest::addColumn<int>("connection_count");
+
+    for (int count = 1; count <= 64; count *= 2) {
+        QTest::newRow(qPrintable(QString::number(count) + " connections")) << count;
+    }
+}
+
+void
+APILoadTest::RunLoad(const QByteArray& request, int connection_count) {
+    std::vector<std::vector<qint64>> latency_table(connection_count);
+    std::vector<char> ok_list(connection_count, 0);
+    std::vector<std::thread> thread_list;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < connection_count; i++) {
+        thread_list.emplace_back([&, i]() {
+            ok_list[i] = RunClient(request, LOAD_REQUESTS_PER_CLIENT, &latency_table[i]);
+        });
+    }
+
+    for (std::thread& thread : thread_list) {
+        thread.join();
+    }
+
+    qint64 elapsed_msec = timer.elapsed();
+
+    std::vector<qint64> latency_list;
+    for (int i = 0; i < connection_count; i++) {
+        QVERIFY(ok_list[i]);
+        latency_list.insert(latency_list.end(), latency_table[i].begin(), latency_table[i].end());
+    }
+
+    qint64 p50 = Percentile(latency_list, 0.50);
+    qint64 p99 = Percentile(latency_list, 0.99);
+
+    qInfo("%d connections: p50 %lld us, p99 %lld us, %.0f requests/s", connection_count, p50, p99,
+        latency_list.size() * 1000.0 / qMax<qint64>(elapsed_msec, 1));
+}
+
+void
+APILoadTest::GetAllTagLatency_data() {
+    AddConnectionCounts();
+}
+
+void
+APILoadTest::GetAllTagLatency() {
+    QFETCH(int, connection_count);
+    RunLoad(Request(LOAD_CMD_GETALLTAG), connection_count);
+}
+
+void
+APILoadTest::GetMediaLatency_data() {
+    AddConnectionCounts();
+}
+
+void
+APILoadTest::GetMediaLatency() {
+    QFETCH(int, connection_count);
+    RunLoad(Request(LOAD_CMD_GETMEDIA, QJsonArray({ LOAD_MEDIA_TYPE_ALL })), connection_count);
+}
+
+QByteArray
+APILoadTest::Frame(const QByteArray& payload) {
+    char header[4];
+    qToBigEndian<quint32>(payload.size(), header);
+    return QByteArray(header, 4) + payload;
+}
+
+double
+APILoadTest::RunPipelinedClient(int cmd, int request_count, int in_flight) {
+    QLocalSocket socket;
+    socket.connectToServer(LOAD_PIPE_NAME);
+    if (!socket.waitForConnected(3000)) {
+        return -1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int sent_count = 0;
+    int recv_count = 0;
+    QByteArray read_buffer;
+
+    while (recv_count < request_count) {
+
+        QByteArray out;
+        for (; sent_count < request_count && sent_count - recv_count < in_flight; sent_count++) {
+            QJsonObject json;
+            json.insert("cmd", cmd);
+            json.insert("rid", sent_count);
+            out.append(Frame(QJsonDocument(json).toJson(QJsonDocument::Compact)));
+        }
+
+        if (!out.isEmpty()) {
+            socket.write(out);
+            socket.flush();
+        }
+
+        if (!socket.waitForReadyRead(10000)) {
+            return -1;
+        }
+
+        read_buffer.append(socket.readAll());
+
+        int offset = 0;
+        while (read_buffer.size() - offset >= 4) {
+            quint32 frame_size = qFromBigEndian<quint32>(read_buffer.constData() + offset);
+            if (read_buffer.size() - offset - 4 < (int) frame_size) {
+                break;
+            }
+
+            offset += 4 + frame_size;
+            recv_count++;
+        }
+
+        read_buffer.remove(0, offset);
+    }
+
+    socket.disconnectFromServer();
+    return request_count * 1000.0 / qMax<qint64>(timer.elapsed(), 1);
+}
+
+//old unframed protocol, one request at a time on one connection
+void
+APILoadTest::LegacyThroughput() {
+    std::vector<qint64> latency_list;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVERIFY(RunClient(Request(LOAD_CMD_GETALLTAG), LOAD_PIPELINE_REQUESTS, &latency_list));
+
+    qInfo("legacy: %.0f requests/s", LOAD_PIPELINE_REQUESTS * 1000.0 / qMax<qint64>(timer.elapsed(), 1));
+}
+
+void
+APILoadTest::FramedThroughput_data() {
+    QTest::addColumn<int>("in_flight");
+
+    QTest::newRow("1 in flight") << 1;
+    QTest::newRow("8 in flight") << 8;
+    QTest::newRow("32 in flight") << 32;
+    QTest::newRow("128 in flight") << 128;
+}
+
+void
+APILoadTest::FramedThroughput() {
+    QFETCH(int, in_flight);
+
+    double requests_per_sec = RunPipelinedClient(LOAD_CMD_GETALLTAG, LOAD_PIPELINE_REQUESTS, in_flight);
+    QVERIFY(requests_per_sec > 0);
+
+    qInfo("framed, %d in flight: %.0f requests/s", in_flight, requests_per_sec);
+}
+
+bool
+APILoadTest::RunMediaRequest(bool stream, qint64* first_frame_out, qint64* done_out) {
+    QLocalSocket socket;
+    socket.connectToServer(LOAD_PIPE_NAME);
+    if (!socket.waitForConnected(3000)) {
+        return false;
+    }
+
+    QJsonObject json;
+    json.insert("cmd", LOAD_CMD_GETMEDIA);
+    json.insert("rid", 1);
+    json.insert("args", QJsonArray({ LOAD_MEDIA_TYPE_ALL }));
+    if (stream) {
+        json.insert("stream", true);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    socket.write(Frame(QJsonDocument(json).toJson(QJsonDocument::Compact)));
+    socket.flush();
+
+    *first_frame_out = -1;
+    int media_count = 0;
+    QByteArray read_buffer;
+
+    while (true) {
+        if (!socket.waitForReadyRead(30000)) {
+            return false;
+        }
+
+        read_buffer.append(socket.readAll());
+
+        int offset = 0;
+        while (read_buffer.size() - offset >= 4) {
+            quint32 frame_size = qFromBigEndian<quint32>(read_buffer.constData() + offset);
+            if (read_buffer.size() - offset - 4 < (int) frame_size) {
+                break;
+            }
+
+            if (*first_frame_out < 0) {
+                *first_frame_out = timer.nsecsElapsed() / 1000;
+            }
+
+            QJsonObject response = QJsonDocument::fromJson(read_buffer.mid(offset + 4, frame_size)).object();
+            offset += 4 + frame_size;
+
+            //unstreamed is a single frame, streamed ends with the totals
+            if (!stream) {
+                *done_out = timer.nsecsElapsed() / 1000;
+                return response.value("res").isArray();
+            }
+
+            if (response.value("end").toBool()) {
+                *done_out = timer.nsecsElapsed() / 1000;
+                return response.value("res").toObject().value("count").toInt() == media_count;
+            }
+
+            media_count += response.value("res").toArray().size();
+        }
+
+        read_buffer.remove(0, offset);
+    }
+}
+
+void
+APILoadTest::StreamedMediaFirstFrame() {
+    qint64 whole_first, whole_done;
+    qint64 stream_first, stream_done;
+
+    QVERIFY(RunMediaRequest(false, &whole_first, &whole_done));
+    QVERIFY(RunMediaRequest(true, &stream_first, &stream_done));
+
+    qInfo("whole: first frame %lld usec, done %lld usec", whole_first, whole_done);
+    qInfo("streamed: first frame %lld usec, done %lld usec", stream_first, stream_done);
+}
+
+QTEST_APPLESS_MAIN(APILoadTest)
+
+#include "tst_apiloadtest.moc"
@@ -0,0 +1,11 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_eventcoalescertest.cpp \
+    ../../event_coalescer.cpp \
+    ../../metrics.cpp
@@ -0,0 +1,268 @@
+#include <QtTest>
+#include <vector>
+#include "../../event_coalescer.h"
+
+// add necessary includes here
+
+class EventCoalescerTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    EventCoalescerTest();
+    ~EventCoalescerTest();
+
+    EventCoalescer::TimePoint t0;
+
+    static NotifyEvent Event(NotifyEvent::EventType type, const wchar_t* dir_wname, const wchar_t* file_wname);
+    static std::vector<NotifyEvent> Drain(EventCoalescer& coalescer);
+    static bool Match(const NotifyEvent& event, NotifyEvent::EventType type, const wchar_t* dir_wname, const wchar_t* file_wname);
+
+    EventCoalescer::TimePoint At(int msec);
+
+private slots:
+
+    void CreateHeldUntilQuiet();
+    void ModifyStormCollapsed();
+    void ModifyStormMaxHold();
+    void CreateModifyRemoveDropped();
+    void RemoveDropsHeldModify();
+    void RemoveCreateMoveAdjacent();
+    void RenamePassThrough();
+    void RenameCarriesHeldModify();
+    void RenameHeldCreateFolded();
+    void ParentDirReleasedFirst();
+    void RescanReleasesAll();
+    void NextReleaseMsec();
+};
+
+EventCoalescerTest::EventCoalescerTest()
+{
+    t0 = std::chrono::steady_clock::now();
+}
+
+EventCoalescerTest::~EventCoalescerTest()
+{
+
+}
+
+NotifyEvent
+EventCoalescerTest::Event(NotifyEvent::EventType type, const wchar_t* dir_wname, const wchar_t* file_wname) {
+    NotifyEvent event;
+    event.event = type;
+    event.dir_wname = dir_wname;
+    event.file_wname = file_wname;
+    return event;
+}
+
+std::vector<NotifyEvent>
+EventCoalescerTest::Drain(EventCoalescer& coalescer) {
+    std::vector<NotifyEvent> ret;
+    NotifyEvent event;
+
+    while (coalescer.HasEvent()) {
+        coalescer.GetNextEvent(&event);
+        ret.push_back(event);
+    }
+
+    return ret;
+}
+
+bool
+EventCoalescerTest::Match(const NotifyEvent& event, NotifyEvent::EventType type, const wchar_t* dir_wname, const wchar_t* file_wname) {
+    return event.event == type && event.dir_wname == dir_wname && event.file_wname == file_wname;
+}
+
+EventCoalescer::TimePoint
+EventCoalescerTest::At(int msec) {
+    return t0 + std::chrono::milliseconds(msec);
+}
+
+void
+EventCoalescerTest::CreateHeldUntilQuiet() {
+    EventCoalescer coalescer(500, 5000);
+
+    coalescer.Push(Event(NotifyEvent::CREATE, L"dir1", L"file1"), At(0));
+    coalescer.ReleaseExpired(At(499));
+    QVERIFY(coalescer.HasEvent() == false);
+
+    coalescer.ReleaseExpired(At(500));
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 1);
+    QVERIFY(Match(result[0], NotifyEvent::CREATE, L"dir1", L"file1"));
+}
+
+void
+EventCoalescerTest::ModifyStormCollapsed() {
+    EventCoalescer coalescer(500, 5000);
+
+    coalescer.Push(Event(NotifyEvent::CREATE, L"dir1", L"file1"), At(0));
+    for (int i = 1; i <= 20; i++) {
+        coalescer.Push(Event(NotifyEvent::MODIFY, L"dir1", L"file1"), At(i * 100));
+    }
+
+    //still being written to
+    coalescer.ReleaseExpired(At(2400));
+    QVERIFY(coalescer.HasEvent() == false);
+
+    coalescer.ReleaseExpired(At(2500));
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 1);
+    QVERIFY(Match(result[0], NotifyEvent::CREATE, L"dir1", L"file1"));
+}
+
+void
+EventCoalescerTest::ModifyStormMaxHold() {
+    EventCoalescer coalescer(500, 2000);
+
+    for (int i = 0; i <= 30; i++) {
+        coalescer.Push(Event(NotifyEvent::MODIFY, L"", L"log"), At(i * 100));
+
+        if (i == 19) {
+            QVERIFY(coalescer.HasEvent() == false);
+        }
+    }
+
+    coalescer.ReleaseExpired(At(2000));
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 1);
+    QVERIFY(Match(result[0], NotifyEvent::MODIFY, L"", L"log"));
+}
+
+void
+EventCoalescerTest::CreateModifyRemoveDropped() {
+    EventCoalescer coalescer;
+
+    coalescer.Push(Event(NotifyEvent::CREATE, L"dir1", L"file.tmp"), At(0));
+    coalescer.Push(Event(NotifyEvent::MODIFY, L"dir1", L"file.tmp"), At(10));
+    coalescer.Push(Event(NotifyEvent::MODIFY, L"dir1", L"file.tmp"), At(20));
+    coalescer.Push(Event(NotifyEvent::REMOVE, L"dir1", L"file.tmp"), At(30));
+    coalescer.ReleaseAll();
+
+    QVERIFY(coalescer.HasEvent() == false);
+    QVERIFY(coalescer.HeldCount() == 0);
+}
+
+void
+EventCoalescerTest::RemoveDropsHeldModify() {
+    EventCoalescer coalescer;
+
+    coalescer.Push(Event(NotifyEvent::MODIFY, L"dir1", L"file1"), At(0));
+    coalescer.Push(Event(NotifyEvent::REMOVE, L"dir1", L"file1"), At(10));
+    coalescer.ReleaseAll();
+
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 1);
+    QVERIFY(Match(result[0], NotifyEvent::REMOVE, L"dir1", L"file1"));
+}
+
+void
+EventCoalescerTest::RemoveCreateMoveAdjacent() {
+    EventCoalescer coalescer;
+
+    coalescer.Push(Event(NotifyEvent::CREATE, L"", L"other"), At(0));
+    coalescer.Push(Event(NotifyEvent::REMOVE, L"dir1", L"file1"), At(0));
+    coalescer.Push(Event(NotifyEvent::CREATE, L"dir2", L"file1"), At(0));
+
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 2);
+    QVERIFY(Match(result[0], NotifyEvent::REMOVE, L"dir1", L"file1"));
+    QVERIFY(Match(result[1], NotifyEvent::CREATE, L"dir2", L"file1"));
+
+    //unrelated create is still held
+    QVERIFY(coalescer.HeldCount() == 1);
+}
+
+void
+EventCoalescerTest::RenamePassThrough() {
+    EventCoalescer coalescer;
+
+    coalescer.Push(Event(NotifyEvent::RENAME_OLD, L"dir1", L"old"), At(0));
+    coalescer.Push(Event(NotifyEvent::RENAME_NEW, L"dir1", L"new"), At(0));
+
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 2);
+    QVERIFY(Match(result[0], NotifyEvent::RENAME_OLD, L"dir1", L"old"));
+    QVERIFY(Match(result[1], NotifyEvent::RENAME_NEW, L"dir1", L"new"));
+}
+
+void
+EventCoalescerTest::RenameCarriesHeldModify() {
+    EventCoalescer coalescer;
+
+    coalescer.Push(Event(NotifyEvent::MODIFY, L"dir1", L"old"), At(0));
+    coalescer.Push(Event(NotifyEvent::MODIFY, L"dir1\\sub", L"file1"), At(0));
+    coalescer.Push(Event(NotifyEvent::RENAME_OLD, L"", L"dir1"), At(10));
+    coalescer.Push(Event(NotifyEvent::RENAME_NEW, L"", L"dir2"), At(10));
+
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 2);
+    QVERIFY(Match(result[0], NotifyEvent::RENAME_OLD, L"", L"dir1"));
+    QVERIFY(Match(result[1], NotifyEvent::RENAME_NEW, L"", L"dir2"));
+
+    coalescer.ReleaseAll();
+    result = Drain(coalescer);
+    QVERIFY(result.size() == 2);
+    QVERIFY(Match(result[0], NotifyEvent::MODIFY, L"dir2", L"old"));
+    QVERIFY(Match(result[1], NotifyEvent::MODIFY, L"dir2\\sub", L"file1"));
+}
+
+void
+EventCoalescerTest::RenameHeldCreateFolded() {
+    EventCoalescer coalescer;
+
+    coalescer.Push(Event(NotifyEvent::CREATE, L"dl", L"movie.part"), At(0));
+    coalescer.Push(Event(NotifyEvent::MODIFY, L"dl", L"movie.part"), At(10));
+    coalescer.Push(Event(NotifyEvent::RENAME_OLD, L"dl", L"movie.part"), At(20));
+    coalescer.Push(Event(NotifyEvent::RENAME_NEW, L"dl", L"movie"), At(20));
+    coalescer.ReleaseAll();
+
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 1);
+    QVERIFY(Match(result[0], NotifyEvent::CREATE, L"dl", L"movie"));
+}
+
+void
+EventCoalescerTest::ParentDirReleasedFirst() {
+    EventCoalescer coalescer(500, 5000);
+
+    coalescer.Push(Event(NotifyEvent::CREATE, L"", L"dir1"), At(0));
+    coalescer.Push(Event(NotifyEvent::CREATE, L"dir1", L"file1"), At(10));
+
+    //dir keeps getting touched while its child has settled
+    coalescer.Push(Event(NotifyEvent::MODIFY, L"", L"dir1"), At(400));
+    coalescer.ReleaseExpired(At(600));
+
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 2);
+    QVERIFY(Match(result[0], NotifyEvent::CREATE, L"", L"dir1"));
+    QVERIFY(Match(result[1], NotifyEvent::CREATE, L"dir1", L"file1"));
+}
+
+void
+EventCoalescerTest::RescanReleasesAll() {
+    EventCoalescer coalescer;
+
+    coalescer.Push(Event(NotifyEvent::CREATE, L"dir1", L"file1"), At(0));
+    coalescer.Push(Event(NotifyEvent::RESCAN, L"dir1", L""), At(10));
+
+    std::vector<NotifyEvent> result = Drain(coalescer);
+    QVERIFY(result.size() == 2);
+    QVERIFY(Match(result[0], NotifyEvent::CREATE, L"dir1", L"file1"));
+    QVERIFY(Match(result[1], NotifyEvent::RESCAN, L"dir1", L""));
+}
+
+void
+EventCoalescerTest::NextReleaseMsec() {
+    EventCoalescer coalescer(500, 5000);
+
+    QVERIFY(coalescer.NextReleaseMsec(At(0)) == -1);
+
+    coalescer.Push(Event(NotifyEvent::MODIFY, L"", L"file1"), At(0));
+    QVERIFY(coalescer.NextReleaseMsec(At(100)) == 400);
+    QVERIFY(coalescer.NextReleaseMsec(At(700)) == 0);
+}
+
+QTEST_APPLESS_MAIN(EventCoalescerTest)
+
+#include "tst_eventcoalescertest.moc"
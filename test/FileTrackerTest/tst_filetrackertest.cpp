@@ -42,6 +42,22 @@ private slots:
     void GetDirMediaIdRecurOneLevelChildDir();
     void GetDirMediaIdRecurOneLevelMultiChildDir();
     void GetDirMediaIdRecurMultiLevelChildDir();
+
+    void PathIndexLongAndShortName();
+    void PathIndexMixedName();
+    void PathIndexUpdateDirName();
+    void PathIndexUpdateDirSubdir();
+    void PathIndexRemoveDir();
+    void PathIndexClear();
+
+    void DirStatsMedia();
+    void DirStatsMediaSize();
+    void DirStatsUpdateDirSubdir();
+    void DirStatsRemoveDir();
+    void GetDirMediaIdSet();
+
+    void DirExistByDepth_data();
+    void DirExistByDepth();
 };
 
 FileTrackerTest::FileTrackerTest()
@@ -499,6 +515,273 @@ void FileTrackerTest::GetDirMediaIdRecurMultiLevelChildDir() {
 
 }
 
+void FileTrackerTest::PathIndexLongAndShortName() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "longdir1", "LONGDI~1");
+    tracker.AddDirSubPath("\\longdir1", "longdir2", "LONGDI~2");
+    tracker.AddDirSubPath("\\longdir1\\longdir2", "dir3", "");
+
+
+    //with and without leading separator
+    QVERIFY(tracker.DirExist("\\longdir1\\longdir2\\dir3") == true);
+    QVERIFY(tracker.DirExist("LONGDI~1\\LONGDI~2\\dir3") == true);
+
+    QString long_path;
+    tracker.GetPathLongName("\\LONGDI~1\\LONGDI~2", &long_path);
+    QVERIFY(long_path == "\\longdir1\\longdir2");
+
+    //file under an indexed dir
+    QVERIFY(tracker.DirExist("\\longdir1\\longdir2\\file.jpg") == false);
+}
+
+void FileTrackerTest::PathIndexMixedName() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "longdir1", "LONGDI~1");
+    tracker.AddDirSubPath("longdir1", "longdir2", "LONGDI~2");
+    tracker.AddDirSubPath("longdir1\\longdir2", "dir3", "");
+
+    //not in the index, found by walking
+    QVERIFY(tracker.DirExist("LONGDI~1\\longdir2\\dir3") == true);
+    QVERIFY(tracker.DirExist("longdir1\\LONGDI~2\\") == true);
+    QVERIFY(tracker.DirExist("LONGDI~1\\longdir2\\dir4") == false);
+
+    QString l_out, s_out;
+    QVERIFY(tracker.GetDirName("longdir1\\LONGDI~2", &l_out, &s_out) > 0);
+    QVERIFY(l_out == "longdir2");
+}
+
+void FileTrackerTest::PathIndexUpdateDirName() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "S1");
+    tracker.AddDirSubPath("dir1", "dir2", "");
+    tracker.AddDirSubPath("dir1\\dir2", "dir3", "");
+
+    tracker.UpdateDirName("dir1", "dir4", "S4");
+
+    QVERIFY(tracker.DirExist("dir1\\dir2\\dir3") == false);
+    QVERIFY(tracker.DirExist("S1\\dir2\\dir3") == false);
+    QVERIFY(tracker.DirExist("dir4\\dir2\\dir3") == true);
+    QVERIFY(tracker.DirExist("S4\\dir2\\dir3") == true);
+}
+
+void FileTrackerTest::PathIndexUpdateDirSubdir() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "");
+    tracker.AddDirSubPath("", "dir2", "");
+    tracker.AddDirSubPath("dir1", "dir3", "");
+    tracker.AddDirSubPath("dir1\\dir3", "dir4", "");
+
+    tracker.UpdateDirSubdir("dir1\\dir3", "dir2");
+
+    QVERIFY(tracker.DirExist("dir1\\dir3\\dir4") == false);
+    QVERIFY(tracker.DirExist("dir2\\dir3\\dir4") == true);
+
+    QString long_path;
+    tracker.GetPathLongName("dir2\\dir3\\dir4", &long_path);
+    QVERIFY(long_path == "\\dir2\\dir3\\dir4");
+}
+
+void FileTrackerTest::PathIndexRemoveDir() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "S1");
+    tracker.AddDirSubPath("dir1", "dir2", "");
+    tracker.AddDirSubPath("", "dir3", "");
+
+    tracker.RemoveDir("dir1");
+
+    QVERIFY(tracker.DirExist("dir3") == true);
+    QVERIFY(tracker.DirExist("S1\\dir2") == false);
+}
+
+void FileTrackerTest::PathIndexClear() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "");
+    tracker.Clear();
+
+    QVERIFY(tracker.DirExist("dir1") == false);
+    QVERIFY(tracker.DirExist("") == true);
+
+    tracker.AddDirSubPath("", "dir1", "");
+    QVERIFY(tracker.DirExist("dir1") == true);
+}
+
+void FileTrackerTest::DirStatsMedia() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "");
+    tracker.AddDirSubPath("dir1", "dir2", "");
+    tracker.AddDirSubPath("", "dir3", "");
+
+    tracker.AddMediaSubPath("", 1, 10);
+    tracker.AddMediaSubPath("dir1", 2, 20);
+    tracker.AddMediaSubPath("dir1\\dir2", 3, 30);
+    tracker.AddMediaSubPath("dir1\\dir2", 3, 30);    //same media twice counts once
+
+    DirStats stats;
+    QVERIFY(tracker.GetDirStats("", &stats) > 0);
+    QVERIFY(stats.media_count == 1);
+    QVERIFY(stats.child_dir_count == 2);
+    QVERIFY(stats.recur_media_count == 3);
+    QVERIFY(stats.recur_byte_count == 60);
+    QVERIFY(stats.recur_dir_count == 3);
+
+    QVERIFY(tracker.GetDirStats("dir1", &stats) > 0);
+    QVERIFY(stats.recur_media_count == 2);
+    QVERIFY(stats.recur_byte_count == 50);
+
+    tracker.RemoveMedia("dir1\\dir2", 3);
+
+    QVERIFY(tracker.GetDirStats("", &stats) > 0);
+    QVERIFY(stats.recur_media_count == 2);
+    QVERIFY(stats.recur_byte_count == 30);
+
+    //subtrees without media are not walked but the result is the same
+    QVector<unsigned int> media_list;
+    tracker.GetDirMediaIdRecurByPath("", &media_list);
+    QVERIFY(media_list.size() == 2);
+    QVERIFY(media_list.contains(1));
+    QVERIFY(media_list.contains(2));
+
+    QVERIFY(tracker.GetDirStats("dir4", &stats) < 0);
+}
+
+void FileTrackerTest::DirStatsMediaSize() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "");
+    tracker.AddMediaSubPath("dir1", 1);        //size not known yet
+    tracker.AddMediaSubPath("dir1", 2, 100);
+
+    DirStats stats;
+    tracker.GetDirStats("", &stats);
+    QVERIFY(stats.recur_byte_count == 100);
+
+    QVERIFY(tracker.UpdateMediaSize("dir1", 1, 50) > 0);
+    QVERIFY(tracker.UpdateMediaSize("dir1", 2, 10) > 0);
+    QVERIFY(tracker.UpdateMediaSize("", 2, 10) < 0);
+
+    tracker.GetDirStats("", &stats);
+    QVERIFY(stats.recur_byte_count == 60);
+
+    tracker.RemoveMedia("dir1", 1);
+    tracker.GetDirStats("dir1", &stats);
+    QVERIFY(stats.recur_byte_count == 10);
+}
+
+void FileTrackerTest::DirStatsUpdateDirSubdir() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "");
+    tracker.AddDirSubPath("", "dir2", "");
+    tracker.AddDirSubPath("dir1", "dir3", "");
+    tracker.AddDirSubPath("dir1\\dir3", "dir4", "");
+
+    tracker.AddMediaSubPath("dir1\\dir3", 1, 5);
+    tracker.AddMediaSubPath("dir1\\dir3\\dir4", 2, 7);
+
+    tracker.UpdateDirSubdir("dir1\\dir3", "dir2");
+
+    DirStats stats;
+    tracker.GetDirStats("dir1", &stats);
+    QVERIFY(stats.recur_media_count == 0);
+    QVERIFY(stats.recur_byte_count == 0);
+    QVERIFY(stats.recur_dir_count == 0);
+
+    tracker.GetDirStats("dir2", &stats);
+    QVERIFY(stats.recur_media_count == 2);
+    QVERIFY(stats.recur_byte_count == 12);
+    QVERIFY(stats.recur_dir_count == 2);
+
+    tracker.GetDirStats("", &stats);
+    QVERIFY(stats.recur_media_count == 2);
+    QVERIFY(stats.recur_dir_count == 4);
+
+    //rename leaves totals alone
+    tracker.UpdateDirName("dir2", "dir5", "");
+    tracker.GetDirStats("dir5", &stats);
+    QVERIFY(stats.recur_byte_count == 12);
+}
+
+void FileTrackerTest::DirStatsRemoveDir() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "");
+    tracker.AddDirSubPath("dir1", "dir2", "");
+    tracker.AddMediaSubPath("", 1, 1);
+    tracker.AddMediaSubPath("dir1\\dir2", 2, 2);
+
+    tracker.RemoveDir("dir1");
+
+    DirStats stats;
+    tracker.GetDirStats("", &stats);
+    QVERIFY(stats.recur_media_count == 1);
+    QVERIFY(stats.recur_byte_count == 1);
+    QVERIFY(stats.recur_dir_count == 0);
+}
+
+void FileTrackerTest::GetDirMediaIdSet() {
+    FileTracker tracker;
+
+    tracker.AddDirSubPath("", "dir1", "S1");
+    tracker.AddDirSubPath("dir1", "dir2", "");
+    tracker.AddDirSubPath("dir1", "dir3", "");
+    tracker.AddMediaSubPath("dir1", 1);
+    tracker.AddMediaSubPath("dir1\\dir2", 2);
+    tracker.AddMediaSubPath("dir1\\dir3", 3);
+    tracker.AddMediaSubPath("", 4);
+
+    QSet<unsigned int> media_set;
+    QVERIFY(tracker.GetDirMediaIdSet("\\S1", true, &media_set) > 0);
+    QVERIFY(media_set == QSet<unsigned int>({ 1, 2, 3 }));
+
+    QVERIFY(tracker.GetDirMediaIdSet("\\dir1", false, &media_set) > 0);
+    QVERIFY(media_set == QSet<unsigned int>({ 1 }));
+
+    QVERIFY(tracker.GetDirMediaIdSet("dir1\\dir2", true, &media_set) > 0);
+    QVERIFY(media_set == QSet<unsigned int>({ 2 }));
+
+    QVERIFY(tracker.GetDirMediaIdSet("dir4", true, &media_set) < 0);
+}
+
+void FileTrackerTest::DirExistByDepth_data() {
+    QTest::addColumn<int>("depth");
+
+    QTest::newRow("depth 1") << 1;
+    QTest::newRow("depth 8") << 8;
+    QTest::newRow("depth 32") << 32;
+    QTest::newRow("depth 128") << 128;
+}
+
+//time per lookup should stay flat as depth grows
+void FileTrackerTest::DirExistByDepth() {
+    QFETCH(int, depth);
+
+    FileTracker tracker;
+
+    QString sub_path;
+    for (int i = 0; i < depth; i++) {
+        QString name = "directory" + QString::number(i);
+        tracker.AddDirSubPath(sub_path, name, "");
+        sub_path += "\\" + name;
+    }
+
+    QString file_path = sub_path + "\\file.jpg";
+
+    QBENCHMARK {
+        tracker.DirExist(sub_path);
+        tracker.DirExist(file_path);
+    }
+
+    QVERIFY(tracker.DirExist(sub_path) == true);
+    QVERIFY(tracker.DirExist(file_path) == false);
+}
+
 QTEST_APPLESS_MAIN(FileTrackerTest)
 
 #include "tst_filetrackertest.moc"
@@ -0,0 +1,16 @@
+QT += testlib concurrent
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_hashenginetest.cpp \
+    ../../hash_engine.cpp \
+    ../../io_scheduler.cpp \
+    ../../blake3.cpp
+
+HEADERS +=
+
+win32: LIBS += -lbcrypt
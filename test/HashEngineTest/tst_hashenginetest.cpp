@@ -0,0 +1,318 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QCryptographicHash>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../../hash_engine.h"
+#include "../../blake3.h"
+#include "../../error.h"
+
+// add necessary includes here
+
+class HashEngineTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    HashEngineTest();
+    ~HashEngineTest();
+
+    QTemporaryDir temp_dir;
+
+    QString WriteFile(const QString& name, const QByteArray& data);
+    static QByteArray Pattern(int size);
+    static QString ExpectedHash(const QByteArray& data);
+
+private slots:
+
+    void EmptyFile();
+    void KnownDigest();
+    void BlockBoundaries();
+    void MissingFile();
+    void Cancelled();
+    void IncrementalMatchesOneShot();
+    void Blake3KnownDigests();
+    void Blake3SplitsAgree();
+    void FingerprintAlgo();
+    void QuickHashMatchesFingerprint();
+    void QuickHashSkipsMiddle();
+    void Throughput();
+};
+
+HashEngineTest::HashEngineTest()
+{
+
+}
+
+HashEngineTest::~HashEngineTest()
+{
+
+}
+
+QString
+HashEngineTest::WriteFile(const QString& name, const QByteArray& data) {
+    QString path = temp_dir.path() + "/" + name;
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+QByteArray
+HashEngineTest::Pattern(int size) {
+    QByteArray data(size, '\0');
+    for (int i = 0; i < size; i++) {
+        data[i] = (char) ((i * 131) ^ (i >> 8));
+    }
+    return data;
+}
+
+QString
+HashEngineTest::ExpectedHash(const QByteArray& data) {
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+}
+
+void
+HashEngineTest::EmptyFile() {
+    std::atomic_bool cancel_flag(false);
+    QString hash;
+
+    QVERIFY(HashEngine::FileSHA256(WriteFile("empty", QByteArray()), cancel_flag, &hash) == 1);
+    QVERIFY(hash == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+}
+
+void
+HashEngineTest::KnownDigest() {
+    std::atomic_bool cancel_flag(false);
+    QString hash;
+
+    QVERIFY(HashEngine::FileSHA256(WriteFile("abc", QByteArray("abc")), cancel_flag, &hash) == 1);
+    QVERIFY(hash == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+void
+HashEngineTest::BlockBoundaries() {
+    const int block_size = 64 * 1024;
+    std::atomic_bool cancel_flag(false);
+
+    //tail shorter, equal and longer than a block, and more blocks than buffers
+    std::vector<int> size_list = { 1, HASH_ENGINE_ALIGNMENT - 1, HASH_ENGINE_ALIGNMENT, block_size - 1, block_size, block_size + 1, 2 * block_size, 5 * block_size + 17 };
+
+    for (int size : size_list) {
+        QByteArray data = Pattern(size);
+        QString hash;
+
+        QVERIFY(HashEngine::FileSHA256(WriteFile("boundary", data), cancel_flag, &hash, block_size) == 1);
+        QVERIFY(hash == ExpectedHash(data));
+    }
+}
+
+void
+HashEngineTest::MissingFile() {
+    std::atomic_bool cancel_flag(false);
+    QString hash;
+
+    QVERIFY(HashEngine::FileSHA256(temp_dir.path() + "/missing", cancel_flag, &hash) == -Error::QFILE_OPEN);
+    QVERIFY(hash.isEmpty());
+}
+
+void
+HashEngineTest::Cancelled() {
+    std::atomic_bool cancel_flag(true);
+    QString hash;
+
+    QVERIFY(HashEngine::FileSHA256(WriteFile("cancelled", Pattern(1024)), cancel_flag, &hash) == -Error::HASH_CANCELLED);
+    QVERIFY(hash.isEmpty());
+}
+
+void
+HashEngineTest::IncrementalMatchesOneShot() {
+    QByteArray data = Pattern(100000);
+
+    Sha256 hasher;
+    hasher.AddData(data.constData(), 1);
+    hasher.AddData(data.constData() + 1, 4095);
+    hasher.AddData(data.constData() + 4096, data.size() - 4096);
+    QVERIFY(QString::fromLatin1(hasher.Result().toHex()) == ExpectedHash(data));
+
+    //starts over after a result
+    hasher.AddData("abc", 3);
+    QVERIFY(QString::fromLatin1(hasher.Result().toHex()) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+//official test vectors, input is i % 251
+void
+HashEngineTest::Blake3KnownDigests() {
+    QVector<QPair<int, QString>> vector_list = {
+        { 0, "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262" },
+        { 1, "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213" },
+        { 1023, "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11" },
+        { 1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7" },
+        { 1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444" },
+        { 2048, "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a" },
+        { 3073, "7124b49501012f81cc7f11ca069ec9226cecb8a2c850cfe644e327d22d3e1cd3" },
+        { 8192, "aae792484c8efe4f19e2ca7d371d8c467ffb10748d8a5a1ae579948f718a2a63" },
+        { 31744, "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47" },
+        { 102400, "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085" }
+    };
+
+    for (const QPair<int, QString>& test_vector : vector_list) {
+        QByteArray data(test_vector.first, '\0');
+        for (int i = 0; i < data.size(); i++) {
+            data[i] = (char) (i % 251);
+        }
+
+        Blake3 hasher;
+        hasher.AddData(data.constData(), data.size());
+        QVERIFY(QString::fromLatin1(hasher.Result().toHex()) == test_vector.second);
+    }
+}
+
+//parallel subtrees, serial subtrees and chunk by chunk all build the same tree
+void
+HashEngineTest::Blake3SplitsAgree() {
+    QByteArray data = Pattern(5 * 1024 * 1024 + 12345);
+
+    Blake3 parallel_hasher;
+    parallel_hasher.AddData(data.constData(), data.size());
+    QByteArray expected = parallel_hasher.Result();
+
+    Blake3 serial_hasher;
+    serial_hasher.SetParallel(false);
+    for (int i = 0; i < data.size(); i += 1024 * 1024) {
+        serial_hasher.AddData(data.constData() + i, std::min(1024 * 1024, data.size() - i));
+    }
+    QVERIFY(serial_hasher.Result() == expected);
+
+    Blake3 small_hasher;
+    for (int i = 0; i < data.size(); i += 1000) {
+        small_hasher.AddData(data.constData() + i, std::min(1000, data.size() - i));
+    }
+    QVERIFY(small_hasher.Result() == expected);
+}
+
+void
+HashEngineTest::FingerprintAlgo() {
+    std::atomic_bool cancel_flag(false);
+    QByteArray data = Pattern(300000);
+    QString path = WriteFile("fingerprint", data);
+
+    Fingerprint sha256_fingerprint;
+    QVERIFY(HashEngine::FileFingerprint(path, HashEngine::SHA256, cancel_flag, &sha256_fingerprint, 64 * 1024) == 1);
+    QVERIFY(sha256_fingerprint.hash == ExpectedHash(data));
+    QVERIFY(sha256_fingerprint.hash_algo == HashEngine::SHA256);
+    QVERIFY(sha256_fingerprint.size == data.size());
+
+    Blake3 hasher;
+    hasher.AddData(data.constData(), data.size());
+
+    Fingerprint blake3_fingerprint;
+    QVERIFY(HashEngine::FileFingerprint(path, HashEngine::BLAKE3, cancel_flag, &blake3_fingerprint, 64 * 1024) == 1);
+    QVERIFY(blake3_fingerprint.hash == QString::fromLatin1(hasher.Result().toHex()));
+    QVERIFY(blake3_fingerprint.hash_algo == HashEngine::BLAKE3);
+
+    //quick hash does not depend on content hash algorithm
+    QVERIFY(blake3_fingerprint.quick_hash == sha256_fingerprint.quick_hash);
+    QVERIFY(blake3_fingerprint.quick_hash.size() == 2 * HASH_ENGINE_QUICK_LEN);
+
+    int algo = -1;
+    QVERIFY(HashEngine::AlgoFromName(HashEngine::AlgoName(HashEngine::BLAKE3), &algo));
+    QVERIFY(algo == HashEngine::BLAKE3);
+    QVERIFY(!HashEngine::AlgoFromName("md5", &algo));
+}
+
+//quick hash computed from full read blocks and from its own two reads agree, around the span edges
+void
+HashEngineTest::QuickHashMatchesFingerprint() {
+    std::atomic_bool cancel_flag(false);
+    std::vector<int> size_list = { 0, 1, HASH_ENGINE_QUICK_SPAN - 1, HASH_ENGINE_QUICK_SPAN, HASH_ENGINE_QUICK_SPAN + 1,
+                                   2 * HASH_ENGINE_QUICK_SPAN - 1, 2 * HASH_ENGINE_QUICK_SPAN, 2 * HASH_ENGINE_QUICK_SPAN + 1, 1000000 };
+
+    for (int size : size_list) {
+        QString path = WriteFile("quick", Pattern(size));
+
+        Fingerprint full;
+        QVERIFY(HashEngine::FileFingerprint(path, HashEngine::SHA256, cancel_flag, &full, 16 * 1024) == 1);
+
+        Fingerprint quick;
+        QVERIFY(HashEngine::FileQuickHash(path, &quick) == 1);
+        QVERIFY(quick.size == size);
+        QVERIFY(quick.quick_hash == full.quick_hash);
+        QVERIFY(quick.hash.isEmpty());
+    }
+}
+
+void
+HashEngineTest::QuickHashSkipsMiddle() {
+    std::atomic_bool cancel_flag(false);
+    QByteArray data = Pattern(1000000);
+
+    Fingerprint before;
+    QVERIFY(HashEngine::FileFingerprint(WriteFile("middle", data), HashEngine::BLAKE3, cancel_flag, &before) == 1);
+
+    //middle changed, only the full hash can tell
+    data[500000] = (char) (data[500000] + 1);
+
+    Fingerprint after;
+    QVERIFY(HashEngine::FileFingerprint(WriteFile("middle", data), HashEngine::BLAKE3, cancel_flag, &after) == 1);
+    QVERIFY(after.quick_hash == before.quick_hash);
+    QVERIFY(after.hash != before.hash);
+
+    //end changed, quick hash already tells
+    data[data.size() - 1] = (char) (data[data.size() - 1] + 1);
+
+    QVERIFY(HashEngine::FileFingerprint(WriteFile("middle", data), HashEngine::BLAKE3, cancel_flag, &after) == 1);
+    QVERIFY(after.quick_hash != before.quick_hash);
+}
+
+//not a pass or fail, reports GB/s per thread hashing a cached file
+void
+HashEngineTest::Throughput() {
+    const int file_size = 128 * 1024 * 1024;
+    const int max_thread_count = std::max(1, std::min(4, (int) std::thread::hardware_concurrency()));
+
+    QString path = WriteFile("throughput", Pattern(file_size));
+
+    {
+        Sha256 hasher;
+        qInfo("sha256 provider: %s", hasher.IsSystemProvider() ? "system" : "fallback");
+    }
+
+    for (int thread_count = 1; thread_count <= max_thread_count; thread_count *= 2) {
+
+        for (int algo = 0; algo < HashEngine::ALGO_COUNT; algo++) {
+
+            std::vector<std::thread> thread_list;
+            std::atomic_int fail_count(0);
+
+            auto begin = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < thread_count; i++) {
+                thread_list.emplace_back([&path, &fail_count, algo]() {
+                    std::atomic_bool cancel_flag(false);
+                    Fingerprint fingerprint;
+                    if (HashEngine::FileFingerprint(path, algo, cancel_flag, &fingerprint) < 0) {
+                        fail_count++;
+                    }
+                });
+            }
+
+            for (std::thread& thread : thread_list) {
+                thread.join();
+            }
+
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            QVERIFY(fail_count.load() == 0);
+
+            qInfo("%s, %d file(s) at once: %.2f GB/s per file", HashEngine::AlgoName(algo).toLatin1().constData(), thread_count,
+                  (double) file_size / (1024.0 * 1024 * 1024) / sec);
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(HashEngineTest)
+
+#include "tst_hashenginetest.moc"
@@ -0,0 +1,259 @@
+#include <QtTest>
+#include <chrono>
+#include <thread>
+#include "../../hash_service.h"
+
+// add necessary includes here
+
+//stands in for file hashing, records the order paths were hashed in
+//paths starting with "block" spin until cancelled
+struct FakeHasher {
+    std::mutex              mutex;
+    std::vector<QString>    hashed_list;
+    std::atomic_int         blocked_count{0};
+
+    HashService::HashFunc Func() {
+        return [this](const QString& abs_path, const std::atomic_bool& cancel_flag, Fingerprint* fingerprint_out) -> int {
+
+            if (abs_path.startsWith("block")) {
+                blocked_count++;
+                while (!cancel_flag.load()) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                return -1;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            hashed_list.push_back(abs_path);
+            fingerprint_out->hash = "hash:" + abs_path;
+            return 1;
+        };
+    }
+};
+
+class HashServiceTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    HashServiceTest();
+    ~HashServiceTest();
+
+    static bool WaitResults(HashService& service, int count, QVector<HashResult>* out);
+    static bool WaitUntil(const std::function<bool()>& cond);
+
+private slots:
+
+    void HashesSubmittedFile();
+    void PriorityOrder();
+    void DuplicateCoalesced();
+    void DuplicateRaisesPriority();
+    void CancelQueued();
+    void CancelInFlight();
+    void ResubmitRestartsInFlight();
+    void NotifyCalled();
+};
+
+HashServiceTest::HashServiceTest()
+{
+
+}
+
+HashServiceTest::~HashServiceTest()
+{
+
+}
+
+bool
+HashServiceTest::WaitResults(HashService& service, int count, QVector<HashResult>* out) {
+    return WaitUntil([&service, count, out]() {
+        QVector<HashResult> result_list;
+        service.TakeResults(&result_list);
+        for (const HashResult& result : result_list) {
+            out->push_back(result);
+        }
+        return out->size() >= count;
+    });
+}
+
+bool
+HashServiceTest::WaitUntil(const std::function<bool()>& cond) {
+    for (int i = 0; i < 5000; i++) {
+        if (cond()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+void
+HashServiceTest::HashesSubmittedFile() {
+    FakeHasher hasher;
+    HashService service(hasher.Func());
+    service.Start(2);
+
+    service.Submit(7, "a.jpg", HashService::LIVE);
+
+    QVector<HashResult> result_list;
+    QVERIFY(WaitResults(service, 1, &result_list));
+    QVERIFY(result_list[0].media_id == 7);
+    QVERIFY(result_list[0].abs_path == "a.jpg");
+    QVERIFY(result_list[0].fingerprint.hash == "hash:a.jpg");
+    QVERIFY(result_list[0].ret == 1);
+    QVERIFY(!service.IsPending(7));
+}
+
+void
+HashServiceTest::PriorityOrder() {
+    FakeHasher hasher;
+    HashService service(hasher.Func());
+
+    //queued before any worker runs so order is decided by priority alone
+    service.Submit(1, "b1", HashService::BACKFILL);
+    service.Submit(2, "b2", HashService::BACKFILL);
+    service.Submit(3, "l1", HashService::LIVE);
+    service.Submit(4, "i1", HashService::INTERACTIVE);
+    service.Submit(5, "l2", HashService::LIVE);
+    QVERIFY(service.GetPendingCount() == 5);
+
+    service.Start(1);
+
+    QVector<HashResult> result_list;
+    QVERIFY(WaitResults(service, 5, &result_list));
+
+    QVERIFY(hasher.hashed_list.size() == 5);
+    QVERIFY(hasher.hashed_list[0] == "i1");
+    QVERIFY(hasher.hashed_list[1] == "l1");
+    QVERIFY(hasher.hashed_list[2] == "l2");
+    QVERIFY(hasher.hashed_list[3] == "b1");
+    QVERIFY(hasher.hashed_list[4] == "b2");
+}
+
+void
+HashServiceTest::DuplicateCoalesced() {
+    FakeHasher hasher;
+    HashService service(hasher.Func());
+
+    service.Submit(1, "old.jpg", HashService::LIVE);
+    service.Submit(1, "new.jpg", HashService::LIVE);
+    QVERIFY(service.GetPendingCount() == 1);
+
+    service.Start(1);
+
+    QVector<HashResult> result_list;
+    QVERIFY(WaitResults(service, 1, &result_list));
+    QVERIFY(result_list[0].abs_path == "new.jpg");
+
+    //nothing else shows up
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    service.TakeResults(&result_list);
+    QVERIFY(result_list.empty());
+    QVERIFY(hasher.hashed_list.size() == 1);
+}
+
+void
+HashServiceTest::DuplicateRaisesPriority() {
+    FakeHasher hasher;
+    HashService service(hasher.Func());
+
+    service.Submit(1, "b1", HashService::BACKFILL);
+    service.Submit(2, "b2", HashService::BACKFILL);
+    service.Submit(3, "l1", HashService::LIVE);
+    service.Submit(2, "b2", HashService::INTERACTIVE);
+
+    //lower priority never demotes
+    service.Submit(3, "l1", HashService::BACKFILL);
+
+    service.Start(1);
+
+    QVector<HashResult> result_list;
+    QVERIFY(WaitResults(service, 3, &result_list));
+    QVERIFY(hasher.hashed_list[0] == "b2");
+    QVERIFY(hasher.hashed_list[1] == "l1");
+    QVERIFY(hasher.hashed_list[2] == "b1");
+}
+
+void
+HashServiceTest::CancelQueued() {
+    FakeHasher hasher;
+    HashService service(hasher.Func());
+
+    service.Submit(1, "a.jpg", HashService::LIVE);
+    service.Submit(2, "b.jpg", HashService::LIVE);
+    service.Cancel(1);
+    QVERIFY(!service.IsPending(1));
+    QVERIFY(service.IsPending(2));
+
+    service.Start(1);
+
+    QVector<HashResult> result_list;
+    QVERIFY(WaitResults(service, 1, &result_list));
+    QVERIFY(result_list.size() == 1);
+    QVERIFY(result_list[0].media_id == 2);
+}
+
+void
+HashServiceTest::CancelInFlight() {
+    FakeHasher hasher;
+    HashService service(hasher.Func());
+    service.Start(1);
+
+    service.Submit(1, "block.mp4", HashService::LIVE);
+    QVERIFY(WaitUntil([&hasher]() { return hasher.blocked_count.load() == 1; }));
+    QVERIFY(service.IsPending(1));
+
+    service.Cancel(1);
+    QVERIFY(!service.IsPending(1));
+
+    //worker is free again and the cancelled run left nothing behind
+    service.Submit(2, "a.jpg", HashService::LIVE);
+
+    QVector<HashResult> result_list;
+    QVERIFY(WaitResults(service, 1, &result_list));
+    QVERIFY(result_list.size() == 1);
+    QVERIFY(result_list[0].media_id == 2);
+}
+
+void
+HashServiceTest::ResubmitRestartsInFlight() {
+    FakeHasher hasher;
+    HashService service(hasher.Func());
+    service.Start(2);
+
+    service.Submit(1, "block.mp4", HashService::LIVE);
+    QVERIFY(WaitUntil([&hasher]() { return hasher.blocked_count.load() == 1; }));
+
+    //file changed while it was being hashed
+    service.Submit(1, "a.mp4", HashService::LIVE);
+
+    QVector<HashResult> result_list;
+    QVERIFY(WaitResults(service, 1, &result_list));
+    QVERIFY(result_list.size() == 1);
+    QVERIFY(result_list[0].media_id == 1);
+    QVERIFY(result_list[0].abs_path == "a.mp4");
+    QVERIFY(WaitUntil([&service]() { return !service.IsPending(1); }));
+}
+
+void
+HashServiceTest::NotifyCalled() {
+    FakeHasher hasher;
+    HashService service(hasher.Func());
+
+    std::atomic_int notify_count(0);
+    service.SetResultNotify([&notify_count]() { notify_count++; });
+    service.Start(2);
+
+    service.Submit(1, "a.jpg", HashService::LIVE);
+    service.Submit(2, "b.jpg", HashService::BACKFILL);
+
+    QVERIFY(WaitUntil([&notify_count]() { return notify_count.load() == 2; }));
+
+    QVector<HashResult> result_list;
+    service.TakeResults(&result_list);
+    QVERIFY(result_list.size() == 2);
+}
+
+QTEST_APPLESS_MAIN(HashServiceTest)
+
+#include "tst_hashservicetest.moc"
@@ -0,0 +1,16 @@
+QT += testlib concurrent
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_ioschedulertest.cpp \
+    ../../io_scheduler.cpp \
+    ../../hash_engine.cpp \
+    ../../blake3.cpp
+
+HEADERS +=
+
+win32: LIBS += -lbcrypt
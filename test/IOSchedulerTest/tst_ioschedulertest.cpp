@@ -0,0 +1,321 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../../io_scheduler.h"
+#include "../../hash_engine.h"
+#include "../../error.h"
+
+// add necessary includes here
+
+class IOSchedulerTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    IOSchedulerTest();
+    ~IOSchedulerTest();
+
+    QTemporaryDir temp_dir;
+
+    QString WriteFile(const QString& name, const QByteArray& data);
+    static QByteArray Pattern(int size, int seed);
+    static QByteArray ReadAll(ReadStream& stream, int* ret_out);
+
+private slots:
+
+    void EmptyFile();
+    void ReadsWholeFile();
+    void ConcurrentStreams();
+    void BlocksAreBounded();
+    void CloseMidStream();
+    void MissingFile();
+    void StopFailsOpenStreams();
+    void FingerprintMatchesDirect();
+    void OneDevicePerMount();
+};
+
+IOSchedulerTest::IOSchedulerTest()
+{
+
+}
+
+IOSchedulerTest::~IOSchedulerTest()
+{
+
+}
+
+QString
+IOSchedulerTest::WriteFile(const QString& name, const QByteArray& data) {
+    QString path = temp_dir.path() + "/" + name;
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+QByteArray
+IOSchedulerTest::Pattern(int size, int seed) {
+    QByteArray data(size, '\0');
+    for (int i = 0; i < size; i++) {
+        data[i] = (char) ((i * 131 + seed) ^ (i >> 8));
+    }
+    return data;
+}
+
+QByteArray
+IOSchedulerTest::ReadAll(ReadStream& stream, int* ret_out) {
+    QByteArray data;
+    const char* block;
+    size_t size;
+
+    for (;;) {
+        *ret_out = stream.Next(&block, &size);
+        if (*ret_out < 0 || size == 0) {
+            break;
+        }
+        data.append(block, (int) size);
+    }
+
+    return data;
+}
+
+void
+IOSchedulerTest::EmptyFile() {
+    IOScheduler scheduler;
+    scheduler.Start();
+
+    std::unique_ptr<ReadStream> stream;
+    QVERIFY(scheduler.Open(WriteFile("empty", QByteArray()), &stream) > 0);
+    QVERIFY(stream->GetFileSize() == 0);
+
+    int ret;
+    QVERIFY(ReadAll(*stream, &ret).isEmpty());
+    QVERIFY(ret > 0);
+}
+
+void
+IOSchedulerTest::ReadsWholeFile() {
+    IOScheduler scheduler;
+    scheduler.Start();
+
+    //exact blocks, a tail and less than one block
+    int size_arr[] = { 100, IO_BLOCK_SIZE, IO_BLOCK_SIZE * 2 + 777 };
+
+    for (int size : size_arr) {
+        QByteArray data = Pattern(size, size);
+        std::unique_ptr<ReadStream> stream;
+        QVERIFY(scheduler.Open(WriteFile("whole" + QString::number(size), data), &stream) > 0);
+        QVERIFY(stream->GetFileSize() == (quint64) size);
+
+        int ret;
+        QVERIFY(ReadAll(*stream, &ret) == data);
+        QVERIFY(ret > 0);
+    }
+}
+
+void
+IOSchedulerTest::ConcurrentStreams() {
+    IOSchedulerConfig config;
+    config.pool_blocks = 4;
+
+    IOScheduler scheduler;
+    scheduler.SetConfig(config);
+    scheduler.Start();
+
+    //more hashers than blocks, every one still gets its own file back in order
+    const int file_count = 8;
+    std::vector<QString> path_list;
+    std::vector<QByteArray> data_list;
+    for (int i = 0; i < file_count; i++) {
+        data_list.push_back(Pattern(IO_BLOCK_SIZE + i * 4099, i));
+        path_list.push_back(WriteFile("concurrent" + QString::number(i), data_list.back()));
+    }
+
+    std::atomic_int match_count(0);
+    std::vector<std::thread> thread_list;
+    for (int i = 0; i < file_count; i++) {
+        thread_list.emplace_back([&, i]() {
+            std::unique_ptr<ReadStream> stream;
+            if (scheduler.Open(path_list[i], &stream) < 0) {
+                return;
+            }
+
+            int ret;
+            if (ReadAll(*stream, &ret) == data_list[i] && ret > 0) {
+                match_count++;
+            }
+        });
+    }
+
+    for (std::thread& thread : thread_list) {
+        thread.join();
+    }
+
+    QVERIFY(match_count == file_count);
+    QVERIFY(scheduler.GetFreeBlockCount() == 4);
+}
+
+void
+IOSchedulerTest::BlocksAreBounded() {
+    IOSchedulerConfig config;
+    config.pool_blocks = 8;
+
+    IOScheduler scheduler;
+    scheduler.SetConfig(config);
+    scheduler.Start();
+
+    //nothing taken yet, readers fill ahead only up to the per stream limit
+    std::unique_ptr<ReadStream> stream;
+    QVERIFY(scheduler.Open(WriteFile("bounded", Pattern(IO_BLOCK_SIZE * 6, 1)), &stream) > 0);
+
+    for (int i = 0; i < 100 && scheduler.GetFreeBlockCount() > 8 - IO_STREAM_MAX_BLOCKS; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    QVERIFY(scheduler.GetFreeBlockCount() == 8 - IO_STREAM_MAX_BLOCKS);
+
+    int ret;
+    QVERIFY(ReadAll(*stream, &ret).size() == IO_BLOCK_SIZE * 6);
+    QVERIFY(ret > 0);
+
+    stream->Close();
+    QVERIFY(scheduler.GetFreeBlockCount() == 8);
+}
+
+void
+IOSchedulerTest::CloseMidStream() {
+    IOSchedulerConfig config;
+    config.pool_blocks = 4;
+
+    IOScheduler scheduler;
+    scheduler.SetConfig(config);
+    scheduler.Start();
+
+    std::unique_ptr<ReadStream> stream;
+    QVERIFY(scheduler.Open(WriteFile("closed", Pattern(IO_BLOCK_SIZE * 4, 2)), &stream) > 0);
+
+    const char* block;
+    size_t size;
+    QVERIFY(stream->Next(&block, &size) > 0);
+    QVERIFY(size == IO_BLOCK_SIZE);
+
+    //blocks come back even with a read in flight
+    stream.reset();
+
+    for (int i = 0; i < 100 && scheduler.GetFreeBlockCount() < 4; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    QVERIFY(scheduler.GetFreeBlockCount() == 4);
+
+    //and the pool still serves new streams
+    QByteArray data = Pattern(5000, 3);
+    QVERIFY(scheduler.Open(WriteFile("after_close", data), &stream) > 0);
+
+    int ret;
+    QVERIFY(ReadAll(*stream, &ret) == data);
+}
+
+void
+IOSchedulerTest::MissingFile() {
+    IOScheduler scheduler;
+    scheduler.Start();
+
+    std::unique_ptr<ReadStream> stream;
+    QVERIFY(scheduler.Open(temp_dir.path() + "/missing", &stream) == -Error::QFILE_OPEN);
+    QVERIFY(!stream);
+
+    //nothing opens before start
+    IOScheduler stopped_scheduler;
+    QVERIFY(stopped_scheduler.Open(WriteFile("not_started", "abc"), &stream) == -Error::QFILE_OPEN);
+}
+
+void
+IOSchedulerTest::StopFailsOpenStreams() {
+    IOSchedulerConfig config;
+    config.pool_blocks = 2;
+
+    IOScheduler scheduler;
+    scheduler.SetConfig(config);
+    scheduler.Start();
+
+    std::unique_ptr<ReadStream> first_stream;
+    std::unique_ptr<ReadStream> second_stream;
+    QVERIFY(scheduler.Open(WriteFile("stop_first", Pattern(IO_BLOCK_SIZE * 4, 4)), &first_stream) > 0);
+    QVERIFY(scheduler.Open(WriteFile("stop_second", Pattern(IO_BLOCK_SIZE * 4, 5)), &second_stream) > 0);
+
+    const char* block;
+    size_t size;
+    QVERIFY(first_stream->Next(&block, &size) > 0);
+
+    //second stream may be starved of blocks, stop must not leave it waiting
+    std::atomic_int ret(1);
+    std::thread waiter([&]() {
+        int ret_buff;
+        ReadAll(*second_stream, &ret_buff);
+        ret = ret_buff;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    scheduler.Stop();
+    first_stream.reset();
+
+    waiter.join();
+    QVERIFY(ret == 1 || ret == -Error::QFILE_READ);
+    QVERIFY(!scheduler.IsRunning());
+}
+
+void
+IOSchedulerTest::FingerprintMatchesDirect() {
+    IOScheduler scheduler;
+    scheduler.Start();
+
+    std::atomic_bool cancel_flag(false);
+    QString path = WriteFile("fingerprint", Pattern(IO_BLOCK_SIZE * 3 + 12345, 6));
+
+    for (int algo = 0; algo < HashEngine::ALGO_COUNT; algo++) {
+        Fingerprint direct;
+        Fingerprint scheduled;
+        QVERIFY(HashEngine::FileFingerprint(path, algo, cancel_flag, &direct) > 0);
+        QVERIFY(HashEngine::FileFingerprint(scheduler, path, algo, cancel_flag, &scheduled) > 0);
+
+        QVERIFY(scheduled.size == direct.size);
+        QVERIFY(scheduled.quick_hash == direct.quick_hash);
+        QVERIFY(scheduled.hash == direct.hash);
+        QVERIFY(scheduled.hash_algo == algo);
+    }
+
+    std::atomic_bool cancelled(true);
+    Fingerprint fingerprint;
+    QVERIFY(HashEngine::FileFingerprint(scheduler, path, 0, cancelled, &fingerprint) == -Error::HASH_CANCELLED);
+
+    //stopped scheduler falls back to reading directly
+    scheduler.Stop();
+    QVERIFY(HashEngine::FileFingerprint(scheduler, path, 0, cancel_flag, &fingerprint) > 0);
+    QVERIFY(fingerprint.size == IO_BLOCK_SIZE * 3 + 12345);
+}
+
+void
+IOSchedulerTest::OneDevicePerMount() {
+    IOScheduler scheduler;
+    scheduler.Start();
+
+    QString first_path = WriteFile("device_first", "first");
+    QString second_path = WriteFile("device_second", "second");
+    QVERIFY(IOScheduler::GetDeviceKey(first_path) == IOScheduler::GetDeviceKey(second_path));
+
+    std::unique_ptr<ReadStream> first_stream;
+    std::unique_ptr<ReadStream> second_stream;
+    QVERIFY(scheduler.Open(first_path, &first_stream) > 0);
+    QVERIFY(scheduler.Open(second_path, &second_stream) > 0);
+    QVERIFY(scheduler.GetDeviceCount() == 1);
+}
+
+QTEST_APPLESS_MAIN(IOSchedulerTest)
+
+#include "tst_ioschedulertest.moc"
@@ -44,6 +44,13 @@ private slots:
     void MatchIgnoreDeepSubdir();
     void MatchIgnoreRegression();
 
+    void MatchWildcardBacktrack();
+    void MatchIgnoreDirEntry();
+    void MatchIgnoreSeparators();
+    void DirStateMatchesPath();
+    void DirStatePrunes();
+    void DirStateIgnoredSubpath();
+
 };
 
 IgnoreListTest::IgnoreListTest()
@@ -229,6 +236,90 @@ IgnoreListTest::MatchIgnoreRegression() {
     QVERIFY(list.MatchIgnore("dir5\\dir1\\test") == false);
 }
 
+//compiled matcher tests
+void
+IgnoreListTest::MatchWildcardBacktrack() {
+    QVERIFY(IgnoreList::MatchWildcard("*b.txt", "abc.b.txt") == true);
+    QVERIFY(IgnoreList::MatchWildcard("a*b*c", "abbbc") == true);
+    QVERIFY(IgnoreList::MatchWildcard("a**c", "abc") == true);
+    QVERIFY(IgnoreList::MatchWildcard("ab*ab", "ab") == false);
+    QVERIFY(IgnoreList::MatchWildcard("*.tmp", "tmp") == false);
+}
+
+void
+IgnoreListTest::MatchIgnoreDirEntry() {
+    //dir entries cover what is inside the dir, not a file of the same name
+    QVERIFY(list.MatchIgnore("dir1") == false);
+    QVERIFY(list.MatchIgnoreDir("\\dir1") == true);
+    QVERIFY(list.MatchIgnoreDir("\\dir1\\dir2") == true);
+    QVERIFY(list.MatchIgnoreDir("\\dir2") == false);
+
+    //file entries never ignore a dir
+    QVERIFY(list.MatchIgnoreDir("\\concrete1") == false);
+}
+
+void
+IgnoreListTest::MatchIgnoreSeparators() {
+    QVERIFY(list.MatchIgnore("\\dir2\\concrete1") == true);
+    QVERIFY(list.MatchIgnore("dir2\\\\concrete1") == true);
+    QVERIFY(list.MatchIgnore("\\") == false);
+    QVERIFY(list.MatchIgnore("") == false);
+}
+
+void
+IgnoreListTest::DirStateMatchesPath() {
+    QStringList path_list = {
+        "dir2\\concrete1", "dir2\\concrete2", "dir3\\dll.type", "dir3\\dir1\\test.type",
+        "dir4\\dir1\\dir1\\dir1\\concrete1", "dir4\\dir1\\dir1\\test", "dir5\\dir1\\spng", "dir5\\test",
+        "sven.type", "sfile", "dir1\\dir2\\concrete2"
+    };
+
+    //walking down dir by dir gives the same answer as matching the whole path
+    for (const QString& path : path_list) {
+        QStringList component_list = path.split("\\");
+        QString file_name = component_list.takeLast();
+
+        IgnoreDirState state = list.GetDirState(QString());
+        bool dir_ignored = false;
+        for (const QString& dir_name : component_list) {
+            IgnoreDirState child_state;
+            dir_ignored = list.MatchIgnoreDir(state, dir_name, &child_state) || dir_ignored;
+            state = child_state;
+        }
+
+        QVERIFY((dir_ignored || list.MatchIgnore(state, file_name)) == list.MatchIgnore(path));
+        QVERIFY(list.MatchIgnore(list.GetDirState(component_list.join("\\")), file_name) == list.MatchIgnore(path));
+    }
+}
+
+void
+IgnoreListTest::DirStatePrunes() {
+    //no entry starts with this dir, nothing below it needs matching
+    IgnoreDirState state = list.GetDirState("\\unrelated");
+    QVERIFY(state.node_list.isEmpty());
+    QVERIFY(state.ignored == false);
+
+    IgnoreDirState child_state;
+    QVERIFY(list.MatchIgnoreDir(state, "dir1", &child_state) == false);
+    QVERIFY(child_state.node_list.isEmpty());
+
+    //wildcard entries at the root still apply to files in it
+    QVERIFY(list.MatchIgnore(list.GetDirState(QString()), "f1") == true);
+    QVERIFY(list.MatchIgnore(state, "f1") == false);
+}
+
+void
+IgnoreListTest::DirStateIgnoredSubpath() {
+    //rescans can start below an ignored dir
+    IgnoreDirState state = list.GetDirState("\\dir1\\deeper");
+    QVERIFY(state.ignored == true);
+    QVERIFY(list.MatchIgnore(state, "anything") == true);
+
+    IgnoreDirState child_state;
+    QVERIFY(list.MatchIgnoreDir(state, "child", &child_state) == true);
+    QVERIFY(child_state.ignored == true);
+}
+
 QTEST_APPLESS_MAIN(IgnoreListTest)
 
 #include "tst_ignorelisttest.moc"
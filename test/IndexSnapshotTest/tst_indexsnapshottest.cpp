@@ -0,0 +1,352 @@
+#include <QtTest>
+#include <QReadWriteLock>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../../index_snapshot.h"
+
+// add necessary includes here
+
+/*
+	Reader latency under a write storm compares readers on the snapshot against readers
+	taking a read lock on the live tables, the way daemon callbacks used to. The writer
+	renames media a batch at a time and holds its write lock for the whole batch, like a
+	directory rename does.
+*/
+
+#define STORM_MEDIA_COUNT           32768
+#define STORM_TAG_MEDIA_COUNT       64
+#define STORM_TAG_COUNT             (STORM_MEDIA_COUNT / STORM_TAG_MEDIA_COUNT)
+#define STORM_BATCH_MEDIA_COUNT     4096        //whole tags, a tag's media are renamed together
+#define STORM_READER_COUNT          4
+#define STORM_READS_PER_READER      20000
+
+class IndexSnapshotTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    IndexSnapshotTest();
+    ~IndexSnapshotTest();
+
+    static Tag MakeTag(unsigned int id, const QString& name, const QSet<unsigned int>& media_id_set);
+    static Media MakeMedia(unsigned int id, const QString& long_name);
+
+    static qint64 Percentile(std::vector<qint64>& latency_list, double percentile);
+
+private slots:
+
+    void PinnedSnapshotUnchanged();
+    void UnchangedShardsShared();
+    void TagNameMovesBetweenTags();
+    void MediaCount();
+    void GenerationOnlyPublish();
+    void ReaderLatencyUnderWriteStorm();
+
+private:
+
+    //latency in usec of every read, false if a reader saw half of a batch
+    bool RunStorm(bool use_snapshot, std::vector<qint64>* latency_out, int* batch_count_out);
+};
+
+IndexSnapshotTest::IndexSnapshotTest()
+{
+
+}
+
+IndexSnapshotTest::~IndexSnapshotTest()
+{
+
+}
+
+Tag
+IndexSnapshotTest::MakeTag(unsigned int id, const QString& name, const QSet<unsigned int>& media_id_set) {
+    Tag tag;
+    tag.id = id;
+    tag.count = media_id_set.size();
+    tag.name = name;
+    tag.media_id_list = media_id_set;
+    return tag;
+}
+
+Media
+IndexSnapshotTest::MakeMedia(unsigned int id, const QString& long_name) {
+    Media media;
+    media.id = id;
+    media.sub_path = "dir";
+    media.long_name = long_name;
+    return media;
+}
+
+qint64
+IndexSnapshotTest::Percentile(std::vector<qint64>& latency_list, double percentile) {
+    size_t idx = (size_t) (percentile * (latency_list.size() - 1));
+    std::nth_element(latency_list.begin(), latency_list.begin() + idx, latency_list.end());
+    return latency_list[idx];
+}
+
+void
+IndexSnapshotTest::PinnedSnapshotUnchanged() {
+    IndexSnapshotWriter writer;
+
+    writer.SetTag(MakeTag(0, "cat", { 1 }));
+    writer.SetMedia(MakeMedia(1, "a.jpg"));
+    writer.Publish(1);
+
+    std::shared_ptr<const IndexSnapshot> old_snapshot = writer.Pin();
+
+    writer.SetTag(MakeTag(0, "cat", { 1, 2 }));
+    writer.SetMedia(MakeMedia(1, "b.jpg"));
+    writer.SetMedia(MakeMedia(2, "c.jpg"));
+
+    //staged changes are not visible yet
+    QCOMPARE(writer.Pin(), old_snapshot);
+
+    writer.Publish(2);
+
+    std::shared_ptr<const IndexSnapshot> new_snapshot = writer.Pin();
+
+    QCOMPARE(old_snapshot->GetGeneration(), (quint64) 1);
+    QCOMPARE(old_snapshot->GetTagByName("cat")->media_id_list.size(), 1);
+    QCOMPARE(old_snapshot->GetMediaById(1)->long_name, QString("a.jpg"));
+    QVERIFY(old_snapshot->GetMediaById(2) == nullptr);
+
+    QCOMPARE(new_snapshot->GetGeneration(), (quint64) 2);
+    QCOMPARE(new_snapshot->GetTagByName("cat")->media_id_list.size(), 2);
+    QCOMPARE(new_snapshot->GetMediaById(1)->long_name, QString("b.jpg"));
+    QCOMPARE(new_snapshot->GetMediaById(2)->long_name, QString("c.jpg"));
+}
+
+void
+IndexSnapshotTest::UnchangedShardsShared() {
+    IndexSnapshotWriter writer;
+
+    writer.SetMedia(MakeMedia(1, "a.jpg"));
+    writer.SetMedia(MakeMedia(2, "b.jpg"));
+    writer.SetMedia(MakeMedia(1 + INDEX_SNAPSHOT_MEDIA_SHARD_COUNT, "c.jpg"));
+    writer.Publish(1);
+
+    std::shared_ptr<const IndexSnapshot> old_snapshot = writer.Pin();
+
+    writer.SetMedia(MakeMedia(1, "d.jpg"));
+    writer.Publish(2);
+
+    std::shared_ptr<const IndexSnapshot> new_snapshot = writer.Pin();
+
+    //media 2 lives in a shard nothing touched, media 1's shard was copied with its neighbour
+    QCOMPARE(new_snapshot->GetMediaById(2), old_snapshot->GetMediaById(2));
+    QVERIFY(new_snapshot->GetMediaById(1) != old_snapshot->GetMediaById(1));
+    QCOMPARE(new_snapshot->GetMediaById(1 + INDEX_SNAPSHOT_MEDIA_SHARD_COUNT)->long_name, QString("c.jpg"));
+}
+
+void
+IndexSnapshotTest::TagNameMovesBetweenTags() {
+    IndexSnapshotWriter writer;
+
+    writer.SetTag(MakeTag(0, "cat", {}));
+    writer.SetTag(MakeTag(1, "dog", {}));
+    writer.Publish(1);
+
+    //dog is renamed to cat after cat is gone, changes can arrive in either order
+    writer.SetTag(MakeTag(1, "cat", {}));
+    writer.RemoveTag(0);
+    writer.Publish(2);
+
+    std::shared_ptr<const IndexSnapshot> snapshot = writer.Pin();
+
+    QCOMPARE(snapshot->GetTagCount(), 1);
+    QVERIFY(snapshot->GetTagById(0) == nullptr);
+    QVERIFY(snapshot->GetTagByName("dog") == nullptr);
+    QCOMPARE(snapshot->GetTagByName("cat")->id, 1u);
+
+    writer.SetTag(MakeTag(2, "bird", {}));
+    writer.SetTag(MakeTag(1, "dog", {}));
+    writer.Publish(3);
+
+    snapshot = writer.Pin();
+
+    QVERIFY(snapshot->GetTagByName("cat") == nullptr);
+    QCOMPARE(snapshot->GetTagByName("dog")->id, 1u);
+    QCOMPARE(snapshot->GetTagByName("bird")->id, 2u);
+}
+
+void
+IndexSnapshotTest::MediaCount() {
+    IndexSnapshotWriter writer;
+
+    for (unsigned int i = 0; i < 1000; i++) {
+        writer.SetMedia(MakeMedia(i, "a.jpg"));
+    }
+    writer.SetMedia(MakeMedia(5, "b.jpg"));
+    writer.Publish(1);
+
+    QCOMPARE(writer.Pin()->GetMediaCount(), 1000);
+
+    writer.RemoveMedia(5);
+    writer.RemoveMedia(5);
+    writer.RemoveMedia(5000);
+    writer.Publish(2);
+
+    std::shared_ptr<const IndexSnapshot> snapshot = writer.Pin();
+    QCOMPARE(snapshot->GetMediaCount(), 999);
+
+    int visited_count = 0;
+    snapshot->ForEachMedia([&visited_count](const Media&) {
+        visited_count++;
+    });
+    QCOMPARE(visited_count, 999);
+}
+
+void
+IndexSnapshotTest::GenerationOnlyPublish() {
+    IndexSnapshotWriter writer;
+
+    writer.SetTag(MakeTag(0, "cat", {}));
+    writer.Publish(1);
+
+    std::shared_ptr<const IndexSnapshot> snapshot = writer.Pin();
+
+    writer.Publish(1);
+    QCOMPARE(writer.Pin(), snapshot);
+
+    writer.Publish(2);
+    QVERIFY(writer.Pin() != snapshot);
+    QCOMPARE(writer.Pin()->GetGeneration(), (quint64) 2);
+    QCOMPARE(writer.Pin()->GetTagByName("cat")->id, 0u);
+}
+
+bool
+IndexSnapshotTest::RunStorm(bool use_snapshot, std::vector<qint64>* latency_out, int* batch_count_out) {
+    IndexSnapshotWriter writer;
+    QReadWriteLock live_lock;
+    QHash<unsigned int, Tag> live_tag_table;
+    QHash<unsigned int, Media> live_media_table;
+
+    for (unsigned int tag_id = 0; tag_id < STORM_TAG_COUNT; tag_id++) {
+        QSet<unsigned int> media_id_set;
+        for (unsigned int i = 0; i < STORM_TAG_MEDIA_COUNT; i++) {
+            media_id_set.insert(tag_id * STORM_TAG_MEDIA_COUNT + i);
+        }
+
+        Tag tag = MakeTag(tag_id, "tag" + QString::number(tag_id), media_id_set);
+        live_tag_table.insert(tag_id, tag);
+        writer.SetTag(tag);
+    }
+
+    for (unsigned int media_id = 0; media_id < STORM_MEDIA_COUNT; media_id++) {
+        Media media = MakeMedia(media_id, "0");
+        live_media_table.insert(media_id, media);
+        writer.SetMedia(media);
+    }
+
+    writer.Publish(0);
+
+    std::atomic_bool done(false);
+    std::atomic_bool consistent(true);
+    std::vector<std::vector<qint64>> latency_table(STORM_READER_COUNT);
+
+    //a reader looks up a tag and every one of its media, like GetTagMedias
+    auto read_tag = [&consistent](const Tag* tag, auto get_media) {
+        QString version;
+        for (auto iter = tag->media_id_list.constBegin(); iter != tag->media_id_list.constEnd(); iter++) {
+            const Media* media = get_media(*iter);
+            if (version.isEmpty()) {
+                version = media->long_name;
+            }
+            else if (media->long_name != version) {
+                consistent = false;
+            }
+        }
+    };
+
+    std::vector<std::thread> reader_list;
+    for (int reader = 0; reader < STORM_READER_COUNT; reader++) {
+        reader_list.emplace_back([&, reader]() {
+            QElapsedTimer timer;
+
+            for (int i = 0; i < STORM_READS_PER_READER; i++) {
+                unsigned int tag_id = (i * STORM_READER_COUNT + reader) % STORM_TAG_COUNT;
+
+                timer.start();
+
+                if (use_snapshot) {
+                    std::shared_ptr<const IndexSnapshot> snapshot = writer.Pin();
+                    read_tag(snapshot->GetTagById(tag_id), [&snapshot](unsigned int media_id) {
+                        return snapshot->GetMediaById(media_id);
+                    });
+                }
+                else {
+                    live_lock.lockForRead();
+                    read_tag(&*live_tag_table.constFind(tag_id), [&live_media_table](unsigned int media_id) {
+                        return &*live_media_table.constFind(media_id);
+                    });
+                    live_lock.unlock();
+                }
+
+                latency_table[reader].push_back(timer.nsecsElapsed() / 1000);
+            }
+        });
+    }
+
+    std::thread writer_thread([&]() {
+        int batch_count = 0;
+        unsigned int next_media_id = 0;
+
+        while (!done) {
+            batch_count++;
+            QString version = QString::number(batch_count);
+
+            live_lock.lockForWrite();
+
+            for (int i = 0; i < STORM_BATCH_MEDIA_COUNT; i++) {
+                Media& media = live_media_table[next_media_id];
+                media.long_name = version;
+                writer.SetMedia(media);
+
+                next_media_id = (next_media_id + 1) % STORM_MEDIA_COUNT;
+            }
+
+            writer.Publish(batch_count);
+
+            live_lock.unlock();
+        }
+
+        *batch_count_out = batch_count;
+    });
+
+    for (std::thread& thread : reader_list) {
+        thread.join();
+    }
+
+    done = true;
+    writer_thread.join();
+
+    for (const std::vector<qint64>& latency_list : latency_table) {
+        latency_out->insert(latency_out->end(), latency_list.begin(), latency_list.end());
+    }
+
+    return consistent;
+}
+
+void
+IndexSnapshotTest::ReaderLatencyUnderWriteStorm() {
+    for (bool use_snapshot : { false, true }) {
+        std::vector<qint64> latency_list;
+        int batch_count = 0;
+
+        QVERIFY(RunStorm(use_snapshot, &latency_list, &batch_count));
+
+        qint64 p50 = Percentile(latency_list, 0.50);
+        qint64 p99 = Percentile(latency_list, 0.99);
+        qint64 max = *std::max_element(latency_list.begin(), latency_list.end());
+
+        qInfo("%s: p50 %lld us, p99 %lld us, max %lld us, %d write batches", use_snapshot ? "snapshot" : "read lock",
+            p50, p99, max, batch_count);
+    }
+}
+
+QTEST_APPLESS_MAIN(IndexSnapshotTest)
+
+#include "tst_indexsnapshottest.moc"
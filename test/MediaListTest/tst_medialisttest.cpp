@@ -31,6 +31,9 @@ private slots:
     void UpdateMediaName();
     void UpdateMediaSubdir();
     void UpdateMediaHash();
+    void UpdateMediaFingerprint();
+    void MediaSameContent();
+    void UpdateMediaSize();
 
 };
 
@@ -314,6 +317,87 @@ MediaListTest::UpdateMediaHash() {
     QVERIFY(info.hash == "hash");
 }
 
+void
+MediaListTest::UpdateMediaFingerprint() {
+    MediaList list;
+
+    MediaInfo media;
+    media.id = 1;
+    media.hash = "old";
+
+    list.InsertMedia(media);
+
+    Fingerprint fingerprint;
+    fingerprint.size = 2048;
+    fingerprint.quick_hash = "quick";
+    fingerprint.hash = "hash";
+    fingerprint.hash_algo = HashEngine::BLAKE3;
+    list.UpdateMediaFingerprint(1, fingerprint);
+
+    MediaInfo info;
+    list.GetMediaInfoById(1, &info);
+
+    QVERIFY(info.size == 2048);
+    QVERIFY(info.quick_hash == "quick");
+    QVERIFY(info.hash == "hash");
+    QVERIFY(info.hash_algo == HashEngine::BLAKE3);
+}
+
+void
+MediaListTest::MediaSameContent() {
+    MediaInfo a;
+    a.size = 100;
+    a.quick_hash = "q1";
+    a.hash = "h1";
+
+    MediaInfo b = a;
+    QVERIFY(a.SameContent(b));
+
+    //nothing but size to go by
+    b.quick_hash.clear();
+    b.hash.clear();
+    QVERIFY(!a.SameContent(b));
+
+    //quick hash alone is not enough while the full hash is pending
+    b.quick_hash = "q1";
+    QVERIFY(!a.SameContent(b));
+
+    b.hash = "h1";
+    QVERIFY(a.SameContent(b));
+
+    b.size = 101;
+    QVERIFY(!a.SameContent(b));
+
+    b.size = 100;
+    b.hash = "h2";
+    QVERIFY(!a.SameContent(b));
+
+    //hashes of different algorithms are not compared, nothing left to confirm with
+    b.hash = "h1";
+    b.hash_algo = a.hash_algo + 1;
+    QVERIFY(!a.SameContent(b));
+
+    b.hash_algo = a.hash_algo;
+    b.quick_hash = "q2";
+    QVERIFY(!a.SameContent(b));
+}
+
+void
+MediaListTest::UpdateMediaSize() {
+    MediaList list;
+
+    MediaInfo media;
+    media.id = 1;
+
+    list.InsertMedia(media);
+    list.UpdateMediaSize(1, 1024);
+
+    MediaInfo info;
+    list.GetMediaInfoById(1, &info);
+
+    QVERIFY(info.size == 1024);
+}
+
 QTEST_APPLESS_MAIN(MediaListTest)
 
 #include "tst_medialisttest.moc"
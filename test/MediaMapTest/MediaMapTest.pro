@@ -0,0 +1,13 @@
+QT += testlib concurrent
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_mediamaptest.cpp \
+    ../../media_map.cpp \
+    ../../logger.cpp
+
+HEADERS += ../../logger.h
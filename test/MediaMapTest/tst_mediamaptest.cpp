@@ -0,0 +1,264 @@
+#include <QtTest>
+#include <QFile>
+#include <QTextStream>
+#include <QRegularExpression>
+#include "../../media_map.h"
+
+// add necessary includes here
+
+class MediaMapTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MediaMapTest();
+    ~MediaMapTest();
+
+    static void CreateMapFile(const QString& content);
+    static MediaInfo MakeMedia(const QString& sub_path, const QString& long_name);
+
+private slots:
+
+    void RequiredLiteralExtension();
+    void RequiredLiteralLongestRun();
+    void RequiredLiteralOptional();
+    void RequiredLiteralNone();
+    void RequiredLiteralEscapeArgument();
+    void RequiredLiteralPosixClass();
+    void LiteralMatcherOverlapping();
+    void GetMappedTagsPrefiltered();
+    void GetMappedTagsMatchesRegex();
+    void GetMappedTagsListMatchesSingle();
+    void GetMappedTagsListEscapeAndClass();
+};
+
+MediaMapTest::MediaMapTest()
+{
+
+}
+
+MediaMapTest::~MediaMapTest()
+{
+
+}
+
+void
+MediaMapTest::CreateMapFile(const QString& content) {
+    QFile file(FILENAME_MAP_FILE_NAME);
+    file.open(QIODevice::WriteOnly);
+    QTextStream stream(&file);
+    stream << content;
+    stream.flush();
+    file.close();
+}
+
+MediaInfo
+MediaMapTest::MakeMedia(const QString& sub_path, const QString& long_name) {
+    MediaInfo media;
+    media.sub_path = sub_path;
+    media.long_name = long_name;
+    return media;
+}
+
+void
+MediaMapTest::RequiredLiteralExtension() {
+    QVERIFY(MediaMap::RequiredLiteral("\\.gif$") == ".gif");
+    QVERIFY(MediaMap::RequiredLiteral("^.*\\.webm$") == ".webm");
+}
+
+void
+MediaMapTest::RequiredLiteralLongestRun() {
+    QVERIFY(MediaMap::RequiredLiteral("abc.*defgh") == "defgh");
+    QVERIFY(MediaMap::RequiredLiteral("\\\\art\\\\[0-9]+_sketch") == "_sketch");
+    QVERIFY(MediaMap::RequiredLiteral("abcd(x|y)ef") == "abcd");
+}
+
+void
+MediaMapTest::RequiredLiteralOptional() {
+    //char before an optional quantifier is not required
+    QVERIFY(MediaMap::RequiredLiteral("colou?r") == "colo");
+    QVERIFY(MediaMap::RequiredLiteral("abc{0,2}") == "ab");
+    QVERIFY(MediaMap::RequiredLiteral("xyz*") == "xy");
+    QVERIFY(MediaMap::RequiredLiteral("ab+") == "ab");
+}
+
+void
+MediaMapTest::RequiredLiteralNone() {
+    QVERIFY(MediaMap::RequiredLiteral("gif|png").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("(?i)gif").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("[abc]+\\d").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("(foo)?").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("\\Qa.b\\E").isEmpty());
+}
+
+void
+MediaMapTest::RequiredLiteralEscapeArgument() {
+    //argument of the escape is not literal text
+    QVERIFY(MediaMap::RequiredLiteral("\\x41bc").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("\\x{41}bc").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("(?<n>a)\\k<name>").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("(a)\\g1bc").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("\\0101bc").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("\\101bc").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("\\cAbc").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("\\p{Lu}bc").isEmpty());
+    QVERIFY(MediaMap::RequiredLiteral("\\N{U+41}bc").isEmpty());
+
+    //classes without an argument still just end the run
+    QVERIFY(MediaMap::RequiredLiteral("ab\\dcde") == "cde");
+}
+
+void
+MediaMapTest::RequiredLiteralPosixClass() {
+    QVERIFY(MediaMap::RequiredLiteral("[[:digit:]]x") == "x");
+    QVERIFY(MediaMap::RequiredLiteral("[^[:space:]a]+_cat") == "_cat");
+    QVERIFY(MediaMap::RequiredLiteral("[[:alpha:][:digit:]]]x") == "]x");
+    QVERIFY(MediaMap::RequiredLiteral("[[:digit:").isEmpty());
+}
+
+void
+MediaMapTest::LiteralMatcherOverlapping() {
+    LiteralMatcher matcher;
+    matcher.AddLiteral("he", 0);
+    matcher.AddLiteral("she", 1);
+    matcher.AddLiteral("his", 2);
+    matcher.AddLiteral("hers", 3);
+    matcher.Build();
+
+    QBitArray bits(4);
+    matcher.Match("ushers", &bits);
+
+    QVERIFY(bits.testBit(0) == true);
+    QVERIFY(bits.testBit(1) == true);
+    QVERIFY(bits.testBit(2) == false);
+    QVERIFY(bits.testBit(3) == true);
+}
+
+void
+MediaMapTest::GetMappedTagsPrefiltered() {
+    CreateMapFile("BEGIN\n\\.gif$\nTAG\nanimated\nEND\n"
+                  "BEGIN\n^\\\\art\\\\\nTAG\nart\nEND\n"
+                  "BEGIN\n[0-9]{4}\nTAG\ndated\nEND\n");
+
+    MediaMap map;
+    map.LoadFile();
+    QVERIFY(map.GetSize() == 3);
+
+    QVector<QString> tags;
+    map.GetMappedTags("\\art\\2019_cat.gif", &tags);
+    QVERIFY(tags.size() == 3);
+    QVERIFY(tags.contains("animated"));
+    QVERIFY(tags.contains("art"));
+    QVERIFY(tags.contains("dated"));
+
+    //literal is there but the pattern does not match
+    tags.clear();
+    map.GetMappedTags("\\misc\\cat.gif.png", &tags);
+    QVERIFY(tags.isEmpty());
+
+    //literals are case sensitive like the patterns
+    tags.clear();
+    map.GetMappedTags("\\misc\\cat.GIF", &tags);
+    QVERIFY(tags.isEmpty());
+}
+
+void
+MediaMapTest::GetMappedTagsMatchesRegex() {
+    QStringList pattern_list = { "\\.gif$", "\\.webm$", "^\\\\a", "cat", "c.t", "dog|cat", "(?i)DOG", "x+y", "_[0-9]+_" };
+
+    QString content;
+    for (int i = 0; i < pattern_list.size(); i++) {
+        content += "BEGIN\n" + pattern_list[i] + "\nTAG\ntag" + QString::number(i) + "\nEND\n";
+    }
+    CreateMapFile(content);
+
+    MediaMap map;
+    map.LoadFile();
+
+    QStringList path_list = { "\\a\\cat.gif", "\\b\\dog.webm", "\\xxy\\cut_12_.png", "\\a", "\\b\\c\\d", "\\cot.gifs" };
+
+    //prefilter never drops a pattern that matches
+    for (const QString& path : path_list) {
+        QVector<QString> tags;
+        map.GetMappedTags(path, &tags);
+
+        QVector<QString> expected;
+        for (int i = 0; i < pattern_list.size(); i++) {
+            if (QRegularExpression(pattern_list[i]).match(path).hasMatch()) {
+                expected.push_back("tag" + QString::number(i));
+            }
+        }
+
+        QVERIFY(tags == expected);
+    }
+}
+
+void
+MediaMapTest::GetMappedTagsListMatchesSingle() {
+    CreateMapFile("BEGIN\n\\.gif$\nTAG\nanimated\nEND\n"
+                  "BEGIN\ncat\nTAG\ncat\nEND\n");
+
+    MediaMap map;
+    map.LoadFile();
+
+    QVector<MediaInfo> media_list;
+    for (int i = 0; i < 200; i++) {
+        media_list.push_back(MakeMedia("\\dir" + QString::number(i % 7), (i % 3 == 0 ? "cat" : "dog") + QString::number(i) + (i % 2 == 0 ? ".gif" : ".png")));
+    }
+
+    QVector<QVector<QString>> tags_list;
+    map.GetMappedTagsList(media_list, &tags_list);
+    QVERIFY(tags_list.size() == media_list.size());
+
+    for (int i = 0; i < media_list.size(); i++) {
+        QVector<QString> tags;
+        map.GetMappedTags(media_list[i].GetSubpathLongName(), &tags);
+        QVERIFY(tags_list[i] == tags);
+    }
+
+    //no patterns still gives one empty list per media
+    MediaMap empty_map;
+    empty_map.GetMappedTagsList(media_list, &tags_list);
+    QVERIFY(tags_list.size() == media_list.size());
+    QVERIFY(tags_list[0].isEmpty());
+}
+
+void
+MediaMapTest::GetMappedTagsListEscapeAndClass() {
+    QStringList pattern_list = { "\\x41bc", "[[:digit:]]x", "[^[:space:]]+_cat", "\\cat" };
+
+    QString content;
+    for (int i = 0; i < pattern_list.size(); i++) {
+        content += "BEGIN\n" + pattern_list[i] + "\nTAG\ntag" + QString::number(i) + "\nEND\n";
+    }
+    CreateMapFile(content);
+
+    MediaMap map;
+    map.LoadFile();
+
+    QVector<MediaInfo> media_list = { MakeMedia("\\a", "Abc.png"), MakeMedia("\\a", "7x.png"), MakeMedia("\\a", "41bc.png"),
+                                      MakeMedia("\\a", "x_cat.png"), MakeMedia("\\cat", "]x.png") };
+
+    QVector<QVector<QString>> tags_list;
+    map.GetMappedTagsList(media_list, &tags_list);
+
+    //prefilter never drops a pattern that matches
+    for (int i = 0; i < media_list.size(); i++) {
+        QVector<QString> expected;
+        for (int j = 0; j < pattern_list.size(); j++) {
+            if (QRegularExpression(pattern_list[j]).match(media_list[i].GetSubpathLongName()).hasMatch()) {
+                expected.push_back("tag" + QString::number(j));
+            }
+        }
+
+        QVERIFY(tags_list[i] == expected);
+    }
+
+    QVERIFY(tags_list[0].contains("tag0"));
+    QVERIFY(tags_list[1].contains("tag1"));
+    QVERIFY(!tags_list[2].contains("tag0"));
+}
+
+QTEST_APPLESS_MAIN(MediaMapTest)
+
+#include "tst_mediamaptest.moc"
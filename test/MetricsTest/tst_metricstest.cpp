@@ -0,0 +1,174 @@
+#include <QtTest>
+#include <thread>
+#include <vector>
+#include "../../metrics.h"
+#include "../../metered_lock.h"
+
+// add necessary includes here
+
+class MetricsTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    MetricsTest();
+    ~MetricsTest();
+
+private slots:
+
+    void CounterAddsUpThreads();
+    void HistogramBuckets();
+    void Percentile();
+    void ShardReusedAfterThreadExit();
+    void MeteredLockRecordsWaitAndHold();
+};
+
+MetricsTest::MetricsTest()
+{
+
+}
+
+MetricsTest::~MetricsTest()
+{
+
+}
+
+void
+MetricsTest::CounterAddsUpThreads() {
+    int64_t before = Metrics::Get(Metrics::HASH_TOTAL);
+
+    std::vector<std::thread> thread_list;
+    for (int i = 0; i < 4; i++) {
+        thread_list.emplace_back([]() {
+            for (int j = 0; j < 1000; j++) {
+                Metrics::Inc(Metrics::HASH_TOTAL);
+            }
+        });
+    }
+
+    for (std::thread& thread : thread_list) {
+        thread.join();
+    }
+
+    Metrics::Inc(Metrics::HASH_TOTAL, 5);
+
+    QCOMPARE(Metrics::Get(Metrics::HASH_TOTAL) - before, (int64_t) 4005);
+}
+
+void
+MetricsTest::HistogramBuckets() {
+    Metrics::HistogramSnapshot before = Metrics::Get(Metrics::API_REQUEST);
+
+    Metrics::Record(Metrics::API_REQUEST, 0);
+    Metrics::Record(Metrics::API_REQUEST, 1);
+    Metrics::Record(Metrics::API_REQUEST, 3);
+    Metrics::Record(Metrics::API_REQUEST, 1000);
+    Metrics::Record(Metrics::API_REQUEST, -5);                  //clock went backwards, counted as 0
+    Metrics::Record(Metrics::API_REQUEST, int64_t(1) << 40);    //past the last bucket
+
+    Metrics::HistogramSnapshot after = Metrics::Get(Metrics::API_REQUEST);
+
+    QCOMPARE(after.count - before.count, (int64_t) 6);
+    QCOMPARE(after.sum - before.sum, (int64_t) 1004 + (int64_t(1) << 40));
+    QCOMPARE(after.max, int64_t(1) << 40);
+
+    //bucket i counts values below 2^i
+    QCOMPARE(after.bucket_arr[0] - before.bucket_arr[0], (int64_t) 2);
+    QCOMPARE(after.bucket_arr[1] - before.bucket_arr[1], (int64_t) 1);
+    QCOMPARE(after.bucket_arr[2] - before.bucket_arr[2], (int64_t) 1);
+    QCOMPARE(after.bucket_arr[10] - before.bucket_arr[10], (int64_t) 1);
+    QCOMPARE(after.bucket_arr[Metrics::HISTOGRAM_BUCKET_COUNT - 1] - before.bucket_arr[Metrics::HISTOGRAM_BUCKET_COUNT - 1], (int64_t) 1);
+}
+
+void
+MetricsTest::Percentile() {
+    Metrics::HistogramSnapshot snapshot;
+    QCOMPARE(snapshot.Percentile(0.5), (int64_t) 0);
+
+    //90 values below 8, 10 below 1024 with the biggest 700
+    snapshot.bucket_arr[3] = 90;
+    snapshot.bucket_arr[10] = 10;
+    snapshot.count = 100;
+    snapshot.max = 700;
+
+    QCOMPARE(snapshot.Percentile(0.5), (int64_t) 8);
+    QCOMPARE(snapshot.Percentile(0.9), (int64_t) 8);
+    QCOMPARE(snapshot.Percentile(0.99), (int64_t) 700);
+}
+
+void
+MetricsTest::ShardReusedAfterThreadExit() {
+
+    //make sure this thread has its shard before counting
+    Metrics::SetThreadName("test");
+
+    std::thread([]() {
+        Metrics::SetThreadName("first");
+        Metrics::Inc(Metrics::HASH_CANCELLED_TOTAL, 3);
+    }).join();
+
+    size_t shard_count = Metrics::GetThreadList().size();
+    int64_t cancelled = Metrics::Get(Metrics::HASH_CANCELLED_TOTAL);
+
+    std::thread([]() {
+        Metrics::Inc(Metrics::HASH_CANCELLED_TOTAL);
+    }).join();
+
+    std::vector<Metrics::ThreadSnapshot> thread_list = Metrics::GetThreadList();
+
+    QCOMPARE(thread_list.size(), shard_count);
+    QCOMPARE(Metrics::Get(Metrics::HASH_CANCELLED_TOTAL), cancelled + 1);
+
+    bool found_self = false;
+    for (const Metrics::ThreadSnapshot& snapshot : thread_list) {
+        QVERIFY(snapshot.name != "first");
+        found_self |= snapshot.name == "test";
+    }
+    QVERIFY(found_self);
+}
+
+void
+MetricsTest::MeteredLockRecordsWaitAndHold() {
+    MeteredRWLock outer_lock(Metrics::TAG_LOCK_WAIT, Metrics::TAG_LOCK_HOLD);
+    MeteredRWLock inner_lock(Metrics::MEDIA_LOCK_WAIT, Metrics::MEDIA_LOCK_HOLD);
+
+    int64_t tag_wait = Metrics::Get(Metrics::TAG_LOCK_WAIT).count;
+    int64_t tag_hold = Metrics::Get(Metrics::TAG_LOCK_HOLD).count;
+    int64_t media_hold = Metrics::Get(Metrics::MEDIA_LOCK_HOLD).count;
+    int64_t media_hold_max = Metrics::Get(Metrics::MEDIA_LOCK_HOLD).max;
+
+    outer_lock.lockForRead();
+    inner_lock.lockForWrite();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    //released out of order on purpose
+    outer_lock.unlock();
+    inner_lock.unlock();
+
+    outer_lock.lockForWrite();
+    outer_lock.unlock();
+
+    QCOMPARE(Metrics::Get(Metrics::TAG_LOCK_WAIT).count - tag_wait, (int64_t) 2);
+    QCOMPARE(Metrics::Get(Metrics::TAG_LOCK_HOLD).count - tag_hold, (int64_t) 2);
+    QCOMPARE(Metrics::Get(Metrics::MEDIA_LOCK_HOLD).count - media_hold, (int64_t) 1);
+    QVERIFY(Metrics::Get(Metrics::MEDIA_LOCK_HOLD).max >= qMax(media_hold_max, (int64_t) 15000));
+
+    //a writer waiting on a reader shows up as wait time
+    outer_lock.lockForRead();
+
+    std::thread writer([&outer_lock]() {
+        outer_lock.lockForWrite();
+        outer_lock.unlock();
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    outer_lock.unlock();
+    writer.join();
+
+    QVERIFY(Metrics::Get(Metrics::TAG_LOCK_WAIT).max >= 15000);
+}
+
+QTEST_APPLESS_MAIN(MetricsTest)
+
+#include "tst_metricstest.moc"
@@ -0,0 +1,24 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_notifytest.cpp \
+    ../../notify.cpp \
+    ../../metrics.cpp
+
+linux: SOURCES += ../../notify_inotify.cpp
+
+win32: SOURCES += ../../util.cpp \
+    ../../logger.cpp \
+    ../../GeneratedFiles/Debug/moc_logger.cpp \
+    ../../hash_engine.cpp \
+    ../../io_scheduler.cpp \
+    ../../blake3.cpp
+
+win32: LIBS += -lbcrypt
+
+HEADERS +=
@@ -0,0 +1,508 @@
+#include <QtTest>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../../notify.h"
+
+// add necessary includes here
+#ifdef __linux__
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class NotifyTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    NotifyTest();
+    ~NotifyTest();
+
+    static bool Covered(const std::vector<std::wstring>& rescan_list, const std::wstring& dir_wname);
+
+#ifdef __linux__
+    std::string root_path;
+
+    void MakeRoot();
+    void RemoveRoot();
+    void MakeDir(const std::string& sub_path);
+    void MakeFile(const std::string& sub_path);
+    void Move(const std::string& from_sub_path, const std::string& to_path);
+
+    static std::vector<NotifyEvent> Drain(Notify& notifier);
+    static bool Contains(const std::vector<NotifyEvent>& event_list, NotifyEvent::EventType type, const wchar_t* dir_wname, const wchar_t* file_wname);
+#endif
+
+private slots:
+
+    void OverflowCoversQuietSibling();
+    void BusyDirsGoFirst();
+    void NestedDirsCollapsed();
+    void NothingTouchedRescansRoot();
+    void SaturatedRescansRoot();
+    void RootTouchedRescansRootOnce();
+    void OldWindowDropped();
+    void TrackingResetAfterTake();
+
+    void InotifyExistingDirsWatched();
+    void InotifyNewDirWatched();
+    void InotifyRenamePaired();
+    void InotifyMoveAcrossDirs();
+    void InotifyDirRenameKeepsWatches();
+    void InotifyMoveOutOfRoot();
+    void InotifyOverflowRescansRoot();
+    void InotifyInterruptWakesWait();
+};
+
+NotifyTest::NotifyTest()
+{
+
+}
+
+NotifyTest::~NotifyTest()
+{
+
+}
+
+//a rescan of a dir covers its whole subtree, root is the empty name
+bool
+NotifyTest::Covered(const std::vector<std::wstring>& rescan_list, const std::wstring& dir_wname) {
+    for (const std::wstring& rescan_wname : rescan_list) {
+        if (rescan_wname.empty() || NotifyRecentDirs::IsSubPathOf(dir_wname, rescan_wname)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+NotifyTest::OverflowCoversQuietSibling() {
+    NotifyRecentDirs recent_dirs;
+
+    //burst in one dir overflows the buffer, the change to its quiet sibling was among the lost events
+    for (int i = 0; i < 1000; i++) {
+        recent_dirs.Touch(L"busy", false);
+    }
+
+    std::vector<std::wstring> rescan_list;
+    recent_dirs.TakeRescanList(&rescan_list);
+
+    QVERIFY(Covered(rescan_list, L"quiet"));
+    QVERIFY(Covered(rescan_list, L"busy\\sub"));
+    QVERIFY(rescan_list.back().empty());
+}
+
+void
+NotifyTest::BusyDirsGoFirst() {
+    NotifyRecentDirs recent_dirs;
+    recent_dirs.Touch(L"a", false);
+    recent_dirs.Touch(L"c", false);
+
+    std::vector<std::wstring> rescan_list;
+    recent_dirs.TakeRescanList(&rescan_list);
+
+    QVERIFY(rescan_list.size() == 3);
+    QVERIFY(rescan_list[0] == L"a" || rescan_list[0] == L"c");
+    QVERIFY(rescan_list[1] == L"a" || rescan_list[1] == L"c");
+    QVERIFY(rescan_list[0] != rescan_list[1]);
+    QVERIFY(rescan_list[2].empty());
+}
+
+void
+NotifyTest::NestedDirsCollapsed() {
+    NotifyRecentDirs recent_dirs;
+    recent_dirs.Touch(L"a\\b", false);
+    recent_dirs.Touch(L"a", false);
+    recent_dirs.Touch(L"ab", false);
+
+    std::vector<std::wstring> rescan_list;
+    recent_dirs.TakeRescanList(&rescan_list);
+
+    QVERIFY(rescan_list.size() == 3);
+    QVERIFY(std::find(rescan_list.begin(), rescan_list.end(), L"a\\b") == rescan_list.end());
+    QVERIFY(std::find(rescan_list.begin(), rescan_list.end(), L"ab") != rescan_list.end());
+    QVERIFY(rescan_list.back().empty());
+}
+
+void
+NotifyTest::NothingTouchedRescansRoot() {
+    NotifyRecentDirs recent_dirs;
+
+    std::vector<std::wstring> rescan_list;
+    recent_dirs.TakeRescanList(&rescan_list);
+
+    QVERIFY(rescan_list.size() == 1);
+    QVERIFY(rescan_list[0].empty());
+}
+
+void
+NotifyTest::SaturatedRescansRoot() {
+    NotifyRecentDirs recent_dirs;
+
+    for (int i = 0; i < NOTIFY_RECENT_DIR_MAX * 2; i++) {
+        recent_dirs.Touch(L"d" + std::to_wstring(i), false);
+    }
+
+    std::vector<std::wstring> rescan_list;
+    recent_dirs.TakeRescanList(&rescan_list);
+
+    QVERIFY(rescan_list.size() == 1);
+    QVERIFY(rescan_list[0].empty());
+}
+
+void
+NotifyTest::RootTouchedRescansRootOnce() {
+    NotifyRecentDirs recent_dirs;
+    recent_dirs.Touch(L"", false);
+    recent_dirs.Touch(L"a", false);
+
+    std::vector<std::wstring> rescan_list;
+    recent_dirs.TakeRescanList(&rescan_list);
+
+    QVERIFY(rescan_list.size() == 1);
+    QVERIFY(rescan_list[0].empty());
+}
+
+void
+NotifyTest::OldWindowDropped() {
+    NotifyRecentDirs recent_dirs;
+    recent_dirs.Touch(L"a", false);
+    recent_dirs.Touch(L"b", true);
+    recent_dirs.Touch(L"c", true);
+
+    std::vector<std::wstring> rescan_list;
+    recent_dirs.TakeRescanList(&rescan_list);
+
+    //a is no longer a hint, root still covers it
+    QVERIFY(rescan_list.size() == 3);
+    QVERIFY(std::find(rescan_list.begin(), rescan_list.end(), L"a") == rescan_list.end());
+    QVERIFY(Covered(rescan_list, L"a"));
+}
+
+void
+NotifyTest::TrackingResetAfterTake() {
+    NotifyRecentDirs recent_dirs;
+    recent_dirs.Touch(L"a", false);
+
+    std::vector<std::wstring> rescan_list;
+    recent_dirs.TakeRescanList(&rescan_list);
+    QVERIFY(rescan_list.size() == 2);
+
+    rescan_list.clear();
+    recent_dirs.TakeRescanList(&rescan_list);
+    QVERIFY(rescan_list.size() == 1);
+    QVERIFY(rescan_list[0].empty());
+}
+
+#ifdef __linux__
+
+void
+NotifyTest::MakeRoot() {
+    char root_template[] = "/tmp/notifytestXXXXXX";
+    QVERIFY(mkdtemp(root_template) != nullptr);
+    root_path = root_template;
+}
+
+void
+NotifyTest::RemoveRoot() {
+    nftw(root_path.c_str(), [](const char* path, const struct stat*, int, struct FTW*) -> int {
+        return remove(path);
+    }, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void
+NotifyTest::MakeDir(const std::string& sub_path) {
+    QVERIFY(mkdir((root_path + '/' + sub_path).c_str(), 0755) == 0);
+}
+
+void
+NotifyTest::MakeFile(const std::string& sub_path) {
+    int fd = open((root_path + '/' + sub_path).c_str(), O_CREAT | O_WRONLY, 0644);
+    QVERIFY(fd != -1);
+    close(fd);
+}
+
+//to_path is root relative unless absolute
+void
+NotifyTest::Move(const std::string& from_sub_path, const std::string& to_path) {
+    std::string abs_to_path = to_path[0] == '/' ? to_path : root_path + '/' + to_path;
+    QVERIFY(rename((root_path + '/' + from_sub_path).c_str(), abs_to_path.c_str()) == 0);
+}
+
+std::vector<NotifyEvent>
+NotifyTest::Drain(Notify& notifier) {
+    std::vector<NotifyEvent> ret;
+    NotifyEvent event;
+
+    notifier.RequestChanges();
+
+    while (notifier.HasEvent()) {
+        notifier.GetNextEvent(&event);
+        ret.push_back(event);
+    }
+
+    return ret;
+}
+
+bool
+NotifyTest::Contains(const std::vector<NotifyEvent>& event_list, NotifyEvent::EventType type, const wchar_t* dir_wname, const wchar_t* file_wname) {
+    for (const NotifyEvent& event : event_list) {
+        if (event.event == type && event.dir_wname == dir_wname && event.file_wname == file_wname) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif
+
+void
+NotifyTest::InotifyExistingDirsWatched() {
+#ifndef __linux__
+    QSKIP("inotify backend only");
+#else
+    MakeRoot();
+    MakeDir("a");
+    MakeDir("a/b");
+
+    Notify notifier(std::wstring(root_path.begin(), root_path.end()));
+    QVERIFY(notifier.InitHandle() == 0);
+
+    //nothing reported for what was there before
+    QVERIFY(Drain(notifier).empty());
+
+    MakeFile("x.jpg");
+    MakeFile("a/b/y.jpg");
+
+    std::vector<NotifyEvent> event_list = Drain(notifier);
+    QVERIFY(event_list.size() == 2);
+    QVERIFY(Contains(event_list, NotifyEvent::CREATE, L"", L"x.jpg"));
+    QVERIFY(Contains(event_list, NotifyEvent::CREATE, L"a\\b", L"y.jpg"));
+
+    RemoveRoot();
+#endif
+}
+
+void
+NotifyTest::InotifyNewDirWatched() {
+#ifndef __linux__
+    QSKIP("inotify backend only");
+#else
+    MakeRoot();
+
+    Notify notifier(std::wstring(root_path.begin(), root_path.end()));
+    QVERIFY(notifier.InitHandle() == 0);
+
+    //file lands before the dir's watch exists, found when the watch is added
+    MakeDir("n");
+    MakeFile("n/early.jpg");
+
+    std::vector<NotifyEvent> event_list = Drain(notifier);
+    QVERIFY(Contains(event_list, NotifyEvent::CREATE, L"", L"n"));
+    QVERIFY(Contains(event_list, NotifyEvent::CREATE, L"n", L"early.jpg"));
+
+    MakeFile("n/late.jpg");
+
+    event_list = Drain(notifier);
+    QVERIFY(event_list.size() == 1);
+    QVERIFY(Contains(event_list, NotifyEvent::CREATE, L"n", L"late.jpg"));
+
+    RemoveRoot();
+#endif
+}
+
+void
+NotifyTest::InotifyRenamePaired() {
+#ifndef __linux__
+    QSKIP("inotify backend only");
+#else
+    MakeRoot();
+    MakeDir("a");
+    MakeFile("a/x.jpg");
+
+    Notify notifier(std::wstring(root_path.begin(), root_path.end()));
+    QVERIFY(notifier.InitHandle() == 0);
+
+    Move("a/x.jpg", "a/z.jpg");
+
+    std::vector<NotifyEvent> event_list = Drain(notifier);
+    QVERIFY(event_list.size() == 2);
+    QVERIFY(event_list[0].event == NotifyEvent::RENAME_OLD && event_list[0].dir_wname == L"a" && event_list[0].file_wname == L"x.jpg");
+    QVERIFY(event_list[1].event == NotifyEvent::RENAME_NEW && event_list[1].dir_wname == L"a" && event_list[1].file_wname == L"z.jpg");
+
+    RemoveRoot();
+#endif
+}
+
+void
+NotifyTest::InotifyMoveAcrossDirs() {
+#ifndef __linux__
+    QSKIP("inotify backend only");
+#else
+    MakeRoot();
+    MakeDir("a");
+    MakeDir("c");
+    MakeFile("a/x.jpg");
+
+    Notify notifier(std::wstring(root_path.begin(), root_path.end()));
+    QVERIFY(notifier.InitHandle() == 0);
+
+    Move("a/x.jpg", "c/x.jpg");
+
+    //same as windows reports it
+    std::vector<NotifyEvent> event_list = Drain(notifier);
+    QVERIFY(event_list.size() == 2);
+    QVERIFY(event_list[0].event == NotifyEvent::REMOVE && event_list[0].dir_wname == L"a" && event_list[0].file_wname == L"x.jpg");
+    QVERIFY(event_list[1].event == NotifyEvent::CREATE && event_list[1].dir_wname == L"c" && event_list[1].file_wname == L"x.jpg");
+
+    RemoveRoot();
+#endif
+}
+
+void
+NotifyTest::InotifyDirRenameKeepsWatches() {
+#ifndef __linux__
+    QSKIP("inotify backend only");
+#else
+    MakeRoot();
+    MakeDir("a");
+    MakeDir("a/b");
+
+    Notify notifier(std::wstring(root_path.begin(), root_path.end()));
+    QVERIFY(notifier.InitHandle() == 0);
+
+    Move("a", "a2");
+
+    std::vector<NotifyEvent> event_list = Drain(notifier);
+    QVERIFY(Contains(event_list, NotifyEvent::RENAME_OLD, L"", L"a"));
+    QVERIFY(Contains(event_list, NotifyEvent::RENAME_NEW, L"", L"a2"));
+
+    //watches follow the dir, names reported under it follow the rename
+    MakeFile("a2/b/y.jpg");
+
+    event_list = Drain(notifier);
+    QVERIFY(event_list.size() == 1);
+    QVERIFY(Contains(event_list, NotifyEvent::CREATE, L"a2\\b", L"y.jpg"));
+
+    RemoveRoot();
+#endif
+}
+
+void
+NotifyTest::InotifyMoveOutOfRoot() {
+#ifndef __linux__
+    QSKIP("inotify backend only");
+#else
+    MakeRoot();
+    MakeDir("a");
+    MakeDir("a/b");
+
+    std::string outside_path = root_path + "_out";
+
+    Notify notifier(std::wstring(root_path.begin(), root_path.end()));
+    QVERIFY(notifier.InitHandle() == 0);
+
+    //no IN_MOVED_TO ever pairs with it
+    Move("a", outside_path);
+
+    std::vector<NotifyEvent> event_list = Drain(notifier);
+    QVERIFY(event_list.size() == 1);
+    QVERIFY(Contains(event_list, NotifyEvent::REMOVE, L"", L"a"));
+
+    //its watches went with it
+    int fd = open((outside_path + "/b/y.jpg").c_str(), O_CREAT | O_WRONLY, 0644);
+    QVERIFY(fd != -1);
+    close(fd);
+
+    QVERIFY(Drain(notifier).empty());
+
+    std::string root_path_buff = root_path;
+    root_path = outside_path;
+    RemoveRoot();
+    root_path = root_path_buff;
+    RemoveRoot();
+#endif
+}
+
+void
+NotifyTest::InotifyOverflowRescansRoot() {
+#ifndef __linux__
+    QSKIP("inotify backend only");
+#else
+    MakeRoot();
+    MakeDir("busy");
+    MakeDir("quiet");
+
+    Notify notifier(std::wstring(root_path.begin(), root_path.end()));
+    QVERIFY(notifier.InitHandle() == 0);
+
+    //a change made before the burst is delivered and makes busy a recent dir
+    MakeFile("busy/first.jpg");
+    QVERIFY(Drain(notifier).size() == 1);
+
+    int max_queued_events = 16384;
+    FILE* limit_file = fopen("/proc/sys/fs/inotify/max_queued_events", "r");
+    if (limit_file != nullptr) {
+        QVERIFY(fscanf(limit_file, "%d", &max_queued_events) == 1);
+        fclose(limit_file);
+    }
+
+    //nothing is read while the kernel queue fills up, the change to quiet is lost with the overflow
+    for (int i = 0; i <= max_queued_events; i++) {
+        MakeFile("busy/" + std::to_string(i));
+    }
+
+    MakeFile("quiet/lost.jpg");
+
+    std::vector<NotifyEvent> event_list = Drain(notifier);
+    QVERIFY(!Contains(event_list, NotifyEvent::CREATE, L"quiet", L"lost.jpg"));
+
+    std::vector<std::wstring> rescan_list;
+    for (const NotifyEvent& event : event_list) {
+        if (event.event == NotifyEvent::RESCAN) {
+            rescan_list.push_back(event.dir_wname);
+        }
+    }
+
+    QVERIFY(!rescan_list.empty());
+    QVERIFY(rescan_list.back().empty());
+    QVERIFY(Covered(rescan_list, L"quiet"));
+
+    RemoveRoot();
+#endif
+}
+
+void
+NotifyTest::InotifyInterruptWakesWait() {
+#ifndef __linux__
+    QSKIP("inotify backend only");
+#else
+    MakeRoot();
+
+    Notify notifier(std::wstring(root_path.begin(), root_path.end()));
+    QVERIFY(notifier.InitHandle() == 0);
+
+    QVERIFY(notifier.WaitChanges(0) == NOTIFY_WAIT_TIMEOUT);
+
+    notifier.Interrupt();
+    QVERIFY(notifier.WaitChanges(1000) == NOTIFY_WAIT_INTERRUPT);
+
+    //interrupt was drained, nothing left to wake on
+    QVERIFY(notifier.WaitChanges(0) == NOTIFY_WAIT_TIMEOUT);
+
+    MakeFile("x.jpg");
+    QVERIFY(notifier.WaitChanges(1000) == NOTIFY_WAIT_EVENT);
+    QVERIFY(notifier.HasEvent());
+
+    RemoveRoot();
+#endif
+}
+
+QTEST_APPLESS_MAIN(NotifyTest)
+
+#include "tst_notifytest.moc"
@@ -0,0 +1,313 @@
+#include <QtTest>
+#include "../../pending_remove.h"
+
+// add necessary includes here
+
+class PendingRemoveTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    PendingRemoveTest();
+    ~PendingRemoveTest();
+
+    //full hash is the quick hash with c in front of it
+    static MediaInfo Media(unsigned int id, const QString& sub_path, const QString& long_name, qint64 size, const QString& quick_hash);
+    static MediaInfo Created(const QString& long_name, qint64 size, const QString& quick_hash, const QString& hash);
+
+private slots:
+
+    void MediaMatchedByNameSizeHash();
+    void MediaNotMatchedOnMismatch();
+    void UnknownSizeMatchesAnySize();
+    void PendingHashMatchesNothing();
+    void QuickHashCollisionNotMatched();
+    void DirMatchedByName();
+    void OldestMatchTakenFirst();
+    void ConcurrentMoves();
+    void TakeBySubPathName();
+    void TakeUnder();
+    void TakeExpired();
+    void ClaimedEntryNotExpired();
+    void LongGapExpiresAll();
+    void NextExpireMsec();
+};
+
+PendingRemoveTest::PendingRemoveTest()
+{
+
+}
+
+PendingRemoveTest::~PendingRemoveTest()
+{
+
+}
+
+MediaInfo
+PendingRemoveTest::Media(unsigned int id, const QString& sub_path, const QString& long_name, qint64 size, const QString& quick_hash) {
+    MediaInfo media(id, sub_path, long_name, long_name, QString());
+    media.quick_hash = quick_hash;
+    media.hash = quick_hash.isEmpty() ? QString() : "c" + quick_hash;
+    media.size = size;
+    return media;
+}
+
+MediaInfo
+PendingRemoveTest::Created(const QString& long_name, qint64 size, const QString& quick_hash, const QString& hash) {
+    MediaInfo media(0, "\\new", long_name, long_name, hash);
+    media.quick_hash = quick_hash;
+    media.size = size;
+    return media;
+}
+
+void
+PendingRemoveTest::MediaMatchedByNameSizeHash() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+
+    QVERIFY(table.MediaCandidateExist("x.jpg", 100));
+
+    PendingRemove out;
+    QVERIFY(table.TakeMedia(Created("x.jpg", 100, "h1", "ch1"), &out));
+    QVERIFY(out.media.id == 1);
+    QVERIFY(out.sub_path_name == "\\a\\x.jpg");
+    QVERIFY(table.IsEmpty());
+    QVERIFY(!table.MediaCandidateExist("x.jpg", 100));
+}
+
+void
+PendingRemoveTest::MediaNotMatchedOnMismatch() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+
+    PendingRemove out;
+    QVERIFY(!table.MediaCandidateExist("y.jpg", 100));
+    QVERIFY(!table.MediaCandidateExist("x.jpg", 101));
+    QVERIFY(!table.TakeMedia(Created("x.jpg", 101, "h1", "ch1"), &out));
+    QVERIFY(!table.TakeMedia(Created("x.jpg", 100, "h2", "ch2"), &out));
+    QVERIFY(!table.TakeDir("x.jpg", &out));
+    QVERIFY(table.GetSize() == 1);
+}
+
+void
+PendingRemoveTest::UnknownSizeMatchesAnySize() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", -1, "h1"), 0);
+
+    PendingRemove out;
+    QVERIFY(table.MediaCandidateExist("x.jpg", 100));
+    QVERIFY(table.TakeMedia(Created("x.jpg", 100, "h1", "ch1"), &out));
+    QVERIFY(out.media.id == 1);
+}
+
+void
+PendingRemoveTest::PendingHashMatchesNothing() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+    table.AddMedia(Media(2, "\\a", "y.jpg", 100, ""), 0);
+
+    //created file not hashed yet
+    PendingRemove out;
+    QVERIFY(table.MediaCandidateExist("x.jpg", 100, ""));
+    QVERIFY(!table.TakeMedia(Created("x.jpg", 100, "", ""), &out));
+    QVERIFY(!table.TakeMedia(Created("x.jpg", 100, "h1", ""), &out));
+
+    //removed media was never hashed
+    QVERIFY(table.MediaCandidateExist("y.jpg", 100, "h2"));
+    QVERIFY(!table.TakeMedia(Created("y.jpg", 100, "h2", "ch2"), &out));
+    QVERIFY(table.GetSize() == 2);
+}
+
+void
+PendingRemoveTest::QuickHashCollisionNotMatched() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+
+    //same size and both ends, middle differs
+    PendingRemove out;
+    QVERIFY(table.MediaCandidateExist("x.jpg", 100, "h1"));
+    QVERIFY(!table.MediaCandidateExist("x.jpg", 100, "h2"));
+    QVERIFY(!table.TakeMedia(Created("x.jpg", 100, "h1", "other"), &out));
+    QVERIFY(table.GetSize() == 1);
+
+    QVERIFY(table.TakeMedia(Created("x.jpg", 100, "h1", "ch1"), &out));
+    QVERIFY(out.media.id == 1);
+}
+
+void
+PendingRemoveTest::DirMatchedByName() {
+    PendingRemoveTable table(1000, 50);
+    table.AddDir("\\a\\b", 0);
+
+    QVERIFY(table.DirCandidateExist("b"));
+    QVERIFY(!table.MediaCandidateExist("b", -1));
+
+    PendingRemove out;
+    QVERIFY(table.TakeDir("b", &out));
+    QVERIFY(out.dir_flag);
+    QVERIFY(out.sub_path_name == "\\a\\b");
+    QVERIFY(table.IsEmpty());
+}
+
+void
+PendingRemoveTest::OldestMatchTakenFirst() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+    table.AddMedia(Media(2, "\\b", "x.jpg", 100, "h1"), 10);
+
+    PendingRemove out;
+    QVERIFY(table.TakeMedia(Created("x.jpg", 100, "h1", "ch1"), &out));
+    QVERIFY(out.media.id == 1);
+    QVERIFY(table.TakeMedia(Created("x.jpg", 100, "h1", "ch1"), &out));
+    QVERIFY(out.media.id == 2);
+}
+
+void
+PendingRemoveTest::ConcurrentMoves() {
+    PendingRemoveTable table(1000, 50);
+
+    for (unsigned int i = 0; i < 100; i++) {
+        table.AddMedia(Media(i, "\\src", QString::number(i) + ".jpg", i, "h" + QString::number(i)), i);
+    }
+
+    QVERIFY(table.GetSize() == 100);
+
+    //creates arrive in any order
+    PendingRemove out;
+    for (int i = 99; i >= 0; i--) {
+        QVERIFY(table.TakeMedia(Created(QString::number(i) + ".jpg", i, "h" + QString::number(i), "ch" + QString::number(i)), &out));
+        QVERIFY(out.media.id == (unsigned int) i);
+    }
+
+    QVERIFY(table.IsEmpty());
+
+    QVector<PendingRemove> expired;
+    table.TakeExpired(5000, &expired);
+    QVERIFY(expired.empty());
+}
+
+void
+PendingRemoveTest::TakeBySubPathName() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+
+    QVERIFY(table.SubPathNameExist("\\a\\x.jpg"));
+    QVERIFY(!table.SubPathNameExist("\\b\\x.jpg"));
+
+    PendingRemove out;
+    QVERIFY(!table.TakeBySubPathName("\\b\\x.jpg", &out));
+    QVERIFY(table.TakeBySubPathName("\\a\\x.jpg", &out));
+    QVERIFY(out.media.id == 1);
+    QVERIFY(!table.MediaCandidateExist("x.jpg", 100));
+}
+
+void
+PendingRemoveTest::TakeUnder() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+    table.AddMedia(Media(2, "\\a\\b", "y.jpg", 100, "h2"), 0);
+    table.AddMedia(Media(3, "\\ab", "z.jpg", 100, "h3"), 0);
+    table.AddDir("\\a\\c", 0);
+
+    QVector<PendingRemove> out;
+    table.TakeUnder("\\a", &out);
+
+    QVERIFY(out.size() == 3);
+    QVERIFY(out[0].media.id == 1);
+    QVERIFY(out[1].media.id == 2);
+    QVERIFY(out[2].dir_flag && out[2].sub_path_name == "\\a\\c");
+    QVERIFY(table.GetSize() == 1);
+    QVERIFY(table.MediaCandidateExist("z.jpg", 100));
+}
+
+void
+PendingRemoveTest::TakeExpired() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+    table.AddMedia(Media(2, "\\a", "y.jpg", 100, "h2"), 500);
+    table.AddDir("\\a\\b", 520);
+
+    QVector<PendingRemove> expired;
+    table.TakeExpired(999, &expired);
+    QVERIFY(expired.empty());
+
+    table.TakeExpired(1000, &expired);
+    QVERIFY(expired.size() == 1);
+    QVERIFY(expired[0].media.id == 1);
+
+    //same slot as the dir, only partly due
+    expired.clear();
+    table.TakeExpired(1510, &expired);
+    QVERIFY(expired.size() == 1);
+    QVERIFY(expired[0].media.id == 2);
+
+    expired.clear();
+    table.TakeExpired(1520, &expired);
+    QVERIFY(expired.size() == 1);
+    QVERIFY(expired[0].dir_flag);
+    QVERIFY(table.IsEmpty());
+}
+
+void
+PendingRemoveTest::ClaimedEntryNotExpired() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+    table.AddMedia(Media(2, "\\a", "y.jpg", 100, "h2"), 0);
+
+    PendingRemove out;
+    QVERIFY(table.TakeMedia(Created("x.jpg", 100, "h1", "ch1"), &out));
+
+    QVector<PendingRemove> expired;
+    table.TakeExpired(1000, &expired);
+    QVERIFY(expired.size() == 1);
+    QVERIFY(expired[0].media.id == 2);
+}
+
+void
+PendingRemoveTest::LongGapExpiresAll() {
+    PendingRemoveTable table(1000, 50);
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+    table.AddMedia(Media(2, "\\a", "y.jpg", 100, "h2"), 700);
+
+    //way past one revolution of the wheel
+    QVector<PendingRemove> expired;
+    table.TakeExpired(100000, &expired);
+    QVERIFY(expired.size() == 2);
+    QVERIFY(table.IsEmpty());
+
+    //wheel restarts from the next add
+    table.AddMedia(Media(3, "\\a", "z.jpg", 100, "h3"), 200000);
+    QVERIFY(table.NextExpireMsec(200000) == 1000);
+
+    expired.clear();
+    table.TakeExpired(201000, &expired);
+    QVERIFY(expired.size() == 1);
+    QVERIFY(expired[0].media.id == 3);
+}
+
+void
+PendingRemoveTest::NextExpireMsec() {
+    PendingRemoveTable table(1000, 50);
+    QVERIFY(table.NextExpireMsec(0) == -1);
+
+    table.AddMedia(Media(1, "\\a", "x.jpg", 100, "h1"), 0);
+    table.AddMedia(Media(2, "\\a", "y.jpg", 100, "h2"), 300);
+    QVERIFY(table.NextExpireMsec(100) == 900);
+
+    PendingRemove out;
+    table.TakeMedia(Created("x.jpg", 100, "h1", "ch1"), &out);
+    QVERIFY(table.NextExpireMsec(100) == 1200);
+
+    //no sweep for most of a window, earliest deadline is still found first
+    table.AddMedia(Media(3, "\\a", "z.jpg", 100, "h3"), 900);
+    QVERIFY(table.NextExpireMsec(900) == 400);
+    QVERIFY(table.NextExpireMsec(2000) == 0);
+
+    QVector<PendingRemove> expired;
+    table.TakeExpired(1300, &expired);
+    QVERIFY(table.NextExpireMsec(1300) == 600);
+}
+
+QTEST_APPLESS_MAIN(PendingRemoveTest)
+
+#include "tst_pendingremovetest.moc"
@@ -0,0 +1,12 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_querytest.cpp \
+    ../../query.cpp
+
+HEADERS +=
@@ -0,0 +1,165 @@
+#include <QtTest>
+#include <QHash>
+#include "../../query.h"
+
+// add necessary includes here
+
+class QueryTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    QueryTest();
+    ~QueryTest();
+
+    QHash<QString, QSet<unsigned int>> tag_table;
+    QHash<QString, QSet<unsigned int>> dir_table;      //sub path -> media directly in it
+    QHash<QString, QSet<unsigned int>> subtree_table;  //sub path -> media in it and below
+
+    QVector<QString> dir_call_list;
+
+    int Run(const QString& raw_query, QSet<unsigned int>* out);
+
+private slots:
+
+    void TagOnly();
+    void DirRecursive();
+    void InDirNonRecursive();
+    void DirComposesWithTags();
+    void DirQuotedPath();
+    void QuotedPrefixIsTag();
+    void UnknownDir();
+    void NoDirHandler();
+};
+
+QueryTest::QueryTest()
+{
+    tag_table.insert("cat", { 1, 2, 5 });
+    tag_table.insert("dog", { 3, 4 });
+    tag_table.insert("dir:cat", { 9 });
+
+    dir_table.insert("\\photos", { 1, 3 });
+    dir_table.insert("\\photos\\2020", { 2, 4 });
+    dir_table.insert("\\my photos", { 5 });
+
+    subtree_table.insert("\\photos", { 1, 2, 3, 4 });
+    subtree_table.insert("\\photos\\2020", { 2, 4 });
+    subtree_table.insert("\\my photos", { 5 });
+}
+
+QueryTest::~QueryTest()
+{
+
+}
+
+int
+QueryTest::Run(const QString& raw_query, QSet<unsigned int>* out) {
+    Query query(raw_query);
+
+    auto tag_handler = [this](const QString& tag_name, QSet<unsigned int>* tag_out) {
+        if (!tag_table.contains(tag_name)) {
+            return -1;
+        }
+
+        *tag_out = tag_table.value(tag_name);
+        return 1;
+    };
+
+    auto dir_handler = [this](const QString& sub_path, bool recursive, QSet<unsigned int>* dir_out) {
+        dir_call_list.push_back(sub_path);
+
+        const QHash<QString, QSet<unsigned int>>& table = recursive ? subtree_table : dir_table;
+        if (!table.contains(sub_path)) {
+            return -1;
+        }
+
+        *dir_out = table.value(sub_path);
+        return 1;
+    };
+
+    if (query.Tokenize(tag_handler, dir_handler) < 0 || query.GenerateAST() < 0 || query.ProcessAST() < 0) {
+        return -1;
+    }
+
+    *out = query.result;
+    return 1;
+}
+
+void
+QueryTest::TagOnly() {
+    QSet<unsigned int> result;
+
+    QVERIFY(Run("cat + dog", &result) > 0);
+    QVERIFY(result == QSet<unsigned int>({ 1, 2, 3, 4, 5 }));
+}
+
+void
+QueryTest::DirRecursive() {
+    QSet<unsigned int> result;
+
+    QVERIFY(Run("dir:\\photos", &result) > 0);
+    QVERIFY(result == QSet<unsigned int>({ 1, 2, 3, 4 }));
+}
+
+void
+QueryTest::InDirNonRecursive() {
+    QSet<unsigned int> result;
+
+    QVERIFY(Run("indir:\\photos", &result) > 0);
+    QVERIFY(result == QSet<unsigned int>({ 1, 3 }));
+}
+
+void
+QueryTest::DirComposesWithTags() {
+    QSet<unsigned int> result;
+
+    QVERIFY(Run("dir:\\photos * cat", &result) > 0);
+    QVERIFY(result == QSet<unsigned int>({ 1, 2 }));
+
+    QVERIFY(Run("(cat + dog) - indir:\\photos\\2020", &result) > 0);
+    QVERIFY(result == QSet<unsigned int>({ 1, 3, 5 }));
+
+    QVERIFY(Run("dog * (indir:\\photos + dir:\\photos\\2020)", &result) > 0);
+    QVERIFY(result == QSet<unsigned int>({ 3, 4 }));
+}
+
+void
+QueryTest::DirQuotedPath() {
+    QSet<unsigned int> result;
+
+    //space and operator characters only survive inside quotes
+    QVERIFY(Run("dir:\"\\my photos\" + dog", &result) > 0);
+    QVERIFY(result == QSet<unsigned int>({ 3, 4, 5 }));
+}
+
+void
+QueryTest::QuotedPrefixIsTag() {
+    QSet<unsigned int> result;
+    dir_call_list.clear();
+
+    QVERIFY(Run("\"dir:cat\"", &result) > 0);
+    QVERIFY(result == QSet<unsigned int>({ 9 }));
+    QVERIFY(dir_call_list.isEmpty());
+}
+
+void
+QueryTest::UnknownDir() {
+    QSet<unsigned int> result;
+
+    QVERIFY(Run("cat * dir:\\missing", &result) < 0);
+}
+
+void
+QueryTest::NoDirHandler() {
+    Query query("dir:\\photos");
+
+    auto tag_handler = [](const QString&, QSet<unsigned int>*) {
+        return 1;
+    };
+
+    QVERIFY(query.Tokenize(tag_handler) < 0);
+}
+
+QTEST_APPLESS_MAIN(QueryTest)
+
+#include "tst_querytest.moc"
@@ -0,0 +1,216 @@
+#include <QtTest>
+#include <cstring>
+#include "../../shared_index.h"
+
+// add necessary includes here
+
+class SharedIndexTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    SharedIndexTest();
+    ~SharedIndexTest();
+
+    static Tag MakeTag(unsigned int id, const QString& name, const QSet<unsigned int>& media_id_set);
+    static QVector<Tag> SampleTagList();
+
+private slots:
+
+    void TagsSortedByName();
+    void MediaIdsSorted();
+    void UnknownTag();
+    void QueryRunsLocally();
+    void QueryFailsOnUnknownTagAndDir();
+    void NonLatinNames();
+    void EmptySnapshot();
+    void RejectsBrokenSnapshot();
+};
+
+SharedIndexTest::SharedIndexTest()
+{
+
+}
+
+SharedIndexTest::~SharedIndexTest()
+{
+
+}
+
+Tag
+SharedIndexTest::MakeTag(unsigned int id, const QString& name, const QSet<unsigned int>& media_id_set) {
+    Tag tag;
+    tag.id = id;
+    tag.count = media_id_set.size();
+    tag.name = name;
+    tag.media_id_list = media_id_set;
+    return tag;
+}
+
+QVector<Tag>
+SharedIndexTest::SampleTagList() {
+    return {
+        MakeTag(0, "dog", { 3, 4 }),
+        MakeTag(1, "cat", { 5, 1, 2 }),
+        MakeTag(2, "bird", {}),
+        MakeTag(7, "big cat", { 2, 9 })
+    };
+}
+
+void
+SharedIndexTest::TagsSortedByName() {
+    QByteArray snapshot = SharedIndex::Serialize(42, SampleTagList());
+
+    SharedIndexView view;
+    QVERIFY(view.Open(snapshot.constData(), snapshot.size()));
+    QCOMPARE(view.GetGeneration(), (quint64) 42);
+    QCOMPARE(view.GetTagCount(), 4);
+
+    QVector<ModelTag> tag_list;
+    view.GetTagList(&tag_list);
+
+    QCOMPARE(tag_list.size(), 4);
+    QCOMPARE(tag_list[0].name, QString("big cat"));
+    QCOMPARE(tag_list[1].name, QString("bird"));
+    QCOMPARE(tag_list[2].name, QString("cat"));
+    QCOMPARE(tag_list[3].name, QString("dog"));
+
+    QCOMPARE(tag_list[0].id, 7u);
+    QCOMPARE(tag_list[0].media_count, 2u);
+    QCOMPARE(tag_list[1].media_count, 0u);
+}
+
+void
+SharedIndexTest::MediaIdsSorted() {
+    QByteArray snapshot = SharedIndex::Serialize(1, SampleTagList());
+
+    SharedIndexView view;
+    QVERIFY(view.Open(snapshot.constData(), snapshot.size()));
+
+    QVector<unsigned int> media_id_list;
+    QCOMPARE(view.GetTagMediaIdList("cat", &media_id_list), 1);
+    QCOMPARE(media_id_list, QVector<unsigned int>({ 1, 2, 5 }));
+
+    QCOMPARE(view.GetTagMediaIdList("bird", &media_id_list), 1);
+    QVERIFY(media_id_list.isEmpty());
+
+    QSet<unsigned int> media_id_set;
+    QCOMPARE(view.GetTagMediaIdSet("dog", &media_id_set), 1);
+    QCOMPARE(media_id_set, QSet<unsigned int>({ 3, 4 }));
+}
+
+void
+SharedIndexTest::UnknownTag() {
+    QByteArray snapshot = SharedIndex::Serialize(1, SampleTagList());
+
+    SharedIndexView view;
+    QVERIFY(view.Open(snapshot.constData(), snapshot.size()));
+
+    QVector<unsigned int> media_id_list;
+    QCOMPARE(view.GetTagMediaIdList("ca", &media_id_list), -1);
+    QCOMPARE(view.GetTagMediaIdList("cats", &media_id_list), -1);
+    QCOMPARE(view.GetTagMediaIdList("Cat", &media_id_list), -1);
+    QCOMPARE(view.GetTagMediaIdList("", &media_id_list), -1);
+}
+
+void
+SharedIndexTest::QueryRunsLocally() {
+    QByteArray snapshot = SharedIndex::Serialize(1, SampleTagList());
+
+    SharedIndexView view;
+    QVERIFY(view.Open(snapshot.constData(), snapshot.size()));
+
+    QSet<unsigned int> result;
+
+    QCOMPARE(view.RunQuery("cat + dog", &result), 1);
+    QCOMPARE(result, QSet<unsigned int>({ 1, 2, 3, 4, 5 }));
+
+    QCOMPARE(view.RunQuery("cat * \"big cat\"", &result), 1);
+    QCOMPARE(result, QSet<unsigned int>({ 2 }));
+
+    QCOMPARE(view.RunQuery("(cat + dog) - \"big cat\"", &result), 1);
+    QCOMPARE(result, QSet<unsigned int>({ 1, 3, 4, 5 }));
+}
+
+void
+SharedIndexTest::QueryFailsOnUnknownTagAndDir() {
+    QByteArray snapshot = SharedIndex::Serialize(1, SampleTagList());
+
+    SharedIndexView view;
+    QSet<unsigned int> result;
+
+    //nothing open yet
+    QCOMPARE(view.RunQuery("cat", &result), -1);
+
+    QVERIFY(view.Open(snapshot.constData(), snapshot.size()));
+
+    QCOMPARE(view.RunQuery("cat + fish", &result), -1);
+    QCOMPARE(view.RunQuery("dir:\\photos * cat", &result), -1);
+}
+
+void
+SharedIndexTest::NonLatinNames() {
+    QVector<Tag> tag_list = {
+        MakeTag(0, QString::fromUtf8("\xE7\x8C\xAB"), { 1 }),              //cat in chinese
+        MakeTag(1, QString::fromUtf8("caf\xC3\xA9"), { 2 }),
+        MakeTag(2, QString::fromUtf8("\xF0\x9F\x90\x88"), { 3 })           //outside the bmp, two code units
+    };
+
+    QByteArray snapshot = SharedIndex::Serialize(1, tag_list);
+
+    SharedIndexView view;
+    QVERIFY(view.Open(snapshot.constData(), snapshot.size()));
+
+    for (const Tag& tag : tag_list) {
+        QVector<unsigned int> media_id_list;
+        QCOMPARE(view.GetTagMediaIdList(tag.name, &media_id_list), 1);
+        QCOMPARE(media_id_list, QVector<unsigned int>({ tag.id + 1 }));
+    }
+}
+
+void
+SharedIndexTest::EmptySnapshot() {
+    QByteArray snapshot = SharedIndex::Serialize(5, QVector<Tag>());
+
+    QCOMPARE(snapshot.size(), (int) sizeof(SharedIndexHeader));
+
+    SharedIndexView view;
+    QVERIFY(view.Open(snapshot.constData(), snapshot.size()));
+    QCOMPARE(view.GetTagCount(), 0);
+
+    QVector<unsigned int> media_id_list;
+    QCOMPARE(view.GetTagMediaIdList("cat", &media_id_list), -1);
+}
+
+void
+SharedIndexTest::RejectsBrokenSnapshot() {
+    QByteArray snapshot = SharedIndex::Serialize(1, SampleTagList());
+
+    SharedIndexView view;
+    QVERIFY(!view.Open(nullptr, 0));
+    QVERIFY(!view.Open(snapshot.constData(), sizeof(SharedIndexHeader) - 1));
+    QVERIFY(!view.Open(snapshot.constData(), snapshot.size() - 1));
+
+    //segments may be rounded up
+    QByteArray padded = snapshot + QByteArray(4096, '\0');
+    QVERIFY(view.Open(padded.constData(), padded.size()));
+
+    QByteArray bad_magic = snapshot;
+    bad_magic[0] = 'x';
+    QVERIFY(!view.Open(bad_magic.constData(), bad_magic.size()));
+    QVERIFY(!view.IsOpen());
+
+    QByteArray bad_posting = snapshot;
+    SharedIndexTag* tag_arr = reinterpret_cast<SharedIndexTag*>(bad_posting.data() + sizeof(SharedIndexHeader));
+    tag_arr[1].posting_count = 100;
+    QVERIFY(!view.Open(bad_posting.constData(), bad_posting.size()));
+
+    QByteArray bad_name = snapshot;
+    tag_arr = reinterpret_cast<SharedIndexTag*>(bad_name.data() + sizeof(SharedIndexHeader));
+    tag_arr[3].name_begin = 0xFFFFFFF0;
+    QVERIFY(!view.Open(bad_name.constData(), bad_name.size()));
+}
+
+QTEST_APPLESS_MAIN(SharedIndexTest)
+
+#include "tst_sharedindextest.moc"
@@ -1,6 +1,7 @@
 #include "thumbnail_provider.h"
 #include "QtConcurrent/qtconcurrentrun.h"
 #include "error.h"
+#include "metrics.h"
 #include <QStringBuilder>
 
 extern "C" {
@@ -65,6 +66,7 @@ ThumbnailProvider::GetMediaThumbnail(const unsigned int media_id, const QString&
 	
 	//failed to obtain cache lock
 	if (!cache_lock.tryLock()) {
+		Metrics::Inc(Metrics::THUMBNAIL_CACHE_MISS_TOTAL);
 		return default_icon;
 	}
 
@@ -76,11 +78,15 @@ ThumbnailProvider::GetMediaThumbnail(const unsigned int media_id, const QString&
 		QImage cached_icon = media_id_to_image_cash.object(media_id)->copy();
 	
 		cache_lock.unlock();
+
+		Metrics::Inc(Metrics::THUMBNAIL_CACHE_HIT_TOTAL);
 		return cached_icon;
 	}
 
 	cache_lock.unlock();
 
+	Metrics::Inc(Metrics::THUMBNAIL_CACHE_MISS_TOTAL);
+
 	//this media thumbnail was not cached
 	return default_icon;
 }
@@ -99,6 +105,7 @@ ThumbnailProvider::RemoveMediaThumbnail(const unsigned int media_id) {
 	}
 
 	media_id_to_image_cash.remove(media_id);
+	Metrics::Set(Metrics::THUMBNAIL_CACHE_SIZE, media_id_to_image_cash.size());
 
 	cache_lock.unlock();
 }
@@ -379,6 +386,8 @@ ThumbnailProvider::SetConfig (const ThumbnailGenConfig& config) {
 		media_id_to_image_cash.clear();
 	}
 
+	Metrics::Set(Metrics::THUMBNAIL_CACHE_SIZE, media_id_to_image_cash.size());
+
 	cache_lock.unlock();
 
 	this->config = config;
@@ -466,6 +475,7 @@ ThumbnailProvider::TestAndGenerateThumbnail(const ModelMedia& m_media) {
 
 	//each image has a cost of 1, the cost is counting how many images not how much memory each image is using
 	media_id_to_image_cash.insert(m_media.id, thumbnail, 1);
+	Metrics::Set(Metrics::THUMBNAIL_CACHE_SIZE, media_id_to_image_cash.size());
 
 	cache_lock.unlock();
 
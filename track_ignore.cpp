@@ -1,6 +1,8 @@
 #include "track_ignore.h"
 #include "error.h"
 
+#include <algorithm>
+
 //static
 
 bool
@@ -16,54 +18,78 @@ IgnoreList::IsConcrete(const QString& str) {
 
 bool
 IgnoreList::MatchWildcard(const QString& pattern, const QString& matchee) {
-	//a single * matches all non empty string
-	if (pattern.size() == 1 && pattern[0] == '*') {
-		return true;
+	if (IsConcrete(pattern)) {
+		return pattern == matchee;
 	}
 
-	int pattern_idx = 0;
-	int matchee_idx = 0;
+	return IgnoreGlob(pattern).Match(matchee.constData(), matchee.size());
+}
+
+uint
+IgnoreList::ComponentHash(const QChar* str, int size) {
+	//fnv-1a, computed straight off the path so lookups need no QString
+	uint hash = 2166136261u;
+	for (int i = 0; i < size; i++) {
+		hash = (hash ^ str[i].unicode()) * 16777619u;
+	}
+
+	return hash;
+}
+
+IgnoreGlob::IgnoreGlob(const QString& pattern) :
+	star_begin(pattern.startsWith('*')),
+	star_end(pattern.endsWith('*'))
+{
+	//consecutive wildcards are the same as one
+	for (const QString& piece : pattern.split('*', QString::SkipEmptyParts)) {
+		piece_vec.push_back(piece);
+	}
+}
+
+bool
+IgnoreGlob::Match(const QChar* str, int size) const {
 
-	while (pattern_idx != pattern.size()) {
+	auto piece_at = [str](const QString& piece, int pos) -> bool {
+		return std::equal(piece.constData(), piece.constData() + piece.size(), str + pos);
+	};
 
-		//matchee finished before pattern means mismatch
-		if (matchee_idx == matchee.size()) {
+	int first = 0;
+	int last = piece_vec.size();
+	int begin = 0;
+	int end = size;
+
+	//pieces not next to a wildcard are anchored to the ends
+	if (!star_begin && first < last) {
+		if (piece_vec[first].size() > end || !piece_at(piece_vec[first], 0)) {
 			return false;
 		}
 
-		if (pattern[pattern_idx] != '*') {
-			if (matchee[matchee_idx] != pattern[pattern_idx]) {
-				return false;
-			}
+		begin = piece_vec[first].size();
+		first++;
+	}
 
-			pattern_idx++;
-			matchee_idx++;
-			continue;
+	if (!star_end && first < last) {
+		if (piece_vec[last - 1].size() > end - begin || !piece_at(piece_vec[last - 1], end - piece_vec[last - 1].size())) {
+			return false;
 		}
 
-		//pattern idx currently lands on wildcard
+		end -= piece_vec[last - 1].size();
+		last--;
+	}
 
-		//QChar lookahead_c = pattern[pattern_idx];
-		//int lookahead_idx = pattern_idx;
-		//look ahead to next non wildcard char
-		while (pattern_idx < pattern.size() && pattern[pattern_idx] == '*') {
-			pattern_idx++;
-		}
+	//pieces in between go at their leftmost spot, which leaves the most room for the rest
+	for (int i = first; i < last; i++) {
+		const QString& piece = piece_vec[i];
 
-		//reaching end of pattern means wildcard at the end matches everything
-		if (pattern_idx == pattern.size()) {
-			return true;
+		while (begin + piece.size() <= end && !piece_at(piece, begin)) {
+			begin++;
 		}
 
-		//let matchee catch up to lookahead char before matching again
-		while (matchee_idx < matchee.size() && matchee[matchee_idx] != pattern[pattern_idx]) {
-			matchee_idx++;
+		if (begin + piece.size() > end) {
+			return false;
 		}
-	}
 
-	//still characters left in matchee means pattern did not match
-	if (matchee_idx != matchee.size()) {
-		return false;
+		begin += piece.size();
 	}
 
 	return true;
@@ -71,6 +97,7 @@ IgnoreList::MatchWildcard(const QString& pattern, const QString& matchee) {
 
 IgnoreList::IgnoreList()
 {
+	Reset();
 }
 
 
@@ -186,184 +213,228 @@ IgnoreList::ParseIgnoreFileLine(const QString& line) {
 		return -2;
 	}
 
-	//populate first index look up tables
-	QHash<QString, QList<int>> *table_ptr;
-	if (IsConcrete(sub_path_vec_buf[0])) {
-		table_ptr = &concrete_to_index_list_table;
-	}
-	else {
-		table_ptr = &wildcard_to_index_list_table;
+	//entries sharing leading components share trie nodes
+	int node_idx = 0;
+	for (const QString& component : sub_path_vec_buf) {
+		node_idx = AddChild(node_idx, component);
 	}
 
-	auto table_iter = table_ptr->find(sub_path_vec_buf[0]);
-	if (table_iter == table_ptr->end()) {
-		QList<int> new_list;
-		new_list.push_back(ignore_entry_vec.size());
-		table_ptr->insert(sub_path_vec_buf[0], new_list);
+	if (ignore_ent_buf.ignore_dir) {
+		node_vec[node_idx].ignore_dir = true;
 	}
 	else {
-		table_iter->push_back(ignore_entry_vec.size());
+		node_vec[node_idx].ignore_file = true;
 	}
-
-	ignore_entry_vec.push_back(ignore_ent_buf);
-	ignore_entry_vec.back().sub_path_vec = std::move(sub_path_vec_buf);
 	
 	return 1;
 }
 
 bool
-IgnoreList::MatchIgnore(const QString& matchee_path) {
+IgnoreList::MatchIgnore(const QString& matchee_path) const {
+	return MatchPath(matchee_path, false);
+}
 
-	//NOTE: machee_path dir separator is backslah (\) due to windows convention
-	QStringList sub_path_list = matchee_path.split("\\", QString::SkipEmptyParts);
+bool	
+IgnoreList::MatchIgnoreDir(const QString& matchee_dir_path) const {
+	return MatchPath(matchee_dir_path, true);
+}
 
-	//get the matching entries' indexes of first sub path
-	QList<int> entry_index_list;
-	if (concrete_to_index_list_table.contains(sub_path_list[0])) {
-		entry_index_list = concrete_to_index_list_table.value(sub_path_list[0]);
-	}
+IgnoreDirState
+IgnoreList::GetDirState(const QString& dir_path) const {
+
+	IgnoreDirState state;
+	state.node_list.append(0);
 
-	//try match with wildcard indexs 
-	for (auto iter = wildcard_to_index_list_table.begin(); iter != wildcard_to_index_list_table.end(); iter++) {
-		if (MatchWildcard(iter.key(), sub_path_list[0])) {
-			entry_index_list.append(iter.value());
+	//NOTE: dir separator is backslash (\) due to windows convention
+	int begin = 0;
+	while (begin < dir_path.size()) {
+		int end = dir_path.indexOf('\\', begin);
+		if (end < 0) {
+			end = dir_path.size();
 		}
+
+		if (end > begin) {
+			IgnoreNodeList next_list;
+			bool dir_hit = false;
+			bool file_hit = false;
+
+			MatchComponent(state.node_list, dir_path.constData() + begin, end - begin, &next_list, &dir_hit, &file_hit);
+
+			state.node_list = next_list;
+			state.ignored = state.ignored || dir_hit;
+		}
+
+		begin = end + 1;
 	}
 
-	//first subpath did not match anything means matchee is not in ignore list
-	if (entry_index_list.size() == 0) {
+	return state;
+}
+
+bool
+IgnoreList::MatchIgnore(const IgnoreDirState& dir_state, const QString& file_name) const {
+
+	if (dir_state.ignored) {
+		return true;
+	}
+
+	if (dir_state.node_list.isEmpty()) {
 		return false;
 	}
 
+	IgnoreNodeList next_list;
+	bool dir_hit = false;
+	bool file_hit = false;
 
-	QList<int> new_entry_index_list;
-	for (int i = 0; i < sub_path_list.size(); i++) {
-		for (int entry_index : entry_index_list) {
+	MatchComponent(dir_state.node_list, file_name.constData(), file_name.size(), &next_list, &dir_hit, &file_hit);
+	return file_hit;
+}
 
-			//we are at the end of this ignore entry
-			if (ignore_entry_vec[entry_index].sub_path_vec.size() - 1 == i) {
+bool
+IgnoreList::MatchIgnoreDir(const IgnoreDirState& parent_state, const QString& dir_name, IgnoreDirState* state_out) const {
 
-				//this ignore entry ignores a dir so we check if matchee is also within this dir
-				if (ignore_entry_vec[entry_index].ignore_dir) {
+	state_out->node_list.clear();
+	state_out->ignored = parent_state.ignored;
 
-					//last sub path of matchee means we are looking at a file not a dir
-					if (i == sub_path_list.size() - 1) {
-						continue;
-					}
+	//nothing in the trie reaches below parent, every dir under it is kept without looking at its name
+	if (parent_state.ignored || parent_state.node_list.isEmpty()) {
+		return parent_state.ignored;
+	}
 
-					if (MatchWildcard(ignore_entry_vec[entry_index].sub_path_vec[i], sub_path_list[i])) {
-						return true;
-					}
+	bool dir_hit = false;
+	bool file_hit = false;
 
-					//it doesnt, move onto next entry
-					continue;
-				}
+	MatchComponent(parent_state.node_list, dir_name.constData(), dir_name.size(), &state_out->node_list, &dir_hit, &file_hit);
 
-				//this ignore entry ignores a file
-				
-				if (i != sub_path_list.size() - 1) {
-					//matchee is deeper than current path depth
-					continue;
-				}
+	state_out->ignored = dir_hit;
+	return dir_hit;
+}
+
+void
+IgnoreList::Reset() {
+
+	node_vec.clear();
+	node_vec.push_back(Node());
+}
 
-				if (MatchWildcard(ignore_entry_vec[entry_index].sub_path_vec[i], sub_path_list[i])) {
-					return true;
-				}
-				continue;
-			}
 
-			if (MatchWildcard(ignore_entry_vec[entry_index].sub_path_vec[i], sub_path_list[i])) {
-				new_entry_index_list.append(entry_index);
+//private
+
+int
+IgnoreList::AddChild(int node_idx, const QString& component) {
+
+	if (IsConcrete(component)) {
+		uint hash = ComponentHash(component.constData(), component.size());
+
+		for (auto iter = node_vec[node_idx].literal_child_table.constFind(hash); iter != node_vec[node_idx].literal_child_table.constEnd() && iter.key() == hash; iter++) {
+			if (node_vec[iter.value()].component == component) {
+				return iter.value();
 			}
 		}
 
-		//no more entries to continue matching means matchee should not be ignored
-		if (new_entry_index_list.size() == 0) {
-			return false;
-		}
+		Node child;
+		child.component = component;
+		node_vec.push_back(child);
 
-		entry_index_list = std::move(new_entry_index_list);
-		new_entry_index_list.clear();
+		node_vec[node_idx].literal_child_table.insert(hash, node_vec.size() - 1);
+		return node_vec.size() - 1;
 	}
 
-	return false;
+	for (int child_idx : node_vec[node_idx].wildcard_child_vec) {
+		if (node_vec[child_idx].component == component) {
+			return child_idx;
+		}
+	}
+
+	Node child;
+	child.component = component;
+	child.glob = IgnoreGlob(component);
+	node_vec.push_back(child);
+
+	node_vec[node_idx].wildcard_child_vec.push_back(node_vec.size() - 1);
+	return node_vec.size() - 1;
 }
 
-bool	
-IgnoreList::MatchIgnoreDir(const QString& matchee_dir_path) {
-	//NOTE: machee_path dir separator is backslah (\) due to windows convention
-	QStringList sub_path_list = matchee_dir_path.split("\\", QString::SkipEmptyParts);
+void
+IgnoreList::MatchComponent(const IgnoreNodeList& node_list, const QChar* str, int size, IgnoreNodeList* next_list, bool* dir_out, bool* file_out) const {
 
-	//get the matching entries' indexes of first sub path
-	QList<int> entry_index_list;
-	if (concrete_to_index_list_table.contains(sub_path_list[0])) {
+	uint hash = ComponentHash(str, size);
 
-		for (int idx : concrete_to_index_list_table.value(sub_path_list[0])) {
-			if (ignore_entry_vec[idx].ignore_dir) {
-				entry_index_list.append(idx);
-			}
-		 }
-	}
+	auto visit = [&](int child_idx) {
+		const Node& child = node_vec[child_idx];
+
+		*dir_out = *dir_out || child.ignore_dir;
+		*file_out = *file_out || child.ignore_file;
+
+		//leaf has nothing further to match
+		if (!child.literal_child_table.isEmpty() || !child.wildcard_child_vec.isEmpty()) {
+			next_list->append(child_idx);
+		}
+	};
+
+	for (int node_idx : node_list) {
+		const Node& node = node_vec[node_idx];
 
-	//try match with wildcard indexs 
-	for (auto iter = wildcard_to_index_list_table.begin(); iter != wildcard_to_index_list_table.end(); iter++) {
-		if (MatchWildcard(iter.key(), sub_path_list[0])) {
+		for (auto iter = node.literal_child_table.constFind(hash); iter != node.literal_child_table.constEnd() && iter.key() == hash; iter++) {
+			const QString& component = node_vec[iter.value()].component;
 
-			for (int idx : iter.value()) {
-				if (ignore_entry_vec[idx].ignore_dir) {
-					entry_index_list.append(idx);
-				}
+			if (component.size() == size && std::equal(component.constData(), component.constData() + size, str)) {
+				visit(iter.value());
+			}
+		}
+
+		for (int child_idx : node.wildcard_child_vec) {
+			if (node_vec[child_idx].glob.Match(str, size)) {
+				visit(child_idx);
 			}
 		}
 	}
+}
 
-	//first subpath did not match anything means matchee is not in ignore list
-	if (entry_index_list.size() == 0) {
-		return false;
+bool
+IgnoreList::MatchPath(const QString& path, bool last_is_dir) const {
+
+	IgnoreNodeList curr_list;
+	IgnoreNodeList next_list;
+	curr_list.append(0);
+
+	//NOTE: path separator is backslash (\) due to windows convention
+	int begin = 0;
+	while (begin < path.size() && path[begin] == '\\') {
+		begin++;
 	}
 
-	QList<int> new_entry_index_list;
-	for (int i = 0; i < sub_path_list.size(); i++) {
-		for (int entry_index : entry_index_list) {
+	while (begin < path.size() && !curr_list.isEmpty()) {
+
+		int end = path.indexOf('\\', begin);
+		if (end < 0) {
+			end = path.size();
+		}
 
-			//we are at the end of this ignore entry
-			if (ignore_entry_vec[entry_index].sub_path_vec.size() - 1 == i) {
+		int next_begin = end;
+		while (next_begin < path.size() && path[next_begin] == '\\') {
+			next_begin++;
+		}
 
-				//if path component matches then the matchee is to be ignored
-				if (MatchWildcard(ignore_entry_vec[entry_index].sub_path_vec[i], sub_path_list[i])) {
-					return true;
-				}
+		bool last = next_begin == path.size();
 
-				continue;
+		bool dir_hit = false;
+		bool file_hit = false;
 
-			}
+		next_list.clear();
+		MatchComponent(curr_list, path.constData() + begin, end - begin, &next_list, &dir_hit, &file_hit);
 
-			if (MatchWildcard(ignore_entry_vec[entry_index].sub_path_vec[i], sub_path_list[i])) {
-				new_entry_index_list.append(entry_index);
-			}
+		//a dir entry covers everything inside it, a file entry only the path that ends on it
+		if (dir_hit && (!last || last_is_dir)) {
+			return true;
 		}
 
-		//no more entries to continue matching means matchee should not be ignored
-		if (new_entry_index_list.size() == 0) {
-			return false;
+		if (file_hit && last && !last_is_dir) {
+			return true;
 		}
 
-		entry_index_list = std::move(new_entry_index_list);
-		
-		//probably redundant
-		new_entry_index_list.clear();
+		std::swap(curr_list, next_list);
+		begin = next_begin;
 	}
 
 	return false;
 }
-
-void
-IgnoreList::Reset() {
-
-	ignore_entry_vec.clear();
-	concrete_to_index_list_table.clear();
-	wildcard_to_index_list_table.clear();
-}
-
-
-//private
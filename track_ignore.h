@@ -4,6 +4,8 @@
 #include <QSet>
 #include <QVector>
 #include <QHash>
+#include <QMultiHash>
+#include <QVarLengthArray>
 #include <QFile>
 
 #include "logger.h"
@@ -23,6 +25,27 @@ struct IgnoreEntry {
 	bool				ignore_dir;
 };
 
+//trie nodes still matching, inline for the few entries most paths touch
+typedef QVarLengthArray<int, 8> IgnoreNodeList;
+
+//match state of a directory, walkers keep one per directory so children are matched from here instead of the root
+struct IgnoreDirState {
+	IgnoreNodeList		node_list;			//empty means nothing below this dir can be ignored
+	bool				ignored = false;	//this dir or one above it is ignored
+};
+
+//component pattern with wildcards, compiled once into the literal pieces between them
+class IgnoreGlob {
+public:
+	explicit IgnoreGlob(const QString& pattern = QString());
+
+	bool	Match(const QChar* str, int size) const;
+
+private:
+	QVector<QString>	piece_vec;
+	bool				star_begin;
+	bool				star_end;
+};
 
 class IgnoreList
 {
@@ -38,17 +61,37 @@ public:
 	int		LoadIgnoreFile(const QString& working_dir);
 	int		GenerateDefaultIgnoreFile(QFile& ignore_file, const QString& working_dir);
 	int		ParseIgnoreFileLine(const QString&);
-	bool	MatchIgnore(const QString& path);
-	bool	MatchIgnoreDir(const QString& dir_path);
+	bool	MatchIgnore(const QString& path) const;
+	bool	MatchIgnoreDir(const QString& dir_path) const;
+
+	//incremental matching for directory walkers
+	IgnoreDirState	GetDirState(const QString& dir_path) const;
+	bool			MatchIgnore(const IgnoreDirState& dir_state, const QString& file_name) const;
+	bool			MatchIgnoreDir(const IgnoreDirState& parent_state, const QString& dir_name, IgnoreDirState* state_out) const;
 	
 	void	Reset();
 
 private:
 
-	QVector<IgnoreEntry>		ignore_entry_vec;
+	//one path component of one or more entries, node 0 is the root
+	struct Node {
+		QString					component;
+		IgnoreGlob				glob;					//used when component has wildcards
+		QMultiHash<uint, int>	literal_child_table;	//component hash -> child idx
+		QVector<int>			wildcard_child_vec;
+		bool					ignore_file = false;	//an entry ends here naming a file
+		bool					ignore_dir = false;		//an entry ends here naming a dir
+	};
 
-	QHash<QString, QList<int>>	concrete_to_index_list_table;
-	QHash<QString, QList<int>>	wildcard_to_index_list_table;
+	QVector<Node>		node_vec;
 
-};
+	static uint		ComponentHash(const QChar* str, int size);
 
+	int		AddChild(int node_idx, const QString& component);
+
+	//children of node_list matching component go to next_list, ignore flags of the matched children are or'd in
+	void	MatchComponent(const IgnoreNodeList& node_list, const QChar* str, int size, IgnoreNodeList* next_list, bool* dir_out, bool* file_out) const;
+
+	//walks backslash separated path in place, last_is_dir tells how the last component is matched
+	bool	MatchPath(const QString& path, bool last_is_dir) const;
+};
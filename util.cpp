@@ -2,9 +2,8 @@
 #include "util.h"
 #include "error.h"
 #include "logger.h"
+#include "hash_engine.h"
 #include <memory>
-#include <QCryptographicHash>
-#include <QFile>
 #include <QStringBuilder>
 
 int
@@ -63,6 +62,21 @@ PathUtil::DirectoryExistsW(const std::wstring& abs_wpath) {
 	return true;
 }
 
+bool
+PathUtil::GetFileSizeW(const std::wstring& abs_wpath, qint64* size_out) {
+	WIN32_FILE_ATTRIBUTE_DATA attr_data;
+	if (!GetFileAttributesExW(abs_wpath.c_str(), GetFileExInfoStandard, &attr_data)) {
+		return false;
+	}
+
+	if (attr_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+		return false;
+	}
+
+	*size_out = ((qint64) attr_data.nFileSizeHigh << 32) | attr_data.nFileSizeLow;
+	return true;
+}
+
 //ugly piece of shit. do it better
 int
 PathUtil::GetCurrentDirectoryToWString(std::wstring *out) {
@@ -106,25 +120,13 @@ PathUtil::GetRelativePath(const std::wstring& abs_root_path, const std::wstring&
 
 int
 FileUtil::GetFileSHA2(const QString& abs_file_path, QString* hash_out) {
-	QCryptographicHash hasher(QCryptographicHash::Sha256);
-	QFile file(abs_file_path);
-	QByteArray buff;
-
-	if (!file.open(QIODevice::ReadOnly)) {
-		return -Error::QFILE_OPEN;
-		Logger::Log(QFILE_OPEN_MSG, LogEntry::LT_ERROR);
-	}
-
-	while (!file.atEnd()) {
-		buff = file.read(FILE_HASH_READ_BLOCK_SIZE);
-		hasher.addData(buff);
-	}
-
-	buff = std::move(hasher.result());
-	*hash_out = std::move(buff.toHex());
+	std::atomic_bool never_cancel(false);
+	return GetFileSHA2(abs_file_path, never_cancel, hash_out);
+}
 
-	file.close();
-	return 1;
+int
+FileUtil::GetFileSHA2(const QString& abs_file_path, const std::atomic_bool& cancel_flag, QString* hash_out) {
+	return HashEngine::FileSHA256(abs_file_path, cancel_flag, hash_out);
 }
 
 int
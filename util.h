@@ -2,11 +2,10 @@
 #include "media_structs.h"
 
 #include <string>
+#include <atomic>
 #include <QString>
 #include <Windows.h>
 
-#define FILE_HASH_READ_BLOCK_SIZE	4096	//default ntfs logical block size
-
 namespace PathUtil {
 
 	//Split string into Directory and Filename given (C)-string (W)ide char pointer
@@ -17,6 +16,9 @@ namespace PathUtil {
 	bool FileExistsW(const std::wstring&);
 	bool DirectoryExistsW(const std::wstring&);
 
+	//false if path does not exist or is a directory
+	bool GetFileSizeW(const std::wstring&, qint64* size_out);
+
 	//returned dir does not have trailing slash. eg: C:\foo\bar instead of C:\foo\bar(\)
 	int GetCurrentDirectoryToWString(std::wstring*);
 
@@ -28,6 +30,7 @@ namespace PathUtil {
 
 namespace FileUtil {
 	int GetFileSHA2(const QString& abs_file_path, QString* hash_out);
+	int GetFileSHA2(const QString& abs_file_path, const std::atomic_bool& cancel_flag, QString* hash_out);		//gives up between block reads once cancel flag is set
 	int GetFileSHA2(const QString& root_dir, const MediaInfo& media, QString* hash_out);			//spits out result in hex_hash
 	int GetFileSHA2(const QString& root_dir, MediaInfo& media);									//the result is in media.hash
 }
\ No newline at end of file